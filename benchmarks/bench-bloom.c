@@ -0,0 +1,118 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Measures cvs_hashmap_contains_key() on a blocklist-style workload, where
+ * 9 lookups in 10 are for keys that are not in the map, with and without
+ * CHF__BLOOM_FILTER, for uint64_t and string keys.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cvs-hashmap.h"
+#include "bench-common.h"
+
+#define KEYS        1000000
+#define LOOKUPS     2000000
+
+/* The keys looked up are copied out in lookup order, so fetching them is a
+ * sequential read and only the map's own cache misses are timed. */
+static void run(const char *name, cvs_hashmap_type_t type, unsigned flags,
+                void **keys, void **absent, size_t key_size)
+{
+    cvs_hashmap_t hashmap;
+    cvs_hashmap_stats_t stats;
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    uint64_t start, ns;
+    size_t i, hits;
+    char *probes;
+
+    probes = (char*) malloc(LOOKUPS * key_size);
+    if (NULL == probes) {
+        return;
+    }
+    for (i = 0; i < LOOKUPS; i++) {
+        uint64_t r = bench_rand(&state);
+        void *key = (0 == r % 10) ? keys[(r >> 8) % KEYS] : absent[(r >> 8) % KEYS];
+
+        memcpy(&probes[i * key_size], key, key_size);
+    }
+
+    cvs_hashmap_init_ex(&hashmap, type, flags);
+    for (i = 0; i < KEYS; i++) {
+        cvs_hashmap_put(&hashmap, keys[i], keys[i]);
+    }
+
+    hits = 0;
+    start = bench_now();
+    for (i = 0; i < LOOKUPS; i++) {
+        hits += cvs_hashmap_contains_key(&hashmap, &probes[i * key_size]);
+    }
+    ns = bench_now() - start;
+    bench_consume(&hits);
+
+    cvs_hashmap_stats(&hashmap, &stats);
+    printf("%-20s %10.2f %12zu %12.5f\n", name, (double) ns / LOOKUPS,
+           stats.bloom_bytes, stats.bloom_false_positive_rate);
+    cvs_hashmap_destroy(&hashmap);
+    free(probes);
+}
+
+int main(void)
+{
+    uint64_t *numbers;
+    char (*strings)[24];
+    void **u64_keys, **string_keys;
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    size_t i;
+
+    numbers = (uint64_t*) malloc(2 * KEYS * sizeof(uint64_t));
+    strings = malloc(2 * KEYS * sizeof(*strings));
+    u64_keys = (void**) malloc(2 * KEYS * sizeof(void*));
+    string_keys = (void**) malloc(2 * KEYS * sizeof(void*));
+    if ((NULL == numbers) || (NULL == strings) || (NULL == u64_keys) ||
+        (NULL == string_keys))
+    {
+        return 1;
+    }
+    for (i = 0; i < 2 * KEYS; i++) {
+        numbers[i] = bench_rand(&state);
+        snprintf(strings[i], sizeof(strings[i]), "dev-%016llx",
+                 (unsigned long long) numbers[i]);
+        u64_keys[i] = &numbers[i];
+        string_keys[i] = strings[i];
+    }
+
+    printf("90%% misses       ns/contains  filter bytes   false pos.\n");
+    run("uint64", CHT__UINT64, CHF__NONE, u64_keys, &u64_keys[KEYS],
+        sizeof(uint64_t));
+    run("uint64 + filter", CHT__UINT64, CHF__BLOOM_FILTER, u64_keys, &u64_keys[KEYS],
+        sizeof(uint64_t));
+    run("string", CHT__STRING, CHF__NONE, string_keys, &string_keys[KEYS],
+        sizeof(*strings));
+    run("string + filter", CHT__STRING, CHF__BLOOM_FILTER, string_keys, &string_keys[KEYS],
+        sizeof(*strings));
+
+    free(string_keys);
+    free(u64_keys);
+    free(strings);
+    free(numbers);
+
+    return 0;
+}
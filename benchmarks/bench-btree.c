@@ -0,0 +1,192 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Compares cvs_btree with cvs_hashmap for uint64_t keys: loading and point
+ * lookups, then the ordered queries the hashmap can only answer by
+ * iterating every pair.  A range [a, b) on the hashmap collects the keys in
+ * range and sorts them; "the next key after k" keeps the smallest key above
+ * k seen during the iteration.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cvs-btree.h"
+#include "cvs-hashmap.h"
+#include "bench-common.h"
+
+#define KEYS            1000000
+#define RANGE_KEYS      100         /* keys per range query, on average */
+#define BTREE_QUERIES   100000
+#define HASHMAP_QUERIES 20
+
+typedef struct {
+    uint64_t from;
+    uint64_t to;
+    uint64_t *found;
+    size_t count;
+} collect_t;
+
+typedef struct {
+    uint64_t after;
+    uint64_t next;
+    bool seen;
+} next_t;
+
+static bool count_range(uint64_t key, void *value, void *user_data)
+{
+    (void) value;
+    ((collect_t*) user_data)->found[((collect_t*) user_data)->count++] = key;
+
+    return true;
+}
+
+static bool collect_range(void *key, void *value, void *user_data)
+{
+    collect_t *c = (collect_t*) user_data;
+    uint64_t k = *((uint64_t*) key);
+
+    (void) value;
+    if ((c->from <= k) && (k < c->to)) {
+        c->found[c->count++] = k;
+    }
+
+    return true;
+}
+
+static bool find_next(void *key, void *value, void *user_data)
+{
+    next_t *n = (next_t*) user_data;
+    uint64_t k = *((uint64_t*) key);
+
+    (void) value;
+    if ((n->after < k) && (!n->seen || (k < n->next))) {
+        n->next = k;
+        n->seen = true;
+    }
+
+    return true;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *((const uint64_t*) a);
+    uint64_t y = *((const uint64_t*) b);
+
+    return (x > y) - (x < y);
+}
+
+int main(void)
+{
+    cvs_btree_t btree;
+    cvs_btree_cursor_t cursor;
+    cvs_hashmap_t hashmap;
+    collect_t collect;
+    next_t next;
+    uint64_t *keys, span, start, ns, key;
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    size_t i, found;
+
+    keys = (uint64_t*) malloc(KEYS * sizeof(uint64_t));
+    collect.found = (uint64_t*) malloc(KEYS * sizeof(uint64_t));
+    if ((NULL == keys) || (NULL == collect.found)) {
+        return 1;
+    }
+    for (i = 0; i < KEYS; i++) {
+        keys[i] = bench_rand(&state);
+    }
+    span = UINT64_MAX / KEYS * RANGE_KEYS;
+
+    printf("%zu keys                 btree      hashmap\n", (size_t) KEYS);
+
+    cvs_btree_init(&btree);
+    start = bench_now();
+    for (i = 0; i < KEYS; i++) {
+        cvs_btree_put(&btree, keys[i], &keys[i]);
+    }
+    ns = bench_now() - start;
+    cvs_hashmap_init(&hashmap, CHT__UINT64);
+    start = bench_now();
+    for (i = 0; i < KEYS; i++) {
+        cvs_hashmap_put(&hashmap, &keys[i], &keys[i]);
+    }
+    printf("ns/put              %10.1f %12.1f\n", (double) ns / KEYS,
+           (double) (bench_now() - start) / KEYS);
+
+    start = bench_now();
+    for (i = 0; i < KEYS; i++) {
+        bench_consume(cvs_btree_get(&btree, keys[(i * 7919) % KEYS]));
+    }
+    ns = bench_now() - start;
+    start = bench_now();
+    for (i = 0; i < KEYS; i++) {
+        bench_consume(cvs_hashmap_get(&hashmap, &keys[(i * 7919) % KEYS]));
+    }
+    printf("ns/get              %10.1f %12.1f\n", (double) ns / KEYS,
+           (double) (bench_now() - start) / KEYS);
+
+    /* Range queries, both sides collect the keys in order. */
+    found = 0;
+    start = bench_now();
+    for (i = 0; i < BTREE_QUERIES; i++) {
+        collect.from = bench_rand(&state);
+        collect.to = (collect.from < UINT64_MAX - span) ? collect.from + span : UINT64_MAX;
+        collect.count = 0;
+        cvs_btree_range(&btree, collect.from, collect.to, count_range, &collect);
+        found += collect.count;
+    }
+    ns = bench_now() - start;
+    printf("us/range            %10.2f", (double) ns / BTREE_QUERIES / 1000.0);
+    start = bench_now();
+    for (i = 0; i < HASHMAP_QUERIES; i++) {
+        collect.from = bench_rand(&state);
+        collect.to = (collect.from < UINT64_MAX - span) ? collect.from + span : UINT64_MAX;
+        collect.count = 0;
+        cvs_hashmap_iterate(&hashmap, collect_range, &collect);
+        qsort(collect.found, collect.count, sizeof(uint64_t), compare_u64);
+    }
+    printf(" %12.2f   (%.1f keys per range)\n",
+           (double) (bench_now() - start) / HASHMAP_QUERIES / 1000.0,
+           (double) found / BTREE_QUERIES);
+
+    /* The next key after a random one. */
+    start = bench_now();
+    for (i = 0; i < BTREE_QUERIES; i++) {
+        if (cvs_btree_upper_bound(&btree, bench_rand(&state), &cursor)) {
+            cvs_btree_cursor_next(&cursor, &key, NULL);
+            bench_consume(&key);
+        }
+    }
+    ns = bench_now() - start;
+    printf("us/next             %10.2f", (double) ns / BTREE_QUERIES / 1000.0);
+    start = bench_now();
+    for (i = 0; i < HASHMAP_QUERIES; i++) {
+        next.after = bench_rand(&state);
+        next.seen = false;
+        cvs_hashmap_iterate(&hashmap, find_next, &next);
+        bench_consume(&next);
+    }
+    printf(" %12.2f\n", (double) (bench_now() - start) / HASHMAP_QUERIES / 1000.0);
+
+    cvs_hashmap_destroy(&hashmap);
+    cvs_btree_destroy(&btree);
+    free(collect.found);
+    free(keys);
+
+    return 0;
+}
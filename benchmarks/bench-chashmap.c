@@ -0,0 +1,127 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Compares cvs_chashmap against a cvs_hashmap behind one global mutex with a
+ * 90% get / 10% put mix of uint64 keys, at 1 to 16 threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "cvs-hashmap.h"
+#include "cvs-chashmap.h"
+#include "bench-common.h"
+
+#define KEYS            (1 << 20)
+#define OPS_PER_THREAD  (1 << 21)
+#define MAX_THREADS     16
+
+typedef struct {
+    bool concurrent;
+    uint64_t seed;
+} worker_arg_t;
+
+static cvs_hashmap_t locked_map;
+static pthread_mutex_t locked_map_lock = PTHREAD_MUTEX_INITIALIZER;
+static cvs_chashmap_t concurrent_map;
+static uint64_t *keys;
+
+static void *worker(void *p)
+{
+    worker_arg_t *arg = (worker_arg_t*) p;
+    uint64_t state = arg->seed;
+    size_t i;
+
+    for (i = 0; i < OPS_PER_THREAD; i++) {
+        uint64_t r = bench_rand(&state);
+        uint64_t *key = &keys[r % KEYS];
+
+        if (arg->concurrent) {
+            if (0 == (r >> 60) % 10) {
+                cvs_chashmap_put(&concurrent_map, key, key);
+            } else {
+                bench_consume(cvs_chashmap_get(&concurrent_map, key));
+            }
+        } else {
+            pthread_mutex_lock(&locked_map_lock);
+            if (0 == (r >> 60) % 10) {
+                cvs_hashmap_put(&locked_map, key, key);
+            } else {
+                bench_consume(cvs_hashmap_get(&locked_map, key));
+            }
+            pthread_mutex_unlock(&locked_map_lock);
+        }
+    }
+
+    return NULL;
+}
+
+static double run(bool concurrent, int threads)
+{
+    pthread_t tid[MAX_THREADS];
+    worker_arg_t args[MAX_THREADS];
+    uint64_t start;
+    int i;
+
+    start = bench_now();
+    for (i = 0; i < threads; i++) {
+        args[i].concurrent = concurrent;
+        args[i].seed = 0x9e3779b97f4a7c15ULL * (i + 1);
+        pthread_create(&tid[i], NULL, worker, &args[i]);
+    }
+    for (i = 0; i < threads; i++) {
+        pthread_join(tid[i], NULL);
+    }
+
+    /* Millions of operations per second. */
+    return (double) threads * OPS_PER_THREAD * 1000.0 / (double) (bench_now() - start);
+}
+
+int main(void)
+{
+    size_t i;
+    int threads;
+
+    keys = (uint64_t*) malloc(KEYS * sizeof(uint64_t));
+    if (NULL == keys) {
+        return 1;
+    }
+
+    cvs_hashmap_init(&locked_map, CHT__UINT64);
+    cvs_chashmap_init(&concurrent_map, CHT__UINT64);
+    for (i = 0; i < KEYS; i++) {
+        keys[i] = i * 0x9e3779b97f4a7c15ULL;
+        cvs_hashmap_put(&locked_map, &keys[i], &keys[i]);
+        cvs_chashmap_put(&concurrent_map, &keys[i], &keys[i]);
+    }
+
+    printf("threads  mutex+cvs_hashmap Mops/s  cvs_chashmap Mops/s\n");
+    for (threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        double locked = run(false, threads);
+        double concurrent = run(true, threads);
+
+        printf("%7d  %22.2f  %19.2f\n", threads, locked, concurrent);
+    }
+
+    cvs_hashmap_destroy(&locked_map);
+    cvs_chashmap_destroy(&concurrent_map);
+    free(keys);
+
+    return 0;
+}
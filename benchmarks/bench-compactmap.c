@@ -0,0 +1,86 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Compares full map iteration of cvs_hashmap and cvs_compactmap with uint64
+ * keys, the telemetry pattern of walking every entry every few seconds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cvs-hashmap.h"
+#include "cvs-compactmap.h"
+#include "bench-common.h"
+
+#define KEYS    (1 << 20)
+#define PASSES  20
+
+static bool sum_iterator(void *key, void *value, void *user_data)
+{
+    *((uint64_t*) user_data) += CVSHM_KEY_TO_UINT64(key);
+    bench_consume(value);
+
+    return true;
+}
+
+int main(void)
+{
+    cvs_hashmap_t hashmap;
+    cvs_compactmap_t compactmap;
+    uint64_t *keys;
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    uint64_t start, sum, hashmap_ns, compactmap_ns;
+    size_t i;
+
+    keys = (uint64_t*) malloc(KEYS * sizeof(uint64_t));
+    if (NULL == keys) {
+        return 1;
+    }
+
+    cvs_hashmap_init(&hashmap, CHT__UINT64);
+    cvs_compactmap_init(&compactmap, CHT__UINT64);
+    for (i = 0; i < KEYS; i++) {
+        keys[i] = bench_rand(&state);
+        cvs_hashmap_put(&hashmap, &keys[i], &keys[i]);
+        cvs_compactmap_put(&compactmap, &keys[i], &keys[i]);
+    }
+
+    sum = 0;
+    start = bench_now();
+    for (i = 0; i < PASSES; i++) {
+        cvs_hashmap_iterate(&hashmap, sum_iterator, &sum);
+    }
+    hashmap_ns = bench_now() - start;
+
+    start = bench_now();
+    for (i = 0; i < PASSES; i++) {
+        cvs_compactmap_iterate(&compactmap, sum_iterator, &sum);
+    }
+    compactmap_ns = bench_now() - start;
+    bench_consume(&sum);
+
+    printf("map             ns/entry iterated\n");
+    printf("cvs_hashmap     %17.2f\n", (double) hashmap_ns / ((double) KEYS * PASSES));
+    printf("cvs_compactmap  %17.2f\n", (double) compactmap_ns / ((double) KEYS * PASSES));
+
+    cvs_hashmap_destroy(&hashmap);
+    cvs_compactmap_destroy(&compactmap);
+    free(keys);
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Compares readers of a cvs_cowmap with readers of one cvs_hashmap behind a
+ * pthread_rwlock, from 1 to MAX_THREADS reader threads, by the gets per second
+ * of all readers together.  Each reader does LOOKUPS gets of random keys,
+ * taking the lock (or acquiring a version) for every get, while one writer
+ * changes a key every WRITE_EVERY_US microseconds: under the write lock for
+ * the rwlock map, by copying and publishing a whole version for the cowmap.
+ * The writes column shows how many writes got through meanwhile; readers of
+ * the rwlock map can keep its writer out, the cowmap's writer never waits.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "cvs-cowmap.h"
+#include "bench-common.h"
+
+#define KEYS            (1 << 16)
+#define LOOKUPS         (1 << 20)
+#define MAX_THREADS     8
+#define WRITE_EVERY_US  1000
+
+typedef struct {
+    uint64_t seed;
+} reader_arg_t;
+
+static uint64_t keys[KEYS];
+static cvs_cowmap_t cowmap;
+static cvs_hashmap_t locked;
+static pthread_rwlock_t rwlock;
+static int done;
+static size_t writes;
+
+static void *cow_reader(void *p)
+{
+    reader_arg_t *arg = (reader_arg_t*) p;
+    cvs_cowmap_reader_t *reader = cvs_cowmap_reader_new(&cowmap);
+    uint64_t state = arg->seed;
+    size_t i;
+
+    for (i = 0; i < LOOKUPS; i++) {
+        cvs_hashmap_t *version = cvs_cowmap_acquire(reader);
+
+        bench_consume(cvs_hashmap_get(version, &keys[bench_rand(&state) % KEYS]));
+        cvs_cowmap_release(reader);
+    }
+    cvs_cowmap_reader_free(reader);
+
+    return NULL;
+}
+
+static void *cow_writer(void *p)
+{
+    size_t n = 0;
+
+    (void) p;
+    while (0 == __atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+        cvs_hashmap_t *version = cvs_cowmap_copy(&cowmap);
+
+        cvs_hashmap_put(version, &keys[n % KEYS], (void*) (uintptr_t) n);
+        cvs_cowmap_publish(&cowmap, version);
+        n++;
+        usleep(WRITE_EVERY_US);
+    }
+    writes = n;
+
+    return NULL;
+}
+
+static void *rw_reader(void *p)
+{
+    reader_arg_t *arg = (reader_arg_t*) p;
+    uint64_t state = arg->seed;
+    size_t i;
+
+    for (i = 0; i < LOOKUPS; i++) {
+        pthread_rwlock_rdlock(&rwlock);
+        bench_consume(cvs_hashmap_get(&locked, &keys[bench_rand(&state) % KEYS]));
+        pthread_rwlock_unlock(&rwlock);
+    }
+
+    return NULL;
+}
+
+static void *rw_writer(void *p)
+{
+    size_t n = 0;
+
+    (void) p;
+    while (0 == __atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+        pthread_rwlock_wrlock(&rwlock);
+        cvs_hashmap_put(&locked, &keys[n % KEYS], (void*) (uintptr_t) n);
+        pthread_rwlock_unlock(&rwlock);
+        n++;
+        usleep(WRITE_EVERY_US);
+    }
+    writes = n;
+
+    return NULL;
+}
+
+/* Runs the readers against one writer, returns the millions of gets per
+ * second done by all the readers together. */
+static double run(size_t threads, void *(*reader)(void*), void *(*writer)(void*))
+{
+    pthread_t tids[MAX_THREADS], wtid;
+    reader_arg_t args[MAX_THREADS];
+    uint64_t start, ns;
+    size_t i;
+
+    done = 0;
+    pthread_create(&wtid, NULL, writer, NULL);
+    start = bench_now();
+    for (i = 0; i < threads; i++) {
+        args[i].seed = 0x9e3779b97f4a7c15ULL * (i + 1);
+        pthread_create(&tids[i], NULL, reader, &args[i]);
+    }
+    for (i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    ns = bench_now() - start;
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+    pthread_join(wtid, NULL);
+
+    return (double) threads * LOOKUPS * 1000.0 / (double) ns;
+}
+
+int main(void)
+{
+    cvs_hashmap_t *version;
+    size_t i, threads;
+
+    version = (cvs_hashmap_t*) malloc(sizeof(cvs_hashmap_t));
+    if ((NULL == version) ||
+        (false == cvs_cowmap_init(&cowmap, MAX_THREADS, NULL, NULL)) ||
+        (false == cvs_hashmap_init(version, CHT__UINT64)) ||
+        (false == cvs_hashmap_init(&locked, CHT__UINT64)))
+    {
+        return 1;
+    }
+    pthread_rwlock_init(&rwlock, NULL);
+
+    for (i = 0; i < KEYS; i++) {
+        keys[i] = i * 0x9e3779b97f4a7c15ULL;
+        cvs_hashmap_put(version, &keys[i], &keys[i]);
+        cvs_hashmap_put(&locked, &keys[i], &keys[i]);
+    }
+    cvs_cowmap_publish(&cowmap, version);
+
+    printf("readers   rwlock Mgets/s   writes   cowmap Mgets/s   writes\n");
+    for (threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        double rw_rate, cow_rate;
+        size_t rw_writes;
+
+        rw_rate = run(threads, rw_reader, rw_writer);
+        rw_writes = writes;
+        cow_rate = run(threads, cow_reader, cow_writer);
+        printf("%7zu   %14.2f %8zu   %14.2f %8zu\n", threads, rw_rate, rw_writes,
+               cow_rate, writes);
+    }
+
+    pthread_rwlock_destroy(&rwlock);
+    cvs_hashmap_destroy(&locked);
+    cvs_cowmap_destroy(&cowmap);
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Compares lookups in a mutable cvs_hashmap and the cvs_frozenmap made from
+ * it, for a small parameter-name style table up to one of 4 million keys,
+ * which also shows how the freeze time grows.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cvs-hashmap.h"
+#include "cvs-frozenmap.h"
+#include "bench-common.h"
+
+#define LOOKUPS (1 << 23)
+
+static void run(size_t count)
+{
+    cvs_hashmap_t map;
+    cvs_frozenmap_t frozen;
+    char (*keys)[32];
+    uint64_t start, state, freeze_ns;
+    double mutable_ns, frozen_ns;
+    size_t i;
+
+    keys = malloc(count * sizeof(*keys));
+    if (NULL == keys) {
+        return;
+    }
+
+    cvs_hashmap_init(&map, CHT__STRING);
+    for (i = 0; i < count; i++) {
+        sprintf(keys[i], "Device.Param.%zu.Value", i);
+        cvs_hashmap_put(&map, keys[i], keys[i]);
+    }
+
+    start = bench_now();
+    if (false == cvs_frozenmap_freeze(&frozen, &map)) {
+        printf("%9zu  freeze failed\n", count);
+        cvs_hashmap_destroy(&map);
+        free(keys);
+        return;
+    }
+    freeze_ns = bench_now() - start;
+
+    state = 0x9e3779b97f4a7c15ULL;
+    start = bench_now();
+    for (i = 0; i < LOOKUPS; i++) {
+        bench_consume(cvs_hashmap_get(&map, keys[bench_rand(&state) % count]));
+    }
+    mutable_ns = (double) (bench_now() - start) / LOOKUPS;
+
+    start = bench_now();
+    for (i = 0; i < LOOKUPS; i++) {
+        bench_consume(cvs_frozenmap_get(&frozen, keys[bench_rand(&state) % count]));
+    }
+    frozen_ns = (double) (bench_now() - start) / LOOKUPS;
+
+    printf("%9zu  %12.1f  %14.1f  %11.1f\n", count, mutable_ns, frozen_ns,
+           freeze_ns / 1e6);
+
+    cvs_frozenmap_destroy(&frozen);
+    cvs_hashmap_destroy(&map);
+    free(keys);
+}
+
+int main(void)
+{
+    printf("     keys  cvs_hashmap  cvs_frozenmap  freeze (ms)  (lookup ns)\n");
+    run(1000);
+    run(100000);
+    run(1000000);
+    run(4000000);
+
+    return 0;
+}
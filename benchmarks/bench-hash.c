@@ -0,0 +1,121 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Measures the rebar-hash functions for each key type, with the FNV-1a loop
+ * the maps used before as a reference for the byte hashes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rebar-hash.h"
+#include "bench-common.h"
+
+#define BYTES_PER_RUN   (256ULL << 20)
+#define INTS_PER_RUN    (64ULL << 20)
+
+static uint64_t fnv1a(const void *data, size_t length)
+{
+    const uint8_t *p = (const uint8_t*) data;
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    while (0 < length--) {
+        h ^= *p++;
+        h *= 0x100000001b3ULL;
+    }
+
+    return rebar_hash_mix64(h);
+}
+
+static void run_bytes(const uint8_t *buf, size_t length, uint64_t seed)
+{
+    uint64_t start, h, n, i;
+    double wy, fnv, crc;
+
+    n = BYTES_PER_RUN / length;
+
+    h = 0;
+    start = bench_now();
+    for (i = 0; i < n; i++) {
+        h += rebar_hash_bytes(&buf[i & 63], length, seed ^ h);
+    }
+    wy = (double) (bench_now() - start) / (double) n;
+    bench_consume(&h);
+
+    start = bench_now();
+    for (i = 0; i < n; i++) {
+        h += fnv1a(&buf[i & 63], length);
+    }
+    fnv = (double) (bench_now() - start) / (double) n;
+    bench_consume(&h);
+
+    start = bench_now();
+    for (i = 0; i < n; i++) {
+        h += rebar_hash_crc32c(&buf[i & 63], length, (uint32_t) h);
+    }
+    crc = (double) (bench_now() - start) / (double) n;
+    bench_consume(&h);
+
+    printf("bytes %6zu  %10.2f  %10.2f  %10.2f\n", length, wy, fnv, crc);
+}
+
+int main(void)
+{
+    uint8_t *buf;
+    uint64_t seed, start, h, i, state;
+    size_t lengths[] = { 8, 16, 32, 64, 256, 4096 };
+    size_t l;
+
+    buf = (uint8_t*) malloc(4096 + 64);
+    if (NULL == buf) {
+        return 1;
+    }
+    state = 0x9e3779b97f4a7c15ULL;
+    for (i = 0; i < 4096 + 64; i++) {
+        buf[i] = (uint8_t) bench_rand(&state);
+    }
+    seed = rebar_hash_seed();
+
+    printf("crc32c: %s\n", rebar_hash_crc32c_is_accelerated() ? "sse4.2" : "table");
+    printf("key          ns/hash\n");
+
+    h = 0;
+    start = bench_now();
+    for (i = 0; i < INTS_PER_RUN; i++) {
+        h += rebar_hash_u32((uint32_t) (i ^ h), seed);
+    }
+    printf("uint32       %10.2f\n", (double) (bench_now() - start) / (double) INTS_PER_RUN);
+    bench_consume(&h);
+
+    start = bench_now();
+    for (i = 0; i < INTS_PER_RUN; i++) {
+        h += rebar_hash_u64(i ^ h, seed);
+    }
+    printf("uint64       %10.2f\n", (double) (bench_now() - start) / (double) INTS_PER_RUN);
+    bench_consume(&h);
+
+    printf("\nkey           rebar_hash       FNV-1a     crc32c  (ns/hash)\n");
+    for (l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        run_bytes(buf, lengths[l], seed);
+    }
+
+    free(buf);
+
+    return 0;
+}
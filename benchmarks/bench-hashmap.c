@@ -0,0 +1,121 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Compares the ways of loading a cvs_hashmap with a known set of string keys,
+ * the pattern of reading a large config file at startup, and of counting
+ * occurrences of keys.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cvs-hashmap.h"
+#include "bench-common.h"
+
+#define KEYS    200000
+#define PASSES  10
+
+int main(void)
+{
+    cvs_hashmap_t hashmap;
+    char (*strings)[24];
+    void **keys;
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    uint64_t start, put_ns, reserve_ns, unique_ns, get_put_ns, slot_ns;
+    size_t i, pass;
+
+    strings = malloc(KEYS * sizeof(*strings));
+    keys = (void**) malloc(KEYS * sizeof(void*));
+    if ((NULL == strings) || (NULL == keys)) {
+        return 1;
+    }
+    for (i = 0; i < KEYS; i++) {
+        snprintf(strings[i], sizeof(strings[i]), "%016llx",
+                 (unsigned long long) bench_rand(&state));
+        keys[i] = strings[i];
+    }
+
+    put_ns = 0;
+    reserve_ns = 0;
+    unique_ns = 0;
+    for (pass = 0; pass < PASSES; pass++) {
+        start = bench_now();
+        cvs_hashmap_init(&hashmap, CHT__STRING);
+        for (i = 0; i < KEYS; i++) {
+            cvs_hashmap_put(&hashmap, keys[i], keys[i]);
+        }
+        put_ns += bench_now() - start;
+        bench_consume(&hashmap);
+        cvs_hashmap_destroy(&hashmap);
+
+        start = bench_now();
+        cvs_hashmap_init(&hashmap, CHT__STRING);
+        cvs_hashmap_reserve(&hashmap, KEYS);
+        for (i = 0; i < KEYS; i++) {
+            cvs_hashmap_put(&hashmap, keys[i], keys[i]);
+        }
+        reserve_ns += bench_now() - start;
+        bench_consume(&hashmap);
+        cvs_hashmap_destroy(&hashmap);
+
+        start = bench_now();
+        cvs_hashmap_init_from_arrays(&hashmap, CHT__STRING, CHF__NONE,
+                                     keys, keys, KEYS, true);
+        unique_ns += bench_now() - start;
+        bench_consume(&hashmap);
+        cvs_hashmap_destroy(&hashmap);
+    }
+
+    /* Count a stream where every key shows up PASSES times. */
+    start = bench_now();
+    cvs_hashmap_init(&hashmap, CHT__STRING);
+    for (pass = 0; pass < PASSES; pass++) {
+        for (i = 0; i < KEYS; i++) {
+            uintptr_t n = (uintptr_t) cvs_hashmap_get(&hashmap, keys[i]);
+
+            cvs_hashmap_put(&hashmap, keys[i], (void*) (n + 1));
+        }
+    }
+    get_put_ns = bench_now() - start;
+    cvs_hashmap_destroy(&hashmap);
+
+    start = bench_now();
+    cvs_hashmap_init(&hashmap, CHT__STRING);
+    for (pass = 0; pass < PASSES; pass++) {
+        for (i = 0; i < KEYS; i++) {
+            void **slot = cvs_hashmap_get_or_insert(&hashmap, keys[i], NULL);
+
+            *slot = (void*) ((uintptr_t) *slot + 1);
+        }
+    }
+    slot_ns = bench_now() - start;
+    cvs_hashmap_destroy(&hashmap);
+
+    printf("load                        ns/key\n");
+    printf("put                   %12.2f\n", (double) put_ns / ((double) KEYS * PASSES));
+    printf("reserve + put         %12.2f\n", (double) reserve_ns / ((double) KEYS * PASSES));
+    printf("init_from_arrays      %12.2f\n", (double) unique_ns / ((double) KEYS * PASSES));
+    printf("\ncount                       ns/key\n");
+    printf("get + put             %12.2f\n", (double) get_put_ns / ((double) KEYS * PASSES));
+    printf("get_or_insert         %12.2f\n", (double) slot_ns / ((double) KEYS * PASSES));
+
+    free(keys);
+    free(strings);
+
+    return 0;
+}
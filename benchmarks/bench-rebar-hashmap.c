@@ -0,0 +1,189 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Compares the generic cvs_hashmap with maps generated by
+ * REBAR_HASHMAP_DEFINE() for the same keys: inserts, lookups that hit and
+ * lookups that miss, for uint64_t and string keys.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cvs-hashmap.h"
+#include "rebar-hashmap.h"
+#include "bench-common.h"
+
+#define KEYS    200000
+#define PASSES  10
+
+REBAR_HASHMAP_DEFINE(u64map, uint64_t, void*, rebar_hash_u64, REBAR_HASHMAP_EQ)
+REBAR_HASHMAP_DEFINE(strmap, const char*, void*, rebar_hashmap_hash_string,
+                     rebar_hashmap_eq_string)
+
+static void print(const char *name, uint64_t put_ns, uint64_t hit_ns, uint64_t miss_ns)
+{
+    double n = (double) KEYS * PASSES;
+
+    printf("%-22s %10.2f %10.2f %10.2f\n", name, (double) put_ns / n,
+           (double) hit_ns / n, (double) miss_ns / n);
+}
+
+static void run_u64(const uint64_t *keys, const uint64_t *absent)
+{
+    cvs_hashmap_t hashmap;
+    u64map_t u64map;
+    uint64_t start, put_ns, hit_ns, miss_ns;
+    size_t i, pass;
+
+    put_ns = hit_ns = miss_ns = 0;
+    for (pass = 0; pass < PASSES; pass++) {
+        start = bench_now();
+        cvs_hashmap_init(&hashmap, CHT__UINT64);
+        for (i = 0; i < KEYS; i++) {
+            cvs_hashmap_put(&hashmap, (void*) &keys[i], (void*) &keys[i]);
+        }
+        put_ns += bench_now() - start;
+
+        start = bench_now();
+        for (i = 0; i < KEYS; i++) {
+            bench_consume(cvs_hashmap_get(&hashmap, (void*) &keys[i]));
+        }
+        hit_ns += bench_now() - start;
+
+        start = bench_now();
+        for (i = 0; i < KEYS; i++) {
+            bench_consume(cvs_hashmap_get(&hashmap, (void*) &absent[i]));
+        }
+        miss_ns += bench_now() - start;
+        cvs_hashmap_destroy(&hashmap);
+    }
+    print("cvs_hashmap uint64", put_ns, hit_ns, miss_ns);
+
+    put_ns = hit_ns = miss_ns = 0;
+    for (pass = 0; pass < PASSES; pass++) {
+        start = bench_now();
+        u64map_init(&u64map);
+        for (i = 0; i < KEYS; i++) {
+            u64map_put(&u64map, keys[i], (void*) &keys[i]);
+        }
+        put_ns += bench_now() - start;
+
+        start = bench_now();
+        for (i = 0; i < KEYS; i++) {
+            bench_consume(u64map_get(&u64map, keys[i]));
+        }
+        hit_ns += bench_now() - start;
+
+        start = bench_now();
+        for (i = 0; i < KEYS; i++) {
+            bench_consume(u64map_get(&u64map, absent[i]));
+        }
+        miss_ns += bench_now() - start;
+        u64map_destroy(&u64map);
+    }
+    print("generated uint64", put_ns, hit_ns, miss_ns);
+}
+
+static void run_string(char **keys, char **absent)
+{
+    cvs_hashmap_t hashmap;
+    strmap_t strmap;
+    uint64_t start, put_ns, hit_ns, miss_ns;
+    size_t i, pass;
+
+    put_ns = hit_ns = miss_ns = 0;
+    for (pass = 0; pass < PASSES; pass++) {
+        start = bench_now();
+        cvs_hashmap_init(&hashmap, CHT__STRING);
+        for (i = 0; i < KEYS; i++) {
+            cvs_hashmap_put(&hashmap, keys[i], keys[i]);
+        }
+        put_ns += bench_now() - start;
+
+        start = bench_now();
+        for (i = 0; i < KEYS; i++) {
+            bench_consume(cvs_hashmap_get(&hashmap, keys[i]));
+        }
+        hit_ns += bench_now() - start;
+
+        start = bench_now();
+        for (i = 0; i < KEYS; i++) {
+            bench_consume(cvs_hashmap_get(&hashmap, absent[i]));
+        }
+        miss_ns += bench_now() - start;
+        cvs_hashmap_destroy(&hashmap);
+    }
+    print("cvs_hashmap string", put_ns, hit_ns, miss_ns);
+
+    put_ns = hit_ns = miss_ns = 0;
+    for (pass = 0; pass < PASSES; pass++) {
+        start = bench_now();
+        strmap_init(&strmap);
+        for (i = 0; i < KEYS; i++) {
+            strmap_put(&strmap, keys[i], keys[i]);
+        }
+        put_ns += bench_now() - start;
+
+        start = bench_now();
+        for (i = 0; i < KEYS; i++) {
+            bench_consume(strmap_get(&strmap, keys[i]));
+        }
+        hit_ns += bench_now() - start;
+
+        start = bench_now();
+        for (i = 0; i < KEYS; i++) {
+            bench_consume(strmap_get(&strmap, absent[i]));
+        }
+        miss_ns += bench_now() - start;
+        strmap_destroy(&strmap);
+    }
+    print("generated string", put_ns, hit_ns, miss_ns);
+}
+
+int main(void)
+{
+    uint64_t *keys, *absent;
+    char (*strings)[24];
+    char **string_keys;
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    size_t i;
+
+    keys = (uint64_t*) malloc(2 * KEYS * sizeof(uint64_t));
+    strings = malloc(2 * KEYS * sizeof(*strings));
+    string_keys = (char**) malloc(2 * KEYS * sizeof(char*));
+    if ((NULL == keys) || (NULL == strings) || (NULL == string_keys)) {
+        return 1;
+    }
+    absent = &keys[KEYS];
+    for (i = 0; i < 2 * KEYS; i++) {
+        keys[i] = bench_rand(&state);
+        snprintf(strings[i], sizeof(strings[i]), "%016llx",
+                 (unsigned long long) keys[i]);
+        string_keys[i] = strings[i];
+    }
+
+    printf("                       ns/put     ns/hit    ns/miss\n");
+    run_u64(keys, absent);
+    run_string(string_keys, &string_keys[KEYS]);
+
+    free(string_keys);
+    free(strings);
+    free(keys);
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Measures how cvs_shardmap scales from 1 to 16 threads, one shard per
+ * thread.  Each thread gets its own keys and does a 90% get / 10% put mix:
+ * the gets are of keys in its own shard, the puts go to any key and are
+ * forwarded when another shard owns it.  Every thread drains its inbox every
+ * DRAIN_EVERY operations.  The work per thread is fixed, so perfect scaling
+ * is a total rate that grows with the thread count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "cvs-shardmap.h"
+#include "bench-common.h"
+
+#define KEYS_PER_SHARD  (1 << 16)
+#define OPS_PER_THREAD  (1 << 21)
+#define DRAIN_EVERY     256
+#define MAX_THREADS     16
+
+typedef struct {
+    size_t shard;
+    uint64_t seed;
+    uint64_t *local;        /* keys routed to this shard */
+    size_t local_count;
+} worker_arg_t;
+
+static cvs_shardmap_t map;
+static uint64_t *keys;
+static size_t key_count;
+static pthread_barrier_t barrier;
+
+static void *worker(void *p)
+{
+    worker_arg_t *arg = (worker_arg_t*) p;
+    uint64_t state = arg->seed;
+    size_t i;
+
+    pthread_barrier_wait(&barrier);
+    for (i = 0; i < OPS_PER_THREAD; i++) {
+        uint64_t r = bench_rand(&state);
+
+        if (0 == (r >> 60) % 10) {
+            uint64_t *key = &keys[r % key_count];
+
+            cvs_shardmap_put(&map, arg->shard, key, key);
+        } else {
+            uint64_t *key = &arg->local[r % arg->local_count];
+
+            bench_consume(cvs_shardmap_get(&map, arg->shard, key));
+        }
+        if (0 == i % DRAIN_EVERY) {
+            cvs_shardmap_drain(&map, arg->shard);
+        }
+    }
+    pthread_barrier_wait(&barrier);
+    cvs_shardmap_drain(&map, arg->shard);
+
+    return NULL;
+}
+
+static double run(int threads)
+{
+    pthread_t tid[MAX_THREADS];
+    worker_arg_t args[MAX_THREADS];
+    uint64_t start, elapsed;
+    size_t i;
+    int t;
+
+    key_count = (size_t) threads * KEYS_PER_SHARD;
+    cvs_shardmap_init(&map, CHT__UINT64, CHF__NONE, threads, NULL, NULL);
+    for (t = 0; t < threads; t++) {
+        args[t].shard = t;
+        args[t].seed = 0x9e3779b97f4a7c15ULL * (t + 1);
+        args[t].local = (uint64_t*) malloc(key_count * sizeof(uint64_t));
+        args[t].local_count = 0;
+    }
+    for (i = 0; i < key_count; i++) {
+        size_t shard = cvs_shardmap_route(&map, &keys[i]);
+
+        args[shard].local[args[shard].local_count++] = keys[i];
+        cvs_shardmap_put(&map, shard, &keys[i], &keys[i]);
+    }
+
+    pthread_barrier_init(&barrier, NULL, threads + 1);
+    for (t = 0; t < threads; t++) {
+        pthread_create(&tid[t], NULL, worker, &args[t]);
+    }
+    pthread_barrier_wait(&barrier);
+    start = bench_now();
+    pthread_barrier_wait(&barrier);
+    elapsed = bench_now() - start;
+    for (t = 0; t < threads; t++) {
+        pthread_join(tid[t], NULL);
+        free(args[t].local);
+    }
+    pthread_barrier_destroy(&barrier);
+    cvs_shardmap_destroy(&map);
+
+    /* Millions of operations per second. */
+    return (double) threads * OPS_PER_THREAD * 1000.0 / (double) elapsed;
+}
+
+int main(void)
+{
+    double single;
+    size_t i;
+    int threads;
+
+    keys = (uint64_t*) malloc(MAX_THREADS * KEYS_PER_SHARD * sizeof(uint64_t));
+    if (NULL == keys) {
+        return 1;
+    }
+    for (i = 0; i < MAX_THREADS * KEYS_PER_SHARD; i++) {
+        keys[i] = i * 0x9e3779b97f4a7c15ULL;
+    }
+
+    printf("threads  cvs_shardmap Mops/s  speedup\n");
+    single = 0.0;
+    for (threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        double rate = run(threads);
+
+        if (1 == threads) {
+            single = rate;
+        }
+        printf("%7d  %19.2f  %7.2f\n", threads, rate, rate / single);
+    }
+
+    free(keys);
+
+    return 0;
+}
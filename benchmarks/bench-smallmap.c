@@ -0,0 +1,99 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Measures many small CHT__UINT32 maps, the shape of per-device attribute
+ * sets: KEYS_PER_MAP keys each, looked up in a random map.  The inline
+ * layout is compared with the same maps forced into buckets by reserving
+ * room for more than CVSHM_SMALL_MAX keys up front.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cvs-hashmap.h"
+#include "bench-common.h"
+
+#define MAPS            20000
+#define KEYS_PER_MAP    5
+#define LOOKUPS         2000000
+
+static void run(const char *name, cvs_hashmap_t *maps, bool hashed)
+{
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    uint64_t start, put_ns, hit_ns, miss_ns;
+    uint32_t k;
+    size_t i;
+
+    start = bench_now();
+    for (i = 0; i < MAPS; i++) {
+        cvs_hashmap_init(&maps[i], CHT__UINT32);
+        if (hashed) {
+            cvs_hashmap_reserve(&maps[i], CVSHM_SMALL_MAX + 1);
+        }
+        for (k = 0; k < KEYS_PER_MAP; k++) {
+            uint32_t attr = k * 7 + 1;
+
+            cvs_hashmap_put(&maps[i], &attr, (void*) (uintptr_t) (attr + 1));
+        }
+    }
+    put_ns = bench_now() - start;
+
+    start = bench_now();
+    for (i = 0; i < LOOKUPS; i++) {
+        uint64_t r = bench_rand(&state);
+
+        k = (uint32_t) (r >> 32) % KEYS_PER_MAP * 7 + 1;
+        bench_consume(cvs_hashmap_get(&maps[r % MAPS], &k));
+    }
+    hit_ns = bench_now() - start;
+
+    start = bench_now();
+    for (i = 0; i < LOOKUPS; i++) {
+        uint64_t r = bench_rand(&state);
+
+        k = (uint32_t) (r >> 32) % KEYS_PER_MAP * 7 + 2;
+        bench_consume(cvs_hashmap_get(&maps[r % MAPS], &k));
+    }
+    miss_ns = bench_now() - start;
+
+    for (i = 0; i < MAPS; i++) {
+        cvs_hashmap_destroy(&maps[i]);
+    }
+
+    printf("%-10s %10.2f %10.2f %10.2f\n", name,
+           (double) put_ns / ((double) MAPS * KEYS_PER_MAP),
+           (double) hit_ns / LOOKUPS, (double) miss_ns / LOOKUPS);
+}
+
+int main(void)
+{
+    cvs_hashmap_t *maps;
+
+    maps = (cvs_hashmap_t*) malloc(MAPS * sizeof(cvs_hashmap_t));
+    if (NULL == maps) {
+        return 1;
+    }
+
+    printf("               ns/put     ns/hit    ns/miss\n");
+    run("inline", maps, false);
+    run("hashed", maps, true);
+
+    free(maps);
+
+    return 0;
+}
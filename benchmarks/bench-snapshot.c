@@ -0,0 +1,91 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Compares building a 1M entry string config map at start up against
+ * opening a snapshot of it, and the lookup cost of each.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cvs-hashmap.h"
+#include "cvs-snapshot.h"
+#include "bench-common.h"
+
+#define KEYS    (1 << 20)
+#define LOOKUPS (1 << 22)
+#define PATH    "bench-snapshot.snap"
+
+int main(void)
+{
+    cvs_hashmap_t map;
+    cvs_snapshot_t snap;
+    char (*keys)[24];
+    uint64_t start, build_ns, open_ns, state;
+    size_t i;
+
+    keys = malloc(KEYS * sizeof(*keys));
+    if (NULL == keys) {
+        return 1;
+    }
+    for (i = 0; i < KEYS; i++) {
+        sprintf(keys[i], "device-%08zx", i * 2654435761u);
+    }
+
+    start = bench_now();
+    cvs_hashmap_init(&map, CHT__STRING);
+    for (i = 0; i < KEYS; i++) {
+        cvs_hashmap_put(&map, keys[i], keys[i]);
+    }
+    build_ns = bench_now() - start;
+
+    if (false == cvs_snapshot_save(&map, PATH, NULL, NULL)) {
+        return 1;
+    }
+
+    start = bench_now();
+    if (false == cvs_snapshot_open(&snap, PATH)) {
+        return 1;
+    }
+    open_ns = bench_now() - start;
+
+    printf("start up: build map %.1f ms, open snapshot %.3f ms\n",
+           build_ns / 1e6, open_ns / 1e6);
+
+    state = 0x9e3779b97f4a7c15ULL;
+    start = bench_now();
+    for (i = 0; i < LOOKUPS; i++) {
+        bench_consume(cvs_hashmap_get(&map, keys[bench_rand(&state) % KEYS]));
+    }
+    printf("lookup: cvs_hashmap %.1f ns", (double) (bench_now() - start) / LOOKUPS);
+
+    start = bench_now();
+    for (i = 0; i < LOOKUPS; i++) {
+        bench_consume(cvs_snapshot_get(&snap, keys[bench_rand(&state) % KEYS], NULL));
+    }
+    printf(", cvs_snapshot %.1f ns\n", (double) (bench_now() - start) / LOOKUPS);
+
+    cvs_snapshot_close(&snap);
+    cvs_hashmap_destroy(&map);
+    unlink(PATH);
+    free(keys);
+
+    return 0;
+}
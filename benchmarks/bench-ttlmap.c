@@ -0,0 +1,73 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Measures what cvs_ttlmap_advance() costs as the map grows.  Every map has
+ * its deadlines spread so that about EXPIRE_PER_TICK entries expire per tick,
+ * so the work per tick is the same and only the number of waiting entries
+ * changes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cvs-ttlmap.h"
+#include "bench-common.h"
+
+#define EXPIRE_PER_TICK 100
+#define TICKS           100
+
+static void expire(void *key, void *value, void *user_data)
+{
+    (void) key;
+    (void) value;
+    (*((size_t*) user_data))++;
+}
+
+int main(void)
+{
+    size_t sizes[] = { 10000, 100000, 1000000, 0 };
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    size_t s;
+
+    printf("entries      ns/advance   ns/expired\n");
+    for (s = 0; 0 != sizes[s]; s++) {
+        cvs_ttlmap_t ttlmap;
+        uint64_t key, span, start, ns;
+        size_t expired;
+
+        expired = 0;
+        span = sizes[s] / EXPIRE_PER_TICK;
+        cvs_ttlmap_init(&ttlmap, CHT__UINT64, 0, expire, &expired);
+        for (key = 0; key < sizes[s]; key++) {
+            cvs_ttlmap_put(&ttlmap, &key, NULL, 1 + bench_rand(&state) % span);
+        }
+
+        start = bench_now();
+        for (key = 1; key <= TICKS; key++) {
+            cvs_ttlmap_advance(&ttlmap, key);
+        }
+        ns = bench_now() - start;
+
+        printf("%8zu   %12.1f %12.2f\n", sizes[s], (double) ns / TICKS,
+               (double) ns / (double) ((expired) ? expired : 1));
+        bench_consume(&ttlmap);
+        cvs_ttlmap_destroy(&ttlmap);
+    }
+
+    return 0;
+}
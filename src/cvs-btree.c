@@ -0,0 +1,804 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cvs-btree.h"
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+#define CACHE_LINE          64
+
+/* Both kinds of node are 4 cache lines: 15 keys and 15 values plus the chain
+ * pointer for a leaf, 15 keys and 16 children for an inner node. */
+#define CVSBT_LEAF_KEYS     15
+#define CVSBT_INNER_KEYS    15
+
+/* Every node but the root holds at least this many keys. */
+#define CVSBT_LEAF_MIN      (CVSBT_LEAF_KEYS / 2)
+#define CVSBT_INNER_MIN     (CVSBT_INNER_KEYS / 2)
+
+/* With at least 8 children per inner node 2^64 keys fit in 22 levels. */
+#define CVSBT_MAX_HEIGHT    32
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+/* The keys of a leaf are sorted, next is the leaf with the following keys. */
+struct __cvs_btree_leaf {
+    uint64_t keys[CVSBT_LEAF_KEYS];
+    void *values[CVSBT_LEAF_KEYS];
+    struct __cvs_btree_leaf *next;
+    uint32_t count;
+} __attribute__((aligned(CACHE_LINE)));
+
+typedef struct __cvs_btree_leaf cvs_btree_leaf_t;
+
+/* Every key under children[i] is below keys[i], and every key under
+ * children[i + 1] is at or above it.  Only count + 1 children are in use. */
+typedef struct {
+    uint64_t keys[CVSBT_INNER_KEYS];
+    uint32_t count;
+    void *children[CVSBT_INNER_KEYS + 1];
+} __attribute__((aligned(CACHE_LINE))) cvs_btree_inner_t;
+
+/* The inner nodes passed on the way down to a leaf, and the child taken in
+ * each: path[0] is the root, path[height - 1] the parent of the leaf. */
+typedef struct {
+    cvs_btree_inner_t *nodes[CVSBT_MAX_HEIGHT];
+    size_t slots[CVSBT_MAX_HEIGHT];
+} cvs_btree_path_t;
+
+/*----------------------------------------------------------------------------*/
+/*                            File Scoped Variables                           */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                             Function Prototypes                            */
+/*----------------------------------------------------------------------------*/
+static void *__node_new(void);
+static void __free_nodes(void *node, size_t height);
+static size_t __leaf_lower(const cvs_btree_leaf_t *leaf, uint64_t key);
+static size_t __inner_child(const cvs_btree_inner_t *inner, uint64_t key);
+static cvs_btree_leaf_t *__descend(cvs_btree_t *btree, uint64_t key, cvs_btree_path_t *path);
+static void __seek(cvs_btree_t *btree, uint64_t key, cvs_btree_cursor_t *cursor);
+static void __settle(cvs_btree_cursor_t *cursor);
+static void __leaf_insert(cvs_btree_leaf_t *leaf, size_t at, uint64_t key, void *value);
+static void __leaf_split(cvs_btree_leaf_t *leaf, cvs_btree_leaf_t *right, size_t at,
+                         uint64_t key, void *value);
+static void __insert_up(cvs_btree_t *btree, cvs_btree_path_t *path, uint64_t key,
+                        void *child, void **spare);
+static void __rebalance(cvs_btree_t *btree, cvs_btree_path_t *path);
+static bool __fix_leaf(cvs_btree_inner_t *parent, size_t at);
+static bool __fix_inner(cvs_btree_inner_t *parent, size_t at);
+static void __remove_child(cvs_btree_inner_t *parent, size_t at);
+
+/*----------------------------------------------------------------------------*/
+/*                             External Functions                             */
+/*----------------------------------------------------------------------------*/
+
+/* See cvs-btree.h for details. */
+bool cvs_btree_init(cvs_btree_t *btree)
+{
+    if (NULL == btree) {
+        return false;
+    }
+
+    memset(btree, 0, sizeof(cvs_btree_t));
+
+    return true;
+}
+
+
+/* See cvs-btree.h for details. */
+void cvs_btree_destroy(cvs_btree_t *btree)
+{
+    if (btree) {
+        __free_nodes(btree->root, btree->height);
+        btree->root = NULL;
+        btree->height = 0;
+        btree->count = 0;
+    }
+}
+
+
+/* See cvs-btree.h for details. */
+void *cvs_btree_get(cvs_btree_t *btree, uint64_t key)
+{
+    cvs_btree_cursor_t cursor;
+
+    if ((NULL == btree) || (NULL == btree->root)) {
+        return NULL;
+    }
+
+    cursor.leaf = __descend(btree, key, NULL);
+    cursor.index = __leaf_lower(cursor.leaf, key);
+    if ((cursor.index < cursor.leaf->count) && (key == cursor.leaf->keys[cursor.index])) {
+        return cursor.leaf->values[cursor.index];
+    }
+
+    return NULL;
+}
+
+
+/* See cvs-btree.h for details. */
+bool cvs_btree_contains_key(cvs_btree_t *btree, uint64_t key)
+{
+    cvs_btree_cursor_t cursor;
+
+    if ((NULL == btree) || (NULL == btree->root)) {
+        return false;
+    }
+
+    cursor.leaf = __descend(btree, key, NULL);
+    cursor.index = __leaf_lower(cursor.leaf, key);
+
+    return (cursor.index < cursor.leaf->count) && (key == cursor.leaf->keys[cursor.index]);
+}
+
+
+/* See cvs-btree.h for details. */
+void *cvs_btree_put(cvs_btree_t *btree, uint64_t key, void *value)
+{
+    cvs_btree_path_t path;
+    cvs_btree_leaf_t *leaf;
+    void *spare[CVSBT_MAX_HEIGHT + 2];
+    size_t at, need, i, d;
+
+    if (NULL == btree) {
+        return NULL;
+    }
+
+    if (NULL == btree->root) {
+        btree->root = __node_new();
+        if (NULL == btree->root) {
+            return NULL;
+        }
+    }
+
+    leaf = __descend(btree, key, &path);
+    at = __leaf_lower(leaf, key);
+    if ((at < leaf->count) && (key == leaf->keys[at])) {
+        void *old = leaf->values[at];
+
+        leaf->values[at] = value;
+        return old;
+    }
+
+    if (leaf->count < CVSBT_LEAF_KEYS) {
+        __leaf_insert(leaf, at, key, value);
+        btree->count++;
+        return NULL;
+    }
+
+    /* The leaf splits, and so does every full inner node above it.  Get all
+     * the nodes that takes up front so running out of memory changes
+     * nothing. */
+    need = 1;
+    d = btree->height;
+    while ((0 < d) && (CVSBT_INNER_KEYS == path.nodes[d - 1]->count)) {
+        need++;
+        d--;
+    }
+    if (0 == d) {
+        need++;
+    }
+    for (i = 0; i < need; i++) {
+        spare[i] = __node_new();
+        if (NULL == spare[i]) {
+            while (0 < i) {
+                free(spare[--i]);
+            }
+            return NULL;
+        }
+    }
+
+    __leaf_split(leaf, (cvs_btree_leaf_t*) spare[0], at, key, value);
+    btree->count++;
+    __insert_up(btree, &path, ((cvs_btree_leaf_t*) spare[0])->keys[0], spare[0], &spare[1]);
+
+    return NULL;
+}
+
+
+/* See cvs-btree.h for details. */
+void *cvs_btree_remove(cvs_btree_t *btree, uint64_t key)
+{
+    cvs_btree_path_t path;
+    cvs_btree_leaf_t *leaf;
+    void *rv;
+    size_t at;
+
+    if ((NULL == btree) || (NULL == btree->root)) {
+        return NULL;
+    }
+
+    leaf = __descend(btree, key, &path);
+    at = __leaf_lower(leaf, key);
+    if ((at >= leaf->count) || (key != leaf->keys[at])) {
+        return NULL;
+    }
+
+    rv = leaf->values[at];
+    leaf->count--;
+    memmove(&leaf->keys[at], &leaf->keys[at + 1], (leaf->count - at) * sizeof(uint64_t));
+    memmove(&leaf->values[at], &leaf->values[at + 1], (leaf->count - at) * sizeof(void*));
+    btree->count--;
+
+    if (0 == btree->height) {
+        if (0 == leaf->count) {
+            free(leaf);
+            btree->root = NULL;
+        }
+    } else if (leaf->count < CVSBT_LEAF_MIN) {
+        __rebalance(btree, &path);
+    }
+
+    return rv;
+}
+
+
+/* See cvs-btree.h for details. */
+size_t cvs_btree_get_size(cvs_btree_t *btree)
+{
+    size_t rv;
+
+    rv = 0;
+    if (btree) {
+        rv = btree->count;
+    }
+
+    return rv;
+}
+
+
+/* See cvs-btree.h for details. */
+bool cvs_btree_lower_bound(cvs_btree_t *btree, uint64_t key, cvs_btree_cursor_t *cursor)
+{
+    if (NULL == cursor) {
+        return false;
+    }
+
+    __seek(btree, key, cursor);
+
+    return (NULL != cursor->leaf) ? true : false;
+}
+
+
+/* See cvs-btree.h for details. */
+bool cvs_btree_upper_bound(cvs_btree_t *btree, uint64_t key, cvs_btree_cursor_t *cursor)
+{
+    if (NULL == cursor) {
+        return false;
+    }
+
+    cursor->leaf = NULL;
+    if (UINT64_MAX != key) {
+        __seek(btree, key + 1, cursor);
+    }
+
+    return (NULL != cursor->leaf) ? true : false;
+}
+
+
+/* See cvs-btree.h for details. */
+bool cvs_btree_cursor_next(cvs_btree_cursor_t *cursor, uint64_t *key, void **value)
+{
+    if ((NULL == cursor) || (NULL == cursor->leaf)) {
+        return false;
+    }
+
+    if (key) {
+        *key = cursor->leaf->keys[cursor->index];
+    }
+    if (value) {
+        *value = cursor->leaf->values[cursor->index];
+    }
+    cursor->index++;
+    __settle(cursor);
+
+    return true;
+}
+
+
+/* See cvs-btree.h for details. */
+void cvs_btree_range(cvs_btree_t *btree, uint64_t from, uint64_t to,
+                     cvs_btree_iterator_fn_t iterator, void *user_data)
+{
+    cvs_btree_cursor_t cursor;
+
+    if ((NULL == iterator) || (from >= to)) {
+        return;
+    }
+
+    __seek(btree, from, &cursor);
+    while (NULL != cursor.leaf) {
+        cvs_btree_leaf_t *leaf = cursor.leaf;
+        size_t i;
+
+        for (i = cursor.index; i < leaf->count; i++) {
+            if ((leaf->keys[i] >= to) ||
+                (false == (iterator)(leaf->keys[i], leaf->values[i], user_data)))
+            {
+                return;
+            }
+        }
+        cursor.leaf = leaf->next;
+        cursor.index = 0;
+    }
+}
+
+
+/* See cvs-btree.h for details. */
+void cvs_btree_iterate(cvs_btree_t *btree, cvs_btree_iterator_fn_t iterator,
+                       void *user_data)
+{
+    cvs_btree_cursor_t cursor;
+
+    if (NULL == iterator) {
+        return;
+    }
+
+    __seek(btree, 0, &cursor);
+    while (NULL != cursor.leaf) {
+        cvs_btree_leaf_t *leaf = cursor.leaf;
+        size_t i;
+
+        for (i = 0; i < leaf->count; i++) {
+            if (false == (iterator)(leaf->keys[i], leaf->values[i], user_data)) {
+                return;
+            }
+        }
+        cursor.leaf = leaf->next;
+    }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                             Internal functions                             */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Allocates a node, leaf or inner, aligned to a cache line and empty.
+ *
+ *  @return the node or NULL if out of memory
+ */
+static void *__node_new(void)
+{
+    void *node;
+    size_t size;
+
+    size = (sizeof(cvs_btree_leaf_t) > sizeof(cvs_btree_inner_t)) ?
+           sizeof(cvs_btree_leaf_t) : sizeof(cvs_btree_inner_t);
+    if (0 != posix_memalign(&node, CACHE_LINE, size)) {
+        return NULL;
+    }
+    memset(node, 0, size);
+
+    return node;
+}
+
+
+/**
+ *  Frees a node and everything under it.
+ *
+ *  @param node the node to free, may be NULL
+ *  @param height the number of inner levels from the node down to the leaves
+ */
+static void __free_nodes(void *node, size_t height)
+{
+    if ((NULL != node) && (0 < height)) {
+        cvs_btree_inner_t *inner = (cvs_btree_inner_t*) node;
+        size_t i;
+
+        for (i = 0; i <= inner->count; i++) {
+            __free_nodes(inner->children[i], height - 1);
+        }
+    }
+    free(node);
+}
+
+
+/**
+ *  Counts the keys of a leaf below a key, which is where the key is or would
+ *  go.  The count is branch free, a linear pass over a few cache lines beats
+ *  a binary search at this size.
+ *
+ *  @param leaf the leaf to search
+ *  @param key the key to search for
+ *
+ *  @return the index of the first key at or above key
+ */
+static size_t __leaf_lower(const cvs_btree_leaf_t *leaf, uint64_t key)
+{
+    size_t i, rv;
+
+    rv = 0;
+    for (i = 0; i < leaf->count; i++) {
+        rv += (leaf->keys[i] < key);
+    }
+
+    return rv;
+}
+
+
+/**
+ *  Picks the child of an inner node that a key belongs under.
+ *
+ *  @param inner the inner node
+ *  @param key the key to search for
+ *
+ *  @return the index of the child
+ */
+static size_t __inner_child(const cvs_btree_inner_t *inner, uint64_t key)
+{
+    size_t i, rv;
+
+    rv = 0;
+    for (i = 0; i < inner->count; i++) {
+        rv += (inner->keys[i] <= key);
+    }
+
+    return rv;
+}
+
+
+/**
+ *  Walks from the root down to the leaf a key belongs in.
+ *
+ *  @note The tree must have a root.
+ *
+ *  @param btree the tree to search
+ *  @param key the key to search for
+ *  @param path if not NULL, records the inner nodes passed on the way
+ *
+ *  @return the leaf
+ */
+static cvs_btree_leaf_t *__descend(cvs_btree_t *btree, uint64_t key, cvs_btree_path_t *path)
+{
+    void *node;
+    size_t d;
+
+    node = btree->root;
+    for (d = 0; d < btree->height; d++) {
+        cvs_btree_inner_t *inner = (cvs_btree_inner_t*) node;
+        size_t slot = __inner_child(inner, key);
+
+        if (path) {
+            path->nodes[d] = inner;
+            path->slots[d] = slot;
+        }
+        node = inner->children[slot];
+    }
+
+    return (cvs_btree_leaf_t*) node;
+}
+
+
+/**
+ *  Points a cursor at the first key at or above a key.
+ *
+ *  @param btree the tree to search, may be NULL
+ *  @param key the key to search for
+ *  @param cursor the cursor to position, the leaf is NULL if there is no key
+ */
+static void __seek(cvs_btree_t *btree, uint64_t key, cvs_btree_cursor_t *cursor)
+{
+    cursor->leaf = NULL;
+    cursor->index = 0;
+    if ((btree) && (btree->root)) {
+        cursor->leaf = __descend(btree, key, NULL);
+        cursor->index = __leaf_lower(cursor->leaf, key);
+        __settle(cursor);
+    }
+}
+
+
+/**
+ *  Moves a cursor that is past the end of its leaf to the start of the next
+ *  one, or to NULL after the last leaf.
+ *
+ *  @param cursor the cursor to fix up
+ */
+static void __settle(cvs_btree_cursor_t *cursor)
+{
+    while ((NULL != cursor->leaf) && (cursor->index >= cursor->leaf->count)) {
+        cursor->leaf = cursor->leaf->next;
+        cursor->index = 0;
+    }
+}
+
+
+/**
+ *  Inserts a pair into a leaf that has room for it.
+ *
+ *  @param leaf the leaf to insert into
+ *  @param at the index the key goes at
+ *  @param key the key to insert
+ *  @param value the value of the key
+ */
+static void __leaf_insert(cvs_btree_leaf_t *leaf, size_t at, uint64_t key, void *value)
+{
+    memmove(&leaf->keys[at + 1], &leaf->keys[at], (leaf->count - at) * sizeof(uint64_t));
+    memmove(&leaf->values[at + 1], &leaf->values[at], (leaf->count - at) * sizeof(void*));
+    leaf->keys[at] = key;
+    leaf->values[at] = value;
+    leaf->count++;
+}
+
+
+/**
+ *  Splits a full leaf in two while inserting a pair, the upper half moving to
+ *  a new leaf chained after it.
+ *
+ *  @param leaf the full leaf
+ *  @param right the empty new leaf
+ *  @param at the index the key goes at
+ *  @param key the key to insert
+ *  @param value the value of the key
+ */
+static void __leaf_split(cvs_btree_leaf_t *leaf, cvs_btree_leaf_t *right, size_t at,
+                         uint64_t key, void *value)
+{
+    size_t keep = (CVSBT_LEAF_KEYS + 1) / 2;
+
+    if (at < keep) {
+        /* The key lands in the left half, which gives up one more pair. */
+        right->count = CVSBT_LEAF_KEYS - (keep - 1);
+        memcpy(right->keys, &leaf->keys[keep - 1], right->count * sizeof(uint64_t));
+        memcpy(right->values, &leaf->values[keep - 1], right->count * sizeof(void*));
+        leaf->count = keep - 1;
+        __leaf_insert(leaf, at, key, value);
+    } else {
+        right->count = CVSBT_LEAF_KEYS - keep;
+        memcpy(right->keys, &leaf->keys[keep], right->count * sizeof(uint64_t));
+        memcpy(right->values, &leaf->values[keep], right->count * sizeof(void*));
+        leaf->count = keep;
+        __leaf_insert(right, at - keep, key, value);
+    }
+
+    right->next = leaf->next;
+    leaf->next = right;
+}
+
+
+/**
+ *  Adds a new node to the parent of the node it was split from, splitting
+ *  full inner nodes up the path and growing a new root if the old one split.
+ *
+ *  @param btree the tree being changed
+ *  @param path the path down to the leaf that split
+ *  @param key the smallest key under the new node
+ *  @param child the new node, to go right of the node it split from
+ *  @param spare the nodes set aside for splitting inner nodes and a new root
+ */
+static void __insert_up(cvs_btree_t *btree, cvs_btree_path_t *path, uint64_t key,
+                        void *child, void **spare)
+{
+    cvs_btree_inner_t *root;
+    size_t d;
+
+    for (d = btree->height; 0 < d; d--) {
+        cvs_btree_inner_t *inner = path->nodes[d - 1];
+        size_t at = path->slots[d - 1];
+        uint64_t keys[CVSBT_INNER_KEYS + 1];
+        void *children[CVSBT_INNER_KEYS + 2];
+        cvs_btree_inner_t *right;
+        size_t keep;
+
+        if (inner->count < CVSBT_INNER_KEYS) {
+            memmove(&inner->keys[at + 1], &inner->keys[at],
+                    (inner->count - at) * sizeof(uint64_t));
+            memmove(&inner->children[at + 2], &inner->children[at + 1],
+                    (inner->count - at) * sizeof(void*));
+            inner->keys[at] = key;
+            inner->children[at + 1] = child;
+            inner->count++;
+            return;
+        }
+
+        /* Lay out all the keys and children, keep the lower half and move
+         * the upper half to a new node, handing the middle key up. */
+        memcpy(keys, inner->keys, at * sizeof(uint64_t));
+        keys[at] = key;
+        memcpy(&keys[at + 1], &inner->keys[at], (CVSBT_INNER_KEYS - at) * sizeof(uint64_t));
+        memcpy(children, inner->children, (at + 1) * sizeof(void*));
+        children[at + 1] = child;
+        memcpy(&children[at + 2], &inner->children[at + 1],
+               (CVSBT_INNER_KEYS - at) * sizeof(void*));
+
+        keep = (CVSBT_INNER_KEYS + 1) / 2;
+        right = (cvs_btree_inner_t*) *spare++;
+        inner->count = keep;
+        memcpy(inner->keys, keys, keep * sizeof(uint64_t));
+        memcpy(inner->children, children, (keep + 1) * sizeof(void*));
+        right->count = CVSBT_INNER_KEYS - keep;
+        memcpy(right->keys, &keys[keep + 1], right->count * sizeof(uint64_t));
+        memcpy(right->children, &children[keep + 1], (right->count + 1) * sizeof(void*));
+
+        key = keys[keep];
+        child = right;
+    }
+
+    root = (cvs_btree_inner_t*) *spare;
+    root->count = 1;
+    root->keys[0] = key;
+    root->children[0] = btree->root;
+    root->children[1] = child;
+    btree->root = root;
+    btree->height++;
+}
+
+
+/**
+ *  Restores the minimum fill after a removal left a leaf short, borrowing
+ *  from or merging with a sibling and working up the path as merges take
+ *  keys out of inner nodes.  A root left with a single child is dropped.
+ *
+ *  @param btree the tree being changed
+ *  @param path the path down to the short leaf
+ */
+static void __rebalance(cvs_btree_t *btree, cvs_btree_path_t *path)
+{
+    size_t d;
+    bool merged;
+
+    d = btree->height;
+    merged = __fix_leaf(path->nodes[d - 1], path->slots[d - 1]);
+    while (merged && (1 < d) && (path->nodes[d - 1]->count < CVSBT_INNER_MIN)) {
+        d--;
+        merged = __fix_inner(path->nodes[d - 1], path->slots[d - 1]);
+    }
+
+    if (0 == ((cvs_btree_inner_t*) btree->root)->count) {
+        cvs_btree_inner_t *root = (cvs_btree_inner_t*) btree->root;
+
+        btree->root = root->children[0];
+        btree->height--;
+        free(root);
+    }
+}
+
+
+/**
+ *  Refills a short leaf from a sibling with pairs to spare, or else merges it
+ *  with a sibling.
+ *
+ *  @param parent the parent of the leaf
+ *  @param at the index of the leaf in the parent
+ *
+ *  @return true if two leaves were merged, taking a key out of the parent
+ */
+static bool __fix_leaf(cvs_btree_inner_t *parent, size_t at)
+{
+    cvs_btree_leaf_t *leaf, *left, *right;
+
+    leaf = (cvs_btree_leaf_t*) parent->children[at];
+    left = (0 < at) ? (cvs_btree_leaf_t*) parent->children[at - 1] : NULL;
+    right = (at < parent->count) ? (cvs_btree_leaf_t*) parent->children[at + 1] : NULL;
+
+    if ((NULL != left) && (CVSBT_LEAF_MIN < left->count)) {
+        left->count--;
+        __leaf_insert(leaf, 0, left->keys[left->count], left->values[left->count]);
+        parent->keys[at - 1] = leaf->keys[0];
+        return false;
+    }
+
+    if ((NULL != right) && (CVSBT_LEAF_MIN < right->count)) {
+        leaf->keys[leaf->count] = right->keys[0];
+        leaf->values[leaf->count] = right->values[0];
+        leaf->count++;
+        right->count--;
+        memmove(right->keys, &right->keys[1], right->count * sizeof(uint64_t));
+        memmove(right->values, &right->values[1], right->count * sizeof(void*));
+        parent->keys[at] = right->keys[0];
+        return false;
+    }
+
+    /* Merge the right one of the pair into the left one. */
+    if (NULL != left) {
+        right = leaf;
+        leaf = left;
+        at--;
+    }
+    memcpy(&leaf->keys[leaf->count], right->keys, right->count * sizeof(uint64_t));
+    memcpy(&leaf->values[leaf->count], right->values, right->count * sizeof(void*));
+    leaf->count += right->count;
+    leaf->next = right->next;
+    free(right);
+    __remove_child(parent, at);
+
+    return true;
+}
+
+
+/**
+ *  Refills a short inner node from a sibling with children to spare, or else
+ *  merges it with a sibling.
+ *
+ *  @param parent the parent of the inner node
+ *  @param at the index of the inner node in the parent
+ *
+ *  @return true if two nodes were merged, taking a key out of the parent
+ */
+static bool __fix_inner(cvs_btree_inner_t *parent, size_t at)
+{
+    cvs_btree_inner_t *inner, *left, *right;
+
+    inner = (cvs_btree_inner_t*) parent->children[at];
+    left = (0 < at) ? (cvs_btree_inner_t*) parent->children[at - 1] : NULL;
+    right = (at < parent->count) ? (cvs_btree_inner_t*) parent->children[at + 1] : NULL;
+
+    /* Borrowing rotates a key through the parent. */
+    if ((NULL != left) && (CVSBT_INNER_MIN < left->count)) {
+        memmove(&inner->keys[1], inner->keys, inner->count * sizeof(uint64_t));
+        memmove(&inner->children[1], inner->children, (inner->count + 1) * sizeof(void*));
+        inner->keys[0] = parent->keys[at - 1];
+        inner->children[0] = left->children[left->count];
+        inner->count++;
+        parent->keys[at - 1] = left->keys[left->count - 1];
+        left->count--;
+        return false;
+    }
+
+    if ((NULL != right) && (CVSBT_INNER_MIN < right->count)) {
+        inner->keys[inner->count] = parent->keys[at];
+        inner->children[inner->count + 1] = right->children[0];
+        inner->count++;
+        parent->keys[at] = right->keys[0];
+        right->count--;
+        memmove(right->keys, &right->keys[1], right->count * sizeof(uint64_t));
+        memmove(right->children, &right->children[1], (right->count + 1) * sizeof(void*));
+        return false;
+    }
+
+    /* Merge the right one of the pair into the left one, pulling down the
+     * key between them. */
+    if (NULL != left) {
+        right = inner;
+        inner = left;
+        at--;
+    }
+    inner->keys[inner->count] = parent->keys[at];
+    memcpy(&inner->keys[inner->count + 1], right->keys, right->count * sizeof(uint64_t));
+    memcpy(&inner->children[inner->count + 1], right->children,
+           (right->count + 1) * sizeof(void*));
+    inner->count += right->count + 1;
+    free(right);
+    __remove_child(parent, at);
+
+    return true;
+}
+
+
+/**
+ *  Takes keys[at] and children[at + 1] out of an inner node, after the child
+ *  was merged into children[at].
+ *
+ *  @param parent the inner node
+ *  @param at the index of the key to remove
+ */
+static void __remove_child(cvs_btree_inner_t *parent, size_t at)
+{
+    parent->count--;
+    memmove(&parent->keys[at], &parent->keys[at + 1], (parent->count - at) * sizeof(uint64_t));
+    memmove(&parent->children[at + 1], &parent->children[at + 2],
+            (parent->count - at) * sizeof(void*));
+}
@@ -0,0 +1,229 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __CVS_BTREE_H__
+#define __CVS_BTREE_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * cvs-btree.h implements an ordered map of uint64_t keys (uint32_t keys are
+ * simply widened) as a B+ tree.  Unlike cvs_hashmap it can answer "every key
+ * in [a, b)" and "the first key after k" without looking at the whole map.
+ *
+ * The values live in the leaves, which are chained in key order so a range is
+ * a walk along the leaf chain.  Leaves and inner nodes are each four cache
+ * lines (up to 15 keys, aligned to a line), so a lookup touches a few lines
+ * per level and the tree stays shallow: a million keys are 5 or 6 levels
+ * deep.  Get, put and remove are O(log n); a range is O(log n + k) for the k
+ * keys it visits.
+ *
+ * Cursors point into the leaves and are only valid until the tree is next
+ * changed.
+ */
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Called during the range and iterate operations for each key-value pair,
+ *  in ascending key order.
+ *
+ *  @note No tree manipulation is permitted during this call.
+ *
+ *  @param key the key of the pair
+ *  @param value the value of the pair
+ *
+ *  @return true to continue, false stops the iteration process
+ */
+typedef bool (*cvs_btree_iterator_fn_t)(uint64_t key, void *value, void *user_data);
+
+
+struct __cvs_btree_leaf;
+
+/* Do not directly access any of the values in the structure. */
+typedef struct {
+    void *root;                 /* NULL until the first put */
+    size_t height;              /* inner levels above the leaves */
+    size_t count;
+} cvs_btree_t;
+
+/* A position in the tree, see cvs_btree_lower_bound(). */
+typedef struct {
+    struct __cvs_btree_leaf *leaf;  /* NULL past the last key */
+    size_t index;
+} cvs_btree_cursor_t;
+
+/*----------------------------------------------------------------------------*/
+/*                                 Functions                                  */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Initializes the tree.
+ *
+ *  @param btree the tree to initialize
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_btree_init(cvs_btree_t *btree);
+
+
+/**
+ *  Destroys the structure.
+ *
+ *  @note This does not destroy the values of the tree.
+ *
+ *  @param btree the tree to destroy
+ */
+void cvs_btree_destroy(cvs_btree_t *btree);
+
+
+/**
+ *  Returns the value to which the specified key is mapped, or NULL if this tree
+ *  contains no mapping for the key.
+ *
+ *  @param btree the tree to search
+ *  @param key the key whose associated value is to be returned
+ *
+ *  @return the value to which the specified key is mapped, or NULL if this tree
+ *          contains no mapping for the key (or any other error occurs)
+ */
+void *cvs_btree_get(cvs_btree_t *btree, uint64_t key);
+
+
+/**
+ *  Returns true if this tree contains a mapping for the specified key.
+ *
+ *  @param btree the tree to search
+ *  @param key the key whose presence in this tree is to be tested
+ *
+ *  @return true if this tree contains a mapping for the specified key
+ */
+bool cvs_btree_contains_key(cvs_btree_t *btree, uint64_t key);
+
+
+/**
+ *  Associates the specified value with the specified key, replacing the value
+ *  the key had before.
+ *
+ *  @param btree the tree to change
+ *  @param key the key with which the specified value is to be associated
+ *  @param value the value to be associated with the specified key
+ *
+ *  @return the value the key had before, or NULL if it was not in the tree
+ *          (or any other error occurs, in which case the tree is unchanged)
+ */
+void *cvs_btree_put(cvs_btree_t *btree, uint64_t key, void *value);
+
+
+/**
+ *  Removes the mapping for a key from this tree if it is present.
+ *
+ *  @param btree the tree to change
+ *  @param key the key whose mapping is to be removed from the tree
+ *
+ *  @return the value of the removed mapping, or NULL if there was no mapping
+ *          for key (or any other error occurs)
+ */
+void *cvs_btree_remove(cvs_btree_t *btree, uint64_t key);
+
+
+/**
+ *  Returns the number of key-value mappings in this tree.
+ *
+ *  @param btree the tree to examine
+ *
+ *  @return the number of key-value mappings in this tree
+ */
+size_t cvs_btree_get_size(cvs_btree_t *btree);
+
+
+/**
+ *  Points a cursor at the first key at or after the specified key.
+ *
+ *  @param btree the tree to search
+ *  @param key the key to search for
+ *  @param cursor the cursor to position
+ *
+ *  @return true if there is such a key, false otherwise
+ */
+bool cvs_btree_lower_bound(cvs_btree_t *btree, uint64_t key, cvs_btree_cursor_t *cursor);
+
+
+/**
+ *  Points a cursor at the first key after the specified key.
+ *
+ *  @param btree the tree to search
+ *  @param key the key to search for
+ *  @param cursor the cursor to position
+ *
+ *  @return true if there is such a key, false otherwise
+ */
+bool cvs_btree_upper_bound(cvs_btree_t *btree, uint64_t key, cvs_btree_cursor_t *cursor);
+
+
+/**
+ *  Gets the pair a cursor points at and moves the cursor to the next key.
+ *
+ *  @param cursor the cursor to read and advance
+ *  @param key if not NULL, set to the key of the pair
+ *  @param value if not NULL, set to the value of the pair
+ *
+ *  @return true if the cursor pointed at a pair, false if it was past the
+ *          last key
+ */
+bool cvs_btree_cursor_next(cvs_btree_cursor_t *cursor, uint64_t *key, void **value);
+
+
+/**
+ *  Calls the iterator for every key in [from, to), in ascending order.
+ *
+ *  @param btree the tree to iterate over
+ *  @param from the first key of the range
+ *  @param to the key after the range, nothing is visited unless from < to
+ *  @param iterator the iterator function to call with each pair
+ *  @param user_data additional user data passed through to the iterator
+ */
+void cvs_btree_range(cvs_btree_t *btree, uint64_t from, uint64_t to,
+                     cvs_btree_iterator_fn_t iterator, void *user_data);
+
+
+/**
+ *  Calls the iterator for every key in the tree, in ascending order.
+ *
+ *  @param btree the tree to iterate over
+ *  @param iterator the iterator function to call with each pair
+ *  @param user_data additional user data passed through to the iterator
+ */
+void cvs_btree_iterate(cvs_btree_t *btree, cvs_btree_iterator_fn_t iterator,
+                       void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,641 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "cvs-chashmap.h"
+#include "rebar-hash.h"
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+#define MIN_SLOTS       8
+#define CACHE_LINE      64
+
+/* Slot tags.  A full slot's tag is its hash with the top bit set. */
+#define TAG_EMPTY       0
+#define TAG_DELETED     1
+#define TAG_FULL(hash)  ((hash) | (1ULL << 63))
+
+/* Slot arrays are resized once 3/4ths of the slots are full or deleted. */
+#define MAX_USED(mask)  (((mask) + 1) / 4 * 3)
+
+#define LOAD(ptr)           __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define LOAD_ACQUIRE(ptr)   __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define STORE(ptr, val)     __atomic_store_n((ptr), (val), __ATOMIC_RELAXED)
+#define STORE_RELEASE(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+typedef struct {
+    uint64_t tag;
+    union {
+        char *string;
+        uint32_t u32;
+        uint64_t u64;
+    } key;
+    void *value;
+} cvs_chashmap_slot_t;
+
+typedef struct __cvs_chashmap_table {
+    size_t mask;                            /* slot count - 1 */
+    size_t used;                            /* full + deleted slots */
+    struct __cvs_chashmap_table *retired;   /* the table this one replaced */
+    cvs_chashmap_slot_t slots[];
+} cvs_chashmap_table_t;
+
+/* Each stripe gets its own cache line so writers on different stripes don't
+ * bounce the same line between cores. */
+struct __cvs_chashmap_stripe {
+    pthread_mutex_t lock;
+    uint32_t seq;                   /* odd while a writer is changing it */
+    size_t count;
+    cvs_chashmap_table_t *table;    /* NULL until the first put */
+} __attribute__((aligned(CACHE_LINE)));
+
+typedef struct __cvs_chashmap_stripe cvs_chashmap_stripe_t;
+
+/*----------------------------------------------------------------------------*/
+/*                            File Scoped Variables                           */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                             Function Prototypes                            */
+/*----------------------------------------------------------------------------*/
+static uint64_t __hash(cvs_chashmap_t *chashmap, void *key);
+static cvs_chashmap_stripe_t *__stripe(cvs_chashmap_t *chashmap, uint64_t hash);
+static bool __read(cvs_chashmap_t *chashmap, void *key, void **value);
+static cvs_chashmap_slot_t *__locked_find(cvs_chashmap_t *chashmap,
+                                          cvs_chashmap_table_t *table,
+                                          void *key, uint64_t hash);
+static void __write_begin(cvs_chashmap_stripe_t *stripe);
+static void __write_end(cvs_chashmap_stripe_t *stripe);
+static void __resize(cvs_chashmap_stripe_t *stripe);
+static void __clean(cvs_chashmap_stripe_t *stripe);
+static size_t __free_slot(cvs_chashmap_table_t *table, uint64_t tag);
+static void *__key_ptr(cvs_chashmap_t *chashmap, cvs_chashmap_slot_t *s);
+
+/*----------------------------------------------------------------------------*/
+/*                             External Functions                             */
+/*----------------------------------------------------------------------------*/
+/* See cvs-chashmap.h for details. */
+bool cvs_chashmap_init(cvs_chashmap_t *chashmap, cvs_hashmap_type_t type)
+{
+    void *stripes;
+    size_t i;
+
+    if (NULL == chashmap) {
+        return false;
+    }
+
+    switch( type ) {
+        case CHT__STRING:
+        case CHT__UINT32:
+        case CHT__UINT64:
+            break;
+
+        default:
+            return false;
+    }
+
+    if (0 != posix_memalign(&stripes, CACHE_LINE,
+                            CVSCHM_STRIPES * sizeof(cvs_chashmap_stripe_t))) {
+        return false;
+    }
+    memset(stripes, 0, CVSCHM_STRIPES * sizeof(cvs_chashmap_stripe_t));
+
+    chashmap->type = type;
+    chashmap->seed = rebar_hash_seed();
+    chashmap->stripes = (cvs_chashmap_stripe_t*) stripes;
+    for (i = 0; i < CVSCHM_STRIPES; i++) {
+        pthread_mutex_init(&chashmap->stripes[i].lock, NULL);
+    }
+
+    return true;
+}
+
+
+/* See cvs-chashmap.h for details. */
+void cvs_chashmap_destroy(cvs_chashmap_t *chashmap)
+{
+    size_t i;
+
+    if ((NULL == chashmap) || (NULL == chashmap->stripes)) {
+        return;
+    }
+
+    for (i = 0; i < CVSCHM_STRIPES; i++) {
+        cvs_chashmap_table_t *table, *retired;
+
+        for (table = chashmap->stripes[i].table; NULL != table; table = retired) {
+            retired = table->retired;
+            free(table);
+        }
+        pthread_mutex_destroy(&chashmap->stripes[i].lock);
+    }
+
+    free(chashmap->stripes);
+    chashmap->stripes = NULL;
+}
+
+
+/* See cvs-chashmap.h for details. */
+void *cvs_chashmap_get(cvs_chashmap_t *chashmap, void *key)
+{
+    void *rv;
+
+    rv = NULL;
+    if ((chashmap) && (chashmap->stripes) && (key)) {
+        __read(chashmap, key, &rv);
+    }
+
+    return rv;
+}
+
+
+/* See cvs-chashmap.h for details. */
+bool cvs_chashmap_contains_key(cvs_chashmap_t *chashmap, void *key)
+{
+    void *value;
+
+    if ((chashmap) && (chashmap->stripes) && (key)) {
+        return __read(chashmap, key, &value);
+    }
+
+    return false;
+}
+
+
+/* See cvs-chashmap.h for details. */
+void *cvs_chashmap_remove(cvs_chashmap_t *chashmap, void *key)
+{
+    void *rv;
+    uint64_t hash;
+    cvs_chashmap_stripe_t *stripe;
+    cvs_chashmap_slot_t *s;
+
+    rv = NULL;
+    if ((NULL == chashmap) || (NULL == chashmap->stripes) || (NULL == key)) {
+        return rv;
+    }
+
+    hash = __hash(chashmap, key);
+    stripe = __stripe(chashmap, hash);
+
+    pthread_mutex_lock(&stripe->lock);
+    s = __locked_find(chashmap, stripe->table, key, hash);
+    if (s) {
+        rv = s->value;
+
+        __write_begin(stripe);
+        STORE(&s->tag, (uint64_t) TAG_DELETED);
+        STORE(&stripe->count, stripe->count - 1);
+        __write_end(stripe);
+    }
+    pthread_mutex_unlock(&stripe->lock);
+
+    return rv;
+}
+
+
+/* See cvs-chashmap.h for details. */
+void cvs_chashmap_put(cvs_chashmap_t *chashmap, void *key, void *value)
+{
+    uint64_t hash;
+    cvs_chashmap_stripe_t *stripe;
+    cvs_chashmap_table_t *table;
+    cvs_chashmap_slot_t *s;
+    size_t i;
+
+    if ((NULL == chashmap) || (NULL == chashmap->stripes) || (NULL == key)) {
+        return;
+    }
+
+    hash = __hash(chashmap, key);
+    stripe = __stripe(chashmap, hash);
+
+    pthread_mutex_lock(&stripe->lock);
+
+    s = __locked_find(chashmap, stripe->table, key, hash);
+    if (s) {
+        __write_begin(stripe);
+        STORE(&s->value, value);
+        __write_end(stripe);
+
+        pthread_mutex_unlock(&stripe->lock);
+        return;
+    }
+
+    __write_begin(stripe);
+
+    if ((NULL == stripe->table) || (stripe->table->used >= MAX_USED(stripe->table->mask))) {
+        __resize(stripe);
+    }
+
+    /* The key isn't present, so take the first empty or deleted slot. */
+    table = stripe->table;
+    for (i = hash & table->mask; ; i = (i + 1) & table->mask) {
+        if (TAG_FULL(0) > table->slots[i].tag) {
+            break;
+        }
+    }
+    s = &table->slots[i];
+    if (TAG_EMPTY == s->tag) {
+        table->used++;
+    }
+
+    /* The key and value have to be visible before the tag is. */
+    if (CHT__STRING == chashmap->type) {
+        STORE(&s->key.string, (char*) key);
+    } else if (CHT__UINT64 == chashmap->type) {
+        STORE(&s->key.u64, *((uint64_t*) key));
+    } else {
+        STORE(&s->key.u32, *((uint32_t*) key));
+    }
+    STORE(&s->value, value);
+    STORE_RELEASE(&s->tag, TAG_FULL(hash));
+    STORE(&stripe->count, stripe->count + 1);
+
+    __write_end(stripe);
+
+    pthread_mutex_unlock(&stripe->lock);
+}
+
+
+/* See cvs-chashmap.h for details. */
+bool cvs_chashmap_is_empty(cvs_chashmap_t *chashmap)
+{
+    return (0 == cvs_chashmap_get_size(chashmap)) ? true : false;
+}
+
+
+/* See cvs-chashmap.h for details. */
+void cvs_chashmap_iterate(cvs_chashmap_t *chashmap,
+                          cvs_hashmap_iterator_fn_t iterator,
+                          void *user_data)
+{
+    size_t i, j;
+
+    if ((NULL == chashmap) || (NULL == chashmap->stripes) || (NULL == iterator)) {
+        return;
+    }
+
+    for (i = 0; i < CVSCHM_STRIPES; i++) {
+        cvs_chashmap_stripe_t *stripe = &chashmap->stripes[i];
+        bool keep_going = true;
+
+        pthread_mutex_lock(&stripe->lock);
+        if (stripe->table) {
+            for (j = 0; (keep_going) && (j <= stripe->table->mask); j++) {
+                cvs_chashmap_slot_t *s = &stripe->table->slots[j];
+
+                if (TAG_FULL(0) <= s->tag) {
+                    keep_going = (iterator)(__key_ptr(chashmap, s), s->value, user_data);
+                }
+            }
+        }
+        pthread_mutex_unlock(&stripe->lock);
+
+        if (false == keep_going) {
+            return;
+        }
+    }
+}
+
+
+/* See cvs-chashmap.h for details. */
+size_t cvs_chashmap_get_size(cvs_chashmap_t *chashmap)
+{
+    size_t rv, i;
+
+    rv = 0;
+    if ((chashmap) && (chashmap->stripes)) {
+        for (i = 0; i < CVSCHM_STRIPES; i++) {
+            rv += LOAD(&chashmap->stripes[i].count);
+        }
+    }
+
+    return rv;
+}
+
+
+/* See cvs-chashmap.h for details. */
+size_t cvs_chashmap_get_slots(cvs_chashmap_t *chashmap)
+{
+    size_t rv, i;
+
+    rv = 0;
+    if ((chashmap) && (chashmap->stripes)) {
+        for (i = 0; i < CVSCHM_STRIPES; i++) {
+            cvs_chashmap_stripe_t *stripe = &chashmap->stripes[i];
+            cvs_chashmap_table_t *table;
+
+            pthread_mutex_lock(&stripe->lock);
+            for (table = stripe->table; NULL != table; table = table->retired) {
+                rv += table->mask + 1;
+            }
+            pthread_mutex_unlock(&stripe->lock);
+        }
+    }
+
+    return rv;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                             Internal functions                             */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Hashes the key based on the type of the hashmap.
+ */
+static uint64_t __hash(cvs_chashmap_t *chashmap, void *key)
+{
+    if (CHT__STRING == chashmap->type) {
+        return rebar_hash_string((const char*) key, NULL, chashmap->seed);
+    } else if (CHT__UINT64 == chashmap->type) {
+        return rebar_hash_u64(*((uint64_t*) key), chashmap->seed);
+    }
+
+    return rebar_hash_u32(*((uint32_t*) key), chashmap->seed);
+}
+
+
+/**
+ *  Picks the stripe for a hash.  The slot index uses the low bits of the
+ *  hash, so the stripe uses bits well above them.
+ */
+static cvs_chashmap_stripe_t *__stripe(cvs_chashmap_t *chashmap, uint64_t hash)
+{
+    return &chashmap->stripes[(hash >> 40) & (CVSCHM_STRIPES - 1)];
+}
+
+
+/**
+ *  The lock free lookup.  The probe reads the stripe's table without the
+ *  mutex, then checks the stripe's sequence counter: if a writer started or
+ *  finished while the probe ran, whatever was read may be torn and the probe
+ *  is repeated.
+ *
+ *  @param chashmap the hashmap to search
+ *  @param key the key to search for
+ *  @param value where the value is stored if the key is found
+ *
+ *  @return true if the key was found, false otherwise
+ */
+static bool __read(cvs_chashmap_t *chashmap, void *key, void **value)
+{
+    uint64_t hash, tag;
+    cvs_chashmap_stripe_t *stripe;
+
+    hash = __hash(chashmap, key);
+    tag = TAG_FULL(hash);
+    stripe = __stripe(chashmap, hash);
+
+    while (1) {
+        cvs_chashmap_table_t *table;
+        uint32_t seq;
+        bool found;
+        void *v;
+
+        seq = LOAD_ACQUIRE(&stripe->seq);
+        if (seq & 1) {
+            continue;
+        }
+
+        found = false;
+        v = NULL;
+        table = LOAD_ACQUIRE(&stripe->table);
+        if (table) {
+            size_t i, probes;
+
+            /* A torn read could hide the empty slot that ends the probe, so
+             * never look at more slots than the table has. */
+            i = hash & table->mask;
+            for (probes = 0; probes <= table->mask; probes++) {
+                cvs_chashmap_slot_t *s = &table->slots[i];
+                uint64_t t = LOAD_ACQUIRE(&s->tag);
+
+                if (TAG_EMPTY == t) {
+                    break;
+                }
+                if (tag == t) {
+                    if (CHT__STRING == chashmap->type) {
+                        char *k = LOAD(&s->key.string);
+
+                        found = (NULL != k) && (0 == strcmp((char*) key, k));
+                    } else if (CHT__UINT64 == chashmap->type) {
+                        found = (*((uint64_t*) key) == LOAD(&s->key.u64));
+                    } else {
+                        found = (*((uint32_t*) key) == LOAD(&s->key.u32));
+                    }
+                    if (found) {
+                        v = LOAD(&s->value);
+                        break;
+                    }
+                }
+                i = (i + 1) & table->mask;
+            }
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (seq == LOAD(&stripe->seq)) {
+            *value = v;
+            return found;
+        }
+    }
+}
+
+
+/**
+ *  Finds the slot holding the key.  The stripe's mutex must be held.
+ *
+ *  @return the slot of the key or NULL
+ */
+static cvs_chashmap_slot_t *__locked_find(cvs_chashmap_t *chashmap,
+                                          cvs_chashmap_table_t *table,
+                                          void *key, uint64_t hash)
+{
+    size_t i;
+
+    if (NULL == table) {
+        return NULL;
+    }
+
+    for (i = hash & table->mask; TAG_EMPTY != table->slots[i].tag; i = (i + 1) & table->mask) {
+        cvs_chashmap_slot_t *s = &table->slots[i];
+
+        if (TAG_FULL(hash) != s->tag) {
+            continue;
+        }
+        if (CHT__STRING == chashmap->type) {
+            if (0 == strcmp((char*) key, s->key.string)) {
+                return s;
+            }
+        } else if (CHT__UINT64 == chashmap->type) {
+            if (*((uint64_t*) key) == s->key.u64) {
+                return s;
+            }
+        } else if (*((uint32_t*) key) == s->key.u32) {
+            return s;
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ *  Marks the start of a change to a stripe; readers retry until the matching
+ *  __write_end().
+ */
+static void __write_begin(cvs_chashmap_stripe_t *stripe)
+{
+    STORE(&stripe->seq, stripe->seq + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+
+/**
+ *  Marks the end of a change to a stripe.
+ */
+static void __write_end(cvs_chashmap_stripe_t *stripe)
+{
+    STORE_RELEASE(&stripe->seq, stripe->seq + 1);
+}
+
+
+/**
+ *  Makes room for another entry.  If twice the live entries need more slots
+ *  than the stripe has, they are moved into a new, larger slot array and the
+ *  old array is kept on the retired list since a reader may still be probing
+ *  it.  Otherwise the table is only clogged with deleted slots, so they are
+ *  cleaned out of the current array instead.
+ *
+ *  @note The stripe's mutex must be held and __write_begin() called.
+ */
+static void __resize(cvs_chashmap_stripe_t *stripe)
+{
+    cvs_chashmap_table_t *old, *table;
+    size_t slots, i;
+
+    old = stripe->table;
+
+    slots = MIN_SLOTS;
+    while (MAX_USED(slots - 1) <= stripe->count * 2) {
+        slots *= 2;
+    }
+
+    if ((old) && (slots <= old->mask + 1)) {
+        __clean(stripe);
+        return;
+    }
+
+    table = (cvs_chashmap_table_t*) calloc(1, sizeof(cvs_chashmap_table_t) +
+                                              slots * sizeof(cvs_chashmap_slot_t));
+    assert(table);
+    table->mask = slots - 1;
+    table->retired = old;
+
+    if (old) {
+        for (i = 0; i <= old->mask; i++) {
+            if (TAG_FULL(0) <= old->slots[i].tag) {
+                table->slots[__free_slot(table, old->slots[i].tag)] = old->slots[i];
+                table->used++;
+            }
+        }
+    }
+
+    STORE_RELEASE(&stripe->table, table);
+}
+
+
+/**
+ *  Rehashes the stripe's entries within its current slot array, dropping the
+ *  deleted slots.  Readers probing the array meanwhile see the odd sequence
+ *  counter and retry, so the array can be rewritten under them.
+ *
+ *  @note The stripe's mutex must be held and __write_begin() called.
+ */
+static void __clean(cvs_chashmap_stripe_t *stripe)
+{
+    cvs_chashmap_table_t *table;
+    cvs_chashmap_slot_t *live;
+    size_t count, i;
+
+    table = stripe->table;
+
+    live = NULL;
+    if (stripe->count) {
+        live = (cvs_chashmap_slot_t*) malloc(stripe->count * sizeof(cvs_chashmap_slot_t));
+        assert(live);
+    }
+
+    count = 0;
+    for (i = 0; i <= table->mask; i++) {
+        if (TAG_FULL(0) <= table->slots[i].tag) {
+            live[count++] = table->slots[i];
+        }
+        STORE(&table->slots[i].tag, (uint64_t) TAG_EMPTY);
+    }
+
+    for (i = 0; i < count; i++) {
+        cvs_chashmap_slot_t *s = &table->slots[__free_slot(table, live[i].tag)];
+
+        STORE(&s->key.u64, live[i].key.u64);
+        STORE(&s->value, live[i].value);
+        STORE(&s->tag, live[i].tag);
+    }
+    table->used = count;
+
+    free(live);
+}
+
+
+/**
+ *  Returns the index of the first empty slot on the tag's probe sequence.
+ */
+static size_t __free_slot(cvs_chashmap_table_t *table, uint64_t tag)
+{
+    size_t i;
+
+    for (i = tag & table->mask; TAG_EMPTY != table->slots[i].tag; i = (i + 1) & table->mask) {
+        ;
+    }
+
+    return i;
+}
+
+
+/**
+ *  Returns the key pointer handed to iterator functions for the slot.
+ */
+static void *__key_ptr(cvs_chashmap_t *chashmap, cvs_chashmap_slot_t *s)
+{
+    if (CHT__STRING == chashmap->type) {
+        return s->key.string;
+    } else if (CHT__UINT64 == chashmap->type) {
+        return &s->key.u64;
+    }
+
+    return &s->key.u32;
+}
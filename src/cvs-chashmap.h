@@ -0,0 +1,198 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __CVS_CHASHMAP_H__
+#define __CVS_CHASHMAP_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cvs-hashmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * cvs-chashmap.h implements a thread safe hashmap with the cvs_hashmap call
+ * shapes.  The keys are spread over a fixed number of stripes, each an open
+ * addressing table with its own mutex and sequence counter.  Writers (put,
+ * remove) take the stripe's mutex and bump the sequence counter around the
+ * change.  Readers (get, contains_key) never lock: they probe the table and
+ * retry if the sequence counter moved while they were reading.
+ *
+ * A stripe moves to a larger slot array only when its live entries outgrow
+ * the current one; deleted slots are cleaned out of the current array.  The
+ * replaced arrays may still be in use by a reader, so they are kept until
+ * cvs_chashmap_destroy().  Each was at most half the size of the one that
+ * replaced it, so together they never take more memory than the live tables.
+ *
+ * CHT__STRING keys are not copied, and a lock free reader may still be
+ * comparing against a removed key, so key strings must stay valid until the
+ * map is destroyed.
+ */
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+/* The number of independently locked stripes, must be a power of 2. */
+#define CVSCHM_STRIPES  64
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+struct __cvs_chashmap_stripe;
+
+/* Do not directly access any of the values in the structure. */
+typedef struct {
+    cvs_hashmap_type_t type;
+    uint64_t seed;
+    struct __cvs_chashmap_stripe *stripes;
+} cvs_chashmap_t;
+
+/*----------------------------------------------------------------------------*/
+/*                                 Functions                                  */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Initializes the concurrent hashmap structure.
+ *
+ *  @note This is not thread safe, the map must not be shared until it
+ *        returns.
+ *
+ *  @param chashmap the hashmap to initialize
+ *  @param type the type of the keys
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_chashmap_init(cvs_chashmap_t *chashmap, cvs_hashmap_type_t type);
+
+
+/**
+ *  Destroys the structure.
+ *
+ *  @note This does not destroy the key-value pairs of the hashmap, only
+ *        the hashmap.
+ *  @note This is not thread safe, no other thread may be using the map.
+ *
+ *  @param chashmap the hashmap to destroy
+ */
+void cvs_chashmap_destroy(cvs_chashmap_t *chashmap);
+
+
+/**
+ *  Returns the value to which the specified key is mapped, or NULL if this map
+ *  contains no mapping for the key.  Never blocks on a lock.
+ *
+ *  @param chashmap the hashmap to search
+ *  @param key the pointer to the key whose associated value is to be returned
+ *
+ *  @return the value to which the specified key is mapped, or NULL if this map
+ *          contains no mapping for the key (or any other error occurs)
+ */
+void *cvs_chashmap_get(cvs_chashmap_t *chashmap, void *key);
+
+
+/**
+ *  Returns true if this map contains a mapping for the specified key.  Never
+ *  blocks on a lock.
+ *
+ *  @param chashmap the hashmap to search
+ *  @param key the pointer to the key whose associated value is to be tested
+ *
+ *  @return true if this map contains a mapping for the specified key, or false
+ *          otherwise
+ */
+bool cvs_chashmap_contains_key(cvs_chashmap_t *chashmap, void *key);
+
+
+/**
+ *  Removes the mapping for the specified key from this map if present.
+ *
+ *  @param chashmap the hashmap to search
+ *  @param key the pointer to the key whose mapping is to be removed from the map
+ *
+ *  @return the previous value associated with key, or NULL if there was no
+ *          mapping for key (or any other error occurs)
+ */
+void *cvs_chashmap_remove(cvs_chashmap_t *chashmap, void *key);
+
+
+/**
+ *  Associates the specified value with the specified key in this map. If the
+ *  map previously contained a mapping for the key, the old value is replaced.
+ *
+ *  @param chashmap the hashmap to search
+ *  @param key pointer to the key with which the specified value is to be associated
+ *  @param value value to be associated with the specified key
+ */
+void cvs_chashmap_put(cvs_chashmap_t *chashmap, void *key, void *value);
+
+
+/**
+ *  Returns true if this map contains no key-value mappings.
+ *
+ *  @param chashmap the hashmap to search
+ *
+ *  @return true if this map contains no key-value mappings
+ */
+bool cvs_chashmap_is_empty(cvs_chashmap_t *chashmap);
+
+
+/**
+ *  Iterates over the key-value mappings and calls the provided iterator
+ *  function for each pair.  Each stripe is locked while it is visited, so
+ *  the iteration sees a consistent view of each stripe but not of the whole
+ *  map.
+ *
+ *  @note No hash manipulation is permitted during this call.
+ *
+ *  @param chashmap the hashmap to iterate over
+ *  @param iterator the iterator function to call for each pair
+ *  @param user_data additional user data passed through to the iterator function
+ */
+void cvs_chashmap_iterate(cvs_chashmap_t *chashmap,
+                          cvs_hashmap_iterator_fn_t iterator,
+                          void *user_data);
+
+
+/**
+ *  Returns the number of key-value mappings in this hashmap.  With concurrent
+ *  writers this is a snapshot that may already be stale.
+ *
+ *  @param chashmap the hashmap to inspect
+ *
+ *  @return the number of key-value mappings in the hashmap, or 0 on error
+ */
+size_t cvs_chashmap_get_size(cvs_chashmap_t *chashmap);
+
+
+/**
+ *  Returns the number of slots the hashmap has allocated, counting the
+ *  arrays kept for lock free readers as well as the live ones.
+ *
+ *  @param chashmap the hashmap to inspect
+ *
+ *  @return the number of slots allocated, or 0 on error
+ */
+size_t cvs_chashmap_get_slots(cvs_chashmap_t *chashmap);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,457 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "cvs-compactmap.h"
+#include "rebar-hash.h"
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+/* Index slot values.  A slot holding entry n stores n + SLOT_FIRST. */
+#define SLOT_EMPTY      0
+#define SLOT_DUMMY      1       /* the entry was removed, keep probing */
+#define SLOT_FIRST      2
+
+/* The hash stored in a removed entry.  Live hashes have the top bit clear. */
+#define DELETED_HASH    UINT64_MAX
+#define HASH_MASK       (UINT64_MAX >> 1)
+
+#define MIN_SLOTS       8
+
+/* Up to 2/3rds of the index slots point at entries. */
+#define USABLE(slots)   (((slots) * 2) / 3)
+
+/* Bits of the hash mixed into each probe step. */
+#define PERTURB_SHIFT   5
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                            File Scoped Variables                           */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                             Function Prototypes                            */
+/*----------------------------------------------------------------------------*/
+static uint64_t __hash(cvs_compactmap_t *compactmap, void *key);
+static bool __key_equals(cvs_compactmap_t *compactmap, cvs_compactmap_entry_t *e, void *key);
+static size_t __slot_get(cvs_compactmap_t *compactmap, size_t i);
+static void __slot_set(cvs_compactmap_t *compactmap, size_t i, size_t value);
+static size_t __find(cvs_compactmap_t *compactmap, void *key, uint64_t hash);
+static void __insert_index(cvs_compactmap_t *compactmap, uint64_t hash, size_t entry);
+static void __rebuild(cvs_compactmap_t *compactmap);
+
+/*----------------------------------------------------------------------------*/
+/*                             External Functions                             */
+/*----------------------------------------------------------------------------*/
+/* See cvs-compactmap.h for details. */
+bool cvs_compactmap_init(cvs_compactmap_t *compactmap, cvs_hashmap_type_t type)
+{
+    bool rv;
+
+    rv = false;
+    if (compactmap) {
+        switch( type ) {
+            case CHT__STRING:
+            case CHT__UINT32:
+            case CHT__UINT64:
+                memset(compactmap, 0, sizeof(cvs_compactmap_t));
+                compactmap->type = type;
+                compactmap->seed = rebar_hash_seed();
+                rv = true;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return rv;
+}
+
+
+/* See cvs-compactmap.h for details. */
+void cvs_compactmap_destroy(cvs_compactmap_t *compactmap)
+{
+    if (compactmap) {
+        free(compactmap->index);
+        free(compactmap->entries);
+        compactmap->index = NULL;
+        compactmap->entries = NULL;
+        compactmap->index_mask = 0;
+        compactmap->index_width = 0;
+        compactmap->capacity = 0;
+        compactmap->used = 0;
+        compactmap->count = 0;
+    }
+}
+
+
+/* See cvs-compactmap.h for details. */
+void *cvs_compactmap_get(cvs_compactmap_t *compactmap, void *key)
+{
+    void *rv;
+    size_t slot;
+
+    rv = NULL;
+    if ((compactmap) && (key)) {
+        slot = __find(compactmap, key, __hash(compactmap, key));
+        if (SLOT_EMPTY != slot) {
+            rv = compactmap->entries[__slot_get(compactmap, slot - 1) - SLOT_FIRST].value;
+        }
+    }
+
+    return rv;
+}
+
+
+/* See cvs-compactmap.h for details. */
+bool cvs_compactmap_contains_key(cvs_compactmap_t *compactmap, void *key)
+{
+    if ((compactmap) && (key)) {
+        return (SLOT_EMPTY != __find(compactmap, key, __hash(compactmap, key))) ? true : false;
+    }
+
+    return false;
+}
+
+
+/* See cvs-compactmap.h for details. */
+void *cvs_compactmap_remove(cvs_compactmap_t *compactmap, void *key)
+{
+    void *rv;
+    size_t slot;
+
+    rv = NULL;
+    if ((compactmap) && (key)) {
+        slot = __find(compactmap, key, __hash(compactmap, key));
+        if (SLOT_EMPTY != slot) {
+            cvs_compactmap_entry_t *e;
+
+            e = &compactmap->entries[__slot_get(compactmap, slot - 1) - SLOT_FIRST];
+            rv = e->value;
+            e->hash = DELETED_HASH;
+            e->value = NULL;
+
+            /* The slot may be part of another key's probe sequence. */
+            __slot_set(compactmap, slot - 1, SLOT_DUMMY);
+            compactmap->count--;
+        }
+    }
+
+    return rv;
+}
+
+
+/* See cvs-compactmap.h for details. */
+void cvs_compactmap_put(cvs_compactmap_t *compactmap, void *key, void *value)
+{
+    uint64_t hash;
+    size_t slot;
+    cvs_compactmap_entry_t *e;
+
+    if ((NULL == compactmap) || (NULL == key)) {
+        return;
+    }
+
+    hash = __hash(compactmap, key);
+    slot = __find(compactmap, key, hash);
+    if (SLOT_EMPTY != slot) {
+        compactmap->entries[__slot_get(compactmap, slot - 1) - SLOT_FIRST].value = value;
+        return;
+    }
+
+    if (compactmap->used == compactmap->capacity) {
+        __rebuild(compactmap);
+    }
+
+    e = &compactmap->entries[compactmap->used];
+    e->hash = hash;
+    switch (compactmap->type) {
+        case CHT__STRING:
+            e->key.string = (char*) key;
+            break;
+        case CHT__UINT32:
+            e->key.u32 = *((uint32_t*) key);
+            break;
+        default:
+            e->key.u64 = *((uint64_t*) key);
+            break;
+    }
+    e->value = value;
+
+    __insert_index(compactmap, hash, compactmap->used);
+    compactmap->used++;
+    compactmap->count++;
+}
+
+
+/* See cvs-compactmap.h for details. */
+bool cvs_compactmap_is_empty(cvs_compactmap_t *compactmap)
+{
+    return (0 == cvs_compactmap_get_size(compactmap)) ? true : false;
+}
+
+
+/* See cvs-compactmap.h for details. */
+void cvs_compactmap_iterate(cvs_compactmap_t *compactmap,
+                            cvs_hashmap_iterator_fn_t iterator,
+                            void *user_data)
+{
+    if ((compactmap) && (iterator)) {
+        size_t i;
+
+        for (i = 0; i < compactmap->used; i++) {
+            cvs_compactmap_entry_t *e = &compactmap->entries[i];
+
+            if (DELETED_HASH == e->hash) {
+                continue;
+            }
+
+            if (false == (iterator)(((CHT__STRING == compactmap->type) ?
+                                     (void*) e->key.string : (void*) &e->key),
+                                    e->value, user_data)) {
+                return;
+            }
+        }
+    }
+}
+
+
+/* See cvs-compactmap.h for details. */
+size_t cvs_compactmap_get_size(cvs_compactmap_t *compactmap)
+{
+    size_t rv;
+
+    rv = 0;
+    if (compactmap) {
+        rv = compactmap->count;
+    }
+
+    return rv;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                             Internal functions                             */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Hashes the key based on the type of the compactmap.  The top bit is
+ *  cleared so a live hash never equals DELETED_HASH.
+ */
+static uint64_t __hash(cvs_compactmap_t *compactmap, void *key)
+{
+    uint64_t h;
+
+    switch (compactmap->type) {
+        case CHT__STRING:
+            h = rebar_hash_string((const char*) key, NULL, compactmap->seed);
+            break;
+        case CHT__UINT32:
+            h = rebar_hash_u32(*((uint32_t*) key), compactmap->seed);
+            break;
+        default:
+            h = rebar_hash_u64(*((uint64_t*) key), compactmap->seed);
+            break;
+    }
+
+    return h & HASH_MASK;
+}
+
+
+/**
+ *  Compares the key to the key stored in the entry.
+ */
+static bool __key_equals(cvs_compactmap_t *compactmap, cvs_compactmap_entry_t *e, void *key)
+{
+    switch (compactmap->type) {
+        case CHT__STRING:
+            return (0 == strcmp((char*) key, e->key.string)) ? true : false;
+        case CHT__UINT32:
+            return (*((uint32_t*) key) == e->key.u32) ? true : false;
+        default:
+            break;
+    }
+
+    return (*((uint64_t*) key) == e->key.u64) ? true : false;
+}
+
+
+/**
+ *  Reads an index slot, whatever the width of the index.
+ */
+static size_t __slot_get(cvs_compactmap_t *compactmap, size_t i)
+{
+    switch (compactmap->index_width) {
+        case 1:
+            return ((uint8_t*) compactmap->index)[i];
+        case 2:
+            return ((uint16_t*) compactmap->index)[i];
+        default:
+            break;
+    }
+
+    return ((uint32_t*) compactmap->index)[i];
+}
+
+
+/**
+ *  Writes an index slot, whatever the width of the index.
+ */
+static void __slot_set(cvs_compactmap_t *compactmap, size_t i, size_t value)
+{
+    switch (compactmap->index_width) {
+        case 1:
+            ((uint8_t*) compactmap->index)[i] = (uint8_t) value;
+            break;
+        case 2:
+            ((uint16_t*) compactmap->index)[i] = (uint16_t) value;
+            break;
+        default:
+            ((uint32_t*) compactmap->index)[i] = (uint32_t) value;
+            break;
+    }
+}
+
+
+/**
+ *  Finds the index slot pointing at the key's entry.
+ *
+ *  The probe follows CPython's recurrence, i = 5i + 1 + perturb with more of
+ *  the hash shifted into perturb each step, which soon visits every slot.
+ *
+ *  @param compactmap the compactmap to search
+ *  @param key the key to search for
+ *  @param hash the hash of the key
+ *
+ *  @return the slot number + 1, or SLOT_EMPTY if the key is not present
+ */
+static size_t __find(cvs_compactmap_t *compactmap, void *key, uint64_t hash)
+{
+    uint64_t perturb;
+    size_t i;
+
+    if (NULL == compactmap->index) {
+        return SLOT_EMPTY;
+    }
+
+    perturb = hash;
+    i = (size_t) hash & compactmap->index_mask;
+    while (1) {
+        size_t slot = __slot_get(compactmap, i);
+
+        if (SLOT_EMPTY == slot) {
+            return SLOT_EMPTY;
+        }
+
+        if (SLOT_FIRST <= slot) {
+            cvs_compactmap_entry_t *e = &compactmap->entries[slot - SLOT_FIRST];
+
+            if ((hash == e->hash) && __key_equals(compactmap, e, key)) {
+                return i + 1;
+            }
+        }
+
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + (size_t) perturb + 1) & compactmap->index_mask;
+    }
+}
+
+
+/**
+ *  Points the first empty slot of the hash's probe sequence at an entry.
+ *  Removed slots are not reused, they are cleared by the next rebuild.
+ *
+ *  @param compactmap the compactmap to update
+ *  @param hash the hash of the entry's key
+ *  @param entry the entry number
+ */
+static void __insert_index(cvs_compactmap_t *compactmap, uint64_t hash, size_t entry)
+{
+    uint64_t perturb;
+    size_t i;
+
+    perturb = hash;
+    i = (size_t) hash & compactmap->index_mask;
+    while (SLOT_EMPTY != __slot_get(compactmap, i)) {
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + (size_t) perturb + 1) & compactmap->index_mask;
+    }
+
+    __slot_set(compactmap, i, entry + SLOT_FIRST);
+}
+
+
+/**
+ *  Squeezes the removed entries out of the entry array and rebuilds the
+ *  index, sized so the live entries take at most half the usable space.
+ *  Entries keep their relative order.
+ *
+ *  @param compactmap the compactmap to rebuild
+ */
+static void __rebuild(cvs_compactmap_t *compactmap)
+{
+    cvs_compactmap_entry_t *entries;
+    size_t slots, i, j;
+
+    slots = MIN_SLOTS;
+    while (USABLE(slots) < compactmap->count * 2 + 1) {
+        slots *= 2;
+    }
+    assert(USABLE(slots) <= UINT32_MAX - SLOT_FIRST);
+
+    /* Pack the live entries to the front, in place. */
+    entries = compactmap->entries;
+    for (i = 0, j = 0; i < compactmap->used; i++) {
+        if (DELETED_HASH != entries[i].hash) {
+            entries[j++] = entries[i];
+        }
+    }
+    compactmap->used = j;
+
+    compactmap->capacity = USABLE(slots);
+    compactmap->entries = (cvs_compactmap_entry_t*)
+        realloc(entries, compactmap->capacity * sizeof(cvs_compactmap_entry_t));
+    assert(compactmap->entries);
+
+    /* The narrowest index that can number every entry. */
+    if (compactmap->capacity + SLOT_FIRST <= UINT8_MAX) {
+        compactmap->index_width = 1;
+    } else if (compactmap->capacity + SLOT_FIRST <= UINT16_MAX) {
+        compactmap->index_width = 2;
+    } else {
+        compactmap->index_width = 4;
+    }
+
+    free(compactmap->index);
+    compactmap->index = calloc(slots, compactmap->index_width);
+    assert(compactmap->index);
+    compactmap->index_mask = slots - 1;
+
+    for (i = 0; i < compactmap->used; i++) {
+        __insert_index(compactmap, compactmap->entries[i].hash, i);
+    }
+}
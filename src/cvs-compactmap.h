@@ -0,0 +1,184 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __CVS_COMPACTMAP_H__
+#define __CVS_COMPACTMAP_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cvs-hashmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * cvs-compactmap.h implements an insertion ordered hashmap laid out like
+ * CPython's dict.  The entries (hash, key, value) are appended to a dense
+ * array in insertion order and a separate sparse index table of 1, 2 or 4
+ * byte entry numbers is probed to find them.  Iterating is a linear scan of
+ * the entry array, in the order the keys were first put.
+ *
+ * Removing a key leaves a hole in the entry array that is squeezed out the
+ * next time the table is rebuilt.  Replacing the value of a key keeps its
+ * position.  CHT__STRING keys are not copied, the strings must outlive the
+ * map.  The API mirrors cvs_hashmap.
+ */
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+
+/* Do not directly access any of the values in the structure. */
+typedef struct {
+    uint64_t hash;              /* all ones once the key is removed */
+    union {
+        char *string;
+        uint32_t u32;
+        uint64_t u64;
+    } key;
+    void *value;
+} cvs_compactmap_entry_t;
+
+/* Do not directly access any of the values in the structure. */
+typedef struct {
+    cvs_hashmap_type_t type;
+    uint64_t seed;
+    size_t count;               /* live entries */
+    size_t used;                /* entries appended, live or removed */
+    size_t capacity;            /* entries that fit before a rebuild */
+    size_t index_mask;          /* index slots - 1, slots are 2^n */
+    unsigned index_width;       /* bytes per index slot: 1, 2 or 4 */
+    void *index;                /* NULL until the first put */
+    cvs_compactmap_entry_t *entries;
+} cvs_compactmap_t;
+
+/*----------------------------------------------------------------------------*/
+/*                                 Functions                                  */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Initializes the compactmap structure.
+ *
+ *  @param compactmap the compactmap to initialize
+ *  @param type the key type, CHT__STRING, CHT__UINT32 or CHT__UINT64
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_compactmap_init(cvs_compactmap_t *compactmap, cvs_hashmap_type_t type);
+
+
+/**
+ *  Destroys the structure.
+ *
+ *  @note This does not destroy the key-value pairs of the compactmap, only
+ *        the compactmap.
+ *
+ *  @param compactmap the compactmap to destroy
+ */
+void cvs_compactmap_destroy(cvs_compactmap_t *compactmap);
+
+
+/**
+ *  Returns the value to which the specified key is mapped, or NULL if this map
+ *  contains no mapping for the key.
+ *
+ *  @param compactmap the compactmap to search
+ *  @param key the pointer to the key whose associated value is to be returned
+ *
+ *  @return the value to which the specified key is mapped, or NULL if this map
+ *          contains no mapping for the key (or any other error occurs)
+ */
+void *cvs_compactmap_get(cvs_compactmap_t *compactmap, void *key);
+
+
+/**
+ *  Returns true if this map contains a mapping for the specified key.
+ *
+ *  @param compactmap the compactmap to search
+ *  @param key the pointer to the key whose associated value is to be tested
+ *
+ *  @return true if this map contains a mapping for the specified key, or false
+ *          otherwise
+ */
+bool cvs_compactmap_contains_key(cvs_compactmap_t *compactmap, void *key);
+
+
+/**
+ *  Removes the mapping for the specified key from this map if present.
+ *
+ *  @param compactmap the compactmap to search
+ *  @param key the pointer to the key whose mapping is to be removed from the map
+ *
+ *  @return the previous value associated with key, or NULL if there was no
+ *          mapping for key (or any other error occurs)
+ */
+void *cvs_compactmap_remove(cvs_compactmap_t *compactmap, void *key);
+
+
+/**
+ *  Associates the specified value with the specified key in this map. If the
+ *  map previously contained a mapping for the key, the old value is replaced
+ *  and the key keeps its place in the iteration order.
+ *
+ *  @param compactmap the compactmap to search
+ *  @param key pointer to the key with which the specified value is to be associated
+ *  @param value value to be associated with the specified key
+ */
+void cvs_compactmap_put(cvs_compactmap_t *compactmap, void *key, void *value);
+
+
+/**
+ *  Returns true if this map contains no key-value mappings.
+ *
+ *  @param compactmap the compactmap to search
+ *
+ *  @return true if this map contains no key-value mappings
+ */
+bool cvs_compactmap_is_empty(cvs_compactmap_t *compactmap);
+
+
+/**
+ *  Iterates over the key-value mappings in insertion order and calls the
+ *  provided iterator function for each pair.
+ *
+ *  @note No compactmap manipulation is permitted during this call.
+ *
+ *  @param compactmap the compactmap to iterate over
+ *  @param iterator the iterator function to call for each pair
+ *  @param user_data additional user data passed through to the iterator function
+ */
+void cvs_compactmap_iterate(cvs_compactmap_t *compactmap,
+                            cvs_hashmap_iterator_fn_t iterator,
+                            void *user_data);
+
+
+/**
+ *  Returns the number of key-value mappings in this compactmap.
+ *
+ *  @param compactmap the compactmap to inspect
+ *
+ *  @return the number of key-value mappings in the compactmap, or 0 on error
+ */
+size_t cvs_compactmap_get_size(cvs_compactmap_t *compactmap);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,335 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "cvs-cowmap.h"
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+#define CACHE_LINE      64
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+/* A reader slot, alone on its cache line so readers never share a line. */
+struct __cvs_cowmap_reader {
+    cvs_hashmap_t *hazard;          /* the version held, accessed atomically */
+    cvs_cowmap_t *cowmap;
+    bool in_use;
+} __attribute__((aligned(CACHE_LINE)));
+
+/*----------------------------------------------------------------------------*/
+/*                            File Scoped Variables                           */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                             Function Prototypes                            */
+/*----------------------------------------------------------------------------*/
+static bool __is_held(cvs_cowmap_t *cowmap, cvs_hashmap_t *version);
+static void __free_version(cvs_cowmap_t *cowmap, cvs_hashmap_t *version);
+static size_t __reclaim(cvs_cowmap_t *cowmap);
+
+/*----------------------------------------------------------------------------*/
+/*                             External Functions                             */
+/*----------------------------------------------------------------------------*/
+
+/* See cvs-cowmap.h for details. */
+bool cvs_cowmap_init(cvs_cowmap_t *cowmap, size_t max_readers,
+                     cvs_cowmap_retire_fn_t retire, void *user_data)
+{
+    void *readers;
+
+    if ((NULL == cowmap) || (0 == max_readers)) {
+        return false;
+    }
+
+    if (0 != posix_memalign(&readers, CACHE_LINE,
+                            max_readers * sizeof(cvs_cowmap_reader_t)))
+    {
+        return false;
+    }
+
+    memset(cowmap, 0, sizeof(cvs_cowmap_t));
+    if (0 != pthread_mutex_init(&cowmap->lock, NULL)) {
+        free(readers);
+        return false;
+    }
+
+    memset(readers, 0, max_readers * sizeof(cvs_cowmap_reader_t));
+    cowmap->readers = (cvs_cowmap_reader_t*) readers;
+    cowmap->max_readers = max_readers;
+    cowmap->retire = retire;
+    cowmap->user_data = user_data;
+
+    return true;
+}
+
+
+/* See cvs-cowmap.h for details. */
+void cvs_cowmap_destroy(cvs_cowmap_t *cowmap)
+{
+    if (cowmap) {
+        size_t i;
+
+        for (i = 0; i < cowmap->retired_count; i++) {
+            __free_version(cowmap, cowmap->retired[i]);
+        }
+        if (cowmap->current) {
+            __free_version(cowmap, cowmap->current);
+        }
+
+        free(cowmap->retired);
+        free(cowmap->readers);
+        pthread_mutex_destroy(&cowmap->lock);
+        memset(cowmap, 0, sizeof(cvs_cowmap_t));
+    }
+}
+
+
+/* See cvs-cowmap.h for details. */
+bool cvs_cowmap_publish(cvs_cowmap_t *cowmap, cvs_hashmap_t *version)
+{
+    cvs_hashmap_t *old;
+
+    if ((NULL == cowmap) || (NULL == version)) {
+        return false;
+    }
+
+    /* Readers must only ever find a version nothing more will be done to. */
+    cvs_hashmap_settle(version);
+
+    pthread_mutex_lock(&cowmap->lock);
+
+    /* Publishing the current version again would retire (and free) it while
+     * it is still current.  Only publishers swap current, under the lock. */
+    if (version == cowmap->current) {
+        pthread_mutex_unlock(&cowmap->lock);
+        return false;
+    }
+
+    /* Make room to retire the old version first, so nothing fails after the
+     * swap. */
+    if (cowmap->retired_count == cowmap->retired_size) {
+        cvs_hashmap_t **retired;
+        size_t size;
+
+        size = (0 == cowmap->retired_size) ? 4 : 2 * cowmap->retired_size;
+        retired = (cvs_hashmap_t**) realloc(cowmap->retired,
+                                            size * sizeof(cvs_hashmap_t*));
+        if (NULL == retired) {
+            pthread_mutex_unlock(&cowmap->lock);
+            return false;
+        }
+        cowmap->retired = retired;
+        cowmap->retired_size = size;
+    }
+
+    old = __atomic_exchange_n(&cowmap->current, version, __ATOMIC_SEQ_CST);
+    if (old) {
+        cowmap->retired[cowmap->retired_count++] = old;
+    }
+    __reclaim(cowmap);
+
+    pthread_mutex_unlock(&cowmap->lock);
+
+    return true;
+}
+
+
+/* See cvs-cowmap.h for details. */
+cvs_hashmap_t *cvs_cowmap_copy(cvs_cowmap_t *cowmap)
+{
+    cvs_hashmap_t *copy = NULL;
+
+    if (cowmap) {
+        /* The current version is only freed under the lock, after it has
+         * been replaced. */
+        pthread_mutex_lock(&cowmap->lock);
+        if (cowmap->current) {
+            copy = (cvs_hashmap_t*) malloc(sizeof(cvs_hashmap_t));
+            if ((copy) && (false == cvs_hashmap_clone(copy, cowmap->current))) {
+                free(copy);
+                copy = NULL;
+            }
+        }
+        pthread_mutex_unlock(&cowmap->lock);
+    }
+
+    return copy;
+}
+
+
+/* See cvs-cowmap.h for details. */
+size_t cvs_cowmap_reclaim(cvs_cowmap_t *cowmap)
+{
+    size_t rv = 0;
+
+    if (cowmap) {
+        pthread_mutex_lock(&cowmap->lock);
+        rv = __reclaim(cowmap);
+        pthread_mutex_unlock(&cowmap->lock);
+    }
+
+    return rv;
+}
+
+
+/* See cvs-cowmap.h for details. */
+cvs_cowmap_reader_t *cvs_cowmap_reader_new(cvs_cowmap_t *cowmap)
+{
+    cvs_cowmap_reader_t *rv = NULL;
+
+    if (cowmap) {
+        size_t i;
+
+        pthread_mutex_lock(&cowmap->lock);
+        for (i = 0; i < cowmap->max_readers; i++) {
+            if (false == cowmap->readers[i].in_use) {
+                rv = &cowmap->readers[i];
+                rv->in_use = true;
+                rv->cowmap = cowmap;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&cowmap->lock);
+    }
+
+    return rv;
+}
+
+
+/* See cvs-cowmap.h for details. */
+void cvs_cowmap_reader_free(cvs_cowmap_reader_t *reader)
+{
+    if (reader) {
+        cvs_cowmap_t *cowmap = reader->cowmap;
+
+        pthread_mutex_lock(&cowmap->lock);
+        __atomic_store_n(&reader->hazard, NULL, __ATOMIC_RELEASE);
+        reader->in_use = false;
+        pthread_mutex_unlock(&cowmap->lock);
+    }
+}
+
+
+/* See cvs-cowmap.h for details. */
+cvs_hashmap_t *cvs_cowmap_acquire(cvs_cowmap_reader_t *reader)
+{
+    cvs_hashmap_t *version = NULL;
+
+    if (reader) {
+        cvs_hashmap_t **current = &reader->cowmap->current;
+
+        /* Once the hazard is visible, a version that is still current is
+         * safe: the writer checks the hazards after it swaps, so it either
+         * sees this one or swapped before the check below. */
+        version = __atomic_load_n(current, __ATOMIC_ACQUIRE);
+        while (1) {
+            cvs_hashmap_t *again;
+
+            __atomic_store_n(&reader->hazard, version, __ATOMIC_SEQ_CST);
+            again = __atomic_load_n(current, __ATOMIC_SEQ_CST);
+            if (again == version) {
+                break;
+            }
+            version = again;
+        }
+    }
+
+    return version;
+}
+
+
+/* See cvs-cowmap.h for details. */
+void cvs_cowmap_release(cvs_cowmap_reader_t *reader)
+{
+    if (reader) {
+        __atomic_store_n(&reader->hazard, NULL, __ATOMIC_RELEASE);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                             Internal functions                             */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Tells if any reader holds a version.
+ *
+ *  @param cowmap the structure to check
+ *  @param version the version to look for
+ *
+ *  @return true if a reader holds it, false otherwise
+ */
+static bool __is_held(cvs_cowmap_t *cowmap, cvs_hashmap_t *version)
+{
+    size_t i;
+
+    for (i = 0; i < cowmap->max_readers; i++) {
+        if (version == __atomic_load_n(&cowmap->readers[i].hazard, __ATOMIC_SEQ_CST)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ *  Hands a version to the retire function, then destroys and frees it.
+ *
+ *  @param cowmap the structure the version belonged to
+ *  @param version the version to free
+ */
+static void __free_version(cvs_cowmap_t *cowmap, cvs_hashmap_t *version)
+{
+    if (cowmap->retire) {
+        (cowmap->retire)(version, cowmap->user_data);
+    }
+    cvs_hashmap_destroy(version);
+    free(version);
+}
+
+
+/**
+ *  Frees the retired versions no reader holds.  The lock must be held.
+ *
+ *  @param cowmap the structure to reclaim versions of
+ *
+ *  @return the number of retired versions left
+ */
+static size_t __reclaim(cvs_cowmap_t *cowmap)
+{
+    size_t i, kept;
+
+    kept = 0;
+    for (i = 0; i < cowmap->retired_count; i++) {
+        cvs_hashmap_t *version = cowmap->retired[i];
+
+        if (__is_held(cowmap, version)) {
+            cowmap->retired[kept++] = version;
+        } else {
+            __free_version(cowmap, version);
+        }
+    }
+    cowmap->retired_count = kept;
+
+    return kept;
+}
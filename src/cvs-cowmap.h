@@ -0,0 +1,197 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __CVS_COWMAP_H__
+#define __CVS_COWMAP_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "cvs-hashmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * cvs-cowmap.h publishes versions of a cvs_hashmap to readers on other
+ * threads without locking them.  A writer builds a new version privately,
+ * from scratch or from cvs_cowmap_copy() of the current one, and
+ * cvs_cowmap_publish() swaps it in with one atomic exchange.  Readers see
+ * either the old version or the new one, never a version being changed.
+ *
+ * Each reader thread registers once and gets a slot of its own, on its own
+ * cache line.  cvs_cowmap_acquire() records the current version in the slot
+ * (a hazard pointer) and cvs_cowmap_release() clears it, so reading costs no
+ * lock and no shared counter.  A replaced version is kept while any slot
+ * holds it, and freed by the first publish or cvs_cowmap_reclaim() after
+ * its last reader releases it.
+ *
+ * Published versions are settled (see cvs_hashmap_settle()) and must not be
+ * changed afterwards; readers may call the read only cvs_hashmap functions
+ * on them.  Writers must not run concurrently with each other.
+ */
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Called for a version no reader can reach any more, before the version is
+ *  destroyed and freed.  This is the chance to free values that belong to
+ *  this version only; a version made by cvs_cowmap_copy() shares its values
+ *  with the version it was copied from.
+ *
+ *  @param version the version being freed
+ */
+typedef void (*cvs_cowmap_retire_fn_t)(cvs_hashmap_t *version, void *user_data);
+
+
+struct __cvs_cowmap_reader;
+typedef struct __cvs_cowmap_reader cvs_cowmap_reader_t;
+
+/* Do not directly access any of the values in the structure. */
+typedef struct {
+    cvs_hashmap_t *current;         /* accessed atomically */
+    pthread_mutex_t lock;           /* guards everything but current */
+    cvs_cowmap_reader_t *readers;
+    size_t max_readers;
+    cvs_hashmap_t **retired;        /* replaced, but maybe still read */
+    size_t retired_count;
+    size_t retired_size;
+    cvs_cowmap_retire_fn_t retire;
+    void *user_data;
+} cvs_cowmap_t;
+
+/*----------------------------------------------------------------------------*/
+/*                                 Functions                                  */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Initializes the structure, with no version published.
+ *
+ *  @note This is not thread safe, the structure must not be shared until it
+ *        returns.
+ *
+ *  @param cowmap the structure to initialize
+ *  @param max_readers the number of reader slots, must not be 0
+ *  @param retire the function called for each version as it is freed, may
+ *         be NULL
+ *  @param user_data additional user data passed through to retire
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_cowmap_init(cvs_cowmap_t *cowmap, size_t max_readers,
+                     cvs_cowmap_retire_fn_t retire, void *user_data);
+
+
+/**
+ *  Frees every version, calling the retire function for each.
+ *
+ *  @note No reader may hold a version, and no other thread may use the
+ *        structure, during or after this call.
+ *
+ *  @param cowmap the structure to destroy
+ */
+void cvs_cowmap_destroy(cvs_cowmap_t *cowmap);
+
+
+/**
+ *  Makes a version the current one.  The version is settled first, and from
+ *  then on belongs to the structure: it must have been allocated with
+ *  malloc(), and must not be changed or freed by the caller.
+ *
+ *  @param cowmap the structure to publish to
+ *  @param version the new version
+ *
+ *  @return true if successful, false otherwise (the version still belongs to
+ *          the caller, unless it was already the current version)
+ */
+bool cvs_cowmap_publish(cvs_cowmap_t *cowmap, cvs_hashmap_t *version);
+
+
+/**
+ *  Makes a private copy of the current version with cvs_hashmap_clone(), for
+ *  a writer to change and publish.
+ *
+ *  @param cowmap the structure to copy from
+ *
+ *  @return the copy, allocated with malloc(), or NULL if nothing has been
+ *          published (or any other error occurs)
+ */
+cvs_hashmap_t *cvs_cowmap_copy(cvs_cowmap_t *cowmap);
+
+
+/**
+ *  Frees the replaced versions no reader holds any more.  Publishing does
+ *  this too.
+ *
+ *  @param cowmap the structure to reclaim versions of
+ *
+ *  @return the number of replaced versions still held by readers
+ */
+size_t cvs_cowmap_reclaim(cvs_cowmap_t *cowmap);
+
+
+/**
+ *  Claims a reader slot for the calling thread.
+ *
+ *  @param cowmap the structure to read
+ *
+ *  @return the reader, or NULL if every slot is taken
+ */
+cvs_cowmap_reader_t *cvs_cowmap_reader_new(cvs_cowmap_t *cowmap);
+
+
+/**
+ *  Gives a reader slot back.  The reader must not hold a version.
+ *
+ *  @param reader the reader to give back
+ */
+void cvs_cowmap_reader_free(cvs_cowmap_reader_t *reader);
+
+
+/**
+ *  Gets the current version and keeps it from being freed until released.
+ *  A reader holds one version at a time, acquiring again releases the
+ *  version held before.
+ *
+ *  @param reader the calling thread's reader
+ *
+ *  @return the current version, or NULL if nothing has been published
+ */
+cvs_hashmap_t *cvs_cowmap_acquire(cvs_cowmap_reader_t *reader);
+
+
+/**
+ *  Lets the version a reader holds be freed.  The reader must not use it
+ *  afterwards.
+ *
+ *  @param reader the calling thread's reader
+ */
+void cvs_cowmap_release(cvs_cowmap_reader_t *reader);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
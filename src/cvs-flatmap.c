@@ -0,0 +1,433 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "cvs-flatmap.h"
+#include "rebar-hash.h"
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+/* The number of slots probed at once. */
+#define GROUP_WIDTH     16
+
+/* Control byte values.  A full slot holds the low 7 bits of the key's hash,
+ * so the sign bit alone tells empty/deleted apart from full. */
+#define CTRL_EMPTY      ((int8_t) -128)
+#define CTRL_DELETED    ((int8_t) -2)
+
+#define H1(hash)        ((hash) >> 7)
+#define H2(hash)        ((int8_t) ((hash) & 0x7f))
+
+/* The table is resized once 7/8ths of the slots are used. */
+#define MAX_LOAD(slots) ((slots) - (slots) / 8)
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                            File Scoped Variables                           */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                             Function Prototypes                            */
+/*----------------------------------------------------------------------------*/
+static uint64_t __hash(cvs_flatmap_t *flatmap, void *key);
+static uint32_t __match(const int8_t *group, int8_t value);
+static cvs_flatmap_slot_t *__find(cvs_flatmap_t *flatmap, void *key, uint64_t hash);
+static size_t __find_free(cvs_flatmap_t *flatmap, uint64_t hash);
+static void __resize(cvs_flatmap_t *flatmap);
+
+/*----------------------------------------------------------------------------*/
+/*                             External Functions                             */
+/*----------------------------------------------------------------------------*/
+/* See cvs-flatmap.h for details. */
+bool cvs_flatmap_init(cvs_flatmap_t *flatmap, cvs_hashmap_type_t type)
+{
+    bool rv;
+
+    rv = false;
+    if (flatmap) {
+        switch( type ) {
+            case CHT__UINT32:
+            case CHT__UINT64:
+                memset(flatmap, 0, sizeof(cvs_flatmap_t));
+                flatmap->type = type;
+                flatmap->seed = rebar_hash_seed();
+                rv = true;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return rv;
+}
+
+
+/* See cvs-flatmap.h for details. */
+void cvs_flatmap_destroy(cvs_flatmap_t *flatmap)
+{
+    if (flatmap) {
+        free(flatmap->ctrl);
+        free(flatmap->slots);
+        flatmap->ctrl = NULL;
+        flatmap->slots = NULL;
+        flatmap->group_mask = 0;
+        flatmap->growth_left = 0;
+        flatmap->count = 0;
+    }
+}
+
+
+/* See cvs-flatmap.h for details. */
+void *cvs_flatmap_get(cvs_flatmap_t *flatmap, void *key)
+{
+    void *rv;
+    cvs_flatmap_slot_t *s;
+
+    rv = NULL;
+    if ((flatmap) && (key)) {
+        s = __find(flatmap, key, __hash(flatmap, key));
+        if (s) {
+            rv = s->value;
+        }
+    }
+
+    return rv;
+}
+
+
+/* See cvs-flatmap.h for details. */
+bool cvs_flatmap_contains_key(cvs_flatmap_t *flatmap, void *key)
+{
+    if ((flatmap) && (key)) {
+        return (NULL != __find(flatmap, key, __hash(flatmap, key))) ? true : false;
+    }
+
+    return false;
+}
+
+
+/* See cvs-flatmap.h for details. */
+void *cvs_flatmap_remove(cvs_flatmap_t *flatmap, void *key)
+{
+    void *rv;
+    cvs_flatmap_slot_t *s;
+
+    rv = NULL;
+    if ((flatmap) && (key)) {
+        s = __find(flatmap, key, __hash(flatmap, key));
+        if (s) {
+            size_t i, group;
+
+            rv = s->value;
+            i = (size_t) (s - flatmap->slots);
+            group = i & ~((size_t) GROUP_WIDTH - 1);
+
+            /* A probe stops at a group with an empty slot, so if this group
+             * already has one nothing can probe past it and the slot can be
+             * reused for free.  Otherwise leave a tombstone. */
+            if (0 != __match(&flatmap->ctrl[group], CTRL_EMPTY)) {
+                flatmap->ctrl[i] = CTRL_EMPTY;
+                flatmap->growth_left++;
+            } else {
+                flatmap->ctrl[i] = CTRL_DELETED;
+            }
+            flatmap->count--;
+        }
+    }
+
+    return rv;
+}
+
+
+/* See cvs-flatmap.h for details. */
+void cvs_flatmap_put(cvs_flatmap_t *flatmap, void *key, void *value)
+{
+    uint64_t hash;
+    cvs_flatmap_slot_t *s;
+    size_t i;
+
+    if ((NULL == flatmap) || (NULL == key)) {
+        return;
+    }
+
+    hash = __hash(flatmap, key);
+    s = __find(flatmap, key, hash);
+    if (s) {
+        s->value = value;
+        return;
+    }
+
+    if (0 == flatmap->growth_left) {
+        __resize(flatmap);
+    }
+
+    i = __find_free(flatmap, hash);
+    if (CTRL_EMPTY == flatmap->ctrl[i]) {
+        flatmap->growth_left--;
+    }
+    flatmap->ctrl[i] = H2(hash);
+
+    s = &flatmap->slots[i];
+    if (CHT__UINT64 == flatmap->type) {
+        s->key.u64 = *((uint64_t*) key);
+    } else {
+        s->key.u32 = *((uint32_t*) key);
+    }
+    s->value = value;
+    flatmap->count++;
+}
+
+
+/* See cvs-flatmap.h for details. */
+bool cvs_flatmap_is_empty(cvs_flatmap_t *flatmap)
+{
+    return (0 == cvs_flatmap_get_size(flatmap)) ? true : false;
+}
+
+
+/* See cvs-flatmap.h for details. */
+void cvs_flatmap_iterate(cvs_flatmap_t *flatmap,
+                         cvs_hashmap_iterator_fn_t iterator,
+                         void *user_data)
+{
+    if ((flatmap) && (iterator) && (flatmap->slots)) {
+        size_t i, slots;
+
+        slots = (flatmap->group_mask + 1) * GROUP_WIDTH;
+        for (i = 0; i < slots; i++) {
+            cvs_flatmap_slot_t *s;
+
+            if (flatmap->ctrl[i] < 0) {
+                continue;
+            }
+
+            s = &flatmap->slots[i];
+            if (CHT__UINT64 == flatmap->type) {
+                if (false == (iterator)(&s->key.u64, s->value, user_data)) {
+                    return;
+                }
+            } else {
+                if (false == (iterator)(&s->key.u32, s->value, user_data)) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+
+/* See cvs-flatmap.h for details. */
+size_t cvs_flatmap_get_size(cvs_flatmap_t *flatmap)
+{
+    size_t rv;
+
+    rv = 0;
+    if (flatmap) {
+        rv = flatmap->count;
+    }
+
+    return rv;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                             Internal functions                             */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Hashes the key based on the type of the flatmap.
+ */
+static uint64_t __hash(cvs_flatmap_t *flatmap, void *key)
+{
+    if (CHT__UINT64 == flatmap->type) {
+        return rebar_hash_u64(*((uint64_t*) key), flatmap->seed);
+    }
+
+    return rebar_hash_u32(*((uint32_t*) key), flatmap->seed);
+}
+
+
+/**
+ *  Compares all the control bytes of a group to a value.
+ *
+ *  @param group the first control byte of the group
+ *  @param value the control byte value to look for
+ *
+ *  @return a bitmask with bit n set if group[n] equals the value
+ */
+static uint32_t __match(const int8_t *group, int8_t value)
+{
+#if defined(__SSE2__)
+    __m128i ctrl = _mm_load_si128((const __m128i*) group);
+
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value)));
+#else
+    uint32_t mask;
+    int i;
+
+    mask = 0;
+    for (i = 0; i < GROUP_WIDTH; i++) {
+        if (value == group[i]) {
+            mask |= 1u << i;
+        }
+    }
+
+    return mask;
+#endif
+}
+
+
+/**
+ *  Finds the slot holding the key.
+ *
+ *  The groups are probed in triangular order (+1, +2, +3, ... groups) which
+ *  visits every group of a power of 2 sized table exactly once.  A group with
+ *  an empty slot ends the probe since an insert would have used it.
+ *
+ *  @param flatmap the flatmap to search
+ *  @param key the key to search for
+ *  @param hash the hash of the key
+ *
+ *  @return the slot of the key or NULL
+ */
+static cvs_flatmap_slot_t *__find(cvs_flatmap_t *flatmap, void *key, uint64_t hash)
+{
+    size_t group, step;
+    int8_t h2;
+
+    if (NULL == flatmap->slots) {
+        return NULL;
+    }
+
+    h2 = H2(hash);
+    group = (size_t) H1(hash) & flatmap->group_mask;
+    for (step = 1; step <= flatmap->group_mask + 1; step++) {
+        const int8_t *ctrl = &flatmap->ctrl[group * GROUP_WIDTH];
+        uint32_t mask;
+
+        for (mask = __match(ctrl, h2); 0 != mask; mask &= mask - 1) {
+            cvs_flatmap_slot_t *s;
+
+            s = &flatmap->slots[group * GROUP_WIDTH + __builtin_ctz(mask)];
+            if (CHT__UINT64 == flatmap->type) {
+                if (*((uint64_t*) key) == s->key.u64) {
+                    return s;
+                }
+            } else if (*((uint32_t*) key) == s->key.u32) {
+                return s;
+            }
+        }
+
+        if (0 != __match(ctrl, CTRL_EMPTY)) {
+            break;
+        }
+        group = (group + step) & flatmap->group_mask;
+    }
+
+    return NULL;
+}
+
+
+/**
+ *  Finds the first empty or deleted slot in the hash's probe sequence.
+ *
+ *  @note There must be at least one free slot in the table.
+ *
+ *  @return the index of the free slot
+ */
+static size_t __find_free(cvs_flatmap_t *flatmap, uint64_t hash)
+{
+    size_t group, step;
+
+    group = (size_t) H1(hash) & flatmap->group_mask;
+    for (step = 1; ; step++) {
+        const int8_t *ctrl = &flatmap->ctrl[group * GROUP_WIDTH];
+        uint32_t mask;
+
+        mask = __match(ctrl, CTRL_EMPTY) | __match(ctrl, CTRL_DELETED);
+        if (0 != mask) {
+            return group * GROUP_WIDTH + __builtin_ctz(mask);
+        }
+        group = (group + step) & flatmap->group_mask;
+    }
+}
+
+
+/**
+ *  Rebuilds the table into fresh arrays.  The table doubles unless most of
+ *  the used slots were tombstones, in which case it is rebuilt at the same
+ *  size to reclaim them.
+ *
+ *  @param flatmap the flatmap to resize
+ */
+static void __resize(cvs_flatmap_t *flatmap)
+{
+    int8_t *old_ctrl;
+    cvs_flatmap_slot_t *old_slots;
+    size_t old_slot_count, slot_count, i;
+
+    old_ctrl = flatmap->ctrl;
+    old_slots = flatmap->slots;
+    old_slot_count = (old_slots) ? (flatmap->group_mask + 1) * GROUP_WIDTH : 0;
+
+    slot_count = GROUP_WIDTH;
+    while (MAX_LOAD(slot_count) <= flatmap->count * 2) {
+        slot_count *= 2;
+    }
+
+    /* The control bytes are loaded a group at a time with aligned loads. */
+    if (0 != posix_memalign((void**) &flatmap->ctrl, GROUP_WIDTH, slot_count)) {
+        flatmap->ctrl = NULL;
+    }
+    flatmap->slots = (cvs_flatmap_slot_t*) malloc(slot_count * sizeof(cvs_flatmap_slot_t));
+    assert(flatmap->ctrl && flatmap->slots);
+
+    memset(flatmap->ctrl, CTRL_EMPTY, slot_count);
+    flatmap->group_mask = slot_count / GROUP_WIDTH - 1;
+    flatmap->growth_left = MAX_LOAD(slot_count) - flatmap->count;
+
+    for (i = 0; i < old_slot_count; i++) {
+        uint64_t hash;
+        size_t j;
+
+        if (old_ctrl[i] < 0) {
+            continue;
+        }
+
+        hash = __hash(flatmap, &old_slots[i].key);
+        j = __find_free(flatmap, hash);
+        flatmap->ctrl[j] = H2(hash);
+        flatmap->slots[j] = old_slots[i];
+    }
+
+    free(old_ctrl);
+    free(old_slots);
+}
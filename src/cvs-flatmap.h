@@ -0,0 +1,172 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __CVS_FLATMAP_H__
+#define __CVS_FLATMAP_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cvs-hashmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * cvs-flatmap.h implements an open addressing hashmap for CHT__UINT32 and
+ * CHT__UINT64 keys.  Keys and values are stored inline in a flat slot array
+ * and a parallel array of control bytes is probed 16 slots at a time (with a
+ * single SSE2 compare when available).  The API mirrors cvs_hashmap.
+ */
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+
+/* Do not directly access any of the values in the structure. */
+typedef struct {
+    union {
+        uint32_t u32;
+        uint64_t u64;
+    } key;
+    void *value;
+} cvs_flatmap_slot_t;
+
+/* Do not directly access any of the values in the structure. */
+typedef struct {
+    cvs_hashmap_type_t type;
+    uint64_t seed;
+    size_t count;
+    size_t growth_left;         /* inserts into empty slots before a resize */
+    size_t group_mask;          /* group count - 1, group count is 2^n */
+    int8_t *ctrl;               /* one control byte per slot */
+    cvs_flatmap_slot_t *slots;  /* NULL until the first put */
+} cvs_flatmap_t;
+
+/*----------------------------------------------------------------------------*/
+/*                                 Functions                                  */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Initializes the flatmap structure.
+ *
+ *  @param flatmap the flatmap to initialize
+ *  @param type the key type, only CHT__UINT32 and CHT__UINT64 are supported
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_flatmap_init(cvs_flatmap_t *flatmap, cvs_hashmap_type_t type);
+
+
+/**
+ *  Destroys the structure.
+ *
+ *  @note This does not destroy the values of the flatmap, only the flatmap.
+ *
+ *  @param flatmap the flatmap to destroy
+ */
+void cvs_flatmap_destroy(cvs_flatmap_t *flatmap);
+
+
+/**
+ *  Returns the value to which the specified key is mapped, or NULL if this map
+ *  contains no mapping for the key.
+ *
+ *  @param flatmap the flatmap to search
+ *  @param key the pointer to the key whose associated value is to be returned
+ *
+ *  @return the value to which the specified key is mapped, or NULL if this map
+ *          contains no mapping for the key (or any other error occurs)
+ */
+void *cvs_flatmap_get(cvs_flatmap_t *flatmap, void *key);
+
+
+/**
+ *  Returns true if this map contains a mapping for the specified key.
+ *
+ *  @param flatmap the flatmap to search
+ *  @param key the pointer to the key whose associated value is to be tested
+ *
+ *  @return true if this map contains a mapping for the specified key, or false
+ *          otherwise
+ */
+bool cvs_flatmap_contains_key(cvs_flatmap_t *flatmap, void *key);
+
+
+/**
+ *  Removes the mapping for the specified key from this map if present.
+ *
+ *  @param flatmap the flatmap to search
+ *  @param key the pointer to the key whose mapping is to be removed from the map
+ *
+ *  @return the previous value associated with key, or NULL if there was no
+ *          mapping for key (or any other error occurs)
+ */
+void *cvs_flatmap_remove(cvs_flatmap_t *flatmap, void *key);
+
+
+/**
+ *  Associates the specified value with the specified key in this map. If the
+ *  map previously contained a mapping for the key, the old value is replaced.
+ *
+ *  @param flatmap the flatmap to search
+ *  @param key pointer to the key with which the specified value is to be associated
+ *  @param value value to be associated with the specified key
+ */
+void cvs_flatmap_put(cvs_flatmap_t *flatmap, void *key, void *value);
+
+
+/**
+ *  Returns true if this map contains no key-value mappings.
+ *
+ *  @param flatmap the flatmap to search
+ *
+ *  @return true if this map contains no key-value mappings
+ */
+bool cvs_flatmap_is_empty(cvs_flatmap_t *flatmap);
+
+
+/**
+ *  Iterates over the key-value mappings and calls the provided iterator
+ *  function for each pair.
+ *
+ *  @note No flatmap manipulation is permitted during this call.
+ *
+ *  @param flatmap the flatmap to iterate over
+ *  @param iterator the iterator function to call for each pair
+ *  @param user_data additional user data passed through to the iterator function
+ */
+void cvs_flatmap_iterate(cvs_flatmap_t *flatmap,
+                         cvs_hashmap_iterator_fn_t iterator,
+                         void *user_data);
+
+
+/**
+ *  Returns the number of key-value mappings in this flatmap.
+ *
+ *  @param flatmap the flatmap to inspect
+ *
+ *  @return the number of key-value mappings in the flatmap, or 0 on error
+ */
+size_t cvs_flatmap_get_size(cvs_flatmap_t *flatmap);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
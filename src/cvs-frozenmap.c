@@ -0,0 +1,505 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cvs-frozenmap.h"
+#include "rebar-hash.h"
+#include "rebar-key.h"
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+/* Displacements tried for one bucket before starting over with a new seed. */
+#define MAX_DISPLACEMENT    (1u << 20)
+#define MAX_SEEDS           16
+
+#define GOLDEN64            0x9e3779b97f4a7c15ULL
+
+/* Keys in the pool start on 8 byte boundaries. */
+#define ALIGN8(x)           (((x) + 7) & ~((size_t) 7))
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+/* The state of the copy out of the hashmap, passed through its iterator. */
+typedef struct {
+    cvs_frozenmap_t *frozenmap;
+    cvs_frozenmap_entry_t *entries;
+    size_t count;
+    size_t pool_size;
+} cvs_frozenmap_collector_t;
+
+/* The working arrays of one build attempt. */
+typedef struct {
+    uint64_t *hashes;           /* per key */
+    uint64_t *taken;            /* a bit per slot */
+    size_t *start;              /* per bucket, where its keys start in members */
+    size_t *members;            /* key numbers grouped by bucket */
+    size_t *order;              /* buckets, largest first */
+    size_t *slots;              /* the slot of each member */
+} cvs_frozenmap_scratch_t;
+
+/*----------------------------------------------------------------------------*/
+/*                            File Scoped Variables                           */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                             Function Prototypes                            */
+/*----------------------------------------------------------------------------*/
+static bool __measure(void *key, void *value, void *user_data);
+static bool __collect(void *key, void *value, void *user_data);
+static cvs_frozenmap_entry_t *__find(cvs_frozenmap_t *frozenmap, void *key);
+static bool __build(cvs_frozenmap_t *frozenmap, cvs_frozenmap_entry_t *entries);
+static bool __place(cvs_frozenmap_t *frozenmap, cvs_frozenmap_entry_t *entries,
+                    cvs_frozenmap_scratch_t *s);
+static size_t __range(uint64_t hash, size_t n);
+static size_t __slot(uint64_t hash, uint32_t displacement, size_t n);
+static void __rank(cvs_frozenmap_t *frozenmap, const uint64_t *taken);
+
+/*----------------------------------------------------------------------------*/
+/*                             External Functions                             */
+/*----------------------------------------------------------------------------*/
+/* See cvs-frozenmap.h for details. */
+bool cvs_frozenmap_freeze(cvs_frozenmap_t *frozenmap, cvs_hashmap_t *hashmap)
+{
+    cvs_frozenmap_collector_t c;
+    int tries;
+
+    if ((NULL == frozenmap) || (NULL == hashmap)) {
+        return false;
+    }
+
+    memset(frozenmap, 0, sizeof(cvs_frozenmap_t));
+    frozenmap->type = hashmap->type;
+    frozenmap->key_length = hashmap->key_length;
+
+    memset(&c, 0, sizeof(c));
+    c.frozenmap = frozenmap;
+    cvs_hashmap_iterate(hashmap, __measure, &c);
+    if (0 == c.count) {
+        return true;
+    }
+
+    frozenmap->count = c.count;
+    frozenmap->slot_count = c.count + c.count / CVSFM_LOAD_PERCENT + 1;
+    frozenmap->bucket_count = (c.count + CVSFM_BUCKET_KEYS - 1) / CVSFM_BUCKET_KEYS;
+    frozenmap->pool = (uint8_t*) malloc(c.pool_size);
+    frozenmap->entries = (cvs_frozenmap_entry_t*)
+        malloc(c.count * sizeof(cvs_frozenmap_entry_t));
+    frozenmap->displacements = (uint32_t*)
+        malloc(frozenmap->bucket_count * sizeof(uint32_t));
+    frozenmap->ranks = (uint64_t*)
+        malloc(2 * ((frozenmap->slot_count + 63) / 64) * sizeof(uint64_t));
+    c.entries = (cvs_frozenmap_entry_t*) malloc(c.count * sizeof(cvs_frozenmap_entry_t));
+
+    if ((NULL != frozenmap->pool) && (NULL != frozenmap->entries) &&
+        (NULL != frozenmap->displacements) && (NULL != frozenmap->ranks) &&
+        (NULL != c.entries)) {
+        c.count = 0;
+        c.pool_size = 0;
+        cvs_hashmap_iterate(hashmap, __collect, &c);
+
+        /* A seed that leaves some bucket without a displacement is rare,
+         * but possible, so try a few. */
+        for (tries = 0; tries < MAX_SEEDS; tries++) {
+            frozenmap->seed = rebar_hash_seed();
+            if (__build(frozenmap, c.entries)) {
+                free(c.entries);
+                return true;
+            }
+        }
+    }
+
+    free(c.entries);
+    cvs_frozenmap_destroy(frozenmap);
+
+    return false;
+}
+
+
+/* See cvs-frozenmap.h for details. */
+void cvs_frozenmap_destroy(cvs_frozenmap_t *frozenmap)
+{
+    if (frozenmap) {
+        free(frozenmap->displacements);
+        free(frozenmap->ranks);
+        free(frozenmap->entries);
+        free(frozenmap->pool);
+        frozenmap->displacements = NULL;
+        frozenmap->ranks = NULL;
+        frozenmap->entries = NULL;
+        frozenmap->pool = NULL;
+        frozenmap->bucket_count = 0;
+        frozenmap->slot_count = 0;
+        frozenmap->count = 0;
+    }
+}
+
+
+/* See cvs-frozenmap.h for details. */
+void *cvs_frozenmap_get(cvs_frozenmap_t *frozenmap, void *key)
+{
+    cvs_frozenmap_entry_t *e;
+
+    e = __find(frozenmap, key);
+
+    return (e) ? e->value : NULL;
+}
+
+
+/* See cvs-frozenmap.h for details. */
+bool cvs_frozenmap_contains_key(cvs_frozenmap_t *frozenmap, void *key)
+{
+    return (NULL != __find(frozenmap, key)) ? true : false;
+}
+
+
+/* See cvs-frozenmap.h for details. */
+bool cvs_frozenmap_is_empty(cvs_frozenmap_t *frozenmap)
+{
+    return (0 == cvs_frozenmap_get_size(frozenmap)) ? true : false;
+}
+
+
+/* See cvs-frozenmap.h for details. */
+void cvs_frozenmap_iterate(cvs_frozenmap_t *frozenmap,
+                           cvs_hashmap_iterator_fn_t iterator,
+                           void *user_data)
+{
+    if ((frozenmap) && (iterator)) {
+        size_t i;
+
+        for (i = 0; i < frozenmap->count; i++) {
+            cvs_frozenmap_entry_t *e = &frozenmap->entries[i];
+            cvs_hashmap_blob_t blob;
+            void *key;
+
+            key = (void*) e->key;
+            if (CHT__BLOB == frozenmap->type) {
+                blob.data = e->key;
+                blob.length = e->key_length;
+                key = &blob;
+            }
+
+            if (false == (iterator)(key, e->value, user_data)) {
+                return;
+            }
+        }
+    }
+}
+
+
+/* See cvs-frozenmap.h for details. */
+size_t cvs_frozenmap_get_size(cvs_frozenmap_t *frozenmap)
+{
+    size_t rv;
+
+    rv = 0;
+    if (frozenmap) {
+        rv = frozenmap->count;
+    }
+
+    return rv;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                             Internal functions                             */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Counts the keys and the pool space they need.
+ */
+static bool __measure(void *key, void *value, void *user_data)
+{
+    cvs_frozenmap_collector_t *c = (cvs_frozenmap_collector_t*) user_data;
+    size_t length;
+
+    (void) value;
+    rebar_key_bytes(c->frozenmap->type, c->frozenmap->key_length, key, &length);
+
+    /* Strings keep their NUL so the iterator can hand them out. */
+    c->pool_size += ALIGN8(length + 1);
+    c->count++;
+
+    return true;
+}
+
+
+/**
+ *  Copies a key into the pool and records the pair.
+ */
+static bool __collect(void *key, void *value, void *user_data)
+{
+    cvs_frozenmap_collector_t *c = (cvs_frozenmap_collector_t*) user_data;
+    cvs_frozenmap_entry_t *e = &c->entries[c->count++];
+    uint8_t *dest = &c->frozenmap->pool[c->pool_size];
+    const void *data;
+    size_t length;
+
+    data = rebar_key_bytes(c->frozenmap->type, c->frozenmap->key_length, key, &length);
+    if (0 < length) {
+        memcpy(dest, data, length);
+    }
+    dest[length] = '\0';
+    c->pool_size += ALIGN8(length + 1);
+
+    e->key = dest;
+    e->key_length = length;
+    e->value = value;
+
+    return true;
+}
+
+
+/**
+ *  Finds the one entry the key can be in and checks that it is the key.
+ *
+ *  @param frozenmap the frozen map to search
+ *  @param key the key to search for
+ *
+ *  @return the entry of the key, or NULL
+ */
+static cvs_frozenmap_entry_t *__find(cvs_frozenmap_t *frozenmap, void *key)
+{
+    const void *data;
+    cvs_frozenmap_entry_t *e;
+    const uint64_t *rank;
+    uint64_t hash, below;
+    uint32_t displacement;
+    size_t length, slot;
+
+    if ((NULL == frozenmap) || (NULL == key) || (0 == frozenmap->count)) {
+        return NULL;
+    }
+
+    data = rebar_key_bytes(frozenmap->type, frozenmap->key_length, key, &length);
+    hash = rebar_hash_bytes(data, length, frozenmap->seed);
+
+    displacement = frozenmap->displacements[__range(hash, frozenmap->bucket_count)];
+    slot = __slot(hash, displacement, frozenmap->slot_count);
+
+    /* The used slots before this one, within its word and before it. */
+    rank = &frozenmap->ranks[2 * (slot / 64)];
+    below = (1ULL << (slot % 64)) - 1;
+    if (0 == (rank[0] & (1ULL << (slot % 64)))) {
+        return NULL;
+    }
+    e = &frozenmap->entries[rank[1] + (size_t) __builtin_popcountll(rank[0] & below)];
+    if ((length == e->key_length) && (0 == memcmp(data, e->key, length))) {
+        return e;
+    }
+
+    return NULL;
+}
+
+
+/**
+ *  Tries to build the map with the current seed, see __place().
+ *
+ *  @param frozenmap the frozen map being built
+ *  @param entries the pairs, in any order
+ *
+ *  @return true if every bucket was placed, false to try another seed
+ */
+static bool __build(cvs_frozenmap_t *frozenmap, cvs_frozenmap_entry_t *entries)
+{
+    cvs_frozenmap_scratch_t s;
+    size_t n = frozenmap->count;
+    size_t r = frozenmap->bucket_count;
+    bool rv;
+
+    s.hashes = (uint64_t*) malloc(n * sizeof(uint64_t));
+    s.taken = (uint64_t*) calloc((frozenmap->slot_count + 63) / 64, sizeof(uint64_t));
+    s.start = (size_t*) calloc(r + 1, sizeof(size_t));
+    s.members = (size_t*) malloc(n * sizeof(size_t));
+    s.order = (size_t*) calloc(r, sizeof(size_t));
+    s.slots = (size_t*) malloc(n * sizeof(size_t));
+
+    rv = false;
+    if ((NULL != s.hashes) && (NULL != s.taken) && (NULL != s.start) &&
+        (NULL != s.members) && (NULL != s.order) && (NULL != s.slots)) {
+        rv = __place(frozenmap, entries, &s);
+    }
+
+    free(s.hashes);
+    free(s.taken);
+    free(s.start);
+    free(s.members);
+    free(s.order);
+    free(s.slots);
+
+    return rv;
+}
+
+
+/**
+ *  Finds a displacement for every bucket with the current seed and places
+ *  the entries in their slots.
+ *
+ *  Buckets are placed largest first, while most slots are still free.  Each
+ *  tries displacements 0, 1, 2, ... until all of its keys land on distinct
+ *  free slots.  The entries are then stored in slot order, one per key.
+ *
+ *  @param frozenmap the frozen map being built
+ *  @param entries the pairs, in any order
+ *  @param s the zeroed working arrays
+ *
+ *  @return true if every bucket was placed, false to try another seed
+ */
+static bool __place(cvs_frozenmap_t *frozenmap, cvs_frozenmap_entry_t *entries,
+                    cvs_frozenmap_scratch_t *s)
+{
+    size_t n = frozenmap->count;
+    size_t m = frozenmap->slot_count;
+    size_t r = frozenmap->bucket_count;
+    size_t *by_size;
+    size_t i, b, max_size;
+
+    /* Group the keys by bucket with a counting sort, s->order holding each
+     * bucket's fill cursor for now. */
+    for (i = 0; i < n; i++) {
+        s->hashes[i] = rebar_hash_bytes(entries[i].key, entries[i].key_length,
+                                        frozenmap->seed);
+        s->start[__range(s->hashes[i], r) + 1]++;
+    }
+    max_size = 0;
+    for (b = 0; b < r; b++) {
+        if (max_size < s->start[b + 1]) {
+            max_size = s->start[b + 1];
+        }
+        s->start[b + 1] += s->start[b];
+    }
+    for (i = 0; i < n; i++) {
+        b = __range(s->hashes[i], r);
+        s->members[s->start[b] + s->order[b]++] = i;
+    }
+
+    /* Order the buckets largest first, again with a counting sort. */
+    by_size = (size_t*) calloc(max_size + 2, sizeof(size_t));
+    if (NULL == by_size) {
+        return false;
+    }
+    for (b = 0; b < r; b++) {
+        by_size[max_size - (s->start[b + 1] - s->start[b]) + 1]++;
+    }
+    for (i = 0; i <= max_size; i++) {
+        by_size[i + 1] += by_size[i];
+    }
+    for (b = 0; b < r; b++) {
+        s->order[by_size[max_size - (s->start[b + 1] - s->start[b])]++] = b;
+    }
+    free(by_size);
+
+    memset(frozenmap->displacements, 0, r * sizeof(uint32_t));
+    for (i = 0; i < r; i++) {
+        size_t first, size, j, k;
+        uint32_t d;
+
+        b = s->order[i];
+        first = s->start[b];
+        size = s->start[b + 1] - first;
+        if (0 == size) {
+            break;      /* the rest are empty too */
+        }
+
+        for (d = 0; d < MAX_DISPLACEMENT; d++) {
+            for (j = 0; j < size; j++) {
+                size_t slot = __slot(s->hashes[s->members[first + j]], d, m);
+
+                if (s->taken[slot / 64] & (1ULL << (slot % 64))) {
+                    break;
+                }
+                for (k = 0; (k < j) && (s->slots[first + k] != slot); k++) {
+                    ;
+                }
+                if (k < j) {
+                    break;
+                }
+                s->slots[first + j] = slot;
+            }
+            if (j == size) {
+                break;
+            }
+        }
+        if (MAX_DISPLACEMENT == d) {
+            return false;
+        }
+
+        frozenmap->displacements[b] = d;
+        for (j = 0; j < size; j++) {
+            s->taken[s->slots[first + j] / 64] |= 1ULL << (s->slots[first + j] % 64);
+        }
+    }
+
+    __rank(frozenmap, s->taken);
+    for (i = 0; i < n; i++) {
+        const uint64_t *rank = &frozenmap->ranks[2 * (s->slots[i] / 64)];
+        uint64_t below = (1ULL << (s->slots[i] % 64)) - 1;
+
+        frozenmap->entries[rank[1] + (size_t) __builtin_popcountll(rank[0] & below)] =
+            entries[s->members[i]];
+    }
+
+    return true;
+}
+
+
+/**
+ *  Maps a hash onto [0, n) with a multiply instead of a division.
+ */
+static size_t __range(uint64_t hash, size_t n)
+{
+#if defined(__SIZEOF_INT128__)
+    return (size_t) (((__uint128_t) hash * n) >> 64);
+#else
+    return (size_t) (hash % n);
+#endif
+}
+
+
+/**
+ *  The slot of a key in a bucket with the given displacement.
+ */
+static size_t __slot(uint64_t hash, uint32_t displacement, size_t n)
+{
+    return __range(rebar_hash_mix64(hash + GOLDEN64 * ((uint64_t) displacement + 1)), n);
+}
+
+
+/**
+ *  Fills in the rank table from the used slots: for every 64 slots, their
+ *  bits and the number of used slots before them.
+ *
+ *  @param frozenmap the frozen map being built
+ *  @param taken a bit per slot, set for the used ones
+ */
+static void __rank(cvs_frozenmap_t *frozenmap, const uint64_t *taken)
+{
+    size_t w, words, before;
+
+    words = (frozenmap->slot_count + 63) / 64;
+    before = 0;
+    for (w = 0; w < words; w++) {
+        frozenmap->ranks[2 * w] = taken[w];
+        frozenmap->ranks[2 * w + 1] = before;
+        before += (size_t) __builtin_popcountll(taken[w]);
+    }
+}
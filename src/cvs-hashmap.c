@@ -18,33 +18,111 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "cvs-hashmap.h"
+#include "rebar-hash.h"
 
 /*----------------------------------------------------------------------------*/
 /*                                   Macros                                   */
 /*----------------------------------------------------------------------------*/
-/* none */
+/* The smallest bucket array allocated, must be a power of 2. */
+#define CVSHM_MIN_BUCKETS   8
+
+/* The size of a CHF__OWN_KEYS string arena chunk, longer keys get a chunk of
+ * their own. */
+#define CVSHM_ARENA_CHUNK   4096
+
+/* The size of a node slab chunk, nodes bigger than this get a chunk each. */
+#define CVSHM_SLAB_CHUNK    4096
+
+/* Bumps an operation counter, or nothing without CVSHM_COUNTERS. */
+#ifdef CVSHM_COUNTERS
+#define CVSHM_COUNT(hashmap, counter)   ((hashmap)->counters.counter++)
+#else
+#define CVSHM_COUNT(hashmap, counter)   do { } while (0)
+#endif
+
+/* The number of keys the batch calls hash and prefetch ahead of use. */
+#define CVSHM_BATCH         16
+
+#if defined(__GNUC__)
+#define CVSHM_PREFETCH(addr)    __builtin_prefetch(addr)
+#else
+#define CVSHM_PREFETCH(addr)
+#endif
+
+/* A filter block is a cache line of 8 words, a key sets one bit in each.
+ * The bits come from the top of the hash times an odd constant, so they
+ * are mixed from every bit of the hash. */
+#define CVSHM_BLOOM_WORDS   8
+#define CVSHM_BLOOM_MIX     0x9e3779b97f4a7c15ULL
+
+/* The first word of the block of a hash, picked by the hash's upper half
+ * since the lower bits pick the bucket. */
+#define CVSHM_BLOOM_BLOCK(hash, mask) \
+    (((size_t) (((hash) >> 32) | ((hash) << 32)) & (mask)) * CVSHM_BLOOM_WORDS)
+#define CACHE_LINE          64
+
+#if (0 != (CVSHM_SMALL_MAX % 4))
+#error "CVSHM_SMALL_MAX must be a multiple of 4"
+#endif
 
 /*----------------------------------------------------------------------------*/
 /*                               Data Structures                              */
 /*----------------------------------------------------------------------------*/
-typedef int (*cvs_hashmap_key_cmp_fct)(void *key_a, void *key_b);
-
+/* Nodes are allocated with only as much of the key union as their map's key
+ * type uses (see hashmap->node_size), so the key must stay the last member. */
 typedef struct {
     rebar_ll_node_t node;
+    uint64_t hash;
+    void *value;
     union {
         char *string;
+        struct {
+            char *string;                       /* in the map's arena */
+            size_t length;
+        } owned;                                /* CHF__OWN_KEYS strings */
         uint32_t u32;
         uint64_t u64;
+        uint8_t bytes[CVSHM_INLINE_KEY_MAX];    /* short CHT__BYTES keys */
+        uint8_t *heap;                          /* long CHT__BYTES keys */
+        struct {
+            union {
+                uint8_t bytes[CVSHM_INLINE_KEY_MAX];
+                uint8_t *heap;
+            } data;
+            size_t length;
+        } blob;
     } key;
-    void *value;
 } cvs_hashmap_node_t;
 
+#define NODE_SIZE(member) \
+    (offsetof(cvs_hashmap_node_t, key) + sizeof(((cvs_hashmap_node_t*) 0)->key.member))
+
+/* A key prepared for a lookup: hashed, and for strings measured, only once. */
 typedef struct {
-    cvs_hashmap_iterator_fn_t fn;
-    cvs_hashmap_key_cmp_fct cmp;
-    void *user_data;
-} cvs_hashmap_iterator_helper_t;
+    void *key;
+    uint64_t hash;
+    size_t length;      /* CHT__STRING and CHT__BLOB keys */
+} cvs_hashmap_lookup_t;
+
+/* CHF__OWN_KEYS keys are packed back to back into these chunks. */
+typedef struct __cvs_hashmap_arena {
+    struct __cvs_hashmap_arena *next;
+    size_t size;
+    size_t used;
+    char data[];
+} cvs_hashmap_arena_t;
+
+/* Nodes are allocated from these chunks.  A removed node is pushed on the
+ * map's free list, which links through the node's first word. */
+typedef struct __cvs_hashmap_slab {
+    struct __cvs_hashmap_slab *next;
+    uint64_t data[];
+} cvs_hashmap_slab_t;
 
 /*----------------------------------------------------------------------------*/
 /*                            File Scoped Variables                           */
@@ -54,45 +132,196 @@ typedef struct {
 /*----------------------------------------------------------------------------*/
 /*                             Function Prototypes                            */
 /*----------------------------------------------------------------------------*/
-static void __deleter(rebar_ll_node_t *node, void *user_data);
-static cvs_hashmap_node_t *__get(cvs_hashmap_t *hashmap, void *key);
-static rebar_ll_iterator_response_t __hash_iterator(rebar_ll_node_t *node, void *user_data);
-static int __string_cmp(void *key_a, void *key_b);
-static int __uint32_t_cmp(void *key_a, void *key_b);
-static int __uint64_t_cmp(void *key_a, void *key_b);
+static void __prepare(cvs_hashmap_t *hashmap, void *key, cvs_hashmap_lookup_t *lookup);
+static bool __key_equals(cvs_hashmap_t *hashmap, cvs_hashmap_node_t *n,
+                         const cvs_hashmap_lookup_t *lookup);
+static void *__key_ptr(cvs_hashmap_t *hashmap, cvs_hashmap_node_t *n,
+                       cvs_hashmap_blob_t *blob);
+static const uint8_t *__key_bytes(cvs_hashmap_t *hashmap, cvs_hashmap_node_t *n);
+static void __set_key(cvs_hashmap_t *hashmap, cvs_hashmap_node_t *n,
+                      const cvs_hashmap_lookup_t *lookup);
+static char *__arena_copy(cvs_hashmap_t *hashmap, const char *s, size_t length);
+static void __arena_compact(cvs_hashmap_t *hashmap);
+static void __arena_reclaim(cvs_hashmap_t *hashmap);
+static void __arena_free(cvs_hashmap_arena_t *arena);
+static cvs_hashmap_node_t *__alloc_node(cvs_hashmap_t *hashmap);
+static void __free_node(cvs_hashmap_t *hashmap, cvs_hashmap_node_t *n);
+static bool __keys_on_heap(cvs_hashmap_t *hashmap);
+static size_t __slab_slots(cvs_hashmap_t *hashmap, size_t *slot_size);
+static bool __is_small(cvs_hashmap_t *hashmap);
+static void *__small_key(cvs_hashmap_t *hashmap, size_t i);
+static int __small_find(cvs_hashmap_t *hashmap, void *key);
+static void __small_delete(cvs_hashmap_t *hashmap, size_t i);
+static void __small_iterate_ex(cvs_hashmap_t *hashmap,
+                               cvs_hashmap_iterator_ex_fn_t iterator,
+                               cvs_hashmap_delete_fn_t deleter, void *user_data);
+static void __spill(cvs_hashmap_t *hashmap);
+static uint64_t *__bloom_new(size_t buckets, size_t *mask);
+static void __bloom_set(uint64_t *bloom, size_t mask, uint64_t hash);
+static bool __bloom_test(const uint64_t *bloom, size_t mask, uint64_t hash);
+static bool __bloom_maybe(cvs_hashmap_t *hashmap, uint64_t hash);
+static void __bloom_add(cvs_hashmap_t *hashmap, uint64_t hash);
+static void __bloom_start(cvs_hashmap_t *hashmap);
+static void __bloom_step(cvs_hashmap_t *hashmap);
+static void __bloom_removed(cvs_hashmap_t *hashmap, size_t removes);
+static double __bloom_fpr(const uint64_t *bloom, size_t mask);
+static bool __clone_pair(void *key, void *value, void *user_data);
+static void **__get(cvs_hashmap_t *hashmap, void *key);
+static rebar_ll_node_t **__find_link(cvs_hashmap_t *hashmap,
+                                     const cvs_hashmap_lookup_t *lookup);
+static void __put(cvs_hashmap_t *hashmap, const cvs_hashmap_lookup_t *lookup, void *value);
+static void **__slot(cvs_hashmap_t *hashmap, const cvs_hashmap_lookup_t *lookup,
+                     bool *inserted);
+static void __insert(cvs_hashmap_t *hashmap, const cvs_hashmap_lookup_t *lookup, void *value);
+static void __prefetch(cvs_hashmap_t *hashmap, void **keys,
+                       cvs_hashmap_lookup_t *lookups, size_t count);
+static rebar_ll_node_t **__chain_find(cvs_hashmap_t *hashmap, rebar_ll_node_t **link,
+                                      const cvs_hashmap_lookup_t *lookup);
+static void __free_chains(cvs_hashmap_t *hashmap, rebar_ll_node_t **buckets,
+                          size_t mask);
+static void __grow(cvs_hashmap_t *hashmap);
+static void __resize(cvs_hashmap_t *hashmap, size_t count);
+static void __rehash_step(cvs_hashmap_t *hashmap, size_t buckets);
+static size_t __chain_stats(cvs_hashmap_t *hashmap, rebar_ll_node_t **buckets,
+                            size_t count, cvs_hashmap_stats_t *stats);
 
 /*----------------------------------------------------------------------------*/
 /*                             External Functions                             */
 /*----------------------------------------------------------------------------*/
 /* See cvs-hashmap.h for details. */
 bool cvs_hashmap_init(cvs_hashmap_t *hashmap, cvs_hashmap_type_t type)
+{
+    return cvs_hashmap_init_ex(hashmap, type, CHF__NONE);
+}
+
+
+/* See cvs-hashmap.h for details. */
+bool cvs_hashmap_init_ex(cvs_hashmap_t *hashmap, cvs_hashmap_type_t type,
+                         unsigned flags)
 {
     bool rv;
 
     rv = false;
     if (hashmap) {
-        rebar_ll_init(&hashmap->list);
-
-        rv = true;
         switch( type ) {
             case CHT__STRING:
-                hashmap->cmp = __string_cmp;
-                break;
-
             case CHT__UINT32:
-                hashmap->cmp = __uint32_t_cmp;
-                break;
-
             case CHT__UINT64:
-                hashmap->cmp = __uint64_t_cmp;
+            case CHT__BLOB:
+                memset(hashmap, 0, sizeof(cvs_hashmap_t));
+                hashmap->type = type;
+                hashmap->flags = flags;
+                hashmap->seed = rebar_hash_seed();
+                rv = true;
                 break;
 
             default:
-                rv = false;
                 break;
         }
     }
 
+    if (rv) {
+        if ((CHT__STRING == type) && (CHF__OWN_KEYS & flags)) {
+            hashmap->node_size = NODE_SIZE(owned);
+        } else if (CHT__STRING == type) {
+            hashmap->node_size = NODE_SIZE(string);
+        } else if (CHT__UINT32 == type) {
+            hashmap->node_size = NODE_SIZE(u32);
+        } else if (CHT__UINT64 == type) {
+            hashmap->node_size = NODE_SIZE(u64);
+        } else {
+            hashmap->node_size = NODE_SIZE(blob);
+        }
+    }
+
+    return rv;
+}
+
+
+/* See cvs-hashmap.h for details. */
+bool cvs_hashmap_init_bytes(cvs_hashmap_t *hashmap, size_t key_length,
+                            unsigned flags)
+{
+    if ((NULL == hashmap) || (0 == key_length)) {
+        return false;
+    }
+
+    memset(hashmap, 0, sizeof(cvs_hashmap_t));
+    hashmap->type = CHT__BYTES;
+    hashmap->flags = flags;
+    hashmap->seed = rebar_hash_seed();
+    hashmap->key_length = key_length;
+    if (CVSHM_INLINE_KEY_MAX < key_length) {
+        hashmap->node_size = NODE_SIZE(heap);
+    } else {
+        hashmap->node_size = offsetof(cvs_hashmap_node_t, key) + key_length;
+    }
+
+    return true;
+}
+
+
+/* See cvs-hashmap.h for details. */
+bool cvs_hashmap_init_from_arrays(cvs_hashmap_t *hashmap, cvs_hashmap_type_t type,
+                                  unsigned flags, void **keys, void **values,
+                                  size_t count, bool unique)
+{
+    cvs_hashmap_lookup_t lookups[CVSHM_BATCH];
+    size_t i, j, len;
+
+    if ((NULL == keys) || (NULL == values) ||
+        !cvs_hashmap_init_ex(hashmap, type, flags))
+    {
+        return false;
+    }
+
+    cvs_hashmap_reserve(hashmap, count);
+    if (!unique || __is_small(hashmap)) {
+        cvs_hashmap_put_many(hashmap, keys, values, count);
+        return true;
+    }
+
+    for (i = 0; i < count; i += len) {
+        len = (count - i < CVSHM_BATCH) ? count - i : CVSHM_BATCH;
+
+        /* Nothing is searched, so only the bucket slots are worth fetching. */
+        for (j = 0; j < len; j++) {
+            if (NULL != keys[i + j]) {
+                __prepare(hashmap, keys[i + j], &lookups[j]);
+                CVSHM_PREFETCH(&hashmap->buckets[lookups[j].hash & hashmap->bucket_mask]);
+            }
+        }
+        for (j = 0; j < len; j++) {
+            if (NULL != keys[i + j]) {
+                __insert(hashmap, &lookups[j], values[i + j]);
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/* See cvs-hashmap.h for details. */
+bool cvs_hashmap_clone(cvs_hashmap_t *hashmap, cvs_hashmap_t *source)
+{
+    bool rv;
+
+    if ((NULL == hashmap) || (NULL == source) || (hashmap == source)) {
+        return false;
+    }
+
+    if (CHT__BYTES == source->type) {
+        rv = cvs_hashmap_init_bytes(hashmap, source->key_length, source->flags);
+    } else {
+        rv = cvs_hashmap_init_ex(hashmap, source->type, source->flags);
+    }
+
+    if (rv) {
+        cvs_hashmap_reserve(hashmap, source->count);
+        cvs_hashmap_iterate(source, __clone_pair, hashmap);
+    }
+
     return rv;
 }
 
@@ -101,7 +330,41 @@ bool cvs_hashmap_init(cvs_hashmap_t *hashmap, cvs_hashmap_type_t type)
 void cvs_hashmap_destroy(cvs_hashmap_t *hashmap)
 {
     if (hashmap) {
-        rebar_ll_delete_all(&hashmap->list, __deleter, NULL);
+        cvs_hashmap_slab_t *slab;
+
+        __free_chains(hashmap, hashmap->old_buckets, hashmap->old_mask);
+        __free_chains(hashmap, hashmap->buckets, hashmap->bucket_mask);
+        hashmap->old_buckets = NULL;
+        hashmap->old_mask = 0;
+        hashmap->rehash_idx = 0;
+        hashmap->buckets = NULL;
+        hashmap->bucket_mask = 0;
+        hashmap->count = 0;
+
+        free(hashmap->bloom);
+        free(hashmap->bloom_next);
+        hashmap->bloom = NULL;
+        hashmap->bloom_mask = 0;
+        hashmap->bloom_next = NULL;
+        hashmap->bloom_next_mask = 0;
+        hashmap->bloom_idx = 0;
+        hashmap->bloom_removes = 0;
+
+        __arena_free((cvs_hashmap_arena_t*) hashmap->arena);
+        hashmap->arena = NULL;
+        hashmap->arena_used = 0;
+        hashmap->arena_dead = 0;
+
+        slab = (cvs_hashmap_slab_t*) hashmap->slabs;
+        while (NULL != slab) {
+            cvs_hashmap_slab_t *next = slab->next;
+
+            free(slab);
+            slab = next;
+        }
+        hashmap->slabs = NULL;
+        hashmap->slab_left = 0;
+        hashmap->free_nodes = NULL;
     }
 }
 
@@ -110,12 +373,12 @@ void cvs_hashmap_destroy(cvs_hashmap_t *hashmap)
 void *cvs_hashmap_get(cvs_hashmap_t *hashmap, void *key)
 {
     void *rv;
-    cvs_hashmap_node_t *n;
+    void **slot;
 
     rv = NULL;
-    n = __get(hashmap, key);
-    if (n) {
-        rv = n->value;
+    slot = __get(hashmap, key);
+    if (slot) {
+        rv = *slot;
     }
 
     return rv;
@@ -133,14 +396,37 @@ bool cvs_hashmap_contains_key(cvs_hashmap_t *hashmap, void *key)
 void *cvs_hashmap_remove(cvs_hashmap_t *hashmap, void *key)
 {
     void *rv;
-    cvs_hashmap_node_t *n;
+    rebar_ll_node_t **link;
+    cvs_hashmap_lookup_t lookup;
 
     rv = NULL;
-    n = __get(hashmap, key);
-    if (n) {
-        rv = n->value;
-        rebar_ll_remove(&hashmap->list, &n->node);
-        free(n);
+    if ((hashmap) && (key) && __is_small(hashmap)) {
+        int i = __small_find(hashmap, key);
+
+        if (0 <= i) {
+            rv = hashmap->small_values[i];
+            __small_delete(hashmap, (size_t) i);
+        }
+    } else if ((hashmap) && (key) && (hashmap->buckets)) {
+        if (hashmap->old_buckets) {
+            __rehash_step(hashmap, CVSHM_REHASH_BUCKETS);
+        }
+        __bloom_step(hashmap);
+
+        __prepare(hashmap, key, &lookup);
+        link = (__bloom_maybe(hashmap, lookup.hash)) ? __find_link(hashmap, &lookup) : NULL;
+        if ((link) && (*link)) {
+            cvs_hashmap_node_t *n;
+
+            n = rebar_ll_get_data(cvs_hashmap_node_t, node, *link);
+            *link = n->node.next;
+            hashmap->count--;
+
+            rv = n->value;
+            __free_node(hashmap, n);
+            __arena_reclaim(hashmap);
+            __bloom_removed(hashmap, 1);
+        }
     }
 
     return rv;
@@ -150,22 +436,192 @@ void *cvs_hashmap_remove(cvs_hashmap_t *hashmap, void *key)
 /* See cvs-hashmap.h for details. */
 void cvs_hashmap_put(cvs_hashmap_t *hashmap, void *key, void *value)
 {
-    cvs_hashmap_node_t *n;
+    cvs_hashmap_lookup_t lookup;
 
-    n = __get(hashmap, key);
-    if (!n) {
-        n = (cvs_hashmap_node_t *) malloc(sizeof(cvs_hashmap_node_t));
-	assert(n);
-        if (__string_cmp == hashmap->cmp) {
-            n->key.string = key;
-        } else if (__uint64_t_cmp == hashmap->cmp) {
-            n->key.u64 = *((uint64_t*) key);
-        } else {    /* uint32_t mode */
-            n->key.u32 = *((uint32_t*) key);
+    if ((NULL == hashmap) || (NULL == key)) {
+        return;
+    }
+
+    __prepare(hashmap, key, &lookup);
+    __put(hashmap, &lookup, value);
+}
+
+
+/* See cvs-hashmap.h for details. */
+void **cvs_hashmap_get_or_insert(cvs_hashmap_t *hashmap, void *key, bool *inserted)
+{
+    cvs_hashmap_lookup_t lookup;
+    void **slot;
+    bool added;
+
+    if ((NULL == hashmap) || (NULL == key)) {
+        return NULL;
+    }
+
+    __prepare(hashmap, key, &lookup);
+    slot = __slot(hashmap, &lookup, &added);
+    if (inserted) {
+        *inserted = added;
+    }
+
+    return slot;
+}
+
+
+/* See cvs-hashmap.h for details. */
+void *cvs_hashmap_upsert(cvs_hashmap_t *hashmap, void *key,
+                         cvs_hashmap_upsert_fn_t update, void *user_data)
+{
+    cvs_hashmap_lookup_t lookup;
+    void **slot;
+    bool added;
+
+    if ((NULL == hashmap) || (NULL == key) || (NULL == update)) {
+        return NULL;
+    }
+
+    __prepare(hashmap, key, &lookup);
+    slot = __slot(hashmap, &lookup, &added);
+    *slot = (update)(key, *slot, !added, user_data);
+
+    return *slot;
+}
+
+
+/* See cvs-hashmap.h for details. */
+void cvs_hashmap_get_many(cvs_hashmap_t *hashmap, void **keys, void **values,
+                          size_t count)
+{
+    cvs_hashmap_lookup_t lookups[CVSHM_BATCH];
+    size_t i, j, len;
+
+    if ((NULL == hashmap) || (NULL == keys) || (NULL == values)) {
+        return;
+    }
+
+    for (i = 0; i < count; i += len) {
+        len = (count - i < CVSHM_BATCH) ? count - i : CVSHM_BATCH;
+
+        if (__is_small(hashmap)) {
+            for (j = 0; j < len; j++) {
+                void **slot = __get(hashmap, keys[i + j]);
+
+                values[i + j] = (slot) ? *slot : NULL;
+            }
+            continue;
+        }
+
+        if (NULL == hashmap->buckets) {
+            for (j = 0; j < len; j++) {
+                values[i + j] = NULL;
+                if (NULL != keys[i + j]) {
+                    CVSHM_COUNT(hashmap, gets);
+                    CVSHM_COUNT(hashmap, misses);
+                }
+            }
+            continue;
+        }
+
+        if (hashmap->old_buckets) {
+            __rehash_step(hashmap, CVSHM_REHASH_BUCKETS * len);
+        }
+
+        __prefetch(hashmap, &keys[i], lookups, len);
+
+        for (j = 0; j < len; j++) {
+            rebar_ll_node_t **link;
+
+            values[i + j] = NULL;
+            if (NULL != keys[i + j]) {
+                CVSHM_COUNT(hashmap, gets);
+                if (!__bloom_maybe(hashmap, lookups[j].hash)) {
+                    CVSHM_COUNT(hashmap, bloom_rejects);
+                    CVSHM_COUNT(hashmap, misses);
+                    continue;
+                }
+                link = __find_link(hashmap, &lookups[j]);
+                if (*link) {
+                    values[i + j] = rebar_ll_get_data(cvs_hashmap_node_t, node, *link)->value;
+                    CVSHM_COUNT(hashmap, hits);
+                } else {
+                    if (hashmap->bloom) {
+                        CVSHM_COUNT(hashmap, bloom_false_positives);
+                    }
+                    CVSHM_COUNT(hashmap, misses);
+                }
+            }
         }
     }
-    n->value = value;
-    rebar_ll_append(&hashmap->list, &n->node);
+}
+
+
+/* See cvs-hashmap.h for details. */
+void cvs_hashmap_put_many(cvs_hashmap_t *hashmap, void **keys, void **values,
+                          size_t count)
+{
+    cvs_hashmap_lookup_t lookups[CVSHM_BATCH];
+    size_t i, j, len;
+
+    if ((NULL == hashmap) || (NULL == keys) || (NULL == values)) {
+        return;
+    }
+
+    for (i = 0; i < count; i += len) {
+        len = (count - i < CVSHM_BATCH) ? count - i : CVSHM_BATCH;
+
+        /* A put may grow the table, which only makes the prefetch wasted. */
+        if (hashmap->buckets) {
+            __prefetch(hashmap, &keys[i], lookups, len);
+        } else {
+            for (j = 0; j < len; j++) {
+                if (NULL != keys[i + j]) {
+                    __prepare(hashmap, keys[i + j], &lookups[j]);
+                }
+            }
+        }
+
+        for (j = 0; j < len; j++) {
+            if (NULL != keys[i + j]) {
+                __put(hashmap, &lookups[j], values[i + j]);
+            }
+        }
+    }
+}
+
+
+/* See cvs-hashmap.h for details. */
+bool cvs_hashmap_reserve(cvs_hashmap_t *hashmap, size_t count)
+{
+    size_t buckets;
+
+    if (NULL == hashmap) {
+        return false;
+    }
+
+    if (__is_small(hashmap)) {
+        if (count <= CVSHM_SMALL_MAX) {
+            return true;
+        }
+        __spill(hashmap);
+    }
+
+    /* The load factor is kept at or below 1. */
+    buckets = CVSHM_MIN_BUCKETS;
+    while (buckets < count) {
+        if (SIZE_MAX / 2 < buckets) {
+            return false;
+        }
+        buckets *= 2;
+    }
+
+    if ((NULL == hashmap->buckets) || (hashmap->bucket_mask + 1 < buckets)) {
+        __resize(hashmap, buckets);
+    }
+    while (NULL != hashmap->old_buckets) {
+        __rehash_step(hashmap, hashmap->old_mask + 1);
+    }
+
+    return true;
 }
 
 
@@ -181,15 +637,114 @@ void cvs_hashmap_iterate(cvs_hashmap_t *hashmap,
                          cvs_hashmap_iterator_fn_t iterator,
                          void *user_data)
 {
-    if (hashmap) {
-        cvs_hashmap_iterator_helper_t h;
+    if ((hashmap) && (iterator) && __is_small(hashmap)) {
+        size_t i;
+
+        for (i = 0; i < hashmap->count; i++) {
+            if (false == (iterator)(__small_key(hashmap, i), hashmap->small_values[i], user_data)) {
+                return;
+            }
+        }
+    } else if ((hashmap) && (iterator) && (hashmap->buckets)) {
+        rebar_ll_node_t **buckets;
+        cvs_hashmap_blob_t blob;
+        size_t i, mask;
+
+        /* Walk what is left of the old table, then the new one. */
+        buckets = (hashmap->old_buckets) ? hashmap->old_buckets : hashmap->buckets;
+        mask = (hashmap->old_buckets) ? hashmap->old_mask : hashmap->bucket_mask;
+        while (NULL != buckets) {
+            for (i = 0; i <= mask; i++) {
+                rebar_ll_node_t *node;
+
+                for (node = buckets[i]; NULL != node; node = node->next) {
+                    cvs_hashmap_node_t *n;
+
+                    n = rebar_ll_get_data(cvs_hashmap_node_t, node, node);
+                    if (false == (iterator)(__key_ptr(hashmap, n, &blob), n->value, user_data)) {
+                        return;
+                    }
+                }
+            }
+
+            if (buckets == hashmap->buckets) {
+                break;
+            }
+            buckets = hashmap->buckets;
+            mask = hashmap->bucket_mask;
+        }
+    }
+}
 
-        h.cmp = (cvs_hashmap_key_cmp_fct) hashmap->cmp;
-        h.fn = iterator;
-        h.user_data = user_data;
 
-        rebar_ll_iterate(&hashmap->list, __hash_iterator, NULL, &h);
+/* See cvs-hashmap.h for details. */
+void cvs_hashmap_iterate_ex(cvs_hashmap_t *hashmap,
+                            cvs_hashmap_iterator_ex_fn_t iterator,
+                            cvs_hashmap_delete_fn_t deleter,
+                            void *user_data)
+{
+    rebar_ll_node_t **buckets;
+    cvs_hashmap_blob_t blob;
+    size_t i, mask, removes;
+    bool stop;
+
+    if ((NULL == hashmap) || (NULL == iterator)) {
+        return;
+    }
+    if (__is_small(hashmap)) {
+        __small_iterate_ex(hashmap, iterator, deleter, user_data);
+        return;
+    }
+    if (NULL == hashmap->buckets) {
+        return;
+    }
+
+    /* Walk what is left of the old table, then the new one. */
+    stop = false;
+    removes = 0;
+    buckets = (hashmap->old_buckets) ? hashmap->old_buckets : hashmap->buckets;
+    mask = (hashmap->old_buckets) ? hashmap->old_mask : hashmap->bucket_mask;
+    while (NULL != buckets) {
+        for (i = 0; (i <= mask) && !stop; i++) {
+            rebar_ll_node_t **link;
+
+            link = &buckets[i];
+            while ((NULL != *link) && !stop) {
+                rebar_ll_iterator_response_t response;
+                cvs_hashmap_node_t *n;
+                void *key;
+
+                n = rebar_ll_get_data(cvs_hashmap_node_t, node, *link);
+                key = __key_ptr(hashmap, n, &blob);
+                response = (iterator)(key, n->value, user_data);
+                if ((REBAR_IR__DELETE_AND_CONTINUE == response) ||
+                    (REBAR_IR__DELETE_AND_STOP == response))
+                {
+                    *link = n->node.next;
+                    hashmap->count--;
+                    removes++;
+                    if (deleter) {
+                        (deleter)(key, n->value, user_data);
+                    }
+                    __free_node(hashmap, n);
+                } else {
+                    link = &n->node.next;
+                }
+
+                stop = (REBAR_IR__STOP == response) || (REBAR_IR__DELETE_AND_STOP == response);
+            }
+        }
+
+        if (stop || (buckets == hashmap->buckets)) {
+            break;
+        }
+        buckets = hashmap->buckets;
+        mask = hashmap->bucket_mask;
     }
+
+    /* Keys may move, so only compact once the iterator is done with them. */
+    __arena_reclaim(hashmap);
+    __bloom_removed(hashmap, removes);
 }
 
 
@@ -200,132 +755,1356 @@ size_t cvs_hashmap_get_size(cvs_hashmap_t *hashmap)
 
     rv = 0;
     if (hashmap) {
-        rv = rebar_ll_count(&hashmap->list);
+        rv = hashmap->count;
     }
 
     return rv;
 }
 
 
+/* See cvs-hashmap.h for details. */
+bool cvs_hashmap_stats(cvs_hashmap_t *hashmap, cvs_hashmap_stats_t *stats)
+{
+    cvs_hashmap_arena_t *arena;
+    cvs_hashmap_slab_t *slab;
+    size_t probes, slots, slot_size;
+
+    if ((NULL == hashmap) || (NULL == stats)) {
+        return false;
+    }
+
+    memset(stats, 0, sizeof(cvs_hashmap_stats_t));
+    stats->count = hashmap->count;
+    stats->rehashing = (NULL != hashmap->old_buckets) ? true : false;
+    stats->small = __is_small(hashmap);
+    stats->counters = hashmap->counters;
+
+    probes = 0;
+    if (hashmap->old_buckets) {
+        /* Migrated buckets are empty and never probed, leave them out. */
+        probes += __chain_stats(hashmap, &hashmap->old_buckets[hashmap->rehash_idx],
+                                hashmap->old_mask + 1 - hashmap->rehash_idx, stats);
+        stats->bytes += (hashmap->old_mask + 1) * sizeof(rebar_ll_node_t*);
+    }
+    if (hashmap->buckets) {
+        probes += __chain_stats(hashmap, hashmap->buckets, hashmap->bucket_mask + 1, stats);
+        stats->bytes += (hashmap->bucket_mask + 1) * sizeof(rebar_ll_node_t*);
+    }
+
+    for (arena = (cvs_hashmap_arena_t*) hashmap->arena; NULL != arena; arena = arena->next) {
+        stats->bytes += sizeof(cvs_hashmap_arena_t) + arena->size;
+    }
+    if (hashmap->bloom) {
+        stats->bloom_bytes += (hashmap->bloom_mask + 1) * CACHE_LINE;
+        stats->bloom_false_positive_rate = __bloom_fpr(hashmap->bloom, hashmap->bloom_mask);
+    }
+    if (hashmap->bloom_next) {
+        stats->bloom_bytes += (hashmap->bloom_next_mask + 1) * CACHE_LINE;
+    }
+    stats->bytes += stats->bloom_bytes;
+
+    slots = __slab_slots(hashmap, &slot_size);
+    for (slab = (cvs_hashmap_slab_t*) hashmap->slabs; NULL != slab; slab = slab->next) {
+        stats->bytes += sizeof(cvs_hashmap_slab_t) + slots * slot_size;
+    }
+
+    if (stats->buckets) {
+        stats->load_factor = (double) stats->count / (double) stats->buckets;
+    }
+    if (stats->count) {
+        stats->average_probe = (double) probes / (double) stats->count;
+    }
+
+    return true;
+}
+
+
+/* See cvs-hashmap.h for details. */
+void cvs_hashmap_settle(cvs_hashmap_t *hashmap)
+{
+    if (hashmap) {
+        while (NULL != hashmap->old_buckets) {
+            __rehash_step(hashmap, hashmap->old_mask + 1);
+        }
+        while (NULL != hashmap->bloom_next) {
+            __bloom_step(hashmap);
+        }
+    }
+}
+
+
 /*----------------------------------------------------------------------------*/
 /*                             Internal functions                             */
 /*----------------------------------------------------------------------------*/
 
 /**
- *  Deletes the node from the list.
+ *  Hashes the key based on the type of the hashmap.  String and blob keys
+ *  also have their length recorded so comparisons can check it first.
  *
- *  @param node the node being deleted
- *  @param user_data the destructor function to call
+ *  @param hashmap the hashmap the key belongs to
+ *  @param key the key to hash
+ *  @param lookup the prepared key
  */
-static void __deleter(rebar_ll_node_t *node, void *user_data)
+static void __prepare(cvs_hashmap_t *hashmap, void *key, cvs_hashmap_lookup_t *lookup)
 {
-    cvs_hashmap_node_t *n;
+    cvs_hashmap_blob_t *blob;
+
+    lookup->key = key;
+    lookup->length = 0;
+
+    switch (hashmap->type) {
+        case CHT__STRING:
+            lookup->hash = rebar_hash_string((const char*) key, &lookup->length,
+                                             hashmap->seed);
+            break;
+        case CHT__UINT32:
+            lookup->hash = rebar_hash_u32(*((uint32_t*) key), hashmap->seed);
+            break;
+        case CHT__UINT64:
+            lookup->hash = rebar_hash_u64(*((uint64_t*) key), hashmap->seed);
+            break;
+        case CHT__BYTES:
+            lookup->hash = rebar_hash_bytes(key, hashmap->key_length, hashmap->seed);
+            break;
+        default:
+            blob = (cvs_hashmap_blob_t*) key;
+            lookup->hash = rebar_hash_bytes(blob->data, blob->length, hashmap->seed);
+            lookup->length = blob->length;
+            break;
+    }
+}
+
 
-    (void ) user_data; /* Unused */
+/**
+ *  Compares the key to the key stored in the node.  The caller has already
+ *  matched the hashes.
+ *
+ *  @param hashmap the hashmap the node belongs to
+ *  @param n the node to compare against
+ *  @param lookup the prepared key to compare
+ *
+ *  @return true if the keys are equal, false otherwise
+ */
+static bool __key_equals(cvs_hashmap_t *hashmap, cvs_hashmap_node_t *n,
+                         const cvs_hashmap_lookup_t *lookup)
+{
+    void *key = lookup->key;
+
+    switch (hashmap->type) {
+        case CHT__STRING:
+            if (CHF__OWN_KEYS & hashmap->flags) {
+                return ((lookup->length == n->key.owned.length) &&
+                        (0 == memcmp(key, n->key.owned.string, lookup->length))) ? true : false;
+            }
+            return (0 == strcmp((char*) key, n->key.string)) ? true : false;
+        case CHT__UINT32:
+            return (*((uint32_t*) key) == n->key.u32) ? true : false;
+        case CHT__UINT64:
+            return (*((uint64_t*) key) == n->key.u64) ? true : false;
+        case CHT__BYTES:
+            return (0 == memcmp(key, __key_bytes(hashmap, n), hashmap->key_length)) ? true : false;
+        default:
+            break;
+    }
 
-    n = rebar_ll_get_data(cvs_hashmap_node_t, node, node);
+    if (lookup->length != n->key.blob.length) {
+        return false;
+    }
 
-    free(n);
+    return ((0 == lookup->length) ||
+            (0 == memcmp(((cvs_hashmap_blob_t*) key)->data, __key_bytes(hashmap, n),
+                         lookup->length))) ? true : false;
 }
 
 
 /**
- *  Gets the hashmap node for the specified key or returns NULL.
+ *  Returns the key pointer handed to iterator functions for the node.
  *
- *  @param hashmap the hashmap to process
- *  @param key the key to search for
+ *  @param hashmap the hashmap the node belongs to
+ *  @param n the node to get the key of
+ *  @param blob scratch space used to describe CHT__BLOB keys
  *
- *  @return the node of the key or NULL
+ *  @return the pointer to the node's key
  */
-static cvs_hashmap_node_t *__get(cvs_hashmap_t *hashmap, void *key)
+static void *__key_ptr(cvs_hashmap_t *hashmap, cvs_hashmap_node_t *n,
+                       cvs_hashmap_blob_t *blob)
 {
-    cvs_hashmap_node_t *rv;
+    switch (hashmap->type) {
+        case CHT__STRING:
+            return n->key.string;
+        case CHT__UINT32:
+            return &n->key.u32;
+        case CHT__UINT64:
+            return &n->key.u64;
+        case CHT__BYTES:
+            return (void*) __key_bytes(hashmap, n);
+        default:
+            break;
+    }
 
-    rv = NULL;
-    if ((hashmap) && (key)) {
-        rebar_ll_node_t *n;
-        n = rebar_ll_find(&hashmap->list, hashmap->cmp, key, cvs_hashmap_node_t, node);
+    blob->data = __key_bytes(hashmap, n);
+    blob->length = n->key.blob.length;
 
-        if (n) {
-            rv = rebar_ll_get_data(cvs_hashmap_node_t, node, n);
-        }
+    return blob;
+}
+
+
+/**
+ *  Returns where the bytes of a CHT__BYTES or CHT__BLOB key are stored.
+ */
+static const uint8_t *__key_bytes(cvs_hashmap_t *hashmap, cvs_hashmap_node_t *n)
+{
+    if (CHT__BYTES == hashmap->type) {
+        return (CVSHM_INLINE_KEY_MAX < hashmap->key_length) ? n->key.heap : n->key.bytes;
     }
 
-    return rv;
+    return (CVSHM_INLINE_KEY_MAX < n->key.blob.length) ? n->key.blob.data.heap
+                                                        : n->key.blob.data.bytes;
 }
 
 
 /**
- *  Called during the iteration of each hashmap key-value pair by linked list code.
+ *  Stores the key in a new node.  Byte keys are copied, into the node when
+ *  they fit and into their own allocation when they don't.  Owned strings
+ *  are copied into the arena.
  *
- *  See rebar-c.h for details.
+ *  @param hashmap the hashmap the node belongs to
+ *  @param n the node
+ *  @param lookup the prepared key to store
  */
-static rebar_ll_iterator_response_t __hash_iterator(rebar_ll_node_t *node, void *user_data)
+static void __set_key(cvs_hashmap_t *hashmap, cvs_hashmap_node_t *n,
+                      const cvs_hashmap_lookup_t *lookup)
 {
-    bool tmp;
-    cvs_hashmap_node_t *n;
-    cvs_hashmap_iterator_helper_t *h;
+    void *key = lookup->key;
+    cvs_hashmap_blob_t *blob;
+    uint8_t *dest;
+
+    switch (hashmap->type) {
+        case CHT__STRING:
+            if (CHF__OWN_KEYS & hashmap->flags) {
+                n->key.owned.string = __arena_copy(hashmap, (char*) key, lookup->length);
+                n->key.owned.length = lookup->length;
+            } else {
+                n->key.string = key;
+            }
+            return;
+        case CHT__UINT32:
+            n->key.u32 = *((uint32_t*) key);
+            return;
+        case CHT__UINT64:
+            n->key.u64 = *((uint64_t*) key);
+            return;
+        case CHT__BYTES:
+            dest = n->key.bytes;
+            if (CVSHM_INLINE_KEY_MAX < hashmap->key_length) {
+                n->key.heap = (uint8_t*) malloc(hashmap->key_length);
+                assert(n->key.heap);
+                dest = n->key.heap;
+            }
+            memcpy(dest, key, hashmap->key_length);
+            return;
+        default:
+            break;
+    }
+
+    blob = (cvs_hashmap_blob_t*) key;
+    n->key.blob.length = blob->length;
+    dest = n->key.blob.data.bytes;
+    if (CVSHM_INLINE_KEY_MAX < blob->length) {
+        n->key.blob.data.heap = (uint8_t*) malloc(blob->length);
+        assert(n->key.blob.data.heap);
+        dest = n->key.blob.data.heap;
+    }
+    if (0 < blob->length) {
+        memcpy(dest, blob->data, blob->length);
+    }
+}
 
-    n = rebar_ll_get_data(cvs_hashmap_node_t, node, node);
-    h = (cvs_hashmap_iterator_helper_t*) user_data;
 
-    if (__string_cmp == h->cmp) {
-        tmp = (h->fn)(n->key.string, n->value, h->user_data);
-    } else if (__uint64_t_cmp == h->cmp) {
-        tmp = (h->fn)(&n->key.u64, n->value, h->user_data);
-    } else {    /* uint32_t mode */
-        tmp = (h->fn)(&n->key.u32, n->value, h->user_data);
+/**
+ *  Takes a node from the free list, or from the newest slab chunk, allocating
+ *  a new chunk when both are exhausted.
+ *
+ *  @param hashmap the hashmap the node is for
+ *
+ *  @return the uninitialized node
+ */
+static cvs_hashmap_node_t *__alloc_node(cvs_hashmap_t *hashmap)
+{
+    cvs_hashmap_slab_t *slab;
+    size_t slots, slot_size;
+    uint8_t *rv;
+
+    if (NULL != hashmap->free_nodes) {
+        rv = (uint8_t*) hashmap->free_nodes;
+        hashmap->free_nodes = *((void**) rv);
+        return (cvs_hashmap_node_t*) rv;
     }
 
-    if (tmp) {
-        return REBAR_IR__CONTINUE;
+    slots = __slab_slots(hashmap, &slot_size);
+    if (0 == hashmap->slab_left) {
+        slab = (cvs_hashmap_slab_t*) malloc(sizeof(cvs_hashmap_slab_t) + slots * slot_size);
+        assert(slab);
+        slab->next = (cvs_hashmap_slab_t*) hashmap->slabs;
+        hashmap->slabs = slab;
+        hashmap->slab_left = slots;
     }
 
-    return REBAR_IR__STOP;
+    /* Hand out the chunk's slots from the first to the last. */
+    slab = (cvs_hashmap_slab_t*) hashmap->slabs;
+    rv = (uint8_t*) slab->data;
+    rv += (slots - hashmap->slab_left) * slot_size;
+    hashmap->slab_left--;
+
+    return (cvs_hashmap_node_t*) rv;
 }
 
 
-static int __string_cmp(void *key_a, void *key_b)
+/**
+ *  Frees any key storage a node owns and returns the node to the free list.
+ *
+ *  @param hashmap the hashmap the node belongs to
+ *  @param n the node to free
+ */
+static void __free_node(cvs_hashmap_t *hashmap, cvs_hashmap_node_t *n)
 {
-    cvs_hashmap_node_t *n = (cvs_hashmap_node_t*) key_b;
+    if ((CHT__STRING == hashmap->type) && (CHF__OWN_KEYS & hashmap->flags)) {
+        hashmap->arena_dead += n->key.owned.length + 1;
+    } else if ((CHT__BYTES == hashmap->type) && (CVSHM_INLINE_KEY_MAX < hashmap->key_length)) {
+        free(n->key.heap);
+    } else if ((CHT__BLOB == hashmap->type) && (CVSHM_INLINE_KEY_MAX < n->key.blob.length)) {
+        free(n->key.blob.data.heap);
+    }
 
-    return strcmp((char*) key_a, n->key.string);
+    *((void**) n) = hashmap->free_nodes;
+    hashmap->free_nodes = n;
 }
 
 
-static int __uint32_t_cmp(void *key_a, void *key_b)
+/**
+ *  Returns true if the nodes of the map may own heap allocated keys, which
+ *  have to be freed one node at a time.
+ *
+ *  @param hashmap the hashmap to check
+ *
+ *  @return true if a node may own a key allocation, false otherwise
+ */
+static bool __keys_on_heap(cvs_hashmap_t *hashmap)
 {
-    cvs_hashmap_node_t *n;
-    uint32_t a;
-
-    a = *((uint32_t*) key_a);
-    n = (cvs_hashmap_node_t*) key_b;
-
-    if (a == n->key.u32) {
-        return 0;
+    if (CHT__BLOB == hashmap->type) {
+        return true;
     }
-    if (a < n->key.u32) {
-        return -1;
+    if ((CHT__BYTES == hashmap->type) && (CVSHM_INLINE_KEY_MAX < hashmap->key_length)) {
+        return true;
     }
 
-    return 1;
+    return false;
 }
 
 
-static int __uint64_t_cmp(void *key_a, void *key_b)
+/**
+ *  Works out how a slab chunk of the map is divided into nodes.
+ *
+ *  @param hashmap the hashmap to check
+ *  @param slot_size where to store the size of one node slot
+ *
+ *  @return the number of nodes in a chunk
+ */
+static size_t __slab_slots(cvs_hashmap_t *hashmap, size_t *slot_size)
 {
-    cvs_hashmap_node_t *n;
-    uint64_t a;
+    size_t size, slots;
+
+    /* Keep every node 8 byte aligned for its hash. */
+    size = (hashmap->node_size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+    slots = (CVSHM_SLAB_CHUNK - sizeof(cvs_hashmap_slab_t)) / size;
+    *slot_size = size;
+
+    return (0 < slots) ? slots : 1;
+}
 
-    a = *((uint64_t*) key_a);
-    n = (cvs_hashmap_node_t*) key_b;
 
-    if (a == n->key.u64) {
-        return 0;
+/**
+ *  Copies a string into the map's arena.
+ *
+ *  @param hashmap the hashmap that owns the arena
+ *  @param s the string to copy
+ *  @param length the length of the string
+ *
+ *  @return the arena copy of the string
+ */
+static char *__arena_copy(cvs_hashmap_t *hashmap, const char *s, size_t length)
+{
+    cvs_hashmap_arena_t *arena;
+    char *rv;
+
+    arena = (cvs_hashmap_arena_t*) hashmap->arena;
+    if ((NULL == arena) || (arena->size - arena->used < length + 1)) {
+        size_t size;
+
+        size = (CVSHM_ARENA_CHUNK < length + 1) ? length + 1 : CVSHM_ARENA_CHUNK;
+        arena = (cvs_hashmap_arena_t*) malloc(sizeof(cvs_hashmap_arena_t) + size);
+        assert(arena);
+        arena->size = size;
+        arena->used = 0;
+        arena->next = (cvs_hashmap_arena_t*) hashmap->arena;
+        hashmap->arena = arena;
     }
-    if (a < n->key.u64) {
-        return -1;
+
+    rv = &arena->data[arena->used];
+    memcpy(rv, s, length + 1);
+    arena->used += length + 1;
+    hashmap->arena_used += length + 1;
+
+    return rv;
+}
+
+
+/**
+ *  Moves every live key into a fresh arena and frees the old one, dropping
+ *  the space of removed keys.
+ *
+ *  @param hashmap the hashmap whose arena to compact
+ */
+static void __arena_compact(cvs_hashmap_t *hashmap)
+{
+    cvs_hashmap_arena_t *old;
+    rebar_ll_node_t **tables[2];
+    size_t masks[2];
+    size_t t, i;
+
+    old = (cvs_hashmap_arena_t*) hashmap->arena;
+    hashmap->arena = NULL;
+    hashmap->arena_used = 0;
+    hashmap->arena_dead = 0;
+
+    tables[0] = hashmap->old_buckets;
+    masks[0] = hashmap->old_mask;
+    tables[1] = hashmap->buckets;
+    masks[1] = hashmap->bucket_mask;
+
+    for (t = 0; t < 2; t++) {
+        if (NULL == tables[t]) {
+            continue;
+        }
+        for (i = 0; i <= masks[t]; i++) {
+            rebar_ll_node_t *node;
+
+            for (node = tables[t][i]; NULL != node; node = node->next) {
+                cvs_hashmap_node_t *n;
+
+                n = rebar_ll_get_data(cvs_hashmap_node_t, node, node);
+                n->key.owned.string = __arena_copy(hashmap, n->key.owned.string,
+                                                   n->key.owned.length);
+            }
+        }
+    }
+
+    __arena_free(old);
+}
+
+
+/**
+ *  Compacts the arena once most of it is removed keys.  The copy is paid for
+ *  by the removes that made the garbage.
+ *
+ *  @param hashmap the hashmap whose arena to check
+ */
+static void __arena_reclaim(cvs_hashmap_t *hashmap)
+{
+    if ((CVSHM_ARENA_CHUNK < hashmap->arena_dead) &&
+        (hashmap->arena_used < hashmap->arena_dead * 2)) {
+        __arena_compact(hashmap);
+    }
+}
+
+
+/**
+ *  Frees every chunk of an arena.
+ */
+static void __arena_free(cvs_hashmap_arena_t *arena)
+{
+    while (NULL != arena) {
+        cvs_hashmap_arena_t *next = arena->next;
+
+        free(arena);
+        arena = next;
+    }
+}
+
+
+/**
+ *  Tells if the pairs of a map are kept inline: only integer maps are, and
+ *  only until their first bucket array is allocated.
+ *
+ *  @param hashmap the hashmap to check
+ *
+ *  @return true if the map is small, false otherwise
+ */
+static bool __is_small(cvs_hashmap_t *hashmap)
+{
+    return (NULL == hashmap->buckets) &&
+           ((CHT__UINT32 == hashmap->type) || (CHT__UINT64 == hashmap->type));
+}
+
+
+/**
+ *  Gets a pointer to an inline key of a small map.
+ *
+ *  @param hashmap the small hashmap
+ *  @param i the index of the pair
+ *
+ *  @return the pointer to the key
+ */
+static void *__small_key(cvs_hashmap_t *hashmap, size_t i)
+{
+    if (CHT__UINT32 == hashmap->type) {
+        return &hashmap->small_keys.u32[i];
+    }
+    return &hashmap->small_keys.u64[i];
+}
+
+
+/**
+ *  Finds a key among the inline keys of a small map.  With SSE2 the key is
+ *  compared against every inline key at once, 4 uint32_t or 2 uint64_t keys
+ *  per instruction, and the lanes past the count are masked off.
+ *
+ *  @param hashmap the small hashmap
+ *  @param key the key to search for
+ *
+ *  @return the index of the key or -1 if it is not there
+ */
+static int __small_find(cvs_hashmap_t *hashmap, void *key)
+{
+    unsigned mask;
+    size_t i;
+
+    mask = 0;
+#if defined(__SSE2__)
+    if (CHT__UINT32 == hashmap->type) {
+        __m128i k = _mm_set1_epi32((int) CVSHM_KEY_TO_UINT32(key));
+
+        for (i = 0; i < CVSHM_SMALL_MAX; i += 4) {
+            __m128i eq = _mm_cmpeq_epi32(k,
+                            _mm_loadu_si128((const __m128i*) &hashmap->small_keys.u32[i]));
+
+            mask |= (unsigned) _mm_movemask_ps(_mm_castsi128_ps(eq)) << i;
+        }
+    } else {
+        __m128i k = _mm_set1_epi64x((long long) CVSHM_KEY_TO_UINT64(key));
+
+        /* SSE2 has no 64 bit compare, a lane matches when both halves do. */
+        for (i = 0; i < CVSHM_SMALL_MAX; i += 2) {
+            __m128i eq = _mm_cmpeq_epi32(k,
+                            _mm_loadu_si128((const __m128i*) &hashmap->small_keys.u64[i]));
+
+            eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+            mask |= (unsigned) _mm_movemask_pd(_mm_castsi128_pd(eq)) << i;
+        }
+    }
+#else
+    if (CHT__UINT32 == hashmap->type) {
+        uint32_t k = CVSHM_KEY_TO_UINT32(key);
+
+        for (i = 0; i < CVSHM_SMALL_MAX; i++) {
+            mask |= (unsigned) (k == hashmap->small_keys.u32[i]) << i;
+        }
+    } else {
+        uint64_t k = CVSHM_KEY_TO_UINT64(key);
+
+        for (i = 0; i < CVSHM_SMALL_MAX; i++) {
+            mask |= (unsigned) (k == hashmap->small_keys.u64[i]) << i;
+        }
+    }
+#endif
+
+    /* Stale keys past the count can match, and keys are unique below it. */
+    mask &= (1u << hashmap->count) - 1;
+    if (0 == mask) {
+        return -1;
+    }
+
+    return __builtin_ctz(mask);
+}
+
+
+/**
+ *  Removes an inline pair of a small map by moving the last pair into it.
+ *
+ *  @param hashmap the small hashmap
+ *  @param i the index of the pair to remove
+ */
+static void __small_delete(cvs_hashmap_t *hashmap, size_t i)
+{
+    size_t last = --hashmap->count;
+
+    if (CHT__UINT32 == hashmap->type) {
+        hashmap->small_keys.u32[i] = hashmap->small_keys.u32[last];
+    } else {
+        hashmap->small_keys.u64[i] = hashmap->small_keys.u64[last];
+    }
+    hashmap->small_values[i] = hashmap->small_values[last];
+}
+
+
+/**
+ *  The cvs_hashmap_iterate_ex() of a small map.  A removed pair is replaced
+ *  by the last one, which is visited next from the same index.
+ *
+ *  @param hashmap the small hashmap
+ *  @param iterator the iterator to call for each pair
+ *  @param deleter the optional function called for each removed pair
+ *  @param user_data passed to the iterator and deleter
+ */
+static void __small_iterate_ex(cvs_hashmap_t *hashmap,
+                               cvs_hashmap_iterator_ex_fn_t iterator,
+                               cvs_hashmap_delete_fn_t deleter, void *user_data)
+{
+    rebar_ll_iterator_response_t response;
+    size_t i;
+
+    i = 0;
+    while (i < hashmap->count) {
+        void *key = __small_key(hashmap, i);
+
+        response = (iterator)(key, hashmap->small_values[i], user_data);
+        if ((REBAR_IR__DELETE_AND_CONTINUE == response) ||
+            (REBAR_IR__DELETE_AND_STOP == response))
+        {
+            if (deleter) {
+                (deleter)(key, hashmap->small_values[i], user_data);
+            }
+            __small_delete(hashmap, i);
+        } else {
+            i++;
+        }
+
+        if ((REBAR_IR__STOP == response) || (REBAR_IR__DELETE_AND_STOP == response)) {
+            break;
+        }
+    }
+}
+
+
+/**
+ *  Moves the inline pairs of a small map into a bucket array big enough to
+ *  take one more pair, after which the map is hashed.
+ *
+ *  @param hashmap the small hashmap
+ */
+static void __spill(cvs_hashmap_t *hashmap)
+{
+    cvs_hashmap_lookup_t lookup;
+    size_t buckets, count, i;
+
+    buckets = CVSHM_MIN_BUCKETS;
+    while (buckets <= CVSHM_SMALL_MAX) {
+        buckets *= 2;
+    }
+    count = hashmap->count;
+    hashmap->count = 0;
+    __resize(hashmap, buckets);
+
+    for (i = 0; i < count; i++) {
+        __prepare(hashmap, __small_key(hashmap, i), &lookup);
+        __insert(hashmap, &lookup, hashmap->small_values[i]);
+    }
+}
+
+
+/**
+ *  Allocates an empty filter for a table of the given number of buckets.
+ *
+ *  @param buckets the bucket count of the table, a power of 2
+ *  @param mask set to the block count - 1
+ *
+ *  @return the filter
+ */
+static uint64_t *__bloom_new(size_t buckets, size_t *mask)
+{
+    void *bloom;
+    size_t blocks;
+
+    blocks = buckets * CVSHM_BLOOM_BITS / (CACHE_LINE * 8);
+    if (0 == blocks) {
+        blocks = 1;
+    }
+
+    bloom = NULL;
+    if (0 != posix_memalign(&bloom, CACHE_LINE, blocks * CACHE_LINE)) {
+        bloom = NULL;
+    }
+    assert(bloom);
+    memset(bloom, 0, blocks * CACHE_LINE);
+    *mask = blocks - 1;
+
+    return (uint64_t*) bloom;
+}
+
+
+/**
+ *  Sets the bits of a hash in a filter, one in each word of its block.
+ *
+ *  @param bloom the filter
+ *  @param mask the block count - 1
+ *  @param hash the hash of the key
+ */
+static void __bloom_set(uint64_t *bloom, size_t mask, uint64_t hash)
+{
+    uint64_t *block;
+    uint64_t bits;
+    size_t i;
+
+    block = &bloom[CVSHM_BLOOM_BLOCK(hash, mask)];
+    bits = hash * CVSHM_BLOOM_MIX;
+    for (i = 0; i < CVSHM_BLOOM_WORDS; i++) {
+        block[i] |= 1ULL << (bits >> 58);
+        bits <<= 6;
+    }
+}
+
+
+/**
+ *  Tests the bits of a hash in a filter, without branching on each word.
+ *
+ *  @param bloom the filter
+ *  @param mask the block count - 1
+ *  @param hash the hash of the key
+ *
+ *  @return true if every bit is set, false if the key is certainly absent
+ */
+static bool __bloom_test(const uint64_t *bloom, size_t mask, uint64_t hash)
+{
+    const uint64_t *block;
+    uint64_t bits, all;
+    size_t i;
+
+    block = &bloom[CVSHM_BLOOM_BLOCK(hash, mask)];
+    bits = hash * CVSHM_BLOOM_MIX;
+    all = 1;
+    for (i = 0; i < CVSHM_BLOOM_WORDS; i++) {
+        all &= block[i] >> (bits >> 58);
+        bits <<= 6;
+    }
+
+    return (0 != all) ? true : false;
+}
+
+
+/**
+ *  Tells if a key may be in the map, according to its filter.
+ *
+ *  @param hashmap the hashmap to check
+ *  @param hash the hash of the key
+ *
+ *  @return false if the key is certainly absent, true if it may be present or
+ *          the map has no filter
+ */
+static bool __bloom_maybe(cvs_hashmap_t *hashmap, uint64_t hash)
+{
+    if (NULL == hashmap->bloom) {
+        return true;
+    }
+
+    return __bloom_test(hashmap->bloom, hashmap->bloom_mask, hash);
+}
+
+
+/**
+ *  Adds a new key to the filter, and to the one being built to replace it.
+ *
+ *  @param hashmap the hashmap the key was added to
+ *  @param hash the hash of the key
+ */
+static void __bloom_add(cvs_hashmap_t *hashmap, uint64_t hash)
+{
+    if (hashmap->bloom) {
+        __bloom_set(hashmap->bloom, hashmap->bloom_mask, hash);
+    }
+    if (hashmap->bloom_next) {
+        __bloom_set(hashmap->bloom_next, hashmap->bloom_next_mask, hash);
+    }
+}
+
+
+/**
+ *  Starts building a new filter sized for the current bucket array, dropping
+ *  any rebuild in progress.
+ *
+ *  @param hashmap the hashmap to rebuild the filter of
+ */
+static void __bloom_start(cvs_hashmap_t *hashmap)
+{
+    free(hashmap->bloom_next);
+    hashmap->bloom_next = __bloom_new(hashmap->bucket_mask + 1, &hashmap->bloom_next_mask);
+    hashmap->bloom_idx = 0;
+    hashmap->bloom_removes = 0;
+}
+
+
+/**
+ *  Adds the keys of the next few buckets to the filter being built, and puts
+ *  it in place of the old one once every bucket is in.  Nothing is done while
+ *  a rehash is moving nodes between tables; puts go into both filters in the
+ *  meantime and a resize starts the rebuild over.
+ *
+ *  @param hashmap the hashmap to rebuild the filter of
+ */
+static void __bloom_step(cvs_hashmap_t *hashmap)
+{
+    size_t i;
+
+    if ((NULL == hashmap->bloom_next) || (NULL != hashmap->old_buckets)) {
+        return;
+    }
+
+    for (i = 0; (i < CVSHM_BLOOM_REBUILD_BUCKETS) && (hashmap->bloom_idx <= hashmap->bucket_mask);
+         i++, hashmap->bloom_idx++)
+    {
+        rebar_ll_node_t *node;
+
+        for (node = hashmap->buckets[hashmap->bloom_idx]; NULL != node; node = node->next) {
+            __bloom_set(hashmap->bloom_next, hashmap->bloom_next_mask,
+                        rebar_ll_get_data(cvs_hashmap_node_t, node, node)->hash);
+        }
+    }
+
+    if (hashmap->bloom_idx > hashmap->bucket_mask) {
+        free(hashmap->bloom);
+        hashmap->bloom = hashmap->bloom_next;
+        hashmap->bloom_mask = hashmap->bloom_next_mask;
+        hashmap->bloom_next = NULL;
+        hashmap->bloom_next_mask = 0;
+        hashmap->bloom_idx = 0;
+    }
+}
+
+
+/**
+ *  Counts removed keys, which stay in the filter, and starts a rebuild once
+ *  they pass half the keys left in the map.
+ *
+ *  @param hashmap the hashmap keys were removed from
+ *  @param removes the number of keys removed
+ */
+static void __bloom_removed(cvs_hashmap_t *hashmap, size_t removes)
+{
+    hashmap->bloom_removes += removes;
+    if ((hashmap->bloom) && (NULL == hashmap->bloom_next) &&
+        (hashmap->count / 2 < hashmap->bloom_removes))
+    {
+        __bloom_start(hashmap);
+    }
+}
+
+
+/**
+ *  Works out the chance that a key that is not in the map passes the filter:
+ *  the product, over the words of a block, of the share of bits set, averaged
+ *  over the blocks.
+ *
+ *  @param bloom the filter
+ *  @param mask the block count - 1
+ *
+ *  @return the false positive rate, 0 to 1
+ */
+static double __bloom_fpr(const uint64_t *bloom, size_t mask)
+{
+    double sum;
+    size_t b, i;
+
+    sum = 0.0;
+    for (b = 0; b <= mask; b++) {
+        double p = 1.0;
+
+        for (i = 0; i < CVSHM_BLOOM_WORDS; i++) {
+            p *= (double) __builtin_popcountll(bloom[b * CVSHM_BLOOM_WORDS + i]) / 64.0;
+        }
+        sum += p;
+    }
+
+    return sum / (double) (mask + 1);
+}
+
+
+/**
+ *  Puts a pair of the map being cloned into the clone.
+ *
+ *  @param key the key of the pair
+ *  @param value the value of the pair
+ *  @param user_data the clone
+ *
+ *  @return true, to visit every pair
+ */
+static bool __clone_pair(void *key, void *value, void *user_data)
+{
+    cvs_hashmap_put((cvs_hashmap_t*) user_data, key, value);
+
+    return true;
+}
+
+
+/**
+ *  Gets where the value of the specified key is stored or returns NULL.
+ *
+ *  @param hashmap the hashmap to process
+ *  @param key the key to search for
+ *
+ *  @return the value slot of the key or NULL
+ */
+static void **__get(cvs_hashmap_t *hashmap, void *key)
+{
+    void **rv;
+
+    if ((NULL == hashmap) || (NULL == key)) {
+        return NULL;
+    }
+
+    rv = NULL;
+    CVSHM_COUNT(hashmap, gets);
+    if (__is_small(hashmap)) {
+        int i = __small_find(hashmap, key);
+
+        if (0 <= i) {
+            rv = &hashmap->small_values[i];
+        }
+    } else if (hashmap->buckets) {
+        rebar_ll_node_t **link;
+        cvs_hashmap_lookup_t lookup;
+
+        if (hashmap->old_buckets) {
+            __rehash_step(hashmap, CVSHM_REHASH_BUCKETS);
+        }
+        __bloom_step(hashmap);
+
+        __prepare(hashmap, key, &lookup);
+        if (!__bloom_maybe(hashmap, lookup.hash)) {
+            CVSHM_COUNT(hashmap, bloom_rejects);
+        } else {
+            link = __find_link(hashmap, &lookup);
+            if (*link) {
+                rv = &rebar_ll_get_data(cvs_hashmap_node_t, node, *link)->value;
+            } else if (hashmap->bloom) {
+                CVSHM_COUNT(hashmap, bloom_false_positives);
+            }
+        }
+    }
+
+    if (rv) {
+        CVSHM_COUNT(hashmap, hits);
+    } else {
+        CVSHM_COUNT(hashmap, misses);
+    }
+
+    return rv;
+}
+
+
+/**
+ *  Inserts or replaces a key that has already been prepared.
+ *
+ *  @param hashmap the hashmap to put the key into
+ *  @param lookup the prepared key
+ *  @param value the value for the key
+ */
+static void __put(cvs_hashmap_t *hashmap, const cvs_hashmap_lookup_t *lookup, void *value)
+{
+    *__slot(hashmap, lookup, NULL) = value;
+}
+
+
+/**
+ *  Finds the value slot of a key, adding the key with a NULL value if it is
+ *  not there.  A small map that is full is moved into buckets first.
+ *
+ *  @param hashmap the hashmap to search
+ *  @param lookup the prepared key
+ *  @param inserted if not NULL, set to true if the key was added
+ *
+ *  @return the value slot of the key
+ */
+static void **__slot(cvs_hashmap_t *hashmap, const cvs_hashmap_lookup_t *lookup,
+                     bool *inserted)
+{
+    rebar_ll_node_t **link;
+    cvs_hashmap_node_t *n;
+
+    if (inserted) {
+        *inserted = false;
+    }
+
+    if (__is_small(hashmap)) {
+        int i = __small_find(hashmap, lookup->key);
+
+        if (0 <= i) {
+            return &hashmap->small_values[i];
+        }
+        if (hashmap->count < CVSHM_SMALL_MAX) {
+            i = (int) hashmap->count++;
+            if (CHT__UINT32 == hashmap->type) {
+                hashmap->small_keys.u32[i] = CVSHM_KEY_TO_UINT32(lookup->key);
+            } else {
+                hashmap->small_keys.u64[i] = CVSHM_KEY_TO_UINT64(lookup->key);
+            }
+            hashmap->small_values[i] = NULL;
+            if (inserted) {
+                *inserted = true;
+            }
+            return &hashmap->small_values[i];
+        }
+        __spill(hashmap);
+    }
+
+    if (hashmap->old_buckets) {
+        __rehash_step(hashmap, CVSHM_REHASH_BUCKETS);
+    }
+    __bloom_step(hashmap);
+
+    /* Keep the load factor at or below 1. */
+    if ((NULL == hashmap->buckets) || (hashmap->count > hashmap->bucket_mask)) {
+        __grow(hashmap);
+    }
+
+    link = __find_link(hashmap, lookup);
+    if (*link) {
+        return &rebar_ll_get_data(cvs_hashmap_node_t, node, *link)->value;
+    }
+
+    n = __alloc_node(hashmap);
+    n->hash = lookup->hash;
+    n->value = NULL;
+    __set_key(hashmap, n, lookup);
+
+    /* The link points at the NULL tail of the key's chain in the new table. */
+    n->node.next = NULL;
+    *link = &n->node;
+    hashmap->count++;
+    __bloom_add(hashmap, n->hash);
+    if (inserted) {
+        *inserted = true;
+    }
+
+    return &n->value;
+}
+
+
+/**
+ *  Adds a key known not to be in the map at the head of its chain, without
+ *  searching the chain or growing the table.
+ *
+ *  @note The bucket array must be allocated.
+ *
+ *  @param hashmap the hashmap to insert into
+ *  @param lookup the prepared key
+ *  @param value the value of the key
+ */
+static void __insert(cvs_hashmap_t *hashmap, const cvs_hashmap_lookup_t *lookup, void *value)
+{
+    cvs_hashmap_node_t *n;
+    size_t i;
+
+    n = __alloc_node(hashmap);
+    n->hash = lookup->hash;
+    n->value = value;
+    __set_key(hashmap, n, lookup);
+
+    i = n->hash & hashmap->bucket_mask;
+    n->node.next = hashmap->buckets[i];
+    hashmap->buckets[i] = &n->node;
+    hashmap->count++;
+    __bloom_add(hashmap, n->hash);
+}
+
+
+/**
+ *  Hashes a batch of keys and prefetches what looking them up will touch,
+ *  so the cache misses of the whole batch overlap instead of being taken one
+ *  key at a time.  The bucket slots are requested first; by the time the
+ *  second pass reads them the first node of each chain can be requested too.
+ *
+ *  @note The bucket array must be allocated.
+ *
+ *  @param hashmap the hashmap the keys will be looked up in
+ *  @param keys the batch of keys, NULL keys are skipped
+ *  @param lookups where each prepared key is stored
+ *  @param count the number of keys in the batch
+ */
+static void __prefetch(cvs_hashmap_t *hashmap, void **keys,
+                       cvs_hashmap_lookup_t *lookups, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        if (NULL != keys[i]) {
+            uint64_t hash;
+
+            __prepare(hashmap, keys[i], &lookups[i]);
+            hash = lookups[i].hash;
+            CVSHM_PREFETCH(&hashmap->buckets[hash & hashmap->bucket_mask]);
+            if (hashmap->old_buckets) {
+                CVSHM_PREFETCH(&hashmap->old_buckets[hash & hashmap->old_mask]);
+            }
+            if (hashmap->bloom) {
+                CVSHM_PREFETCH(&hashmap->bloom[CVSHM_BLOOM_BLOCK(hash, hashmap->bloom_mask)]);
+            }
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (NULL != keys[i]) {
+            uint64_t hash = lookups[i].hash;
+
+            CVSHM_PREFETCH(hashmap->buckets[hash & hashmap->bucket_mask]);
+            if (hashmap->old_buckets) {
+                CVSHM_PREFETCH(hashmap->old_buckets[hash & hashmap->old_mask]);
+            }
+        }
+    }
+}
+
+
+/**
+ *  Finds the link in the key's bucket chain that points to the node with the
+ *  matching key.  While rehashing the key may still be in the old table, so
+ *  that is checked first.  If the key isn't present the returned link points
+ *  to the NULL at the end of the key's chain in the new table, which is where
+ *  a new node is attached.
+ *
+ *  @note The bucket array must be allocated.
+ *
+ *  @param hashmap the hashmap to search
+ *  @param lookup the prepared key to search for
+ *
+ *  @return the link pointing at the matching node, or at the chain's NULL
+ */
+static rebar_ll_node_t **__find_link(cvs_hashmap_t *hashmap,
+                                     const cvs_hashmap_lookup_t *lookup)
+{
+    if (hashmap->old_buckets) {
+        rebar_ll_node_t **link;
+
+        link = __chain_find(hashmap, &hashmap->old_buckets[lookup->hash & hashmap->old_mask],
+                            lookup);
+        if (*link) {
+            return link;
+        }
+    }
+
+    return __chain_find(hashmap, &hashmap->buckets[lookup->hash & hashmap->bucket_mask],
+                        lookup);
+}
+
+
+/**
+ *  Walks a bucket chain looking for the key.
+ *
+ *  @param hashmap the hashmap the chain belongs to
+ *  @param link the head of the chain
+ *  @param lookup the prepared key to search for
+ *
+ *  @return the link pointing at the matching node, or at the chain's NULL
+ */
+static rebar_ll_node_t **__chain_find(cvs_hashmap_t *hashmap, rebar_ll_node_t **link,
+                                      const cvs_hashmap_lookup_t *lookup)
+{
+    while (NULL != *link) {
+        cvs_hashmap_node_t *n;
+
+        n = rebar_ll_get_data(cvs_hashmap_node_t, node, *link);
+        if ((lookup->hash == n->hash) && __key_equals(hashmap, n, lookup)) {
+            break;
+        }
+        link = &(*link)->next;
+    }
+
+    return link;
+}
+
+
+/**
+ *  Frees the keys the nodes of a bucket array own and then the array itself.
+ *
+ *  @param hashmap the hashmap the nodes belong to
+ *  @param buckets the bucket array, may be NULL
+ *  @param mask the bucket count - 1
+ */
+static void __free_chains(cvs_hashmap_t *hashmap, rebar_ll_node_t **buckets,
+                          size_t mask)
+{
+    size_t i;
+
+    if (NULL == buckets) {
+        return;
+    }
+
+    /* The nodes themselves go when the slabs are freed, so only walk the
+     * chains when there are keys to free. */
+    for (i = 0; (i <= mask) && __keys_on_heap(hashmap); i++) {
+        rebar_ll_node_t *node, *next;
+
+        for (node = buckets[i]; NULL != node; node = next) {
+            next = node->next;
+            __free_node(hashmap, rebar_ll_get_data(cvs_hashmap_node_t, node, node));
+        }
+    }
+    free(buckets);
+}
+
+
+/**
+ *  Doubles the bucket array (or allocates the first one).  The current array
+ *  becomes the old table and its nodes are moved over by __rehash_step(),
+ *  either right away or a few buckets per call with CHF__INCREMENTAL_REHASH.
+ *
+ *  @param hashmap the hashmap to grow
+ */
+static void __grow(cvs_hashmap_t *hashmap)
+{
+    __resize(hashmap, (hashmap->buckets) ? (hashmap->bucket_mask + 1) * 2 : CVSHM_MIN_BUCKETS);
+}
+
+
+/**
+ *  Replaces the bucket array with one of count buckets, moving the nodes over
+ *  as __grow() describes.
+ *
+ *  @param hashmap the hashmap to resize
+ *  @param count the new bucket count, a power of 2
+ */
+static void __resize(cvs_hashmap_t *hashmap, size_t count)
+{
+    rebar_ll_node_t **buckets;
+
+    /* Only one old table is kept, so finish any migration in progress. */
+    while (NULL != hashmap->old_buckets) {
+        __rehash_step(hashmap, hashmap->old_mask + 1);
+    }
+
+    CVSHM_COUNT(hashmap, resizes);
+
+    buckets = (rebar_ll_node_t **) calloc(count, sizeof(rebar_ll_node_t*));
+    assert(buckets);
+
+    if (hashmap->buckets) {
+        hashmap->old_buckets = hashmap->buckets;
+        hashmap->old_mask = hashmap->bucket_mask;
+        hashmap->rehash_idx = 0;
+    }
+    hashmap->buckets = buckets;
+    hashmap->bucket_mask = count - 1;
+
+    if (0 == (CHF__INCREMENTAL_REHASH & hashmap->flags)) {
+        while (NULL != hashmap->old_buckets) {
+            __rehash_step(hashmap, hashmap->old_mask + 1);
+        }
+    }
+
+    /* The filter is sized by buckets, so it is replaced to match.  An empty
+     * map gets its first filter right away. */
+    if (CHF__BLOOM_FILTER & hashmap->flags) {
+        if ((NULL == hashmap->bloom) && (0 == hashmap->count)) {
+            hashmap->bloom = __bloom_new(count, &hashmap->bloom_mask);
+        } else {
+            __bloom_start(hashmap);
+        }
+    }
+}
+
+
+/**
+ *  Moves up to the requested number of non-empty buckets from the old table
+ *  into the new one.  Empty buckets are skipped, but at most
+ *  CVSHM_REHASH_EMPTY_VISITS per requested bucket are looked at so a sparse
+ *  old table can't make a single call expensive.  The hash stored in each
+ *  node means no keys are rehashed.  The old table is freed once drained.
+ *
+ *  @param hashmap the hashmap being rehashed
+ *  @param buckets the number of non-empty buckets to move
+ */
+static void __rehash_step(cvs_hashmap_t *hashmap, size_t buckets)
+{
+    size_t visits;
+
+    visits = buckets * CVSHM_REHASH_EMPTY_VISITS;
+    while ((0 < buckets) && (0 < visits) && (hashmap->rehash_idx <= hashmap->old_mask)) {
+        rebar_ll_node_t *node, *next;
+
+        node = hashmap->old_buckets[hashmap->rehash_idx];
+        hashmap->old_buckets[hashmap->rehash_idx] = NULL;
+        hashmap->rehash_idx++;
+        visits--;
+
+        if (NULL == node) {
+            continue;
+        }
+
+        for (; NULL != node; node = next) {
+            cvs_hashmap_node_t *n;
+            size_t i;
+
+            next = node->next;
+            n = rebar_ll_get_data(cvs_hashmap_node_t, node, node);
+            i = n->hash & hashmap->bucket_mask;
+            node->next = hashmap->buckets[i];
+            hashmap->buckets[i] = node;
+        }
+        buckets--;
+    }
+
+    if (hashmap->rehash_idx > hashmap->old_mask) {
+        free(hashmap->old_buckets);
+        hashmap->old_buckets = NULL;
+        hashmap->old_mask = 0;
+        hashmap->rehash_idx = 0;
+    }
+}
+
+
+/**
+ *  Adds a run of buckets to the stats.
+ *
+ *  @param hashmap the hashmap the buckets belong to
+ *  @param buckets the first bucket
+ *  @param count the number of buckets
+ *  @param stats the stats to add to
+ *
+ *  @return the total nodes compared finding every key in the buckets once
+ */
+static size_t __chain_stats(cvs_hashmap_t *hashmap, rebar_ll_node_t **buckets,
+                            size_t count, cvs_hashmap_stats_t *stats)
+{
+    size_t probes, i;
+
+    probes = 0;
+    for (i = 0; i < count; i++) {
+        rebar_ll_node_t *node;
+        size_t length;
+
+        length = 0;
+        for (node = buckets[i]; NULL != node; node = node->next) {
+            cvs_hashmap_node_t *n;
+
+            n = rebar_ll_get_data(cvs_hashmap_node_t, node, node);
+            length++;
+            if ((CHT__BYTES == hashmap->type) && (CVSHM_INLINE_KEY_MAX < hashmap->key_length)) {
+                stats->bytes += hashmap->key_length;
+            } else if ((CHT__BLOB == hashmap->type) &&
+                       (CVSHM_INLINE_KEY_MAX < n->key.blob.length)) {
+                stats->bytes += n->key.blob.length;
+            }
+        }
+
+        /* The k-th node of a chain takes k compares to find. */
+        probes += length * (length + 1) / 2;
+        if (stats->max_chain < length) {
+            stats->max_chain = length;
+        }
+        if (0 == length) {
+            stats->empty_buckets++;
+        }
+        stats->chains[(length < CVSHM_STATS_CHAINS - 1) ? length : CVSHM_STATS_CHAINS - 1]++;
     }
+    stats->buckets += count;
 
-    return 1;
+    return probes;
 }
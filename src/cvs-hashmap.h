@@ -21,6 +21,32 @@ extern "C" {
 #define CVSHM_KEY_TO_STRING(key)    ((char*) key)
 #define CVSHM_KEY_TO_UINT32(key)    (*((uint32_t*) key))
 #define CVSHM_KEY_TO_UINT64(key)    (*((uint64_t*) key))
+#define CVSHM_KEY_TO_BYTES(key)     ((uint8_t*) key)
+#define CVSHM_KEY_TO_BLOB(key)      ((cvs_hashmap_blob_t*) key)
+
+/* CHT__BYTES and CHT__BLOB keys up to this many bytes are stored in the node
+ * itself, longer keys are copied to their own allocation. */
+#define CVSHM_INLINE_KEY_MAX        16
+
+/* With CHF__INCREMENTAL_REHASH each operation migrates at most this many
+ * non-empty buckets, and visits at most CVSHM_REHASH_EMPTY_VISITS times as
+ * many buckets in total, from the old table to the new one. */
+#define CVSHM_REHASH_BUCKETS        4
+#define CVSHM_REHASH_EMPTY_VISITS   10
+
+/* cvs_hashmap_stats() counts chains of 0 to CVSHM_STATS_CHAINS - 2 nodes
+ * separately, and all longer chains in the last histogram entry. */
+#define CVSHM_STATS_CHAINS          8
+
+/* CHT__UINT32 and CHT__UINT64 maps keep up to this many pairs inline in the
+ * cvs_hashmap_t and only build buckets once they grow past it.  A multiple
+ * of 4, so the keys fill whole SSE2 registers. */
+#define CVSHM_SMALL_MAX             8
+
+/* A CHF__BLOOM_FILTER filter has this many bits per bucket, and a filter
+ * being rebuilt takes in the keys of this many buckets per call. */
+#define CVSHM_BLOOM_BITS            16
+#define CVSHM_BLOOM_REBUILD_BUCKETS 16
 
 /*----------------------------------------------------------------------------*/
 /*                               Data Structures                              */
@@ -28,16 +54,33 @@ extern "C" {
 typedef enum {
     CHT__STRING,
     CHT__UINT32,
-    CHT__UINT64
+    CHT__UINT64,
+    CHT__BYTES,     /* fixed length byte keys, see cvs_hashmap_init_bytes() */
+    CHT__BLOB       /* variable length byte keys, see cvs_hashmap_blob_t */
 } cvs_hashmap_type_t;
 
+/* The key of a CHT__BLOB map.  Pass a pointer to one of these as the key. */
+typedef struct {
+    const void *data;
+    size_t length;
+} cvs_hashmap_blob_t;
+
+/* Options for cvs_hashmap_init_ex(), combine them with | */
+typedef enum {
+    CHF__NONE               = 0,
+    CHF__INCREMENTAL_REHASH = (1 << 0), /* spread growth over many calls */
+    CHF__OWN_KEYS           = (1 << 1), /* CHT__STRING: copy keys into the map */
+    CHF__BLOOM_FILTER       = (1 << 2)  /* answer most misses from a filter */
+} cvs_hashmap_flag_t;
+
 
 /**
  *  Called during the iterate operation for each key-value pair.
  *
  *  @note No hash manipulation is permitted during this call.
  *
- *  @param key the pointer to the key portion of the map
+ *  @param key the pointer to the key portion of the map (for CHT__BLOB maps a
+ *             cvs_hashmap_blob_t that is only valid during the call)
  *  @param value the value portion of the map
  *
  *  @return true to continue, false stops the iteration process
@@ -45,10 +88,128 @@ typedef enum {
 typedef bool (*cvs_hashmap_iterator_fn_t)(void *key, void *value, void *user_data);
 
 
+/**
+ *  Called by cvs_hashmap_upsert() with the current value of a key.
+ *
+ *  @note No hash manipulation is permitted during this call.
+ *
+ *  @param key the key passed to cvs_hashmap_upsert()
+ *  @param value the current value, or NULL if the key was just added
+ *  @param found true if the key was already in the map
+ *
+ *  @return the value to store for the key
+ */
+typedef void *(*cvs_hashmap_upsert_fn_t)(void *key, void *value, bool found,
+                                         void *user_data);
+
+
+/**
+ *  Called during the iterate_ex operation for each key-value pair.
+ *
+ *  @note No hash manipulation is permitted during this call, entries are
+ *        removed by the response instead.
+ *
+ *  @param key the pointer to the key portion of the map (for CHT__BLOB maps a
+ *             cvs_hashmap_blob_t that is only valid during the call)
+ *  @param value the value portion of the map
+ *
+ *  @retval REBAR_IR__CONTINUE keep the pair & continue iterating
+ *  @retval REBAR_IR__DELETE_AND_CONTINUE remove the pair & continue iterating
+ *  @retval REBAR_IR__STOP keep the pair but stop processing
+ *  @retval REBAR_IR__DELETE_AND_STOP remove the pair & stop processing
+ */
+typedef rebar_ll_iterator_response_t (*cvs_hashmap_iterator_ex_fn_t)(void *key, void *value,
+                                                                     void *user_data);
+
+
+/**
+ *  Called for each pair the iterate_ex operation removes, before the key is
+ *  released.  This is the chance to free the value, and the key of a
+ *  CHT__STRING map that does not own its keys.
+ *
+ *  @param key the pointer to the key portion of the map, as passed to the
+ *             iterator
+ *  @param value the value portion of the map
+ */
+typedef void (*cvs_hashmap_delete_fn_t)(void *key, void *value, void *user_data);
+
+
+/* Operation counters, only kept when the library is built with
+ * CVSHM_COUNTERS defined (cmake -DENABLE_HASHMAP_COUNTERS=ON), otherwise the
+ * counting compiles away and these stay 0.  The fields are always present so
+ * the structure is the same size either way. */
+typedef struct {
+    uint64_t gets;              /* get and contains_key calls, and batch keys */
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t resizes;
+    uint64_t bloom_rejects;     /* misses the filter answered */
+    uint64_t bloom_false_positives; /* misses the filter let through */
+} cvs_hashmap_counters_t;
+
+
+/* A report on the shape of a hashmap, filled in by cvs_hashmap_stats(). */
+typedef struct {
+    size_t count;               /* key-value mappings */
+    size_t buckets;             /* including old ones not yet migrated */
+    double load_factor;         /* count / buckets */
+    size_t empty_buckets;
+    size_t max_chain;           /* the longest chain, the worst case probe */
+    double average_probe;       /* nodes compared by a successful lookup */
+    size_t chains[CVSHM_STATS_CHAINS];  /* buckets by chain length */
+    size_t bytes;               /* tables, filters, node slabs, out of node keys and arena */
+    bool rehashing;
+    bool small;                 /* the pairs are inline, see CVSHM_SMALL_MAX */
+    size_t bloom_bytes;         /* CHF__BLOOM_FILTER, including one being rebuilt */
+    double bloom_false_positive_rate;   /* of the filter in use, for an absent key */
+    cvs_hashmap_counters_t counters;
+} cvs_hashmap_stats_t;
+
+
 /* Do not directly access any of the values in the structure. */
 typedef struct {
-    rebar_ll_list_t list;
-    void *cmp;
+    cvs_hashmap_type_t type;
+    unsigned flags;
+    uint64_t seed;              /* from rebar_hash_seed() */
+    size_t key_length;          /* CHT__BYTES only */
+    size_t node_size;
+    size_t count;
+    size_t bucket_mask;         /* bucket count - 1, bucket count is 2^n */
+    rebar_ll_node_t **buckets;  /* NULL until the first put */
+
+    /* The table being drained while a rehash is in progress. */
+    size_t old_mask;
+    size_t rehash_idx;          /* the next old bucket to migrate */
+    rebar_ll_node_t **old_buckets;
+
+    /* The CHF__OWN_KEYS string arena. */
+    void *arena;
+    size_t arena_used;          /* bytes copied in, including removed keys */
+    size_t arena_dead;          /* bytes of removed keys */
+
+    /* Nodes are carved out of slab chunks, removed ones are kept for reuse. */
+    void *slabs;
+    size_t slab_left;           /* unused slots in the newest chunk */
+    void *free_nodes;
+
+    /* The CHF__BLOOM_FILTER filter, and the one replacing it while it is
+     * rebuilt.  Both are arrays of 64 byte blocks, block count - 1 in mask. */
+    uint64_t *bloom;
+    size_t bloom_mask;
+    uint64_t *bloom_next;
+    size_t bloom_next_mask;
+    size_t bloom_idx;           /* the next bucket to add to bloom_next */
+    size_t bloom_removes;       /* removes since the last rebuild started */
+
+    /* The pairs of an integer map while it has no buckets, at 0 to count - 1.
+     * A removed pair is replaced by the last one. */
+    union {
+        uint32_t u32[CVSHM_SMALL_MAX];
+        uint64_t u64[CVSHM_SMALL_MAX];
+    } small_keys;
+    void *small_values[CVSHM_SMALL_MAX];
+
+    cvs_hashmap_counters_t counters;
 } cvs_hashmap_t;
 
 /*----------------------------------------------------------------------------*/
@@ -58,6 +219,12 @@ typedef struct {
 /**
  *  Initializes the hashmap structure.
  *
+ *  CHT__UINT32 and CHT__UINT64 maps start out small: up to CVSHM_SMALL_MAX
+ *  pairs are kept inline and a lookup compares the key against all of them
+ *  at once, without hashing.  Adding one more pair (or reserving room for
+ *  more) moves them into buckets, and the map stays hashed until it is
+ *  destroyed.
+ *
  *  @param hashmap the hashmap to initialize
  *
  *  @return true if successful, false otherwise
@@ -65,6 +232,98 @@ typedef struct {
 bool cvs_hashmap_init(cvs_hashmap_t *hashmap, cvs_hashmap_type_t type );
 
 
+/**
+ *  Initializes the hashmap structure with options.  CHT__BYTES maps need a
+ *  key length and are initialized with cvs_hashmap_init_bytes() instead.
+ *
+ *  CHF__INCREMENTAL_REHASH: when the map grows the old bucket array is kept
+ *  alongside the new one and migrated a few buckets per get, contains_key,
+ *  put and remove call (see CVSHM_REHASH_BUCKETS) so no single call pays for
+ *  rehashing every entry.
+ *
+ *  CHF__OWN_KEYS: CHT__STRING keys are copied into an arena owned by the map,
+ *  with the length and hash of each key kept next to it so a lookup only
+ *  compares the bytes of a key whose hash and length both match.  The caller's
+ *  string may be freed as soon as cvs_hashmap_put() returns.  Key pointers
+ *  handed to iterators point into the arena and are only valid until the map
+ *  is next changed.  cvs_hashmap_destroy() frees the arena in one go.
+ *
+ *  CHF__BLOOM_FILTER: a blocked Bloom filter with CVSHM_BLOOM_BITS bits per
+ *  bucket is checked before the buckets, so most lookups of absent keys
+ *  (get, contains_key, get_many and remove) cost one cache line of the filter
+ *  instead of a walk down a chain.  Puts add to the filter.  Removed keys
+ *  can't be taken out, so once the removes pass half the keys in the map,
+ *  and whenever the table is resized, a new filter is built a few buckets
+ *  per call (see CVSHM_BLOOM_REBUILD_BUCKETS) while the old one keeps
+ *  answering.  cvs_hashmap_stats() reports the filter's size and its false
+ *  positive rate.
+ *
+ *  @param hashmap the hashmap to initialize
+ *  @param type the type of the keys
+ *  @param flags the cvs_hashmap_flag_t options or'ed together
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_hashmap_init_ex(cvs_hashmap_t *hashmap, cvs_hashmap_type_t type,
+                         unsigned flags);
+
+
+/**
+ *  Initializes a CHT__BYTES hashmap, where every key is key_length bytes
+ *  (a MAC address, a UUID, ...) and keys are compared with memcmp().
+ *
+ *  Unlike CHT__STRING keys, CHT__BYTES and CHT__BLOB keys are copied into the
+ *  map by cvs_hashmap_put(), so the caller's key may be reused right away.
+ *
+ *  @param hashmap the hashmap to initialize
+ *  @param key_length the number of bytes in every key, must not be 0
+ *  @param flags the cvs_hashmap_flag_t options or'ed together
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_hashmap_init_bytes(cvs_hashmap_t *hashmap, size_t key_length,
+                            unsigned flags);
+
+
+/**
+ *  Initializes a hashmap holding keys[i] -> values[i] for every i.  The
+ *  bucket array is sized for count keys once, so loading never rehashes.
+ *
+ *  If unique is true the keys are inserted without looking for an existing
+ *  mapping first, which is the bulk of the cost of a put.  The caller must
+ *  guarantee that no key appears twice in the array; a repeated key is stored
+ *  twice and counted twice.  If unique is false a repeated key replaces the
+ *  earlier value, as cvs_hashmap_put() does.  NULL keys are skipped.
+ *
+ *  @param hashmap the hashmap to initialize
+ *  @param type the type of the keys
+ *  @param flags the cvs_hashmap_flag_t options or'ed together
+ *  @param keys the array of key pointers
+ *  @param values the array of values
+ *  @param count the number of keys
+ *  @param unique true if the keys are known to be distinct
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_hashmap_init_from_arrays(cvs_hashmap_t *hashmap, cvs_hashmap_type_t type,
+                                  unsigned flags, void **keys, void **values,
+                                  size_t count, bool unique);
+
+
+/**
+ *  Initializes a hashmap with the type, flags and key-value pairs of another.
+ *  Keys are copied as cvs_hashmap_put() copies them: CHT__STRING keys are
+ *  shared with the source unless it has CHF__OWN_KEYS.  Values are always
+ *  shared.
+ *
+ *  @param hashmap the hashmap to initialize
+ *  @param source the hashmap to copy, which is not changed
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_hashmap_clone(cvs_hashmap_t *hashmap, cvs_hashmap_t *source);
+
+
 /**
  *  Destroys the structure.
  *
@@ -124,6 +383,86 @@ void *cvs_hashmap_remove(cvs_hashmap_t *hashmap, void *key);
 void cvs_hashmap_put(cvs_hashmap_t *hashmap, void *key, void *value);
 
 
+/**
+ *  Returns the slot holding the value of a key, adding the key with a NULL
+ *  value if it is not in the map, so a read-modify-write takes one lookup:
+ *
+ *      void **slot = cvs_hashmap_get_or_insert(&map, word, NULL);
+ *      *slot = (void*) ((uintptr_t) *slot + 1);
+ *
+ *  The slot stays valid until the next change to the map (a put, remove or
+ *  insert of any key, reserve or destroy).  Small CHT__UINT32 and CHT__UINT64
+ *  maps keep their pairs in arrays, where removing one key moves another and
+ *  growing past CVSHM_SMALL_MAX keys moves them all, so get the slot again
+ *  after a change.
+ *
+ *  @param hashmap the hashmap to search
+ *  @param key the pointer to the key to find or add
+ *  @param inserted if not NULL, set to true if the key was added and false if
+ *                  it was already in the map
+ *
+ *  @return the value slot of the key, or NULL on error
+ */
+void **cvs_hashmap_get_or_insert(cvs_hashmap_t *hashmap, void *key, bool *inserted);
+
+
+/**
+ *  Finds or adds a key and stores the value returned by the callback, which is
+ *  given the current value, in a single lookup.
+ *
+ *  @param hashmap the hashmap to update
+ *  @param key the pointer to the key to find or add
+ *  @param update the function computing the new value
+ *  @param user_data additional user data passed through to the callback
+ *
+ *  @return the value stored, or NULL on error
+ */
+void *cvs_hashmap_upsert(cvs_hashmap_t *hashmap, void *key,
+                         cvs_hashmap_upsert_fn_t update, void *user_data);
+
+
+/**
+ *  Looks up a batch of keys.  All the keys are hashed and their buckets
+ *  prefetched before any is resolved, so the cache misses overlap.
+ *
+ *  @param hashmap the hashmap to search
+ *  @param keys the array of key pointers to look up
+ *  @param values the array the values are stored in, values[i] is set to the
+ *                value keys[i] maps to, or NULL if there is no mapping (or
+ *                keys[i] is NULL)
+ *  @param count the number of keys
+ */
+void cvs_hashmap_get_many(cvs_hashmap_t *hashmap, void **keys, void **values,
+                          size_t count);
+
+
+/**
+ *  Associates each values[i] with keys[i], as cvs_hashmap_put() does, for a
+ *  batch of keys.  All the keys are hashed and their buckets prefetched
+ *  before any is inserted.  NULL keys are skipped.
+ *
+ *  @param hashmap the hashmap to put the keys into
+ *  @param keys the array of key pointers
+ *  @param values the array of values
+ *  @param count the number of keys
+ */
+void cvs_hashmap_put_many(cvs_hashmap_t *hashmap, void **keys, void **values,
+                          size_t count);
+
+
+/**
+ *  Grows the bucket array so the map can hold count keys without rehashing.
+ *  Any rehash in progress, and the one this causes, are finished before this
+ *  returns, even with CHF__INCREMENTAL_REHASH.  The map never shrinks.
+ *
+ *  @param hashmap the hashmap to grow
+ *  @param count the number of keys the map should hold
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_hashmap_reserve(cvs_hashmap_t *hashmap, size_t count);
+
+
 /**
  *  Returns true if this map contains no key-value mappings.
  *
@@ -147,6 +486,22 @@ void cvs_hashmap_iterate(cvs_hashmap_t *hashmap,
                          void *user_data);
 
 
+/**
+ *  Iterates over the key-value mappings like cvs_hashmap_iterate(), but the
+ *  iterator may remove the pair it is given, so expiring entries takes a
+ *  single pass.
+ *
+ *  @param hashmap the hashmap to iterate over
+ *  @param iterator the iterator function to call for each pair
+ *  @param deleter the function called for each removed pair, may be NULL
+ *  @param user_data additional user data passed through to both functions
+ */
+void cvs_hashmap_iterate_ex(cvs_hashmap_t *hashmap,
+                            cvs_hashmap_iterator_ex_fn_t iterator,
+                            cvs_hashmap_delete_fn_t deleter,
+                            void *user_data);
+
+
 /**
  *  Returns the number of key-value mappings in this hashmap. 
  *
@@ -157,6 +512,31 @@ void cvs_hashmap_iterate(cvs_hashmap_t *hashmap,
 size_t cvs_hashmap_get_size(cvs_hashmap_t *hashmap);
 
 
+/**
+ *  Reports the size, load and chain lengths of the hashmap, and the
+ *  operation counters if they are compiled in.  This walks every bucket, so
+ *  it takes time in proportion to the size of the map.
+ *
+ *  @param hashmap the hashmap to inspect
+ *  @param stats where to store the report
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_hashmap_stats(cvs_hashmap_t *hashmap, cvs_hashmap_stats_t *stats);
+
+
+/**
+ *  Finishes the work CHF__INCREMENTAL_REHASH and CHF__BLOOM_FILTER spread
+ *  over later calls.  Until the map is next changed, get, contains_key,
+ *  get_many, iterate and stats then only read it, so any number of threads
+ *  may call them at once.  (The CVSHM_COUNTERS counters are not kept
+ *  atomically, and may lose counts while threads share a map.)
+ *
+ *  @param hashmap the hashmap to settle
+ */
+void cvs_hashmap_settle(cvs_hashmap_t *hashmap);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,430 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "cvs-shardmap.h"
+#include "queue.h"
+#include "rebar-hash.h"
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+#define CACHE_LINE      64
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+/* A forwarded change.  CHT__STRING keys are copied in after the header. */
+typedef struct {
+    bool remove;
+    void *value;
+    union {
+        uint32_t u32;
+        uint64_t u64;
+    } key;
+    char string[];
+} cvs_shardmap_msg_t;
+
+/* Each shard gets its own cache lines so the owners and the senders of
+ * different shards don't bounce the same line between cores. */
+struct __cvs_shardmap_shard {
+    pthread_mutex_t lock;           /* guards inbox only */
+    queue_t *inbox;
+    queue_t *draining;              /* owner only, swapped with inbox */
+    cvs_hashmap_t map;              /* owner only */
+} __attribute__((aligned(CACHE_LINE)));
+
+typedef struct __cvs_shardmap_shard cvs_shardmap_shard_t;
+
+/*----------------------------------------------------------------------------*/
+/*                            File Scoped Variables                           */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                             Function Prototypes                            */
+/*----------------------------------------------------------------------------*/
+static bool __send(cvs_shardmap_t *shardmap, size_t shard, void *key, void *value,
+                   bool remove);
+static void __apply(cvs_shardmap_t *shardmap, size_t shard, void *key, void *value,
+                    bool remove);
+static void *__msg_key(cvs_shardmap_t *shardmap, cvs_shardmap_msg_t *msg);
+static void __free_msg(void *msg);
+static void __destroy_shard(cvs_shardmap_t *shardmap, cvs_shardmap_shard_t *s);
+
+/*----------------------------------------------------------------------------*/
+/*                             External Functions                             */
+/*----------------------------------------------------------------------------*/
+/* See cvs-shardmap.h for details. */
+bool cvs_shardmap_init(cvs_shardmap_t *shardmap, cvs_hashmap_type_t type,
+                       unsigned flags, size_t shards,
+                       cvs_hashmap_delete_fn_t deleter, void *user_data)
+{
+    void *mem;
+    size_t i;
+
+    if ((NULL == shardmap) || (0 == shards) || (CVSSM_NO_SHARD == shards)) {
+        return false;
+    }
+
+    switch( type ) {
+        case CHT__STRING:
+            flags |= CHF__OWN_KEYS;
+            break;
+
+        case CHT__UINT32:
+        case CHT__UINT64:
+            break;
+
+        default:
+            return false;
+    }
+
+    if (0 != posix_memalign(&mem, CACHE_LINE, shards * sizeof(cvs_shardmap_shard_t))) {
+        return false;
+    }
+    memset(mem, 0, shards * sizeof(cvs_shardmap_shard_t));
+
+    shardmap->type = type;
+    shardmap->seed = rebar_hash_seed();
+    shardmap->shard_count = shards;
+    shardmap->deleter = deleter;
+    shardmap->user_data = user_data;
+    shardmap->shards = (cvs_shardmap_shard_t*) mem;
+    for (i = 0; i < shards; i++) {
+        cvs_shardmap_shard_t *s = &shardmap->shards[i];
+
+        s->inbox = rebar_queue_init();
+        s->draining = rebar_queue_init();
+        if ((NULL == s->inbox) || (NULL == s->draining) ||
+            (false == cvs_hashmap_init_ex(&s->map, type, flags)) ||
+            (0 != pthread_mutex_init(&s->lock, NULL)))
+        {
+            /* The shard that failed has no mutex, the ones before it do. */
+            rebar_queue_delete(s->inbox, __free_msg);
+            rebar_queue_delete(s->draining, __free_msg);
+            cvs_hashmap_destroy(&s->map);
+            while (0 < i) {
+                __destroy_shard(shardmap, &shardmap->shards[--i]);
+            }
+            free(shardmap->shards);
+            memset(shardmap, 0, sizeof(cvs_shardmap_t));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* See cvs-shardmap.h for details. */
+void cvs_shardmap_destroy(cvs_shardmap_t *shardmap)
+{
+    size_t i;
+
+    if ((NULL == shardmap) || (NULL == shardmap->shards)) {
+        return;
+    }
+
+    for (i = 0; i < shardmap->shard_count; i++) {
+        __destroy_shard(shardmap, &shardmap->shards[i]);
+    }
+
+    free(shardmap->shards);
+    shardmap->shards = NULL;
+    shardmap->shard_count = 0;
+}
+
+
+/* See cvs-shardmap.h for details. */
+size_t cvs_shardmap_route(cvs_shardmap_t *shardmap, void *key)
+{
+    uint64_t hash;
+
+    if ((NULL == shardmap) || (NULL == shardmap->shards) || (NULL == key)) {
+        return CVSSM_NO_SHARD;
+    }
+
+    if (CHT__STRING == shardmap->type) {
+        hash = rebar_hash_string((const char*) key, NULL, shardmap->seed);
+    } else if (CHT__UINT64 == shardmap->type) {
+        hash = rebar_hash_u64(*((uint64_t*) key), shardmap->seed);
+    } else {
+        hash = rebar_hash_u32(*((uint32_t*) key), shardmap->seed);
+    }
+
+    return (size_t) (hash % shardmap->shard_count);
+}
+
+
+/* See cvs-shardmap.h for details. */
+cvs_hashmap_t *cvs_shardmap_local(cvs_shardmap_t *shardmap, size_t shard)
+{
+    if ((NULL == shardmap) || (NULL == shardmap->shards) ||
+        (shardmap->shard_count <= shard))
+    {
+        return NULL;
+    }
+
+    return &shardmap->shards[shard].map;
+}
+
+
+/* See cvs-shardmap.h for details. */
+void *cvs_shardmap_get(cvs_shardmap_t *shardmap, size_t shard, void *key)
+{
+    if ((NULL == shardmap) || (NULL == shardmap->shards) ||
+        (shardmap->shard_count <= shard) || (NULL == key) ||
+        (shard != cvs_shardmap_route(shardmap, key)))
+    {
+        return NULL;
+    }
+
+    return cvs_hashmap_get(&shardmap->shards[shard].map, key);
+}
+
+
+/* See cvs-shardmap.h for details. */
+bool cvs_shardmap_put(cvs_shardmap_t *shardmap, size_t shard, void *key, void *value)
+{
+    size_t owner;
+
+    owner = cvs_shardmap_route(shardmap, key);
+    if (CVSSM_NO_SHARD == owner) {
+        return false;
+    }
+
+    if (owner == shard) {
+        __apply(shardmap, owner, key, value, false);
+        return true;
+    }
+
+    return __send(shardmap, owner, key, value, false);
+}
+
+
+/* See cvs-shardmap.h for details. */
+bool cvs_shardmap_remove(cvs_shardmap_t *shardmap, size_t shard, void *key)
+{
+    size_t owner;
+
+    owner = cvs_shardmap_route(shardmap, key);
+    if (CVSSM_NO_SHARD == owner) {
+        return false;
+    }
+
+    if (owner == shard) {
+        __apply(shardmap, owner, key, NULL, true);
+        return true;
+    }
+
+    return __send(shardmap, owner, key, NULL, true);
+}
+
+
+/* See cvs-shardmap.h for details. */
+size_t cvs_shardmap_drain(cvs_shardmap_t *shardmap, size_t shard)
+{
+    cvs_shardmap_shard_t *s;
+    cvs_shardmap_msg_t *msg;
+    queue_t *pending;
+    size_t rv;
+
+    if ((NULL == shardmap) || (NULL == shardmap->shards) ||
+        (shardmap->shard_count <= shard))
+    {
+        return 0;
+    }
+
+    s = &shardmap->shards[shard];
+
+    /* The draining queue is always empty here, so swapping it in leaves the
+     * senders an empty inbox without allocating one. */
+    pthread_mutex_lock(&s->lock);
+    pending = s->inbox;
+    s->inbox = s->draining;
+    pthread_mutex_unlock(&s->lock);
+    s->draining = pending;
+
+    rv = 0;
+    while (NULL != (msg = (cvs_shardmap_msg_t*) rebar_queue_pop(pending))) {
+        __apply(shardmap, shard, __msg_key(shardmap, msg), msg->value, msg->remove);
+        __free_msg(msg);
+        rv++;
+    }
+
+    return rv;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                             Internal functions                             */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Queues a change in the inbox of the shard that owns its key.
+ *
+ *  @param shardmap the map to change
+ *  @param shard the shard the key belongs to
+ *  @param key the key to change
+ *  @param value the value to store
+ *  @param remove true to remove the key instead
+ *
+ *  @return true if the change was queued, false otherwise
+ */
+static bool __send(cvs_shardmap_t *shardmap, size_t shard, void *key, void *value,
+                   bool remove)
+{
+    cvs_shardmap_shard_t *s;
+    cvs_shardmap_msg_t *msg;
+    size_t length;
+    int rv;
+
+    length = 0;
+    if (CHT__STRING == shardmap->type) {
+        length = strlen((const char*) key) + 1;
+    }
+
+    msg = (cvs_shardmap_msg_t*) malloc(sizeof(cvs_shardmap_msg_t) + length);
+    if (NULL == msg) {
+        return false;
+    }
+    msg->remove = remove;
+    msg->value = value;
+    if (CHT__STRING == shardmap->type) {
+        memcpy(msg->string, key, length);
+    } else if (CHT__UINT64 == shardmap->type) {
+        msg->key.u64 = *((uint64_t*) key);
+    } else {
+        msg->key.u32 = *((uint32_t*) key);
+    }
+
+    s = &shardmap->shards[shard];
+    pthread_mutex_lock(&s->lock);
+    rv = rebar_queue_push(msg, s->inbox);
+    pthread_mutex_unlock(&s->lock);
+
+    if (0 != rv) {
+        free(msg);
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ *  Applies a change to the owner's shard, handing any value it replaces or
+ *  removes to the deleter.
+ *
+ *  @param shardmap the map to change
+ *  @param shard the shard the key belongs to
+ *  @param key the key to change
+ *  @param value the value to store
+ *  @param remove true to remove the key instead
+ */
+static void __apply(cvs_shardmap_t *shardmap, size_t shard, void *key, void *value,
+                    bool remove)
+{
+    cvs_hashmap_t *map;
+    void *old;
+
+    map = &shardmap->shards[shard].map;
+    if (remove) {
+        old = cvs_hashmap_remove(map, key);
+    } else {
+        void **slot;
+        bool inserted;
+
+        slot = cvs_hashmap_get_or_insert(map, key, &inserted);
+        old = (inserted) ? NULL : *slot;
+        *slot = value;
+    }
+
+    if ((NULL != old) && (old != value) && (NULL != shardmap->deleter)) {
+        (shardmap->deleter)(key, old, shardmap->user_data);
+    }
+}
+
+
+/**
+ *  Returns the key pointer of a queued change.
+ */
+static void *__msg_key(cvs_shardmap_t *shardmap, cvs_shardmap_msg_t *msg)
+{
+    if (CHT__STRING == shardmap->type) {
+        return msg->string;
+    } else if (CHT__UINT64 == shardmap->type) {
+        return &msg->key.u64;
+    }
+
+    return &msg->key.u32;
+}
+
+
+/**
+ *  Frees a queued change, the rebar_queue_delete_element_fn_t of the inboxes.
+ */
+static void __free_msg(void *msg)
+{
+    free(msg);
+}
+
+
+/**
+ *  Frees the queued changes, queues, map and lock of a shard.  The value of
+ *  each queued put goes to the deleter, since the sender was told the change
+ *  was queued and nobody else can reach the value any more.
+ *
+ *  @param shardmap the map the shard belongs to
+ *  @param s the shard to destroy
+ */
+static void __destroy_shard(cvs_shardmap_t *shardmap, cvs_shardmap_shard_t *s)
+{
+    queue_t *queues[2];
+    size_t i;
+
+    /* Pop the queues empty first so every message is freed however
+     * rebar_queue_delete() walks them. */
+    queues[0] = s->inbox;
+    queues[1] = s->draining;
+    for (i = 0; i < 2; i++) {
+        cvs_shardmap_msg_t *msg;
+
+        while (NULL != (msg = (cvs_shardmap_msg_t*) rebar_queue_pop(queues[i]))) {
+            void *key = __msg_key(shardmap, msg);
+
+            /* A put of the value the shard already holds leaves it with the
+             * shard's pairs. */
+            if ((false == msg->remove) && (NULL != msg->value) &&
+                (NULL != shardmap->deleter) &&
+                (msg->value != cvs_hashmap_get(&s->map, key)))
+            {
+                (shardmap->deleter)(key, msg->value, shardmap->user_data);
+            }
+            __free_msg(msg);
+        }
+    }
+    rebar_queue_delete(s->inbox, __free_msg);
+    rebar_queue_delete(s->draining, __free_msg);
+
+    cvs_hashmap_destroy(&s->map);
+    pthread_mutex_destroy(&s->lock);
+}
@@ -0,0 +1,193 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __CVS_SHARDMAP_H__
+#define __CVS_SHARDMAP_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cvs-hashmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * cvs-shardmap.h implements a map split into shards, each a plain cvs_hashmap
+ * owned by one thread.  A key belongs to the shard its hash routes it to.
+ *
+ * The owner reads and writes its shard without any locking.  Every other
+ * thread sends its puts and removes to the shard's inbox, a rebar_queue
+ * behind a mutex, and the owner applies them the next time it calls
+ * cvs_shardmap_drain().  The only state shared between threads is the inbox,
+ * so threads only contend when they forward changes to each other.
+ *
+ * Forwarded changes are applied in the order each sender made them, but
+ * changes from different senders interleave in any order, and a change is
+ * not visible until the owner drains its inbox.
+ *
+ * CHT__STRING keys are always copied (the shards use CHF__OWN_KEYS), since a
+ * forwarded key has to outlive the caller's buffer.
+ */
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+/* The shard argument of callers that do not own a shard. */
+#define CVSSM_NO_SHARD  SIZE_MAX
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+struct __cvs_shardmap_shard;
+
+/* Do not directly access any of the values in the structure. */
+typedef struct {
+    cvs_hashmap_type_t type;
+    uint64_t seed;                  /* for routing, the shards have their own */
+    size_t shard_count;
+    cvs_hashmap_delete_fn_t deleter;
+    void *user_data;
+    struct __cvs_shardmap_shard *shards;
+} cvs_shardmap_t;
+
+/*----------------------------------------------------------------------------*/
+/*                                 Functions                                  */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Initializes the sharded map.
+ *
+ *  @note This is not thread safe, the map must not be shared until it
+ *        returns.
+ *
+ *  @param shardmap the map to initialize
+ *  @param type the type of the keys, CHT__STRING, CHT__UINT32 or CHT__UINT64
+ *  @param flags the cvs_hashmap_flag_t options of every shard
+ *  @param shards the number of shards, usually one per worker thread
+ *  @param deleter called by the owner with each value a cvs_shardmap_put()
+ *                 replaces or a cvs_shardmap_remove() removes, may be NULL
+ *  @param user_data additional user data passed through to the deleter
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_shardmap_init(cvs_shardmap_t *shardmap, cvs_hashmap_type_t type,
+                       unsigned flags, size_t shards,
+                       cvs_hashmap_delete_fn_t deleter, void *user_data);
+
+
+/**
+ *  Destroys the structure.  Changes still waiting in an inbox are dropped,
+ *  and the value of each dropped put is handed to the deleter.
+ *
+ *  @note This does not destroy the key-value pairs of the map, only the map.
+ *  @note This is not thread safe, no other thread may be using the map.
+ *
+ *  @param shardmap the map to destroy
+ */
+void cvs_shardmap_destroy(cvs_shardmap_t *shardmap);
+
+
+/**
+ *  Returns the shard a key belongs to.  Any thread may call this.
+ *
+ *  @param shardmap the map to route in
+ *  @param key the pointer to the key
+ *
+ *  @return the shard index, or CVSSM_NO_SHARD on error
+ */
+size_t cvs_shardmap_route(cvs_shardmap_t *shardmap, void *key);
+
+
+/**
+ *  Returns the hashmap of a shard, for the owner to search or iterate with
+ *  the cvs_hashmap calls.
+ *
+ *  @note Only the owner of the shard may use the hashmap.
+ *
+ *  @param shardmap the map the shard belongs to
+ *  @param shard the shard index
+ *
+ *  @return the shard's hashmap, or NULL on error
+ */
+cvs_hashmap_t *cvs_shardmap_local(cvs_shardmap_t *shardmap, size_t shard);
+
+
+/**
+ *  Returns the value to which the specified key is mapped in the caller's own
+ *  shard, or NULL if the shard contains no mapping for the key.
+ *
+ *  @note Only the owner of the shard may call this.
+ *
+ *  @param shardmap the map to search
+ *  @param shard the caller's shard
+ *  @param key the pointer to the key whose associated value is to be returned
+ *
+ *  @return the value to which the specified key is mapped, or NULL if there is
+ *          no mapping, or the key belongs to another shard (or any other error
+ *          occurs)
+ */
+void *cvs_shardmap_get(cvs_shardmap_t *shardmap, size_t shard, void *key);
+
+
+/**
+ *  Associates the specified value with the specified key.  A key of the
+ *  caller's own shard is stored right away, any other key is forwarded to
+ *  the inbox of its shard.
+ *
+ *  @param shardmap the map to change
+ *  @param shard the caller's shard, or CVSSM_NO_SHARD
+ *  @param key pointer to the key with which the specified value is to be associated
+ *  @param value value to be associated with the specified key
+ *
+ *  @return true if the change was applied or queued, false otherwise
+ */
+bool cvs_shardmap_put(cvs_shardmap_t *shardmap, size_t shard, void *key, void *value);
+
+
+/**
+ *  Removes the mapping for the specified key, right away if the key is in
+ *  the caller's own shard and through the key's shard's inbox otherwise.
+ *
+ *  @param shardmap the map to change
+ *  @param shard the caller's shard, or CVSSM_NO_SHARD
+ *  @param key the pointer to the key whose mapping is to be removed
+ *
+ *  @return true if the change was applied or queued, false otherwise
+ */
+bool cvs_shardmap_remove(cvs_shardmap_t *shardmap, size_t shard, void *key);
+
+
+/**
+ *  Applies the changes other threads have sent to a shard.  The inbox is only
+ *  locked long enough to swap it for an empty one.
+ *
+ *  @note Only the owner of the shard may call this.
+ *
+ *  @param shardmap the map the shard belongs to
+ *  @param shard the caller's shard
+ *
+ *  @return the number of changes applied
+ */
+size_t cvs_shardmap_drain(cvs_shardmap_t *shardmap, size_t shard);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
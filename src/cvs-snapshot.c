@@ -0,0 +1,432 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cvs-snapshot.h"
+#include "rebar-hash.h"
+#include "rebar-key.h"
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+#define SNAPSHOT_MAGIC      "CVSSNAP"
+#define SNAPSHOT_VERSION    1
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+
+#define MIN_SLOTS           8
+
+/* Records and values start on 8 byte boundaries. */
+#define ALIGN8(x)           (((x) + 7) & ~((uint64_t) 7))
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+/* The start of the file.  The slot table follows it, then the records. */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;        /* SNAPSHOT_BYTE_ORDER as the writer saw it */
+    uint32_t type;
+    uint32_t crc;               /* CRC32C of the records, then the slots */
+    uint64_t key_length;
+    uint64_t seed;
+    uint64_t count;
+    uint64_t slot_count;
+    uint64_t file_size;
+} cvs_snapshot_header_t;
+
+/* A record is this, the key bytes, padding, then the value bytes. */
+typedef struct {
+    uint32_t key_length;
+    uint32_t value_length;
+} cvs_snapshot_record_t;
+
+/* The state of a save, passed through cvs_hashmap_iterate(). */
+typedef struct {
+    cvs_hashmap_t *hashmap;
+    FILE *f;
+    uint64_t *slots;
+    uint64_t slot_mask;
+    uint64_t seed;
+    uint64_t offset;            /* where the next record goes */
+    uint32_t crc;
+    cvs_snapshot_value_fn_t serializer;
+    void *user_data;
+    bool failed;
+} cvs_snapshot_writer_t;
+
+/*----------------------------------------------------------------------------*/
+/*                            File Scoped Variables                           */
+/*----------------------------------------------------------------------------*/
+static const uint8_t __zeros[8];
+
+/*----------------------------------------------------------------------------*/
+/*                             Function Prototypes                            */
+/*----------------------------------------------------------------------------*/
+static bool __write_record(void *key, void *value, void *user_data);
+static bool __write(cvs_snapshot_writer_t *w, const void *data, size_t length);
+static const cvs_snapshot_record_t *__find(cvs_snapshot_t *snapshot, void *key);
+
+/*----------------------------------------------------------------------------*/
+/*                             External Functions                             */
+/*----------------------------------------------------------------------------*/
+/* See cvs-snapshot.h for details. */
+bool cvs_snapshot_save(cvs_hashmap_t *hashmap, const char *path,
+                       cvs_snapshot_value_fn_t serializer, void *user_data)
+{
+    cvs_snapshot_writer_t w;
+    cvs_snapshot_header_t header;
+    uint64_t slot_count;
+    char *tmp;
+    int fd;
+    bool rv;
+
+    if ((NULL == hashmap) || (NULL == path)) {
+        return false;
+    }
+
+    slot_count = MIN_SLOTS;
+    while (slot_count < cvs_hashmap_get_size(hashmap) * 2) {
+        slot_count *= 2;
+    }
+
+    tmp = (char*) malloc(strlen(path) + sizeof(".XXXXXX"));
+    if (NULL == tmp) {
+        return false;
+    }
+    sprintf(tmp, "%s.XXXXXX", path);
+
+    memset(&w, 0, sizeof(w));
+    w.hashmap = hashmap;
+    w.slots = (uint64_t*) calloc(slot_count * 2, sizeof(uint64_t));
+    w.slot_mask = slot_count - 1;
+    w.seed = rebar_hash_seed();
+    w.offset = sizeof(header) + slot_count * 2 * sizeof(uint64_t);
+    w.serializer = serializer;
+    w.user_data = user_data;
+
+    fd = -1;
+    if (NULL != w.slots) {
+        fd = mkstemp(tmp);
+    }
+    if (0 <= fd) {
+        w.f = fdopen(fd, "wb");
+        if (NULL == w.f) {
+            close(fd);
+        }
+    }
+
+    rv = false;
+    if (NULL != w.f) {
+        /* The records are written first, the table once they are placed. */
+        if (0 != fseeko(w.f, (off_t) w.offset, SEEK_SET)) {
+            w.failed = true;
+        }
+        if (false == w.failed) {
+            cvs_hashmap_iterate(hashmap, __write_record, &w);
+        }
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.byte_order = SNAPSHOT_BYTE_ORDER;
+        header.type = (uint32_t) hashmap->type;
+        header.key_length = hashmap->key_length;
+        header.seed = w.seed;
+        header.count = cvs_hashmap_get_size(hashmap);
+        header.slot_count = slot_count;
+        header.file_size = w.offset;
+        header.crc = rebar_hash_crc32c(w.slots, slot_count * 2 * sizeof(uint64_t), w.crc);
+
+        if ((false == w.failed) &&
+            (0 == fseeko(w.f, 0, SEEK_SET)) &&
+            (1 == fwrite(&header, sizeof(header), 1, w.f)) &&
+            (slot_count * 2 == fwrite(w.slots, sizeof(uint64_t), slot_count * 2, w.f)) &&
+            (0 == fflush(w.f)) &&
+            (0 == fsync(fileno(w.f)))) {
+            rv = true;
+        }
+
+        if (0 != fclose(w.f)) {
+            rv = false;
+        }
+        if ((false == rv) || (0 != rename(tmp, path))) {
+            unlink(tmp);
+            rv = false;
+        }
+    }
+
+    free(w.slots);
+    free(tmp);
+
+    return rv;
+}
+
+
+/* See cvs-snapshot.h for details. */
+bool cvs_snapshot_open(cvs_snapshot_t *snapshot, const char *path)
+{
+    const cvs_snapshot_header_t *header;
+    struct stat st;
+    void *base;
+    int fd;
+
+    if ((NULL == snapshot) || (NULL == path)) {
+        return false;
+    }
+    memset(snapshot, 0, sizeof(cvs_snapshot_t));
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    if ((0 != fstat(fd, &st)) || ((size_t) st.st_size < sizeof(cvs_snapshot_header_t))) {
+        close(fd);
+        return false;
+    }
+
+    /* The mapping holds its own reference to the file. */
+    base = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == base) {
+        return false;
+    }
+
+    header = (const cvs_snapshot_header_t*) base;
+    if ((0 != memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC))) ||
+        (SNAPSHOT_VERSION != header->version) ||
+        (SNAPSHOT_BYTE_ORDER != header->byte_order) ||
+        (CHT__BLOB < header->type) ||
+        ((uint64_t) st.st_size != header->file_size) ||
+        (header->slot_count < MIN_SLOTS) ||
+        (0 != (header->slot_count & (header->slot_count - 1))) ||
+        (header->slot_count > (header->file_size - sizeof(*header)) / (2 * sizeof(uint64_t))) ||
+        (header->count >= header->slot_count)) {
+        munmap(base, (size_t) st.st_size);
+        return false;
+    }
+
+    snapshot->base = (const uint8_t*) base;
+    snapshot->size = (size_t) st.st_size;
+    snapshot->type = (cvs_hashmap_type_t) header->type;
+    snapshot->key_length = (size_t) header->key_length;
+    snapshot->seed = header->seed;
+    snapshot->count = (size_t) header->count;
+    snapshot->slot_mask = (size_t) header->slot_count - 1;
+    snapshot->slots = (const uint64_t*) &snapshot->base[sizeof(*header)];
+
+    return true;
+}
+
+
+/* See cvs-snapshot.h for details. */
+bool cvs_snapshot_verify(cvs_snapshot_t *snapshot)
+{
+    const cvs_snapshot_header_t *header;
+    size_t slot_bytes, records;
+    uint32_t crc;
+
+    if ((NULL == snapshot) || (NULL == snapshot->base)) {
+        return false;
+    }
+
+    header = (const cvs_snapshot_header_t*) snapshot->base;
+    slot_bytes = (snapshot->slot_mask + 1) * 2 * sizeof(uint64_t);
+    records = sizeof(*header) + slot_bytes;
+
+    crc = rebar_hash_crc32c(&snapshot->base[records], snapshot->size - records, 0);
+    crc = rebar_hash_crc32c(snapshot->slots, slot_bytes, crc);
+
+    return (crc == header->crc) ? true : false;
+}
+
+
+/* See cvs-snapshot.h for details. */
+void cvs_snapshot_close(cvs_snapshot_t *snapshot)
+{
+    if ((snapshot) && (snapshot->base)) {
+        munmap((void*) snapshot->base, snapshot->size);
+        memset(snapshot, 0, sizeof(cvs_snapshot_t));
+    }
+}
+
+
+/* See cvs-snapshot.h for details. */
+const void *cvs_snapshot_get(cvs_snapshot_t *snapshot, void *key, size_t *length)
+{
+    const cvs_snapshot_record_t *r;
+
+    r = __find(snapshot, key);
+    if (NULL == r) {
+        return NULL;
+    }
+
+    if (length) {
+        *length = r->value_length;
+    }
+
+    return (const uint8_t*) r + ALIGN8(sizeof(*r) + r->key_length);
+}
+
+
+/* See cvs-snapshot.h for details. */
+bool cvs_snapshot_contains_key(cvs_snapshot_t *snapshot, void *key)
+{
+    return (NULL != __find(snapshot, key)) ? true : false;
+}
+
+
+/* See cvs-snapshot.h for details. */
+size_t cvs_snapshot_get_size(cvs_snapshot_t *snapshot)
+{
+    size_t rv;
+
+    rv = 0;
+    if (snapshot) {
+        rv = snapshot->count;
+    }
+
+    return rv;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                             Internal functions                             */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Appends one key-value pair to the snapshot and places it in the table.
+ */
+static bool __write_record(void *key, void *value, void *user_data)
+{
+    cvs_snapshot_writer_t *w = (cvs_snapshot_writer_t*) user_data;
+    cvs_snapshot_record_t r;
+    const void *kdata, *vdata;
+    size_t klen, vlen;
+    uint64_t hash, i;
+
+    kdata = rebar_key_bytes(w->hashmap->type, w->hashmap->key_length, key, &klen);
+    if (w->serializer) {
+        if (false == (w->serializer)(key, value, &vdata, &vlen, w->user_data)) {
+            w->failed = true;
+            return false;
+        }
+    } else {
+        vdata = value;
+        vlen = (value) ? strlen((const char*) value) + 1 : 0;
+    }
+
+    if ((UINT32_MAX < klen) || (UINT32_MAX < vlen)) {
+        w->failed = true;
+        return false;
+    }
+
+    hash = rebar_hash_bytes(kdata, klen, w->seed);
+    for (i = hash & w->slot_mask; 0 != w->slots[i * 2 + 1]; i = (i + 1) & w->slot_mask) {
+        ;
+    }
+    w->slots[i * 2] = hash;
+    w->slots[i * 2 + 1] = w->offset;
+
+    r.key_length = (uint32_t) klen;
+    r.value_length = (uint32_t) vlen;
+    if ((false == __write(w, &r, sizeof(r))) ||
+        (false == __write(w, kdata, klen)) ||
+        (false == __write(w, __zeros, ALIGN8(sizeof(r) + klen) - (sizeof(r) + klen))) ||
+        (false == __write(w, vdata, vlen)) ||
+        (false == __write(w, __zeros, ALIGN8(vlen) - vlen))) {
+        w->failed = true;
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ *  Writes record bytes, keeping the offset and checksum up to date.
+ */
+static bool __write(cvs_snapshot_writer_t *w, const void *data, size_t length)
+{
+    if (0 == length) {
+        return true;
+    }
+
+    if (1 != fwrite(data, length, 1, w->f)) {
+        return false;
+    }
+    w->crc = rebar_hash_crc32c(data, length, w->crc);
+    w->offset += length;
+
+    return true;
+}
+
+
+/**
+ *  Finds the record of the key.  Offsets and lengths read from the file are
+ *  bounds checked so a damaged file cannot cause a read outside the mapping.
+ *
+ *  @param snapshot the snapshot to search
+ *  @param key the key to search for
+ *
+ *  @return the record, or NULL
+ */
+static const cvs_snapshot_record_t *__find(cvs_snapshot_t *snapshot, void *key)
+{
+    const void *kdata;
+    size_t klen, i, probes;
+    uint64_t hash;
+
+    if ((NULL == snapshot) || (NULL == snapshot->base) || (NULL == key)) {
+        return NULL;
+    }
+
+    kdata = rebar_key_bytes(snapshot->type, snapshot->key_length, key, &klen);
+    hash = rebar_hash_bytes(kdata, klen, snapshot->seed);
+
+    i = (size_t) hash & snapshot->slot_mask;
+    for (probes = 0; probes <= snapshot->slot_mask; probes++) {
+        uint64_t offset = snapshot->slots[i * 2 + 1];
+
+        if (0 == offset) {
+            break;
+        }
+
+        if ((hash == snapshot->slots[i * 2]) && (0 == (offset & 7)) &&
+            (offset <= snapshot->size - sizeof(cvs_snapshot_record_t))) {
+            const cvs_snapshot_record_t *r;
+
+            r = (const cvs_snapshot_record_t*) &snapshot->base[offset];
+            if ((klen == r->key_length) &&
+                (ALIGN8(sizeof(*r) + klen) + r->value_length <= snapshot->size - offset) &&
+                (0 == memcmp(&r[1], kdata, klen))) {
+                return r;
+            }
+        }
+
+        i = (i + 1) & snapshot->slot_mask;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,173 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __CVS_SNAPSHOT_H__
+#define __CVS_SNAPSHOT_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cvs-hashmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * cvs-snapshot.h writes a cvs_hashmap to a file that can later be mapped
+ * read only and searched in place.
+ *
+ * The file is a header, an open addressing table of (hash, offset) slots and
+ * the key and value records, all located by offsets from the start of the
+ * file.  Opening a snapshot checks the header and maps the file, nothing is
+ * allocated or parsed per entry, and every process mapping the same file
+ * shares its pages.  Values are 8 byte aligned so they can be cast to
+ * structures of that alignment or less.
+ *
+ * The file uses the byte order and type sizes of the machine that wrote it,
+ * cvs_snapshot_open() refuses a file written with a different byte order.
+ * The file is created readable by its owner only, change its mode if
+ * processes of other users need to map it.
+ */
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Serializes one value of the hashmap being saved.
+ *
+ *  @param key the key of the pair, as passed to a cvs_hashmap_iterator_fn_t
+ *  @param value the value of the pair
+ *  @param data where to store a pointer to the serialized value, which must
+ *         stay valid until the next call
+ *  @param length where to store the length of the serialized value
+ *  @param user_data the user data passed to cvs_snapshot_save()
+ *
+ *  @return true to continue, false to fail the save
+ */
+typedef bool (*cvs_snapshot_value_fn_t)(void *key, void *value,
+                                        const void **data, size_t *length,
+                                        void *user_data);
+
+/* Do not directly access any of the values in the structure. */
+typedef struct {
+    const uint8_t *base;        /* the mapped file, NULL when closed */
+    size_t size;
+    cvs_hashmap_type_t type;
+    size_t key_length;          /* CHT__BYTES only */
+    uint64_t seed;
+    size_t count;
+    size_t slot_mask;
+    const uint64_t *slots;      /* pairs of hash, record offset */
+} cvs_snapshot_t;
+
+/*----------------------------------------------------------------------------*/
+/*                                 Functions                                  */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Writes the key-value pairs of a hashmap to a snapshot file.  The file is
+ *  written under a temporary name and renamed into place, so a reader never
+ *  sees a partial snapshot.
+ *
+ *  @note No hash manipulation is permitted during this call.
+ *
+ *  @param hashmap the hashmap to save
+ *  @param path the snapshot file to create or replace
+ *  @param serializer the function serializing each value, or NULL if the
+ *         values are NUL terminated strings (stored with the NUL)
+ *  @param user_data additional user data passed through to the serializer
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_snapshot_save(cvs_hashmap_t *hashmap, const char *path,
+                       cvs_snapshot_value_fn_t serializer, void *user_data);
+
+
+/**
+ *  Maps a snapshot file read only.
+ *
+ *  @param snapshot the snapshot to open
+ *  @param path the snapshot file
+ *
+ *  @return true if successful, false if the file is missing, truncated or
+ *          not a snapshot
+ */
+bool cvs_snapshot_open(cvs_snapshot_t *snapshot, const char *path);
+
+
+/**
+ *  Checks the checksum of everything after the header.  This reads the whole
+ *  file, so it is separate from cvs_snapshot_open().
+ *
+ *  @param snapshot the snapshot to check
+ *
+ *  @return true if the file is intact, false otherwise
+ */
+bool cvs_snapshot_verify(cvs_snapshot_t *snapshot);
+
+
+/**
+ *  Unmaps the snapshot.  Pointers returned by cvs_snapshot_get() become
+ *  invalid.
+ *
+ *  @param snapshot the snapshot to close
+ */
+void cvs_snapshot_close(cvs_snapshot_t *snapshot);
+
+
+/**
+ *  Returns the serialized value to which the specified key is mapped, or NULL
+ *  if this snapshot contains no mapping for the key.
+ *
+ *  @param snapshot the snapshot to search
+ *  @param key the pointer to the key, of the type of the saved hashmap
+ *  @param length if not NULL, where the length of the value is stored
+ *
+ *  @return the value inside the mapped file, or NULL if this snapshot
+ *          contains no mapping for the key (or any other error occurs)
+ */
+const void *cvs_snapshot_get(cvs_snapshot_t *snapshot, void *key, size_t *length);
+
+
+/**
+ *  Returns true if this snapshot contains a mapping for the specified key.
+ *
+ *  @param snapshot the snapshot to search
+ *  @param key the pointer to the key whose presence is to be tested
+ *
+ *  @return true if this snapshot contains a mapping for the specified key, or
+ *          false otherwise
+ */
+bool cvs_snapshot_contains_key(cvs_snapshot_t *snapshot, void *key);
+
+
+/**
+ *  Returns the number of key-value mappings in this snapshot.
+ *
+ *  @param snapshot the snapshot to inspect
+ *
+ *  @return the number of key-value mappings in the snapshot, or 0 on error
+ */
+size_t cvs_snapshot_get_size(cvs_snapshot_t *snapshot);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,549 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "cvs-ttlmap.h"
+#include "rebar-key.h"
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+#define SLOT_MASK       (CVSTTL_SLOTS - 1)
+#define BITMAP_WORDS    (CVSTTL_SLOTS / 64)
+
+/* The furthest deadline the wheel can hold, later ones wait at the top. */
+#define HORIZON         (1ULL << (CVSTTL_SLOT_BITS * CVSTTL_LEVELS))
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+/* An entry and its copy of the key, which the hashmap indexes. */
+struct __cvs_ttlmap_entry {
+    struct __cvs_ttlmap_entry *next;
+    struct __cvs_ttlmap_entry **pprev;  /* the pointer pointing at this entry */
+    uint64_t deadline;
+    uint16_t level;
+    uint16_t slot;
+    void *value;
+    rebar_key_t key;
+    uint8_t data[];                     /* string, bytes and blob keys */
+};
+
+typedef struct __cvs_ttlmap_entry cvs_ttlmap_entry_t;
+
+struct __cvs_ttlmap_wheel {
+    cvs_ttlmap_entry_t *slots[CVSTTL_LEVELS][CVSTTL_SLOTS];
+    uint64_t occupied[CVSTTL_LEVELS][BITMAP_WORDS];     /* non-empty slots */
+};
+
+/*----------------------------------------------------------------------------*/
+/*                            File Scoped Variables                           */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                             Function Prototypes                            */
+/*----------------------------------------------------------------------------*/
+static cvs_ttlmap_entry_t *__new_entry(cvs_ttlmap_t *ttlmap, void *key);
+static uint64_t __deadline(cvs_ttlmap_t *ttlmap, uint64_t ttl);
+static void __schedule(cvs_ttlmap_t *ttlmap, cvs_ttlmap_entry_t *e);
+static void __unschedule(cvs_ttlmap_t *ttlmap, cvs_ttlmap_entry_t *e);
+static cvs_ttlmap_entry_t *__take_slot(cvs_ttlmap_t *ttlmap, unsigned level,
+                                       unsigned slot);
+static unsigned __next_slot(const uint64_t *occupied, unsigned slot);
+static uint64_t __next_event(cvs_ttlmap_t *ttlmap);
+static void __cascade(cvs_ttlmap_t *ttlmap, uint64_t tick);
+static size_t __expire(cvs_ttlmap_t *ttlmap, uint64_t tick);
+static bool __init(cvs_ttlmap_t *ttlmap, uint64_t now,
+                   cvs_ttlmap_expire_fn_t expire, void *user_data);
+
+/*----------------------------------------------------------------------------*/
+/*                             External Functions                             */
+/*----------------------------------------------------------------------------*/
+/* See cvs-ttlmap.h for details. */
+bool cvs_ttlmap_init(cvs_ttlmap_t *ttlmap, cvs_hashmap_type_t type, uint64_t now,
+                     cvs_ttlmap_expire_fn_t expire, void *user_data)
+{
+    if ((NULL == ttlmap) || (CHT__BYTES == type)) {
+        return false;
+    }
+
+    memset(ttlmap, 0, sizeof(cvs_ttlmap_t));
+    if (!cvs_hashmap_init(&ttlmap->map, type)) {
+        return false;
+    }
+    ttlmap->type = type;
+
+    return __init(ttlmap, now, expire, user_data);
+}
+
+
+/* See cvs-ttlmap.h for details. */
+bool cvs_ttlmap_init_bytes(cvs_ttlmap_t *ttlmap, size_t key_length, uint64_t now,
+                           cvs_ttlmap_expire_fn_t expire, void *user_data)
+{
+    if (NULL == ttlmap) {
+        return false;
+    }
+
+    memset(ttlmap, 0, sizeof(cvs_ttlmap_t));
+    if (!cvs_hashmap_init_bytes(&ttlmap->map, key_length, CHF__NONE)) {
+        return false;
+    }
+    ttlmap->type = CHT__BYTES;
+    ttlmap->key_length = key_length;
+
+    return __init(ttlmap, now, expire, user_data);
+}
+
+
+/* See cvs-ttlmap.h for details. */
+void cvs_ttlmap_destroy(cvs_ttlmap_t *ttlmap)
+{
+    unsigned level, slot;
+
+    if ((NULL == ttlmap) || (NULL == ttlmap->wheel)) {
+        return;
+    }
+
+    for (level = 0; level < CVSTTL_LEVELS; level++) {
+        for (slot = 0; slot < CVSTTL_SLOTS; slot++) {
+            cvs_ttlmap_entry_t *e, *next;
+
+            for (e = ttlmap->wheel->slots[level][slot]; NULL != e; e = next) {
+                next = e->next;
+                free(e);
+            }
+        }
+    }
+
+    free(ttlmap->wheel);
+    ttlmap->wheel = NULL;
+    cvs_hashmap_destroy(&ttlmap->map);
+}
+
+
+/* See cvs-ttlmap.h for details. */
+void *cvs_ttlmap_get(cvs_ttlmap_t *ttlmap, void *key)
+{
+    cvs_ttlmap_entry_t *e;
+
+    if ((NULL == ttlmap) || (NULL == ttlmap->wheel) || (NULL == key)) {
+        return NULL;
+    }
+
+    e = (cvs_ttlmap_entry_t*) cvs_hashmap_get(&ttlmap->map, key);
+
+    return (e) ? e->value : NULL;
+}
+
+
+/* See cvs-ttlmap.h for details. */
+void *cvs_ttlmap_put(cvs_ttlmap_t *ttlmap, void *key, void *value, uint64_t ttl)
+{
+    cvs_ttlmap_entry_t *e;
+    void *rv;
+
+    if ((NULL == ttlmap) || (NULL == ttlmap->wheel) || (NULL == key)) {
+        return NULL;
+    }
+
+    e = (cvs_ttlmap_entry_t*) cvs_hashmap_get(&ttlmap->map, key);
+    if (e) {
+        rv = e->value;
+        e->value = value;
+        __unschedule(ttlmap, e);
+        e->deadline = __deadline(ttlmap, ttl);
+        __schedule(ttlmap, e);
+        return rv;
+    }
+
+    e = __new_entry(ttlmap, key);
+    e->value = value;
+    e->deadline = __deadline(ttlmap, ttl);
+    cvs_hashmap_put(&ttlmap->map, rebar_key_get(&e->key, e->data, ttlmap->type), e);
+    __schedule(ttlmap, e);
+
+    return NULL;
+}
+
+
+/* See cvs-ttlmap.h for details. */
+bool cvs_ttlmap_refresh(cvs_ttlmap_t *ttlmap, void *key, uint64_t ttl)
+{
+    cvs_ttlmap_entry_t *e;
+
+    if ((NULL == ttlmap) || (NULL == ttlmap->wheel) || (NULL == key)) {
+        return false;
+    }
+
+    e = (cvs_ttlmap_entry_t*) cvs_hashmap_get(&ttlmap->map, key);
+    if (NULL == e) {
+        return false;
+    }
+
+    __unschedule(ttlmap, e);
+    e->deadline = __deadline(ttlmap, ttl);
+    __schedule(ttlmap, e);
+
+    return true;
+}
+
+
+/* See cvs-ttlmap.h for details. */
+void *cvs_ttlmap_remove(cvs_ttlmap_t *ttlmap, void *key)
+{
+    cvs_ttlmap_entry_t *e;
+    void *rv;
+
+    if ((NULL == ttlmap) || (NULL == ttlmap->wheel) || (NULL == key)) {
+        return NULL;
+    }
+
+    e = (cvs_ttlmap_entry_t*) cvs_hashmap_remove(&ttlmap->map, key);
+    if (NULL == e) {
+        return NULL;
+    }
+
+    __unschedule(ttlmap, e);
+    rv = e->value;
+    free(e);
+
+    return rv;
+}
+
+
+/* See cvs-ttlmap.h for details. */
+size_t cvs_ttlmap_advance(cvs_ttlmap_t *ttlmap, uint64_t now)
+{
+    size_t rv;
+
+    if ((NULL == ttlmap) || (NULL == ttlmap->wheel)) {
+        return 0;
+    }
+
+    rv = 0;
+    while (ttlmap->now < now) {
+        uint64_t tick;
+
+        /* Nothing happens on the ticks in between, so skip them. */
+        tick = __next_event(ttlmap);
+        if (now < tick) {
+            ttlmap->now = now;
+            break;
+        }
+
+        ttlmap->now = tick;
+        __cascade(ttlmap, tick);
+        rv += __expire(ttlmap, tick);
+    }
+
+    return rv;
+}
+
+
+/* See cvs-ttlmap.h for details. */
+size_t cvs_ttlmap_get_size(cvs_ttlmap_t *ttlmap)
+{
+    if (NULL == ttlmap) {
+        return 0;
+    }
+
+    return cvs_hashmap_get_size(&ttlmap->map);
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                             Internal functions                             */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Allocates an entry holding a copy of a key.
+ *
+ *  @param ttlmap the map the entry is for
+ *  @param key the caller's key
+ *
+ *  @return the entry, not yet scheduled or indexed
+ */
+static cvs_ttlmap_entry_t *__new_entry(cvs_ttlmap_t *ttlmap, void *key)
+{
+    cvs_ttlmap_entry_t *e;
+    size_t length;
+
+    length = rebar_key_size(ttlmap->type, ttlmap->key_length, key);
+
+    e = (cvs_ttlmap_entry_t*) malloc(sizeof(cvs_ttlmap_entry_t) + length);
+    assert(e);
+    memset(e, 0, sizeof(cvs_ttlmap_entry_t));
+    rebar_key_copy(&e->key, e->data, ttlmap->type, ttlmap->key_length, key);
+
+    return e;
+}
+
+
+/**
+ *  Returns the tick ttl ticks from now, at least the next one and at most the
+ *  last one there is.
+ */
+static uint64_t __deadline(cvs_ttlmap_t *ttlmap, uint64_t ttl)
+{
+    if (0 == ttl) {
+        ttl = 1;
+    }
+
+    if (UINT64_MAX - ttlmap->now < ttl) {
+        return UINT64_MAX;
+    }
+
+    return ttlmap->now + ttl;
+}
+
+
+/**
+ *  Links an entry into the wheel slot for its deadline: the finest level
+ *  whose turn still reaches the deadline, so that the slot is not passed
+ *  before the entry is due.
+ *
+ *  @param ttlmap the map the entry belongs to
+ *  @param e the entry, its deadline not before the current tick
+ */
+static void __schedule(cvs_ttlmap_t *ttlmap, cvs_ttlmap_entry_t *e)
+{
+    cvs_ttlmap_entry_t **head;
+    uint64_t delta, at;
+    unsigned level, slot;
+
+    delta = e->deadline - ttlmap->now;
+    at = e->deadline;
+    if (HORIZON <= delta) {
+        at = ttlmap->now + HORIZON - 1;
+    }
+
+    level = 0;
+    while ((level < CVSTTL_LEVELS - 1) &&
+           ((1ULL << (CVSTTL_SLOT_BITS * (level + 1))) <= delta))
+    {
+        level++;
+    }
+    slot = (unsigned) (at >> (CVSTTL_SLOT_BITS * level)) & SLOT_MASK;
+
+    head = &ttlmap->wheel->slots[level][slot];
+    e->level = (uint16_t) level;
+    e->slot = (uint16_t) slot;
+    e->next = *head;
+    e->pprev = head;
+    if (*head) {
+        (*head)->pprev = &e->next;
+    }
+    *head = e;
+
+    ttlmap->wheel->occupied[level][slot / 64] |= 1ULL << (slot % 64);
+}
+
+
+/**
+ *  Takes an entry out of its wheel slot.
+ */
+static void __unschedule(cvs_ttlmap_t *ttlmap, cvs_ttlmap_entry_t *e)
+{
+    *e->pprev = e->next;
+    if (e->next) {
+        e->next->pprev = e->pprev;
+    }
+
+    if (NULL == ttlmap->wheel->slots[e->level][e->slot]) {
+        ttlmap->wheel->occupied[e->level][e->slot / 64] &= ~(1ULL << (e->slot % 64));
+    }
+
+    e->next = NULL;
+    e->pprev = NULL;
+}
+
+
+/**
+ *  Empties a wheel slot.
+ *
+ *  @return the entries that were in the slot, linked by next
+ */
+static cvs_ttlmap_entry_t *__take_slot(cvs_ttlmap_t *ttlmap, unsigned level,
+                                       unsigned slot)
+{
+    cvs_ttlmap_entry_t *rv;
+
+    rv = ttlmap->wheel->slots[level][slot];
+    ttlmap->wheel->slots[level][slot] = NULL;
+    ttlmap->wheel->occupied[level][slot / 64] &= ~(1ULL << (slot % 64));
+
+    return rv;
+}
+
+
+/**
+ *  Finds the first non-empty slot of a level at or after a slot, going round
+ *  the wheel once.
+ *
+ *  @param occupied the bitmap of the level
+ *  @param slot the slot to start at
+ *
+ *  @return the number of slots from slot to the non-empty one, or
+ *          CVSTTL_SLOTS if the level is empty
+ */
+static unsigned __next_slot(const uint64_t *occupied, unsigned slot)
+{
+    uint64_t word;
+    unsigned w, i;
+
+    w = slot / 64;
+    word = occupied[w] & (~0ULL << (slot % 64));
+    for (i = 0; i <= BITMAP_WORDS; i++) {
+        if (0 != word) {
+            return ((w * 64 + (unsigned) __builtin_ctzll(word)) - slot) & SLOT_MASK;
+        }
+        w = (w + 1) % BITMAP_WORDS;
+        word = occupied[w];
+    }
+
+    return CVSTTL_SLOTS;
+}
+
+
+/**
+ *  Returns the first tick after the current one at which a non-empty slot
+ *  comes round: a slot of level 0 expires on its tick, a slot of a higher
+ *  level is cascaded on the first tick of its span.
+ *
+ *  @param ttlmap the map to look in
+ *
+ *  @return the tick, or UINT64_MAX if the wheel is empty
+ */
+static uint64_t __next_event(cvs_ttlmap_t *ttlmap)
+{
+    uint64_t rv, tick;
+    unsigned level;
+
+    rv = UINT64_MAX;
+    tick = ttlmap->now + 1;
+    for (level = 0; level < CVSTTL_LEVELS; level++) {
+        unsigned shift, dist;
+        uint64_t mask, start, at;
+
+        /* The first tick at or after tick on which this level turns. */
+        shift = CVSTTL_SLOT_BITS * level;
+        mask = (1ULL << shift) - 1;
+        start = (tick + mask) & ~mask;
+        if (start < tick) {
+            continue;
+        }
+
+        dist = __next_slot(ttlmap->wheel->occupied[level],
+                           (unsigned) (start >> shift) & SLOT_MASK);
+        if (CVSTTL_SLOTS == dist) {
+            continue;
+        }
+
+        at = start + ((uint64_t) dist << shift);
+        if ((start <= at) && (at < rv)) {
+            rv = at;
+        }
+    }
+
+    return rv;
+}
+
+
+/**
+ *  Moves the entries of the higher level slots that start at tick down to
+ *  finer levels, the way the Linux kernel timer wheel did.
+ *
+ *  @param ttlmap the map to cascade
+ *  @param tick the current tick
+ */
+static void __cascade(cvs_ttlmap_t *ttlmap, uint64_t tick)
+{
+    unsigned level;
+
+    for (level = 1; level < CVSTTL_LEVELS; level++) {
+        cvs_ttlmap_entry_t *e, *next;
+        unsigned shift;
+
+        shift = CVSTTL_SLOT_BITS * level;
+        if (0 != (tick & ((1ULL << shift) - 1))) {
+            break;
+        }
+
+        e = __take_slot(ttlmap, level, (unsigned) (tick >> shift) & SLOT_MASK);
+        for (; NULL != e; e = next) {
+            next = e->next;
+            __schedule(ttlmap, e);
+        }
+    }
+}
+
+
+/**
+ *  Expires the entries due at tick, all of which are in its level 0 slot.
+ *
+ *  @param ttlmap the map to expire from
+ *  @param tick the current tick
+ *
+ *  @return the number of entries expired
+ */
+static size_t __expire(cvs_ttlmap_t *ttlmap, uint64_t tick)
+{
+    cvs_ttlmap_entry_t *e, *next;
+    size_t rv;
+
+    rv = 0;
+    e = __take_slot(ttlmap, 0, (unsigned) tick & SLOT_MASK);
+    for (; NULL != e; e = next) {
+        void *key;
+
+        next = e->next;
+        key = rebar_key_get(&e->key, e->data, ttlmap->type);
+        cvs_hashmap_remove(&ttlmap->map, key);
+        if (ttlmap->expire) {
+            (ttlmap->expire)(key, e->value, ttlmap->user_data);
+        }
+        free(e);
+        rv++;
+    }
+
+    return rv;
+}
+
+
+/**
+ *  The common part of the initializers, once the hashmap is set up.
+ */
+static bool __init(cvs_ttlmap_t *ttlmap, uint64_t now,
+                   cvs_ttlmap_expire_fn_t expire, void *user_data)
+{
+    ttlmap->wheel = (struct __cvs_ttlmap_wheel*) calloc(1, sizeof(struct __cvs_ttlmap_wheel));
+    if (NULL == ttlmap->wheel) {
+        cvs_hashmap_destroy(&ttlmap->map);
+        return false;
+    }
+
+    ttlmap->now = now;
+    ttlmap->expire = expire;
+    ttlmap->user_data = user_data;
+
+    return true;
+}
@@ -0,0 +1,213 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __CVS_TTLMAP_H__
+#define __CVS_TTLMAP_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cvs-hashmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * cvs-ttlmap.h implements a map whose entries expire a given number of ticks
+ * after they were put or last refreshed.  The tick is whatever unit the
+ * caller passes to cvs_ttlmap_advance(): milliseconds, seconds, ...
+ *
+ * A cvs_hashmap finds the entry of a key, and a hierarchical timing wheel
+ * orders the entries by deadline: CVSTTL_LEVELS wheels of CVSTTL_SLOTS slots,
+ * each slot of a level spanning a whole turn of the level below.  An entry
+ * goes into the slot of the finest level that can hold its deadline, and is
+ * moved down a level each time the wheel turns past its slot, until it sits
+ * in a slot of single ticks.  Deadlines more than 2^32 ticks away wait in the
+ * top level and are placed again when their slot comes round.
+ *
+ * Putting, refreshing and removing an entry are O(1).  Each level keeps a
+ * bitmap of its non-empty slots, so advancing jumps straight to the next
+ * tick that has work; the cost of an advance depends on the entries that
+ * expire (and are moved down), not on how many the map holds or how many
+ * ticks passed.
+ *
+ * Each entry keeps its own copy of its key, so the caller's key only has to
+ * be valid during the call.
+ */
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+#define CVSTTL_SLOT_BITS    8
+#define CVSTTL_SLOTS        (1 << CVSTTL_SLOT_BITS)
+#define CVSTTL_LEVELS       4
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Called by cvs_ttlmap_advance() for each entry that expires.  The entry has
+ *  already been removed from the map.
+ *
+ *  @note No map manipulation is permitted during this call.
+ *
+ *  @param key the pointer to the entry's key (for CHT__BLOB maps a
+ *             cvs_hashmap_blob_t), only valid during the call
+ *  @param value the value of the entry
+ */
+typedef void (*cvs_ttlmap_expire_fn_t)(void *key, void *value, void *user_data);
+
+
+struct __cvs_ttlmap_wheel;
+
+/* Do not directly access any of the values in the structure. */
+typedef struct {
+    cvs_hashmap_t map;              /* key -> entry */
+    cvs_hashmap_type_t type;
+    size_t key_length;              /* CHT__BYTES only */
+    uint64_t now;                   /* the last tick advanced to */
+    cvs_ttlmap_expire_fn_t expire;
+    void *user_data;
+    struct __cvs_ttlmap_wheel *wheel;
+} cvs_ttlmap_t;
+
+/*----------------------------------------------------------------------------*/
+/*                                 Functions                                  */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Initializes the map.
+ *
+ *  @param ttlmap the map to initialize
+ *  @param type the type of the keys, anything but CHT__BYTES
+ *  @param now the current tick
+ *  @param expire the function called for each expired entry, may be NULL
+ *  @param user_data additional user data passed through to the expire function
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_ttlmap_init(cvs_ttlmap_t *ttlmap, cvs_hashmap_type_t type, uint64_t now,
+                     cvs_ttlmap_expire_fn_t expire, void *user_data);
+
+
+/**
+ *  Initializes a map with CHT__BYTES keys of key_length bytes each.
+ *
+ *  @param ttlmap the map to initialize
+ *  @param key_length the number of bytes in every key, must not be 0
+ *  @param now the current tick
+ *  @param expire the function called for each expired entry, may be NULL
+ *  @param user_data additional user data passed through to the expire function
+ *
+ *  @return true if successful, false otherwise
+ */
+bool cvs_ttlmap_init_bytes(cvs_ttlmap_t *ttlmap, size_t key_length, uint64_t now,
+                           cvs_ttlmap_expire_fn_t expire, void *user_data);
+
+
+/**
+ *  Destroys the structure.
+ *
+ *  @note This does not destroy the values of the map, and does not call the
+ *        expire function for them.
+ *
+ *  @param ttlmap the map to destroy
+ */
+void cvs_ttlmap_destroy(cvs_ttlmap_t *ttlmap);
+
+
+/**
+ *  Returns the value to which the specified key is mapped, or NULL if this map
+ *  contains no mapping for the key.  This does not refresh the entry.
+ *
+ *  @param ttlmap the map to search
+ *  @param key the pointer to the key whose associated value is to be returned
+ *
+ *  @return the value to which the specified key is mapped, or NULL if this map
+ *          contains no mapping for the key (or any other error occurs)
+ */
+void *cvs_ttlmap_get(cvs_ttlmap_t *ttlmap, void *key);
+
+
+/**
+ *  Associates the value with the key, to expire ttl ticks after the current
+ *  tick.  An existing entry gets the new value and the new ttl.
+ *
+ *  @param ttlmap the map to change
+ *  @param key pointer to the key with which the specified value is to be associated
+ *  @param value value to be associated with the specified key
+ *  @param ttl the ticks until the entry expires, 0 is taken as 1
+ *
+ *  @return the value the key had before, or NULL if it was not in the map
+ *          (or any other error occurs)
+ */
+void *cvs_ttlmap_put(cvs_ttlmap_t *ttlmap, void *key, void *value, uint64_t ttl);
+
+
+/**
+ *  Moves the deadline of an entry to ttl ticks after the current tick.
+ *
+ *  @param ttlmap the map to change
+ *  @param key the pointer to the key whose entry is to be refreshed
+ *  @param ttl the ticks until the entry expires, 0 is taken as 1
+ *
+ *  @return true if the key was found, false otherwise
+ */
+bool cvs_ttlmap_refresh(cvs_ttlmap_t *ttlmap, void *key, uint64_t ttl);
+
+
+/**
+ *  Removes the entry of a key, without calling the expire function.
+ *
+ *  @param ttlmap the map to change
+ *  @param key the pointer to the key whose entry is to be removed
+ *
+ *  @return the value of the removed entry, or NULL if there was no entry for
+ *          key (or any other error occurs)
+ */
+void *cvs_ttlmap_remove(cvs_ttlmap_t *ttlmap, void *key);
+
+
+/**
+ *  Moves the map's clock forward and expires every entry whose deadline is at
+ *  or before the new tick, calling the expire function for each.  A tick at
+ *  or before the current one does nothing.
+ *
+ *  @param ttlmap the map to advance
+ *  @param now the new current tick
+ *
+ *  @return the number of entries expired
+ */
+size_t cvs_ttlmap_advance(cvs_ttlmap_t *ttlmap, uint64_t now);
+
+
+/**
+ *  Returns the number of entries in the map.
+ *
+ *  @param ttlmap the map to inspect
+ *
+ *  @return the number of entries, or 0 on error
+ */
+size_t cvs_ttlmap_get_size(cvs_ttlmap_t *ttlmap);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
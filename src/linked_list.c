@@ -282,6 +282,183 @@ void rebar_ll_iterate_from(rebar_ll_node_t *from_node,
     }
 }
 
+void rebar_dll_append( rebar_dll_list_t *list, rebar_dll_node_t *node )
+{
+    if( NULL != node ) {
+        node->prev = list->tail;
+        node->next = NULL;
+
+        if( NULL != list->tail ) {
+            list->tail->next = node;
+        } else {
+            /* No list items are present. */
+            list->head = node;
+        }
+        list->tail = node;
+    }
+}
+
+void rebar_dll_prepend( rebar_dll_list_t *list, rebar_dll_node_t *node )
+{
+    if( NULL != node ) {
+        node->prev = NULL;
+        node->next = list->head;
+
+        if( NULL != list->head ) {
+            list->head->prev = node;
+        } else {
+            /* No list items are present. */
+            list->tail = node;
+        }
+        list->head = node;
+    }
+}
+
+void rebar_dll_insert( rebar_dll_list_t *list, rebar_dll_node_t *new_node,
+                      rebar_dll_node_t *insert_near_node,
+                      const rebar_ll_insert_mode_t mode )
+{
+    if( (NULL == new_node) || (NULL == insert_near_node) ) {
+        return;
+    }
+
+    if( REBAR_MODE__BEFORE == mode ) {
+        new_node->prev = insert_near_node->prev;
+        new_node->next = insert_near_node;
+    } else {
+        new_node->prev = insert_near_node;
+        new_node->next = insert_near_node->next;
+    }
+
+    /* Hook up the neighbours, or the ends of the list. */
+    if( NULL != new_node->prev ) {
+        new_node->prev->next = new_node;
+    } else {
+        list->head = new_node;
+    }
+
+    if( NULL != new_node->next ) {
+        new_node->next->prev = new_node;
+    } else {
+        list->tail = new_node;
+    }
+}
+
+void rebar_dll_remove( rebar_dll_list_t *list, rebar_dll_node_t *node )
+{
+    if( NULL == node ) {
+        return;
+    }
+
+    if( NULL != node->prev ) {
+        node->prev->next = node->next;
+    } else {
+        /* We removed from the head of the list. */
+        list->head = node->next;
+    }
+
+    if( NULL != node->next ) {
+        node->next->prev = node->prev;
+    } else {
+        /* This node is at the end of the list. */
+        list->tail = node->prev;
+    }
+
+    node->prev = NULL;
+    node->next = NULL;
+}
+
+rebar_dll_node_t *rebar_dll_pop_head( rebar_dll_list_t *list )
+{
+    rebar_dll_node_t *node = list->head;
+
+    rebar_dll_remove( list, node );
+
+    return node;
+}
+
+rebar_dll_node_t *rebar_dll_pop_tail( rebar_dll_list_t *list )
+{
+    rebar_dll_node_t *node = list->tail;
+
+    rebar_dll_remove( list, node );
+
+    return node;
+}
+
+void rebar_dll_iterate( rebar_dll_list_t *list,
+                       rebar_dll_iterator_fn_t iterator,
+                       rebar_dll_delete_node_fn_t deleter,
+                       void *user_data )
+{
+    rebar_dll_node_t *node, *next;
+
+    node = rebar_dll_get_first( list );
+
+    while( NULL != node ) {
+        rebar_ll_iterator_response_t response;
+
+        next = node->next;
+
+        response = REBAR_IR__DELETE_AND_CONTINUE;
+
+        if( NULL != iterator ) {
+            response = (*iterator)( node, user_data );
+        }
+
+        /* Do we want to delete the node? */
+        if( (REBAR_IR__DELETE_AND_CONTINUE == response) ||
+            (REBAR_IR__DELETE_AND_STOP == response) )
+        {
+            rebar_dll_remove( list, node );
+
+            if( NULL != deleter ) {
+                (*deleter)( node, user_data );
+            }
+
+            if( REBAR_IR__DELETE_AND_STOP == response ) {
+                return;
+            }
+        } else if( REBAR_IR__STOP == response ) {
+            return;
+        }
+
+        node = next;
+    }
+}
+
+size_t rebar_dll_count( rebar_dll_list_t *list )
+{
+    size_t count;
+    rebar_dll_node_t *node;
+
+    count = 0;
+
+    node = rebar_dll_get_first( list );
+    while( NULL != node ) {
+        count++;
+        node = node->next;
+    }
+
+    return count;
+}
+
+rebar_dll_node_t *__rebar_dll_find( rebar_dll_list_t *list,
+                                  rebar_ll_cmp_node_fn_t cmp_fn,
+                                  void *needle,
+                                  int offset )
+{
+    rebar_dll_node_t *node;
+
+    for( node = list->head; NULL != node; node = node->next ) {
+        if( 0 == (*cmp_fn)(needle, ((void*)((char *)node - offset))) ) {
+            return node;
+        }
+    }
+
+    return NULL;
+}
+
 /*----------------------------------------------------------------------------*/
 /*                             Internal functions                             */
 /*----------------------------------------------------------------------------*/
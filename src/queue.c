@@ -41,12 +41,15 @@ bool syncronized; // optional ??
  * Allocates memory for the queue, queue must be deleted by
  * calling rebar_queue_delete(), all client data must have been 
  * freed by the user of this API, Queue will only free it's own structures.
- * Will assert in os if malloc() fails!
+ * Returns NULL if malloc() fails.
  */
 queue_t *rebar_queue_init (void)
 {
     queue_t *q = (queue_t *) malloc(sizeof(queue_t));
-    memset(q, 0, sizeof(queue_t));
+
+    if (NULL != q) {
+        memset(q, 0, sizeof(queue_t));
+    }
 
     return q;
 }
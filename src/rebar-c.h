@@ -43,8 +43,7 @@ extern "C" {
 
     /**
      *  Macro to obtain the pointer to your struct given a linked list node
-     *  (doesn't matter if it is a rebar_ll_node_t or rebar_ll_d_node_t (when
-     *  they exist).
+     *  (doesn't matter if it is a rebar_ll_node_t or rebar_dll_node_t).
      *
      *  struct myStruct {
      *      char          *junk1;
@@ -344,12 +343,260 @@ extern "C" {
     /*                             Doubly Linked List                             */
     /*----------------------------------------------------------------------------*/
 
-    /* Not currently implemented. */
+    /* Do not directly use this structure's internals.  Only use this library
+     * to modify the linked list. */
+    typedef struct __rebar_dll_node {
+        struct __rebar_dll_node *prev;
+        struct __rebar_dll_node *next;
+    } rebar_dll_node_t;
+
+    /* Do not directly use this structure's internals.  Only use this library
+     * to modify the linked list. */
+    typedef struct {
+        rebar_dll_node_t *head;
+        rebar_dll_node_t *tail;
+    } rebar_dll_list_t;
+
+    /**
+     *  Called during the list iterate operation for each node.
+     *
+     *  @note No list manipulation is permitted during this call.
+     *
+     *  @param node the current node in the iteration over the linked list
+     *  @param user_data the supplied user data to the iterator function
+     *
+     *  @retval REBAR_IR__CONTINUE do not alter the node & continue iterating
+     *  @retval REBAR_IR__DELETE_AND_CONTINUE delete the node & continue
+     *                                        iterating
+     *  @retval REBAR_IR__STOP do not alter the node but stop processing
+     *  @retval REBAR_IR__DELETE_AND_STOP delete the node & stop processing
+     */
+    typedef rebar_ll_iterator_response_t(*rebar_dll_iterator_fn_t) (rebar_dll_node_t *node,
+            void *user_data);
+
+    /**
+     *  Called during the list iterate operation when a node has been
+     *  marked for deletion, or during the list delete operation.
+     *
+     *  This is the chance the user has to free any memory associated
+     *  with this node (even the node itself).
+     *
+     *  @param node the node being deleted from the list
+     *  @param user_data the supplied user data to the iterator/delete function
+     */
+    typedef void (*rebar_dll_delete_node_fn_t) (rebar_dll_node_t *node,
+            void *user_data);
+
+    /**
+     *  Used to initialize a doubly linked list.
+     *
+     *  @note Do not pass in NULL for the list or it will be dereferenced!
+     *
+     *  @param list the pointer to the rebar_dll_list_t struct to initiate
+     */
+#define rebar_dll_init( list )   \
+{                               \
+    (list)->head = NULL;        \
+    (list)->tail = NULL;        \
+}
+
+    /**
+     *  Used to get the first node from the list.
+     *
+     *  @note Do not pass in NULL for the list or it will be dereferenced!
+     *
+     *  @param list the list to get the first node from
+     *
+     *  @return first node on success, NULL on error or empty list
+     */
+#define rebar_dll_get_first( list ) ((list)->head)
+
+    /**
+     *  Used to get the next node from the list.
+     *
+     *  @param node the current node of interest
+     *
+     *  @return next node on success, NULL on error or no further nodes available
+     */
+#define rebar_dll_get_next( node ) \
+    (NULL == (node)) ? NULL : (node)->next
+
+    /**
+     *  Used to get the previous node from the list.
+     *
+     *  @param node the current node of interest
+     *
+     *  @return previous node on success, NULL on error or no earlier nodes
+     *          available
+     */
+#define rebar_dll_get_prev( node ) \
+    (NULL == (node)) ? NULL : (node)->prev
+
+    /**
+     *  Used to get the last node from the list.
+     *
+     *  @note Do not pass in NULL for the list or it will be dereferenced!
+     *
+     *  @param list the list to get the last node from
+     *
+     *  @return last node on success, NULL on error or empty list
+     */
+#define rebar_dll_get_last( list ) ((list)->tail)
+
+    /**
+     *  Used to append a node to the tail of a list.
+     *
+     *  @note Do not pass in NULL for the list or it will be dereferenced!
+     *
+     *  @note This function will allow you to add the same node multiple
+     *        times - DO NOT DO THIS!
+     *
+     *  @param list the list to append to
+     *  @param node the node to append to the list
+     */
+    void rebar_dll_append(rebar_dll_list_t *list, rebar_dll_node_t *node);
+
+    /**
+     *  Used to prepend a node to the head of the list.
+     *
+     *  @note Do not pass in NULL for the list or it will be dereferenced!
+     *
+     *  @note This function will allow you to add the same node multiple
+     *        times - DO NOT DO THIS!
+     *
+     *  @param list the list to prepend to
+     *  @param node the node to prepend to the list
+     */
+    void rebar_dll_prepend(rebar_dll_list_t *list, rebar_dll_node_t *node);
+
+    /**
+     *  Used to insert a node either before or after the specified
+     *  node, which must be in the list.  Unlike rebar_ll_insert() this
+     *  does not search the list.
+     *
+     *  @note Do not pass in NULL for the list or it will be dereferenced!
+     *
+     *  @note This function will allow you to add the same node multiple
+     *        times - DO NOT DO THIS!
+     *
+     *  @param list the list to insert a node into
+     *  @param node the node to insert
+     *  @param insert_near_node the node to insert the new node either
+     *                          before or after
+     *  @param mode indicator of the insertion type
+     */
+    void rebar_dll_insert(rebar_dll_list_t *list, rebar_dll_node_t *node,
+            rebar_dll_node_t *insert_near_node,
+            const rebar_ll_insert_mode_t mode);
+
+    /**
+     *  Used to remove a node from a list, which it must be in.  Unlike
+     *  rebar_ll_remove() this does not search the list.
+     *
+     *  @note Do not pass in NULL for the list or it will be dereferenced!
+     *
+     *  @note No memory is released in this operation.  It is up to
+     *  the caller of this function to make sure they have a copy
+     *  of the node pointer to prevent memory leaks.
+     *
+     *  @param list the list to remove a node from
+     *  @param node the node to remove from the list
+     */
+    void rebar_dll_remove(rebar_dll_list_t *list, rebar_dll_node_t *node);
+
+    /**
+     *  Used to remove the node at the head of the list.
+     *
+     *  @note Do not pass in NULL for the list or it will be dereferenced!
+     *
+     *  @param list the list whose head to remove
+     *
+     *  @return the removed node, NULL if the list is empty
+     */
+    rebar_dll_node_t *rebar_dll_pop_head(rebar_dll_list_t *list);
+
+    /**
+     *  Used to remove the node at the tail of the list.
+     *
+     *  @note Do not pass in NULL for the list or it will be dereferenced!
+     *
+     *  @param list the list whose tail to remove
+     *
+     *  @return the removed node, NULL if the list is empty
+     */
+    rebar_dll_node_t *rebar_dll_pop_tail(rebar_dll_list_t *list);
+
+    /**
+     *  Used to iterate over a list and optionally delete nodes from
+     *  the list during the iteration.
+     *
+     *  @note Do not pass in NULL for the list or it will be dereferenced!
+     *
+     *  @param list the list to iterate over
+     *  @param iterator The user provided function to call for each node.
+     *                  If the value of NULL, is passed in each node in the
+     *                  list is deleted.
+     *  @param deleter the user provided function called to delete the node
+     */
+    void rebar_dll_iterate(rebar_dll_list_t *list,
+            rebar_dll_iterator_fn_t iterator,
+            rebar_dll_delete_node_fn_t deleter,
+            void *user_data);
+
+    /**
+     *  Used to delete all nodes in a list.  For each node in the list,
+     *  the user provided deleter function is called and must free any
+     *  appropriate memory.
+     *
+     *  @note Do not pass in NULL for the list or it will be dereferenced!
+     *
+     *  @param list the list to delete the nodes of
+     *  @param deleter the user provided function called to delete the node
+     */
+#define rebar_dll_delete_all( list, deleter, user_data ) \
+    rebar_dll_iterate( list, NULL, deleter, user_data )
+
+    /**
+     *  Used to count the number of nodes in a list.
+     *
+     *  @note Do not pass in NULL for the list or it will be dereferenced!
+     *
+     *  @param list the list to count the nodes for
+     *
+     *  @return the number of items in the list
+     */
+    size_t rebar_dll_count(rebar_dll_list_t *list);
+
+    /**
+     *  Used to find a specific node in the linked list.
+     *
+     *  @note Do not pass in NULL for the list or it will be dereferenced!
+     *  @note Do not pass in NULL for the cmp_fn or it will be dereferenced!
+     *
+     *  @note See rebar_ll_get_data() for details about struct_name and node_name
+     *        useage.
+     *
+     *  @param list the list to search through
+     *  @param cmp_fn the comparison function to use when comparing 2 nodes
+     *  @param needle the data the list is being checked for
+     *  @param struct_name the user structure name
+     *  @param node_name the name of the linked list node name
+     *
+     *  @return the node that matches the needle's data if one is found,
+     *          NULL otherwise
+     */
+#define rebar_dll_find( list, cmp_fn, needle, struct_name, node_name ) \
+    __rebar_dll_find( list, cmp_fn, needle, offsetof(struct_name, node_name) )
+    rebar_dll_node_t *__rebar_dll_find(rebar_dll_list_t *list,
+            rebar_ll_cmp_node_fn_t cmp_fn,
+            void *needle,
+            int offset);
 
 
 #include "cvs-hashmap.h"
 #include "queue.h"
 #include "rebar-xxd.h"
+#include "rebar-hash.h"
 
 
 #ifdef __cplusplus
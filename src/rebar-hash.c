@@ -0,0 +1,354 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define REBAR_HASH_X86_CRC
+#endif
+
+#include "rebar-hash.h"
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+/* The wyhash mixing constants. */
+#define SECRET0     0xa0761d6478bd642fULL
+#define SECRET1     0xe7037ed1a0b428dbULL
+#define SECRET2     0x8ebc6af09c88c6e3ULL
+#define SECRET3     0x589965cc75374cc3ULL
+
+#define GOLDEN64    0x9e3779b97f4a7c15ULL
+
+/* The reflected CRC32C polynomial. */
+#define CRC32C_POLY 0x82f63b78u
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+typedef uint32_t (*crc32c_fn_t)(const uint8_t *p, size_t length, uint32_t crc);
+
+/*----------------------------------------------------------------------------*/
+/*                            File Scoped Variables                           */
+/*----------------------------------------------------------------------------*/
+static uint64_t __seed_base = 0;        /* 0 until first used */
+static uint64_t __seed_counter = 0;
+
+static uint32_t __crc_table[256];
+static crc32c_fn_t __crc_fn = NULL;     /* picked on first use */
+
+/*----------------------------------------------------------------------------*/
+/*                             Function Prototypes                            */
+/*----------------------------------------------------------------------------*/
+static uint64_t __mum(uint64_t a, uint64_t b, uint64_t *hi);
+static uint64_t __wymix(uint64_t a, uint64_t b);
+static uint64_t __read64(const uint8_t *p);
+static uint64_t __read32(const uint8_t *p);
+static crc32c_fn_t __crc_select(void);
+static uint32_t __crc_table_fn(const uint8_t *p, size_t length, uint32_t crc);
+#ifdef REBAR_HASH_X86_CRC
+static uint32_t __crc_sse42_fn(const uint8_t *p, size_t length, uint32_t crc);
+#endif
+
+/*----------------------------------------------------------------------------*/
+/*                             External Functions                             */
+/*----------------------------------------------------------------------------*/
+/* See rebar-hash.h for details. */
+uint64_t rebar_hash_seed(void)
+{
+    uint64_t base;
+
+    base = __atomic_load_n(&__seed_base, __ATOMIC_ACQUIRE);
+    if (0 == base) {
+        uint64_t expected = 0;
+        FILE *f;
+
+        /* Fall back on the clock and an address if there is no urandom. */
+        base = (uint64_t) time(NULL) ^ (uint64_t) (uintptr_t) &base;
+        f = fopen("/dev/urandom", "rb");
+        if (f) {
+            if (1 != fread(&base, sizeof(base), 1, f)) {
+                base ^= (uint64_t) clock();
+            }
+            fclose(f);
+        }
+        base |= 1;
+
+        /* Whichever thread gets here first wins. */
+        if (false == __atomic_compare_exchange_n(&__seed_base, &expected, base, false,
+                                                 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            base = expected;
+        }
+    }
+
+    /* The mixer is a bijection, so every call gets a different seed. */
+    return rebar_hash_mix64(base + GOLDEN64 *
+                            __atomic_add_fetch(&__seed_counter, 1, __ATOMIC_RELAXED));
+}
+
+
+/* See rebar-hash.h for details. */
+uint64_t rebar_hash_bytes(const void *data, size_t length, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t*) data;
+    uint64_t a, b;
+
+    seed ^= __wymix(seed ^ SECRET0, SECRET1);
+
+    if (length <= 16) {
+        if (4 <= length) {
+            /* Two overlapping pairs of 4 byte reads cover 4 to 16 bytes. */
+            size_t mid = (length >> 3) << 2;
+
+            a = (__read32(p) << 32) | __read32(p + mid);
+            b = (__read32(p + length - 4) << 32) | __read32(p + length - 4 - mid);
+        } else if (0 < length) {
+            a = ((uint64_t) p[0] << 16) | ((uint64_t) p[length >> 1] << 8) | p[length - 1];
+            b = 0;
+        } else {
+            a = 0;
+            b = 0;
+        }
+    } else {
+        size_t i = length;
+
+        if (48 < i) {
+            uint64_t see1 = seed, see2 = seed;
+
+            do {
+                seed = __wymix(__read64(p) ^ SECRET1, __read64(p + 8) ^ seed);
+                see1 = __wymix(__read64(p + 16) ^ SECRET2, __read64(p + 24) ^ see1);
+                see2 = __wymix(__read64(p + 32) ^ SECRET3, __read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (48 < i);
+            seed ^= see1 ^ see2;
+        }
+
+        while (16 < i) {
+            seed = __wymix(__read64(p) ^ SECRET1, __read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+
+        /* The last 16 bytes, overlapping what was already mixed. */
+        a = __read64(p + i - 16);
+        b = __read64(p + i - 8);
+    }
+
+    a = __mum(a ^ SECRET1, b ^ seed, &b);
+
+    return __wymix(a ^ SECRET0 ^ (uint64_t) length, b ^ SECRET1);
+}
+
+
+/* See rebar-hash.h for details. */
+uint64_t rebar_hash_string(const char *s, size_t *length, uint64_t seed)
+{
+    size_t len = strlen(s);
+
+    if (length) {
+        *length = len;
+    }
+
+    return rebar_hash_bytes(s, len, seed);
+}
+
+
+/* See rebar-hash.h for details. */
+uint32_t rebar_hash_crc32c(const void *data, size_t length, uint32_t crc)
+{
+    crc32c_fn_t fn;
+
+    fn = __atomic_load_n(&__crc_fn, __ATOMIC_ACQUIRE);
+    if (NULL == fn) {
+        fn = __crc_select();
+    }
+
+    return ~(fn)((const uint8_t*) data, length, ~crc);
+}
+
+
+/* See rebar-hash.h for details. */
+bool rebar_hash_crc32c_is_accelerated(void)
+{
+    crc32c_fn_t fn;
+
+    fn = __atomic_load_n(&__crc_fn, __ATOMIC_ACQUIRE);
+    if (NULL == fn) {
+        fn = __crc_select();
+    }
+
+    return (__crc_table_fn != fn) ? true : false;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                             Internal functions                             */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Multiplies two 64 bit values into a 128 bit product.
+ *
+ *  @param hi where the high 64 bits are stored
+ *
+ *  @return the low 64 bits
+ */
+static uint64_t __mum(uint64_t a, uint64_t b, uint64_t *hi)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t) a * b;
+
+    *hi = (uint64_t) (r >> 64);
+
+    return (uint64_t) r;
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t) a, lb = (uint32_t) b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), lo;
+    uint64_t c = (t < rl) ? 1 : 0;
+
+    lo = t + (rm1 << 32);
+    c += (lo < t) ? 1 : 0;
+    *hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+
+    return lo;
+#endif
+}
+
+
+/**
+ *  Folds the 128 bit product of two values into 64 bits.
+ */
+static uint64_t __wymix(uint64_t a, uint64_t b)
+{
+    uint64_t hi, lo;
+
+    lo = __mum(a, b, &hi);
+
+    return lo ^ hi;
+}
+
+
+/**
+ *  Reads 8 little endian bytes from any alignment.
+ */
+static uint64_t __read64(const uint8_t *p)
+{
+    uint64_t v;
+
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    v = __builtin_bswap64(v);
+#endif
+
+    return v;
+}
+
+
+/**
+ *  Reads 4 little endian bytes from any alignment.
+ */
+static uint64_t __read32(const uint8_t *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    v = __builtin_bswap32(v);
+#endif
+
+    return v;
+}
+
+
+/**
+ *  Picks the CRC32C implementation for this CPU.  The table is filled in
+ *  before the choice is published, so racing callers all see a usable one.
+ *
+ *  @return the implementation
+ */
+static crc32c_fn_t __crc_select(void)
+{
+    crc32c_fn_t fn;
+    uint32_t i, j;
+
+    fn = __crc_table_fn;
+#ifdef REBAR_HASH_X86_CRC
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        fn = __crc_sse42_fn;
+    }
+#endif
+
+    if (__crc_table_fn == fn) {
+        for (i = 0; i < 256; i++) {
+            uint32_t c = i;
+
+            for (j = 0; j < 8; j++) {
+                c = (c >> 1) ^ ((c & 1) ? CRC32C_POLY : 0);
+            }
+            __crc_table[i] = c;
+        }
+    }
+
+    __atomic_store_n(&__crc_fn, fn, __ATOMIC_RELEASE);
+
+    return fn;
+}
+
+
+/**
+ *  CRC32C a byte at a time from a table.
+ */
+static uint32_t __crc_table_fn(const uint8_t *p, size_t length, uint32_t crc)
+{
+    while (0 < length--) {
+        crc = __crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+
+#ifdef REBAR_HASH_X86_CRC
+/**
+ *  CRC32C 8 bytes at a time with the SSE 4.2 crc32 instruction.
+ */
+__attribute__((target("sse4.2")))
+static uint32_t __crc_sse42_fn(const uint8_t *p, size_t length, uint32_t crc)
+{
+    uint64_t c = crc;
+
+    while (8 <= length) {
+        uint64_t v;
+
+        memcpy(&v, p, sizeof(v));
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        length -= 8;
+    }
+    while (0 < length--) {
+        c = _mm_crc32_u8((uint32_t) c, *p++);
+    }
+
+    return (uint32_t) c;
+}
+#endif
@@ -0,0 +1,151 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __REBAR_HASH_H__
+#define __REBAR_HASH_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * rebar-hash.h holds the hash functions shared by the maps.
+ *
+ * rebar_hash_bytes() is a wyhash style keyed hash: 8 and 16 byte reads
+ * folded with 64x64->128 bit multiplies.  The integer hashes are the murmur3
+ * finalizer applied to the key xor the seed, a bijection so distinct keys
+ * never collide on the full 64 bits.
+ *
+ * Every map takes its own seed from rebar_hash_seed(), so which keys share
+ * a bucket differs from map to map and from run to run, and cannot be worked
+ * out in advance from attacker supplied keys such as device names.
+ *
+ * rebar_hash_crc32c() is a checksum, not a map hash: it uses the SSE 4.2
+ * crc32 instruction when the CPU has it (checked once at run time) and a
+ * table otherwise.
+ */
+
+/*----------------------------------------------------------------------------*/
+/*                                 Functions                                  */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Returns a fresh random seed.  Each call returns a different value.
+ *
+ *  @return the seed
+ */
+uint64_t rebar_hash_seed(void);
+
+
+/**
+ *  Hashes a buffer.
+ *
+ *  @param data the bytes to hash
+ *  @param length the number of bytes
+ *  @param seed the seed
+ *
+ *  @return the hash
+ */
+uint64_t rebar_hash_bytes(const void *data, size_t length, uint64_t seed);
+
+
+/**
+ *  Hashes a NUL terminated string, not including the NUL.
+ *
+ *  @param s the string to hash
+ *  @param length if not NULL, where the length of the string is stored
+ *  @param seed the seed
+ *
+ *  @return the hash
+ */
+uint64_t rebar_hash_string(const char *s, size_t *length, uint64_t seed);
+
+
+/**
+ *  The murmur3 64 bit finalizer, spreads every input bit over the output.
+ *
+ *  @param x the value to mix
+ *
+ *  @return the mixed value
+ */
+static inline uint64_t rebar_hash_mix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+
+    return x;
+}
+
+
+/**
+ *  Hashes a 64 bit integer.
+ *
+ *  @param x the integer to hash
+ *  @param seed the seed
+ *
+ *  @return the hash
+ */
+static inline uint64_t rebar_hash_u64(uint64_t x, uint64_t seed)
+{
+    return rebar_hash_mix64(x ^ seed);
+}
+
+
+/**
+ *  Hashes a 32 bit integer.
+ *
+ *  @param x the integer to hash
+ *  @param seed the seed
+ *
+ *  @return the hash
+ */
+static inline uint64_t rebar_hash_u32(uint32_t x, uint64_t seed)
+{
+    return rebar_hash_mix64((uint64_t) x ^ seed);
+}
+
+
+/**
+ *  Computes the CRC32C (Castagnoli) of a buffer.
+ *
+ *  @param data the bytes to checksum
+ *  @param length the number of bytes
+ *  @param crc 0, or the result of the previous call to continue a checksum
+ *
+ *  @return the checksum
+ */
+uint32_t rebar_hash_crc32c(const void *data, size_t length, uint32_t crc);
+
+
+/**
+ *  Returns true if rebar_hash_crc32c() uses the CPU's crc32 instruction.
+ *
+ *  @return true if the hardware path is in use
+ */
+bool rebar_hash_crc32c_is_accelerated(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
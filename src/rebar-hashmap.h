@@ -0,0 +1,397 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __REBAR_HASHMAP_H__
+#define __REBAR_HASHMAP_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rebar-hash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * rebar-hashmap.h generates hashmaps specialized for one key and one value
+ * type.  cvs_hashmap takes its keys as void pointers and calls its hash and
+ * compare functions through pointers; a generated map stores keys and values
+ * by value and the compiler inlines the hash and the equality test into every
+ * probe.
+ *
+ *     REBAR_HASHMAP_DEFINE(name, key_type, value_type, hash_fn, eq_fn)
+ *
+ * defines the types name_t, name_slot_t and name_iterator_fn_t and the
+ * static inline functions name_init(), name_destroy(), name_get(),
+ * name_contains_key(), name_get_or_insert(), name_put(), name_remove(),
+ * name_reserve(), name_is_empty(), name_iterate() and name_get_size().  Use
+ * it once per map type, at file scope.
+ *
+ * hash_fn(key, seed) must return a uint64_t and eq_fn(a, b) a truth value;
+ * either may be a function or a macro.  rebar_hash_u32() and rebar_hash_u64()
+ * fit integer keys directly, with REBAR_HASHMAP_EQ() as the equality.
+ * rebar_hashmap_hash_string() and rebar_hashmap_eq_string() are provided for
+ * NUL terminated keys, which the map does not copy.
+ *
+ * The map is open addressing with linear probing over a power of two slot
+ * array, kept at most 3/4 full.  A control byte per slot holds 7 bits of the
+ * hash, so most mismatched slots are passed over without calling eq_fn, and
+ * a parallel array keeps the low 32 bits so growing does not hash the keys
+ * again.
+ *
+ *     REBAR_HASHMAP_DEFINE(u64map, uint64_t, void*, rebar_hash_u64, REBAR_HASHMAP_EQ)
+ *
+ *     u64map_t map;
+ *     u64map_init(&map);
+ *     u64map_put(&map, 42, device);
+ *     void **found = u64map_get(&map, 42);
+ */
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+#define REBAR_HASHMAP_EQ(a, b)      ((a) == (b))
+
+/* Control bytes: full slots have the top bit set and 7 bits of the hash. */
+#define REBAR_HASHMAP__EMPTY        0x00
+#define REBAR_HASHMAP__DELETED      0x01
+#define REBAR_HASHMAP__FULL         0x80
+#define REBAR_HASHMAP__TAG(hash)    ((uint8_t) (REBAR_HASHMAP__FULL | ((hash) >> 57)))
+#define REBAR_HASHMAP__MIN_SLOTS    8
+
+/**
+ *  Defines a hashmap type and its functions.
+ *
+ *  @param name the prefix of every generated type and function
+ *  @param key_type the key type, copied by value
+ *  @param value_type the value type, copied by value
+ *  @param hash_fn uint64_t hash_fn(key_type key, uint64_t seed)
+ *  @param eq_fn bool eq_fn(key_type a, key_type b)
+ */
+#define REBAR_HASHMAP_DEFINE(name, key_type, value_type, hash_fn, eq_fn)       \
+                                                                               \
+typedef struct {                                                               \
+    key_type key;                                                              \
+    value_type value;                                                          \
+} name##_slot_t;                                                               \
+                                                                               \
+/* Do not directly access any of the values in the structure. */               \
+typedef struct {                                                               \
+    uint64_t seed;                                                             \
+    size_t count;                                                              \
+    size_t used;                /* count plus deleted slots */                 \
+    size_t mask;                /* slot count - 1, slot count is 2^n */        \
+    uint8_t *ctrl;              /* one control byte per slot */                \
+    uint32_t *hashes;           /* low hash bits of each slot, for growing */  \
+    name##_slot_t *slots;       /* NULL until the first put */                 \
+} name##_t;                                                                    \
+                                                                               \
+/* Returns true to continue, false stops the iteration. */                     \
+typedef bool (*name##_iterator_fn_t)(key_type *key, value_type *value,         \
+                                     void *user_data);                         \
+                                                                               \
+static inline bool name##_init(name##_t *map)                                  \
+{                                                                              \
+    if (NULL == map) {                                                         \
+        return false;                                                          \
+    }                                                                          \
+                                                                               \
+    memset(map, 0, sizeof(name##_t));                                          \
+    map->seed = rebar_hash_seed();                                             \
+                                                                               \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+static inline void name##_destroy(name##_t *map)                               \
+{                                                                              \
+    if (NULL == map) {                                                         \
+        return;                                                                \
+    }                                                                          \
+                                                                               \
+    free(map->ctrl);                                                           \
+    free(map->slots);                                                          \
+    free(map->hashes);                                                         \
+    map->ctrl = NULL;                                                          \
+    map->slots = NULL;                                                         \
+    map->hashes = NULL;                                                        \
+    map->count = 0;                                                            \
+    map->used = 0;                                                             \
+    map->mask = 0;                                                             \
+}                                                                              \
+                                                                               \
+/* Returns the slot holding key, or SIZE_MAX. */                               \
+static inline size_t name##__find(name##_t *map, key_type key, uint64_t hash)  \
+{                                                                              \
+    uint8_t tag;                                                               \
+    size_t i;                                                                  \
+                                                                               \
+    if (NULL == map->slots) {                                                  \
+        return SIZE_MAX;                                                       \
+    }                                                                          \
+                                                                               \
+    tag = REBAR_HASHMAP__TAG(hash);                                            \
+    i = (size_t) hash & map->mask;                                             \
+    while (REBAR_HASHMAP__EMPTY != map->ctrl[i]) {                             \
+        if ((tag == map->ctrl[i]) && (eq_fn(map->slots[i].key, key))) {        \
+            return i;                                                          \
+        }                                                                      \
+        i = (i + 1) & map->mask;                                               \
+    }                                                                          \
+                                                                               \
+    return SIZE_MAX;                                                           \
+}                                                                              \
+                                                                               \
+/* Moves the pairs into a slot array sized for count pairs, dropping the       \
+ * deleted slots.  The saved hash bits place them without hashing the keys     \
+ * again, so there can be at most 2^32 slots. */                               \
+static inline bool name##__rehash(name##_t *map, size_t count)                 \
+{                                                                              \
+    name##_slot_t *slots;                                                      \
+    uint32_t *hashes;                                                          \
+    uint8_t *ctrl;                                                             \
+    size_t size, mask, i;                                                      \
+                                                                               \
+    size = REBAR_HASHMAP__MIN_SLOTS;                                           \
+    while (size < 2 * count) {                                                 \
+        size <<= 1;                                                            \
+    }                                                                          \
+    if ((uint64_t) UINT32_MAX < (uint64_t) (size - 1)) {                       \
+        return false;                                                          \
+    }                                                                          \
+    mask = size - 1;                                                           \
+                                                                               \
+    ctrl = (uint8_t*) calloc(size, sizeof(uint8_t));                           \
+    slots = (name##_slot_t*) malloc(size * sizeof(name##_slot_t));             \
+    hashes = (uint32_t*) malloc(size * sizeof(uint32_t));                      \
+    if ((NULL == ctrl) || (NULL == slots) || (NULL == hashes)) {               \
+        free(ctrl);                                                            \
+        free(slots);                                                           \
+        free(hashes);                                                          \
+        return false;                                                          \
+    }                                                                          \
+                                                                               \
+    for (i = 0; (NULL != map->slots) && (i <= map->mask); i++) {               \
+        size_t j;                                                              \
+                                                                               \
+        if (0 == (REBAR_HASHMAP__FULL & map->ctrl[i])) {                       \
+            continue;                                                          \
+        }                                                                      \
+                                                                               \
+        j = (size_t) map->hashes[i] & mask;                                    \
+        while (REBAR_HASHMAP__EMPTY != ctrl[j]) {                              \
+            j = (j + 1) & mask;                                                \
+        }                                                                      \
+        ctrl[j] = map->ctrl[i];                                                \
+        slots[j] = map->slots[i];                                              \
+        hashes[j] = map->hashes[i];                                            \
+    }                                                                          \
+                                                                               \
+    free(map->ctrl);                                                           \
+    free(map->slots);                                                          \
+    free(map->hashes);                                                         \
+    map->ctrl = ctrl;                                                          \
+    map->slots = slots;                                                        \
+    map->hashes = hashes;                                                      \
+    map->mask = mask;                                                          \
+    map->used = map->count;                                                    \
+                                                                               \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+static inline value_type *name##_get(name##_t *map, key_type key)              \
+{                                                                              \
+    size_t i;                                                                  \
+                                                                               \
+    if (NULL == map) {                                                         \
+        return NULL;                                                           \
+    }                                                                          \
+                                                                               \
+    i = name##__find(map, key, hash_fn(key, map->seed));                       \
+                                                                               \
+    return (SIZE_MAX == i) ? NULL : &map->slots[i].value;                      \
+}                                                                              \
+                                                                               \
+static inline bool name##_contains_key(name##_t *map, key_type key)            \
+{                                                                              \
+    return NULL != name##_get(map, key);                                       \
+}                                                                              \
+                                                                               \
+/* Returns the value of key, adding key with a zeroed value if it is new;      \
+ * NULL if the slot array could not grow. */                                   \
+static inline value_type *name##_get_or_insert(name##_t *map, key_type key,    \
+                                               bool *inserted)                 \
+{                                                                              \
+    uint64_t hash;                                                             \
+    size_t i;                                                                  \
+                                                                               \
+    if (NULL == map) {                                                         \
+        return NULL;                                                           \
+    }                                                                          \
+                                                                               \
+    hash = hash_fn(key, map->seed);                                            \
+    i = name##__find(map, key, hash);                                          \
+    if (SIZE_MAX != i) {                                                       \
+        if (inserted) {                                                        \
+            *inserted = false;                                                 \
+        }                                                                      \
+        return &map->slots[i].value;                                           \
+    }                                                                          \
+                                                                               \
+    if ((NULL == map->slots) || ((map->mask + 1) * 3 < (map->used + 1) * 4)) { \
+        if (!name##__rehash(map, map->count + 1)) {                            \
+            return NULL;                                                       \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    i = (size_t) hash & map->mask;                                             \
+    while (0 != (REBAR_HASHMAP__FULL & map->ctrl[i])) {                        \
+        i = (i + 1) & map->mask;                                               \
+    }                                                                          \
+    if (REBAR_HASHMAP__EMPTY == map->ctrl[i]) {                                \
+        map->used++;                                                           \
+    }                                                                          \
+    map->ctrl[i] = REBAR_HASHMAP__TAG(hash);                                   \
+    map->slots[i].key = key;                                                   \
+    map->hashes[i] = (uint32_t) hash;                                          \
+    memset(&map->slots[i].value, 0, sizeof(value_type));                       \
+    map->count++;                                                              \
+                                                                               \
+    if (inserted) {                                                            \
+        *inserted = true;                                                      \
+    }                                                                          \
+    return &map->slots[i].value;                                               \
+}                                                                              \
+                                                                               \
+/* An existing key keeps the key it was first put with. */                     \
+static inline bool name##_put(name##_t *map, key_type key, value_type value)   \
+{                                                                              \
+    value_type *slot;                                                          \
+                                                                               \
+    slot = name##_get_or_insert(map, key, NULL);                               \
+    if (NULL == slot) {                                                        \
+        return false;                                                          \
+    }                                                                          \
+    *slot = value;                                                             \
+                                                                               \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+/* Removes key, copying its value to value if that is not NULL. */             \
+static inline bool name##_remove(name##_t *map, key_type key,                  \
+                                  value_type *value)                           \
+{                                                                              \
+    size_t i;                                                                  \
+                                                                               \
+    if (NULL == map) {                                                         \
+        return false;                                                          \
+    }                                                                          \
+                                                                               \
+    i = name##__find(map, key, hash_fn(key, map->seed));                       \
+    if (SIZE_MAX == i) {                                                       \
+        return false;                                                          \
+    }                                                                          \
+                                                                               \
+    if (value) {                                                               \
+        *value = map->slots[i].value;                                          \
+    }                                                                          \
+                                                                               \
+    /* No probe continues past an empty slot, so if the next slot is empty     \
+     * this one can be empty too instead of a tombstone. */                    \
+    if (REBAR_HASHMAP__EMPTY == map->ctrl[(i + 1) & map->mask]) {              \
+        map->ctrl[i] = REBAR_HASHMAP__EMPTY;                                   \
+        map->used--;                                                           \
+    } else {                                                                   \
+        map->ctrl[i] = REBAR_HASHMAP__DELETED;                                 \
+    }                                                                          \
+    map->count--;                                                              \
+                                                                               \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+/* Sizes the map so count pairs fit without growing again. */                  \
+static inline bool name##_reserve(name##_t *map, size_t count)                 \
+{                                                                              \
+    if (NULL == map) {                                                         \
+        return false;                                                          \
+    }                                                                          \
+                                                                               \
+    if ((NULL != map->slots) && (count * 4 <= (map->mask + 1) * 3)) {          \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    return name##__rehash(map, (count < map->count) ? map->count : count);     \
+}                                                                              \
+                                                                               \
+static inline bool name##_is_empty(name##_t *map)                              \
+{                                                                              \
+    return (NULL == map) || (0 == map->count);                                 \
+}                                                                              \
+                                                                               \
+/* No map manipulation is permitted during the iteration. */                   \
+static inline void name##_iterate(name##_t *map,                               \
+                                  name##_iterator_fn_t iterator,               \
+                                  void *user_data)                             \
+{                                                                              \
+    size_t i;                                                                  \
+                                                                               \
+    if ((NULL == map) || (NULL == iterator) || (NULL == map->slots)) {         \
+        return;                                                                \
+    }                                                                          \
+                                                                               \
+    for (i = 0; i <= map->mask; i++) {                                         \
+        if ((0 != (REBAR_HASHMAP__FULL & map->ctrl[i])) &&                     \
+            !iterator(&map->slots[i].key, &map->slots[i].value, user_data))    \
+        {                                                                      \
+            return;                                                            \
+        }                                                                      \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static inline size_t name##_get_size(name##_t *map)                            \
+{                                                                              \
+    return (NULL == map) ? 0 : map->count;                                     \
+}
+
+/*----------------------------------------------------------------------------*/
+/*                                 Functions                                  */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  The hash_fn for NUL terminated string keys.
+ */
+static inline uint64_t rebar_hashmap_hash_string(const char *key, uint64_t seed)
+{
+    return rebar_hash_string(key, NULL, seed);
+}
+
+
+/**
+ *  The eq_fn for NUL terminated string keys.
+ */
+static inline bool rebar_hashmap_eq_string(const char *a, const char *b)
+{
+    return (a == b) || (0 == strcmp(a, b));
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,115 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <string.h>
+
+#include "rebar-key.h"
+
+/*----------------------------------------------------------------------------*/
+/*                             External Functions                             */
+/*----------------------------------------------------------------------------*/
+/* See rebar-key.h for details. */
+const void *rebar_key_bytes(cvs_hashmap_type_t type, size_t key_length,
+                            void *key, size_t *length)
+{
+    switch( type ) {
+        case CHT__STRING:
+            *length = strlen((const char*) key);
+            return key;
+        case CHT__UINT32:
+            *length = sizeof(uint32_t);
+            return key;
+        case CHT__UINT64:
+            *length = sizeof(uint64_t);
+            return key;
+        case CHT__BYTES:
+            *length = key_length;
+            return key;
+        default:
+            break;
+    }
+
+    *length = ((cvs_hashmap_blob_t*) key)->length;
+
+    return ((cvs_hashmap_blob_t*) key)->data;
+}
+
+
+/* See rebar-key.h for details. */
+size_t rebar_key_size(cvs_hashmap_type_t type, size_t key_length, void *key)
+{
+    switch( type ) {
+        case CHT__STRING:
+            return strlen((const char*) key) + 1;
+        case CHT__BYTES:
+            return key_length;
+        case CHT__BLOB:
+            return ((cvs_hashmap_blob_t*) key)->length;
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+
+/* See rebar-key.h for details. */
+void rebar_key_copy(rebar_key_t *copy, uint8_t *data, cvs_hashmap_type_t type,
+                    size_t key_length, void *key)
+{
+    size_t length;
+
+    length = rebar_key_size(type, key_length, key);
+
+    memset(copy, 0, sizeof(rebar_key_t));
+    switch( type ) {
+        case CHT__UINT32:
+            copy->u32 = *((uint32_t*) key);
+            break;
+        case CHT__UINT64:
+            copy->u64 = *((uint64_t*) key);
+            break;
+        case CHT__BLOB:
+            if (0 < length) {
+                memcpy(data, ((cvs_hashmap_blob_t*) key)->data, length);
+            }
+            copy->blob.data = data;
+            copy->blob.length = length;
+            break;
+        default:
+            memcpy(data, key, length);
+            break;
+    }
+}
+
+
+/* See rebar-key.h for details. */
+void *rebar_key_get(rebar_key_t *copy, uint8_t *data, cvs_hashmap_type_t type)
+{
+    switch( type ) {
+        case CHT__UINT32:
+            return &copy->u32;
+        case CHT__UINT64:
+            return &copy->u64;
+        case CHT__BLOB:
+            return &copy->blob;
+        default:
+            break;
+    }
+
+    return data;
+}
@@ -0,0 +1,112 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __REBAR_KEY_H__
+#define __REBAR_KEY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cvs-hashmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * rebar-key.h holds the key handling shared by the containers that take
+ * cvs_hashmap keys.
+ *
+ * rebar_key_bytes() gives the bytes that make up a key, for the containers
+ * that hash and store keys as plain bytes.
+ *
+ * A copy is a rebar_key_t plus rebar_key_size() bytes of data, usually the
+ * flexible array at the end of the container's entry.  Integer keys live in
+ * the rebar_key_t, string, bytes and blob keys in the data, and a blob's
+ * rebar_key_t points at its data.
+ *
+ * This header is internal to the library and is not installed.
+ */
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+typedef union {
+    uint32_t u32;
+    uint64_t u64;
+    cvs_hashmap_blob_t blob;        /* points at the copy's data */
+} rebar_key_t;
+
+/*----------------------------------------------------------------------------*/
+/*                                 Functions                                  */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Gets the bytes that make up a key.  A string's bytes do not include its
+ *  NUL.
+ *
+ *  @param type the key type
+ *  @param key_length the key length of CHT__BYTES keys
+ *  @param key the key
+ *  @param length where the number of key bytes is stored
+ *
+ *  @return the key bytes
+ */
+const void *rebar_key_bytes(cvs_hashmap_type_t type, size_t key_length,
+                            void *key, size_t *length);
+
+
+/**
+ *  Returns the number of data bytes a copy of the key needs.
+ *
+ *  @param type the key type
+ *  @param key_length the key length of CHT__BYTES keys
+ *  @param key the key
+ *
+ *  @return the number of bytes, 0 for integer keys
+ */
+size_t rebar_key_size(cvs_hashmap_type_t type, size_t key_length, void *key);
+
+
+/**
+ *  Copies a key.
+ *
+ *  @param copy where the copy goes
+ *  @param data rebar_key_size() bytes for the copy's data
+ *  @param type the key type
+ *  @param key_length the key length of CHT__BYTES keys
+ *  @param key the key to copy
+ */
+void rebar_key_copy(rebar_key_t *copy, uint8_t *data, cvs_hashmap_type_t type,
+                    size_t key_length, void *key);
+
+
+/**
+ *  Returns a copied key in the form the cvs_hashmap calls take.
+ *
+ *  @param copy the copy
+ *  @param data the copy's data
+ *  @param type the key type
+ *
+ *  @return the key pointer
+ */
+void *rebar_key_get(rebar_key_t *copy, uint8_t *data, cvs_hashmap_type_t type);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,311 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "rebar-lru.h"
+#include "rebar-key.h"
+
+/*----------------------------------------------------------------------------*/
+/*                                   Macros                                   */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+/* An entry and its copy of the key, which the hashmap indexes. */
+struct __rebar_lru_entry {
+    rebar_dll_node_t link;              /* in the use order list */
+    void *value;
+    bool referenced;                    /* REBAR_LRU__CLOCK only */
+    rebar_key_t key;
+    uint8_t data[];                     /* string, bytes and blob keys */
+};
+
+typedef struct __rebar_lru_entry rebar_lru_entry_t;
+
+/*----------------------------------------------------------------------------*/
+/*                            File Scoped Variables                           */
+/*----------------------------------------------------------------------------*/
+/* none */
+
+/*----------------------------------------------------------------------------*/
+/*                             Function Prototypes                            */
+/*----------------------------------------------------------------------------*/
+static rebar_lru_entry_t *__new_entry(rebar_lru_t *lru, void *key);
+static void __evict(rebar_lru_t *lru);
+static void __touch(rebar_lru_t *lru, rebar_lru_entry_t *e);
+static void __free_entry(rebar_dll_node_t *node, void *user_data);
+
+/*----------------------------------------------------------------------------*/
+/*                             External Functions                             */
+/*----------------------------------------------------------------------------*/
+/* See rebar-lru.h for details. */
+bool rebar_lru_init(rebar_lru_t *lru, cvs_hashmap_type_t type, size_t capacity,
+                    rebar_lru_mode_t mode, rebar_lru_evict_fn_t evict,
+                    void *user_data)
+{
+    if ((NULL == lru) || (0 == capacity) || (CHT__BYTES == type)) {
+        return false;
+    }
+
+    memset(lru, 0, sizeof(rebar_lru_t));
+    if (!cvs_hashmap_init(&lru->map, type)) {
+        return false;
+    }
+    cvs_hashmap_reserve(&lru->map, capacity);
+
+    lru->type = type;
+    lru->capacity = capacity;
+    lru->mode = mode;
+    lru->evict = evict;
+    lru->user_data = user_data;
+
+    return true;
+}
+
+
+/* See rebar-lru.h for details. */
+bool rebar_lru_init_bytes(rebar_lru_t *lru, size_t key_length, size_t capacity,
+                          rebar_lru_mode_t mode, rebar_lru_evict_fn_t evict,
+                          void *user_data)
+{
+    if ((NULL == lru) || (0 == capacity)) {
+        return false;
+    }
+
+    memset(lru, 0, sizeof(rebar_lru_t));
+    if (!cvs_hashmap_init_bytes(&lru->map, key_length, CHF__NONE)) {
+        return false;
+    }
+    cvs_hashmap_reserve(&lru->map, capacity);
+
+    lru->type = CHT__BYTES;
+    lru->key_length = key_length;
+    lru->capacity = capacity;
+    lru->mode = mode;
+    lru->evict = evict;
+    lru->user_data = user_data;
+
+    return true;
+}
+
+
+/* See rebar-lru.h for details. */
+void rebar_lru_destroy(rebar_lru_t *lru)
+{
+    if (NULL == lru) {
+        return;
+    }
+
+    rebar_dll_delete_all(&lru->order, __free_entry, NULL);
+    cvs_hashmap_destroy(&lru->map);
+}
+
+
+/* See rebar-lru.h for details. */
+void *rebar_lru_get(rebar_lru_t *lru, void *key)
+{
+    rebar_lru_entry_t *e;
+
+    if ((NULL == lru) || (NULL == key)) {
+        return NULL;
+    }
+
+    e = (rebar_lru_entry_t*) cvs_hashmap_get(&lru->map, key);
+    if (NULL == e) {
+        return NULL;
+    }
+
+    if (REBAR_LRU__CLOCK == lru->mode) {
+        /* Only write when the mark changes, so repeated hits stay reads. */
+        if (!e->referenced) {
+            e->referenced = true;
+        }
+    } else {
+        __touch(lru, e);
+    }
+
+    return e->value;
+}
+
+
+/* See rebar-lru.h for details. */
+void *rebar_lru_peek(rebar_lru_t *lru, void *key)
+{
+    rebar_lru_entry_t *e;
+
+    if ((NULL == lru) || (NULL == key)) {
+        return NULL;
+    }
+
+    e = (rebar_lru_entry_t*) cvs_hashmap_get(&lru->map, key);
+
+    return (e) ? e->value : NULL;
+}
+
+
+/* See rebar-lru.h for details. */
+void *rebar_lru_put(rebar_lru_t *lru, void *key, void *value)
+{
+    rebar_lru_entry_t *e;
+    void *rv;
+
+    if ((NULL == lru) || (NULL == key)) {
+        return NULL;
+    }
+
+    e = (rebar_lru_entry_t*) cvs_hashmap_get(&lru->map, key);
+    if (e) {
+        rv = e->value;
+        e->value = value;
+        if (REBAR_LRU__CLOCK == lru->mode) {
+            e->referenced = true;
+        } else {
+            __touch(lru, e);
+        }
+        return rv;
+    }
+
+    if (lru->capacity <= cvs_hashmap_get_size(&lru->map)) {
+        __evict(lru);
+    }
+
+    e = __new_entry(lru, key);
+    e->value = value;
+    cvs_hashmap_put(&lru->map, rebar_key_get(&e->key, e->data, lru->type), e);
+    rebar_dll_prepend(&lru->order, &e->link);
+
+    return NULL;
+}
+
+
+/* See rebar-lru.h for details. */
+void *rebar_lru_remove(rebar_lru_t *lru, void *key)
+{
+    rebar_lru_entry_t *e;
+    void *rv;
+
+    if ((NULL == lru) || (NULL == key)) {
+        return NULL;
+    }
+
+    e = (rebar_lru_entry_t*) cvs_hashmap_remove(&lru->map, key);
+    if (NULL == e) {
+        return NULL;
+    }
+
+    rebar_dll_remove(&lru->order, &e->link);
+    rv = e->value;
+    free(e);
+
+    return rv;
+}
+
+
+/* See rebar-lru.h for details. */
+size_t rebar_lru_get_size(rebar_lru_t *lru)
+{
+    if (NULL == lru) {
+        return 0;
+    }
+
+    return cvs_hashmap_get_size(&lru->map);
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                             Internal functions                             */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Allocates an entry holding a copy of a key.
+ *
+ *  @param lru the cache the entry is for
+ *  @param key the caller's key
+ *
+ *  @return the entry, not yet linked or indexed
+ */
+static rebar_lru_entry_t *__new_entry(rebar_lru_t *lru, void *key)
+{
+    rebar_lru_entry_t *e;
+    size_t length;
+
+    length = rebar_key_size(lru->type, lru->key_length, key);
+
+    e = (rebar_lru_entry_t*) malloc(sizeof(rebar_lru_entry_t) + length);
+    assert(e);
+    memset(e, 0, sizeof(rebar_lru_entry_t));
+    rebar_key_copy(&e->key, e->data, lru->type, lru->key_length, key);
+
+    return e;
+}
+
+
+/**
+ *  Evicts the entry at the tail.  In REBAR_LRU__CLOCK mode referenced entries
+ *  at the tail get a second chance first: their mark is cleared and they move
+ *  to the head.  Every mark is cleared at most once, so this ends.
+ *
+ *  @param lru the cache to evict from
+ */
+static void __evict(rebar_lru_t *lru)
+{
+    rebar_lru_entry_t *e;
+    void *key;
+
+    e = rebar_ll_get_data(rebar_lru_entry_t, link, rebar_dll_get_last(&lru->order));
+    while ((REBAR_LRU__CLOCK == lru->mode) && e->referenced) {
+        e->referenced = false;
+        __touch(lru, e);
+        e = rebar_ll_get_data(rebar_lru_entry_t, link, rebar_dll_get_last(&lru->order));
+    }
+
+    rebar_dll_remove(&lru->order, &e->link);
+    key = rebar_key_get(&e->key, e->data, lru->type);
+    cvs_hashmap_remove(&lru->map, key);
+    if (lru->evict) {
+        (lru->evict)(key, e->value, lru->user_data);
+    }
+    free(e);
+}
+
+
+/**
+ *  Makes an entry the most recently used.
+ */
+static void __touch(rebar_lru_t *lru, rebar_lru_entry_t *e)
+{
+    if (rebar_dll_get_first(&lru->order) != &e->link) {
+        rebar_dll_remove(&lru->order, &e->link);
+        rebar_dll_prepend(&lru->order, &e->link);
+    }
+}
+
+
+/**
+ *  Frees an entry as rebar_dll_delete_all() takes it off the list.
+ */
+static void __free_entry(rebar_dll_node_t *node, void *user_data)
+{
+    (void) user_data;
+
+    free(rebar_ll_get_data(rebar_lru_entry_t, link, node));
+}
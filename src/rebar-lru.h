@@ -0,0 +1,195 @@
+/**
+ * Copyright 2018 Comcast Cable Communications Management, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __REBAR_LRU_H__
+#define __REBAR_LRU_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cvs-hashmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * rebar-lru.h implements a cache holding at most a fixed number of entries.
+ * Putting a new key into a full cache evicts the least recently used entry.
+ *
+ * A cvs_hashmap finds the entry of a key and a doubly linked list keeps the
+ * entries in use order, so get, put and remove are all O(1).  Each entry
+ * keeps its own copy of its key (the hashmap indexes that copy), so the
+ * caller's key only has to be valid during the call.
+ *
+ * In REBAR_LRU__EXACT mode every hit moves the entry to the front of the
+ * list.  In REBAR_LRU__CLOCK mode a hit only marks the entry as referenced;
+ * eviction passes over referenced entries once (clearing the mark and moving
+ * them to the front) and evicts the first unmarked one.  CLOCK keeps hits
+ * free of list writes, at the price of evicting approximately rather than
+ * exactly the least recently used entry.
+ */
+
+/*----------------------------------------------------------------------------*/
+/*                               Data Structures                              */
+/*----------------------------------------------------------------------------*/
+typedef enum {
+    REBAR_LRU__EXACT,       /* move the entry on every hit */
+    REBAR_LRU__CLOCK        /* mark the entry on a hit, sort out at eviction */
+} rebar_lru_mode_t;
+
+
+/**
+ *  Called for each entry the cache evicts to make room for a new one.
+ *
+ *  @note No cache manipulation is permitted during this call.
+ *
+ *  @param key the pointer to the entry's key (for CHT__BLOB caches a
+ *             cvs_hashmap_blob_t), only valid during the call
+ *  @param value the value of the entry
+ */
+typedef void (*rebar_lru_evict_fn_t)(void *key, void *value, void *user_data);
+
+
+struct __rebar_lru_entry;
+
+/* Do not directly access any of the values in the structure. */
+typedef struct {
+    cvs_hashmap_t map;              /* key -> entry */
+    cvs_hashmap_type_t type;
+    size_t key_length;              /* CHT__BYTES only */
+    size_t capacity;
+    rebar_lru_mode_t mode;
+    rebar_lru_evict_fn_t evict;
+    void *user_data;
+    rebar_dll_list_t order;         /* most recently used first */
+} rebar_lru_t;
+
+/*----------------------------------------------------------------------------*/
+/*                                 Functions                                  */
+/*----------------------------------------------------------------------------*/
+
+/**
+ *  Initializes the cache.
+ *
+ *  @param lru the cache to initialize
+ *  @param type the type of the keys, anything but CHT__BYTES
+ *  @param capacity the most entries the cache holds, must not be 0
+ *  @param mode how hits are recorded
+ *  @param evict the function called for each evicted entry, may be NULL
+ *  @param user_data additional user data passed through to the evict function
+ *
+ *  @return true if successful, false otherwise
+ */
+bool rebar_lru_init(rebar_lru_t *lru, cvs_hashmap_type_t type, size_t capacity,
+                    rebar_lru_mode_t mode, rebar_lru_evict_fn_t evict,
+                    void *user_data);
+
+
+/**
+ *  Initializes a cache with CHT__BYTES keys of key_length bytes each.
+ *
+ *  @param lru the cache to initialize
+ *  @param key_length the number of bytes in every key, must not be 0
+ *  @param capacity the most entries the cache holds, must not be 0
+ *  @param mode how hits are recorded
+ *  @param evict the function called for each evicted entry, may be NULL
+ *  @param user_data additional user data passed through to the evict function
+ *
+ *  @return true if successful, false otherwise
+ */
+bool rebar_lru_init_bytes(rebar_lru_t *lru, size_t key_length, size_t capacity,
+                          rebar_lru_mode_t mode, rebar_lru_evict_fn_t evict,
+                          void *user_data);
+
+
+/**
+ *  Destroys the structure.
+ *
+ *  @note This does not destroy the values of the cache, and does not call the
+ *        evict function for them.
+ *
+ *  @param lru the cache to destroy
+ */
+void rebar_lru_destroy(rebar_lru_t *lru);
+
+
+/**
+ *  Returns the value of a key and records the hit.
+ *
+ *  @param lru the cache to search
+ *  @param key the pointer to the key whose associated value is to be returned
+ *
+ *  @return the value to which the specified key is mapped, or NULL if this
+ *          cache contains no mapping for the key (or any other error occurs)
+ */
+void *rebar_lru_get(rebar_lru_t *lru, void *key);
+
+
+/**
+ *  Returns the value of a key without recording a hit.
+ *
+ *  @param lru the cache to search
+ *  @param key the pointer to the key whose associated value is to be returned
+ *
+ *  @return the value to which the specified key is mapped, or NULL if this
+ *          cache contains no mapping for the key (or any other error occurs)
+ */
+void *rebar_lru_peek(rebar_lru_t *lru, void *key);
+
+
+/**
+ *  Associates the value with the key and makes it the most recently used
+ *  entry.  If the key is new and the cache is full, the least recently used
+ *  entry is evicted first.
+ *
+ *  @param lru the cache to change
+ *  @param key pointer to the key with which the specified value is to be associated
+ *  @param value value to be associated with the specified key
+ *
+ *  @return the value the key had before, or NULL if it was not in the cache
+ *          (or any other error occurs)
+ */
+void *rebar_lru_put(rebar_lru_t *lru, void *key, void *value);
+
+
+/**
+ *  Removes the entry of a key, without calling the evict function.
+ *
+ *  @param lru the cache to change
+ *  @param key the pointer to the key whose entry is to be removed
+ *
+ *  @return the value of the removed entry, or NULL if there was no entry for
+ *          key (or any other error occurs)
+ */
+void *rebar_lru_remove(rebar_lru_t *lru, void *key);
+
+
+/**
+ *  Returns the number of entries in the cache.
+ *
+ *  @param lru the cache to inspect
+ *
+ *  @return the number of entries, or 0 on error
+ */
+size_t rebar_lru_get_size(rebar_lru_t *lru);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -7,6 +7,18 @@
 #include "../src/rebar-c.h"
 #include "general.h"
 #include "test_hashmap.h"
+#include "test_flatmap.h"
+#include "test_chashmap.h"
+#include "test_compactmap.h"
+#include "test_hash.h"
+#include "test_snapshot.h"
+#include "test_frozenmap.h"
+#include "test_shardmap.h"
+#include "test_lru.h"
+#include "test_ttlmap.h"
+#include "test_rebar_hashmap.h"
+#include "test_btree.h"
+#include "test_cowmap.h"
 #include "test_queue.h"
 
 
@@ -797,6 +809,164 @@ void test_list_find( void )
                struct _foo3, my_node) );
 }
 
+struct _dfoo {
+    int data;
+    rebar_dll_node_t my_node;
+};
+
+/* Checks the list holds exactly the nodes of expect, in order, both ways. */
+static void check_dll( rebar_dll_list_t *list, struct _dfoo **expect, int count )
+{
+    rebar_dll_node_t *node;
+    int i;
+
+    CU_ASSERT( (size_t) count == rebar_dll_count(list) );
+
+    node = rebar_dll_get_first( list );
+    for( i = 0; i < count; i++ ) {
+        CU_ASSERT_FATAL( NULL != node );
+        CU_ASSERT_PTR_EQUAL( &expect[i]->my_node, node );
+        node = rebar_dll_get_next( node );
+    }
+    CU_ASSERT_PTR_NULL( node );
+
+    node = rebar_dll_get_last( list );
+    for( i = count - 1; 0 <= i; i-- ) {
+        CU_ASSERT_FATAL( NULL != node );
+        CU_ASSERT_PTR_EQUAL( &expect[i]->my_node, node );
+        node = rebar_dll_get_prev( node );
+    }
+    CU_ASSERT_PTR_NULL( node );
+}
+
+void test_dlist_insert_remove( void )
+{
+    rebar_dll_list_t list;
+    struct _dfoo f[5];
+
+    rebar_dll_init( &list );
+    check_dll( &list, NULL, 0 );
+    CU_ASSERT_PTR_NULL( rebar_dll_pop_head(&list) );
+    CU_ASSERT_PTR_NULL( rebar_dll_pop_tail(&list) );
+
+    rebar_dll_append( &list, NULL );
+    rebar_dll_prepend( &list, NULL );
+    check_dll( &list, NULL, 0 );
+
+    /* 1, then 0 1 2 */
+    rebar_dll_append( &list, &f[1].my_node );
+    {
+        struct _dfoo *e[] = { &f[1] };
+        check_dll( &list, e, 1 );
+    }
+    rebar_dll_prepend( &list, &f[0].my_node );
+    rebar_dll_append( &list, &f[2].my_node );
+    {
+        struct _dfoo *e[] = { &f[0], &f[1], &f[2] };
+        check_dll( &list, e, 3 );
+    }
+
+    /* Inserting at the head and in the middle: 3 0 1 4 2 */
+    rebar_dll_insert( &list, &f[3].my_node, &f[0].my_node, REBAR_MODE__BEFORE );
+    rebar_dll_insert( &list, &f[4].my_node, &f[1].my_node, REBAR_MODE__AFTER );
+    {
+        struct _dfoo *e[] = { &f[3], &f[0], &f[1], &f[4], &f[2] };
+        check_dll( &list, e, 5 );
+    }
+    /* NULL nodes are ignored. */
+    rebar_dll_insert( &list, NULL, &f[1].my_node, REBAR_MODE__AFTER );
+    rebar_dll_insert( &list, &f[1].my_node, NULL, REBAR_MODE__AFTER );
+    CU_ASSERT( 5 == rebar_dll_count(&list) );
+
+    /* Removing from the middle and both ends. */
+    rebar_dll_remove( &list, &f[1].my_node );
+    CU_ASSERT_PTR_NULL( f[1].my_node.prev );
+    CU_ASSERT_PTR_NULL( f[1].my_node.next );
+    {
+        struct _dfoo *e[] = { &f[3], &f[0], &f[4], &f[2] };
+        check_dll( &list, e, 4 );
+    }
+    CU_ASSERT_PTR_EQUAL( &f[2].my_node, rebar_dll_pop_tail(&list) );
+    CU_ASSERT_PTR_EQUAL( &f[3].my_node, rebar_dll_pop_head(&list) );
+    {
+        struct _dfoo *e[] = { &f[0], &f[4] };
+        check_dll( &list, e, 2 );
+    }
+
+    rebar_dll_insert( &list, &f[2].my_node, &f[4].my_node, REBAR_MODE__AFTER );
+    rebar_dll_remove( &list, &f[0].my_node );
+    rebar_dll_remove( &list, &f[4].my_node );
+    {
+        struct _dfoo *e[] = { &f[2] };
+        check_dll( &list, e, 1 );
+    }
+    CU_ASSERT_PTR_EQUAL( &f[2].my_node, rebar_dll_pop_tail(&list) );
+    check_dll( &list, NULL, 0 );
+}
+
+static rebar_ll_iterator_response_t dlist_iterator( rebar_dll_node_t *node,
+                                                    void *user_data )
+{
+    struct _dfoo *f = rebar_ll_get_data( struct _dfoo, my_node, node );
+
+    IGNORE_UNUSED(user_data)
+
+    if( 3 == f->data ) {
+        return REBAR_IR__DELETE_AND_STOP;
+    }
+    if( 0 == f->data % 2 ) {
+        return REBAR_IR__DELETE_AND_CONTINUE;
+    }
+
+    return REBAR_IR__CONTINUE;
+}
+
+static void dlist_deleter( rebar_dll_node_t *node, void *user_data )
+{
+    (*((int*) user_data))++;
+    free( rebar_ll_get_data(struct _dfoo, my_node, node) );
+}
+
+static int dlist_cmp( void *needle, void *node )
+{
+    return *((int*) needle) - ((struct _dfoo*) node)->data;
+}
+
+void test_dlist_iterate( void )
+{
+    rebar_dll_list_t list;
+    int i, deleted;
+
+    rebar_dll_init( &list );
+    for( i = 0; i < 6; i++ ) {
+        struct _dfoo *f = (struct _dfoo*) malloc( sizeof(struct _dfoo) );
+
+        CU_ASSERT_FATAL( NULL != f );
+        f->data = i;
+        rebar_dll_append( &list, &f->my_node );
+    }
+
+    i = 4;
+    CU_ASSERT_PTR_EQUAL( list.tail->prev, rebar_dll_find(&list, dlist_cmp, &i,
+                         struct _dfoo, my_node) );
+    i = 9;
+    CU_ASSERT_PTR_NULL( rebar_dll_find(&list, dlist_cmp, &i, struct _dfoo, my_node) );
+
+    /* Deletes 0 and 2, keeps 1, deletes 3 and stops: 1 4 5 are left. */
+    deleted = 0;
+    rebar_dll_iterate( &list, dlist_iterator, dlist_deleter, &deleted );
+    CU_ASSERT( 3 == deleted );
+    CU_ASSERT( 3 == rebar_dll_count(&list) );
+    CU_ASSERT( 1 == rebar_ll_get_data(struct _dfoo, my_node, list.head)->data );
+    CU_ASSERT( 4 == rebar_ll_get_data(struct _dfoo, my_node, list.head->next)->data );
+    CU_ASSERT_PTR_EQUAL( list.head, list.head->next->prev );
+
+    rebar_dll_delete_all( &list, dlist_deleter, &deleted );
+    CU_ASSERT( 6 == deleted );
+    CU_ASSERT_PTR_NULL( list.head );
+    CU_ASSERT_PTR_NULL( list.tail );
+}
+
 void add_suites( CU_pSuite *suite )
 {
     *suite = CU_add_suite( "Singly Linked List Test", NULL, NULL );
@@ -814,8 +984,22 @@ void add_suites( CU_pSuite *suite )
     CU_add_test( *suite, "Test rebar_ll_count()      ", test_list_get_count );
     CU_add_test( *suite, "Test rebar_ll_find()       ", test_list_find );
     CU_add_test( *suite, "Test rebar_ll_get_data()     ", test_list_get_data );
+    CU_add_test( *suite, "Test rebar_dll insert/remove ", test_dlist_insert_remove );
+    CU_add_test( *suite, "Test rebar_dll_iterate()   ", test_dlist_iterate );
     /* Start Tests for HASHMAP */
     add_hashmap_tests(suite);
+    add_flatmap_tests(suite);
+    add_chashmap_tests(suite);
+    add_compactmap_tests(suite);
+    add_hash_tests(suite);
+    add_snapshot_tests(suite);
+    add_frozenmap_tests(suite);
+    add_shardmap_tests(suite);
+    add_lru_tests(suite);
+    add_ttlmap_tests(suite);
+    add_rebar_hashmap_tests(suite);
+    add_btree_tests(suite);
+    add_cowmap_tests(suite);
     /* Start test of Queue APIs */
     add_queue_tests(suite);
     
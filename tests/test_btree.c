@@ -0,0 +1,257 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include <stdbool.h>
+
+#include "../src/cvs-btree.h"
+#include "test_btree.h"
+#include "general.h"
+
+#define RANDOM_KEYS     20000
+
+typedef struct {
+    uint64_t last;
+    size_t count;
+    size_t limit;               /* stop after this many, 0 for no limit */
+} walk_t;
+
+static bool walk(uint64_t key, void *value, void *user_data)
+{
+    walk_t *w = (walk_t*) user_data;
+
+    CU_ASSERT((uintptr_t) value == key + 1);
+    if (0 < w->count) {
+        CU_ASSERT(w->last < key);
+    }
+    w->last = key;
+    w->count++;
+
+    return (0 == w->limit) || (w->count < w->limit);
+}
+
+static uint64_t __xorshift(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* Checks the whole tree against a reference of which keys are present. */
+static void check_tree(cvs_btree_t *btree, const bool *present, uint64_t *state)
+{
+    cvs_btree_cursor_t cursor;
+    walk_t w;
+    uint64_t k, key;
+    size_t expected, i;
+    void *value;
+
+    expected = 0;
+    for (k = 0; k < RANDOM_KEYS; k++) {
+        if (present[k]) {
+            expected++;
+        }
+    }
+    CU_ASSERT(expected == cvs_btree_get_size(btree));
+
+    memset(&w, 0, sizeof(w));
+    cvs_btree_iterate(btree, walk, &w);
+    CU_ASSERT(expected == w.count);
+
+    for (i = 0; i < 200; i++) {
+        uint64_t from = __xorshift(state) % (RANDOM_KEYS + 10);
+        uint64_t to = from + __xorshift(state) % 500;
+        size_t in_range = 0;
+
+        for (k = from; k < to && k < RANDOM_KEYS; k++) {
+            if (present[k]) {
+                in_range++;
+            }
+        }
+        memset(&w, 0, sizeof(w));
+        cvs_btree_range(btree, from, to, walk, &w);
+        CU_ASSERT(in_range == w.count);
+
+        /* The lower bound is the first present key at or after from. */
+        for (k = from; k < RANDOM_KEYS && !present[k]; k++) {
+        }
+        CU_ASSERT((k < RANDOM_KEYS) == cvs_btree_lower_bound(btree, from, &cursor));
+        if (k < RANDOM_KEYS) {
+            CU_ASSERT(true == cvs_btree_cursor_next(&cursor, &key, &value));
+            CU_ASSERT(k == key);
+            CU_ASSERT((uintptr_t) value == k + 1);
+        }
+
+        for (k = from + 1; k < RANDOM_KEYS && !present[k]; k++) {
+        }
+        CU_ASSERT((k < RANDOM_KEYS) == cvs_btree_upper_bound(btree, from, &cursor));
+        if (k < RANDOM_KEYS) {
+            CU_ASSERT(true == cvs_btree_cursor_next(&cursor, &key, NULL));
+            CU_ASSERT(k == key);
+        }
+    }
+}
+
+void btree_basic(void)
+{
+    cvs_btree_t btree;
+    cvs_btree_cursor_t cursor;
+    walk_t w;
+    uint64_t key;
+    void *value;
+
+    CU_ASSERT(false == cvs_btree_init(NULL));
+    CU_ASSERT(NULL == cvs_btree_put(NULL, 1, (void*) 2));
+    CU_ASSERT(NULL == cvs_btree_get(NULL, 1));
+    CU_ASSERT(0 == cvs_btree_get_size(NULL));
+
+    CU_ASSERT(true == cvs_btree_init(&btree));
+    CU_ASSERT(NULL == cvs_btree_get(&btree, 1));
+    CU_ASSERT(NULL == cvs_btree_remove(&btree, 1));
+    CU_ASSERT(false == cvs_btree_lower_bound(&btree, 0, &cursor));
+    CU_ASSERT(false == cvs_btree_cursor_next(&cursor, &key, &value));
+
+    CU_ASSERT(NULL == cvs_btree_put(&btree, 10, (void*) 11));
+    CU_ASSERT(NULL == cvs_btree_put(&btree, 30, (void*) 31));
+    CU_ASSERT(NULL == cvs_btree_put(&btree, 20, (void*) 20));
+    CU_ASSERT((void*) 20 == cvs_btree_put(&btree, 20, (void*) 21));
+    CU_ASSERT(3 == cvs_btree_get_size(&btree));
+    CU_ASSERT((void*) 21 == cvs_btree_get(&btree, 20));
+    CU_ASSERT(true == cvs_btree_contains_key(&btree, 30));
+    CU_ASSERT(false == cvs_btree_contains_key(&btree, 25));
+
+    /* The next key after 10 is 20, the first at or after 11 is 20 too. */
+    CU_ASSERT(true == cvs_btree_upper_bound(&btree, 10, &cursor));
+    CU_ASSERT(true == cvs_btree_cursor_next(&cursor, &key, &value));
+    CU_ASSERT(20 == key);
+    CU_ASSERT(true == cvs_btree_cursor_next(&cursor, &key, &value));
+    CU_ASSERT(30 == key);
+    CU_ASSERT(false == cvs_btree_cursor_next(&cursor, &key, &value));
+    CU_ASSERT(true == cvs_btree_lower_bound(&btree, 11, &cursor));
+    CU_ASSERT(true == cvs_btree_cursor_next(&cursor, &key, NULL));
+    CU_ASSERT(20 == key);
+    CU_ASSERT(false == cvs_btree_lower_bound(&btree, 31, &cursor));
+    CU_ASSERT(false == cvs_btree_upper_bound(&btree, 30, &cursor));
+
+    /* The range is half open, and an empty or backwards range visits none. */
+    memset(&w, 0, sizeof(w));
+    cvs_btree_range(&btree, 10, 30, walk, &w);
+    CU_ASSERT(2 == w.count);
+    CU_ASSERT(20 == w.last);
+    memset(&w, 0, sizeof(w));
+    cvs_btree_range(&btree, 30, 10, walk, &w);
+    cvs_btree_range(&btree, 20, 20, walk, &w);
+    CU_ASSERT(0 == w.count);
+
+    /* The largest key has nothing after it. */
+    CU_ASSERT(NULL == cvs_btree_put(&btree, UINT64_MAX, (void*) 0));
+    CU_ASSERT(false == cvs_btree_upper_bound(&btree, UINT64_MAX, &cursor));
+    CU_ASSERT(true == cvs_btree_upper_bound(&btree, 30, &cursor));
+    CU_ASSERT(true == cvs_btree_cursor_next(&cursor, &key, NULL));
+    CU_ASSERT(UINT64_MAX == key);
+    CU_ASSERT(NULL == cvs_btree_remove(&btree, UINT64_MAX));
+
+    CU_ASSERT((void*) 11 == cvs_btree_remove(&btree, 10));
+    CU_ASSERT(NULL == cvs_btree_remove(&btree, 10));
+    CU_ASSERT((void*) 21 == cvs_btree_remove(&btree, 20));
+    CU_ASSERT((void*) 31 == cvs_btree_remove(&btree, 30));
+    CU_ASSERT(0 == cvs_btree_get_size(&btree));
+    CU_ASSERT(false == cvs_btree_lower_bound(&btree, 0, &cursor));
+
+    cvs_btree_destroy(&btree);
+}
+
+void btree_sequential(void)
+{
+    cvs_btree_t btree;
+    walk_t w;
+    uint64_t k;
+
+    /* Ascending and descending loads split only one edge of the tree. */
+    CU_ASSERT(true == cvs_btree_init(&btree));
+    for (k = 0; k < 100000; k++) {
+        cvs_btree_put(&btree, k, (void*) (uintptr_t) (k + 1));
+    }
+    for (k = 200000; k >= 100000; k--) {
+        cvs_btree_put(&btree, k, (void*) (uintptr_t) (k + 1));
+    }
+    CU_ASSERT(200001 == cvs_btree_get_size(&btree));
+
+    memset(&w, 0, sizeof(w));
+    cvs_btree_iterate(&btree, walk, &w);
+    CU_ASSERT(200001 == w.count);
+    CU_ASSERT(200000 == w.last);
+
+    memset(&w, 0, sizeof(w));
+    w.limit = 10;
+    cvs_btree_range(&btree, 5000, 6000, walk, &w);
+    CU_ASSERT(10 == w.count);
+    CU_ASSERT(5009 == w.last);
+
+    /* Emptying from the front merges all the way up to the root. */
+    for (k = 0; k <= 200000; k++) {
+        CU_ASSERT((void*) (uintptr_t) (k + 1) == cvs_btree_remove(&btree, k));
+    }
+    CU_ASSERT(0 == cvs_btree_get_size(&btree));
+    CU_ASSERT(NULL == btree.root);
+
+    /* Destroy frees a tree that still holds keys. */
+    for (k = 0; k < 1000; k++) {
+        cvs_btree_put(&btree, k * 3, (void*) (uintptr_t) (k * 3 + 1));
+    }
+    for (k = 0; k < 1000; k += 2) {
+        cvs_btree_remove(&btree, k * 3);
+    }
+    CU_ASSERT(500 == cvs_btree_get_size(&btree));
+    cvs_btree_destroy(&btree);
+    CU_ASSERT(0 == cvs_btree_get_size(&btree));
+}
+
+void btree_random(void)
+{
+    cvs_btree_t btree;
+    bool *present;
+    uint64_t state;
+    size_t round, i;
+
+    present = (bool*) calloc(RANDOM_KEYS, sizeof(bool));
+    state = 88172645463325252ULL;
+
+    CU_ASSERT(true == cvs_btree_init(&btree));
+    for (round = 0; round < 30; round++) {
+        /* Alternate growing and shrinking phases so nodes both split and
+         * merge at every level. */
+        unsigned put_percent = (round % 3 == 2) ? 20 : 70;
+
+        for (i = 0; i < 20000; i++) {
+            uint64_t r = __xorshift(&state);
+            uint64_t k = r % RANDOM_KEYS;
+
+            if ((r >> 32) % 100 < put_percent) {
+                void *old = cvs_btree_put(&btree, k, (void*) (uintptr_t) (k + 1));
+
+                CU_ASSERT((present[k] ? (void*) (uintptr_t) (k + 1) : NULL) == old);
+                present[k] = true;
+            } else {
+                void *old = cvs_btree_remove(&btree, k);
+
+                CU_ASSERT((present[k] ? (void*) (uintptr_t) (k + 1) : NULL) == old);
+                present[k] = false;
+            }
+        }
+        check_tree(&btree, present, &state);
+    }
+
+    cvs_btree_destroy(&btree);
+    free(present);
+}
+
+
+void add_btree_tests(CU_pSuite *suite)
+{
+    CU_add_test(*suite, "btree basic", btree_basic);
+    CU_add_test(*suite, "btree sequential", btree_sequential);
+    CU_add_test(*suite, "btree random", btree_random);
+}
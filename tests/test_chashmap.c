@@ -0,0 +1,226 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <CUnit/Basic.h>
+#include <stdbool.h>
+
+#include "../src/cvs-chashmap.h"
+#include "test_chashmap.h"
+#include "general.h"
+
+#define STRESS_WRITERS      4
+#define STRESS_READERS      4
+#define STRESS_KEYS         4096    /* per writer */
+#define STRESS_ROUNDS       8
+#define STRESS_STABLE_KEYS  1024
+#define CHURN_KEYS          65536
+
+typedef struct {
+    cvs_chashmap_t *map;
+    uint64_t *keys;
+    size_t count;
+    int *done;
+    size_t errors;
+} stress_arg_t;
+
+void chash_simple_string(void)
+{
+    cvs_chashmap_t map;
+    uint32_t bar[3];
+    char key[8];
+
+    CU_ASSERT(true  == cvs_chashmap_init(&map, CHT__STRING));
+
+    CU_ASSERT(true  == cvs_chashmap_is_empty(&map));
+    CU_ASSERT(NULL  == cvs_chashmap_get(&map, "foo"));
+    CU_ASSERT(false == cvs_chashmap_contains_key(&map, "foo"));
+    CU_ASSERT(NULL  == cvs_chashmap_remove(&map, "foo"));
+
+    cvs_chashmap_put(&map, "foo", &bar[0]);
+    cvs_chashmap_put(&map, "car", &bar[1]);
+    cvs_chashmap_put(&map, "foo", &bar[2]);
+
+    strcpy(key, "foo");
+    CU_ASSERT(2       == cvs_chashmap_get_size(&map));
+    CU_ASSERT(&bar[2] == cvs_chashmap_get(&map, key));
+    CU_ASSERT(&bar[1] == cvs_chashmap_get(&map, "car"));
+    CU_ASSERT(true    == cvs_chashmap_contains_key(&map, "car"));
+
+    CU_ASSERT(&bar[2] == cvs_chashmap_remove(&map, "foo"));
+    CU_ASSERT(NULL    == cvs_chashmap_get(&map, "foo"));
+    CU_ASSERT(1       == cvs_chashmap_get_size(&map));
+
+    cvs_chashmap_destroy(&map);
+}
+
+void chash_boundary(void)
+{
+    cvs_chashmap_t map;
+
+    CU_ASSERT(false == cvs_chashmap_init(NULL, CHT__STRING));
+    CU_ASSERT(false == cvs_chashmap_init(&map, (cvs_hashmap_type_t) 99));
+    CU_ASSERT(true  == cvs_chashmap_init(&map, CHT__UINT32));
+
+    cvs_chashmap_destroy(NULL);
+    cvs_chashmap_iterate(NULL, NULL, NULL);
+    cvs_chashmap_put(&map, NULL, NULL);
+    CU_ASSERT(0     == cvs_chashmap_get_size(NULL));
+    CU_ASSERT(0     == cvs_chashmap_get_slots(NULL));
+    CU_ASSERT(0     == cvs_chashmap_get_slots(&map));
+    CU_ASSERT(false == cvs_chashmap_contains_key(NULL, NULL));
+    CU_ASSERT(false == cvs_chashmap_contains_key(&map, NULL));
+
+    cvs_chashmap_destroy(&map);
+}
+
+void chash_churn(void)
+{
+    cvs_chashmap_t map;
+    uint64_t key, next;
+
+    CU_ASSERT_FATAL(true == cvs_chashmap_init(&map, CHT__UINT64));
+
+    /* Replace a single key with a new one over and over.  No stripe ever
+     * holds more than one key, so none should need more than its first,
+     * smallest (8 slot) table no matter how many deleted slots pile up. */
+    key = 0;
+    cvs_chashmap_put(&map, &key, (void*) 1);
+    for (key = 0; key < CHURN_KEYS; key++) {
+        next = key + 1;
+        CU_ASSERT((void*) (uintptr_t) (key + 1) == cvs_chashmap_remove(&map, &key));
+        cvs_chashmap_put(&map, &next, (void*) (uintptr_t) (next + 1));
+    }
+
+    CU_ASSERT(1 == cvs_chashmap_get_size(&map));
+    CU_ASSERT((void*) (uintptr_t) (CHURN_KEYS + 1) == cvs_chashmap_get(&map, &key));
+    CU_ASSERT(CVSCHM_STRIPES * 8 >= cvs_chashmap_get_slots(&map));
+
+    cvs_chashmap_destroy(&map);
+}
+
+static void *stress_writer(void *p)
+{
+    stress_arg_t *arg = (stress_arg_t*) p;
+    size_t round, i;
+
+    /* Fill and drain our own key range over and over so every stripe keeps
+     * resizing and collecting tombstones while the readers run. */
+    for (round = 0; round < STRESS_ROUNDS; round++) {
+        for (i = 0; i < arg->count; i++) {
+            cvs_chashmap_put(arg->map, &arg->keys[i], &arg->keys[i]);
+        }
+        for (i = 0; i < arg->count; i++) {
+            if (&arg->keys[i] != cvs_chashmap_get(arg->map, &arg->keys[i])) {
+                arg->errors++;
+            }
+        }
+        if (STRESS_ROUNDS - 1 == round) {
+            break;
+        }
+        for (i = 0; i < arg->count; i++) {
+            if (&arg->keys[i] != cvs_chashmap_remove(arg->map, &arg->keys[i])) {
+                arg->errors++;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void *stress_reader(void *p)
+{
+    stress_arg_t *arg = (stress_arg_t*) p;
+    size_t i;
+
+    /* The stable keys are never changed, so every read must see them. */
+    while (0 == __atomic_load_n(arg->done, __ATOMIC_ACQUIRE)) {
+        for (i = 0; i < arg->count; i++) {
+            if (&arg->keys[i] != cvs_chashmap_get(arg->map, &arg->keys[i])) {
+                arg->errors++;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static bool stress_iterator(void *key, void *value, void *user_data)
+{
+    IGNORE_UNUSED(key)
+    IGNORE_UNUSED(value)
+
+    (*((size_t*) user_data))++;
+
+    return true;
+}
+
+void chash_stress(void)
+{
+    cvs_chashmap_t map;
+    pthread_t writers[STRESS_WRITERS], readers[STRESS_READERS];
+    stress_arg_t wargs[STRESS_WRITERS], rargs[STRESS_READERS];
+    uint64_t *keys;
+    int done;
+    size_t i, seen;
+
+    keys = (uint64_t*) malloc((STRESS_WRITERS * STRESS_KEYS + STRESS_STABLE_KEYS) * sizeof(uint64_t));
+    CU_ASSERT_FATAL(NULL != keys);
+    for (i = 0; i < STRESS_WRITERS * STRESS_KEYS + STRESS_STABLE_KEYS; i++) {
+        keys[i] = i;
+    }
+
+    CU_ASSERT_FATAL(true == cvs_chashmap_init(&map, CHT__UINT64));
+
+    for (i = 0; i < STRESS_STABLE_KEYS; i++) {
+        cvs_chashmap_put(&map, &keys[STRESS_WRITERS * STRESS_KEYS + i],
+                         &keys[STRESS_WRITERS * STRESS_KEYS + i]);
+    }
+
+    done = 0;
+    for (i = 0; i < STRESS_READERS; i++) {
+        rargs[i].map = &map;
+        rargs[i].keys = &keys[STRESS_WRITERS * STRESS_KEYS];
+        rargs[i].count = STRESS_STABLE_KEYS;
+        rargs[i].done = &done;
+        rargs[i].errors = 0;
+        pthread_create(&readers[i], NULL, stress_reader, &rargs[i]);
+    }
+    for (i = 0; i < STRESS_WRITERS; i++) {
+        wargs[i].map = &map;
+        wargs[i].keys = &keys[i * STRESS_KEYS];
+        wargs[i].count = STRESS_KEYS;
+        wargs[i].done = &done;
+        wargs[i].errors = 0;
+        pthread_create(&writers[i], NULL, stress_writer, &wargs[i]);
+    }
+
+    for (i = 0; i < STRESS_WRITERS; i++) {
+        pthread_join(writers[i], NULL);
+        CU_ASSERT(0 == wargs[i].errors);
+    }
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+    for (i = 0; i < STRESS_READERS; i++) {
+        pthread_join(readers[i], NULL);
+        CU_ASSERT(0 == rargs[i].errors);
+    }
+
+    CU_ASSERT(STRESS_WRITERS * STRESS_KEYS + STRESS_STABLE_KEYS == cvs_chashmap_get_size(&map));
+
+    seen = 0;
+    cvs_chashmap_iterate(&map, stress_iterator, &seen);
+    CU_ASSERT(STRESS_WRITERS * STRESS_KEYS + STRESS_STABLE_KEYS == seen);
+
+    cvs_chashmap_destroy(&map);
+    free(keys);
+}
+
+
+void add_chashmap_tests(CU_pSuite *suite)
+{
+    CU_add_test(*suite, "chashmap string", chash_simple_string);
+    CU_add_test(*suite, "chashmap Boundary tests", chash_boundary);
+    CU_add_test(*suite, "chashmap tombstone churn", chash_churn);
+    CU_add_test(*suite, "chashmap multi-threaded stress", chash_stress);
+}
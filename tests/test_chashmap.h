@@ -0,0 +1,17 @@
+#ifndef __TEST_CHASHMAP_H__
+#define __TEST_CHASHMAP_H__
+
+
+#include <CUnit/Basic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void add_chashmap_tests(CU_pSuite *suite);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,174 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include <stdbool.h>
+
+#include "../src/cvs-compactmap.h"
+#include "test_compactmap.h"
+#include "general.h"
+
+typedef struct {
+    uint32_t seen;
+    uint32_t last;
+    bool ordered;
+} order_check_t;
+
+static bool compact_order_iterator(void *key, void *value, void *user_data)
+{
+    order_check_t *check = (order_check_t*) user_data;
+    uint32_t position = *((uint32_t*) value);
+
+    /* The values are the insertion positions, so they must only go up. */
+    CU_ASSERT(CVSHM_KEY_TO_UINT64(key) == (uint64_t) position * 7919);
+    if ((0 != check->seen) && (position <= check->last)) {
+        check->ordered = false;
+    }
+    check->last = position;
+    check->seen++;
+
+    return true;
+}
+
+static bool compact_stop_iterator(void *key, void *value, void *user_data)
+{
+    IGNORE_UNUSED(key);
+    IGNORE_UNUSED(value);
+    (*((int*) user_data))++;
+
+    return false;
+}
+
+void compact_simple_string(void)
+{
+    cvs_compactmap_t map;
+    char *keys[3] = { "one", "two", "three" };
+    uint32_t bar[3];
+    int calls;
+
+    CU_ASSERT(true  == cvs_compactmap_init(&map, CHT__STRING));
+    CU_ASSERT(true  == cvs_compactmap_is_empty(&map));
+    CU_ASSERT(NULL  == cvs_compactmap_get(&map, "one"));
+    CU_ASSERT(NULL  == cvs_compactmap_remove(&map, "one"));
+
+    cvs_compactmap_put(&map, keys[0], &bar[0]);
+    cvs_compactmap_put(&map, keys[1], &bar[1]);
+    cvs_compactmap_put(&map, keys[2], &bar[2]);
+    cvs_compactmap_put(&map, "two", &bar[0]);
+
+    CU_ASSERT(3       == cvs_compactmap_get_size(&map));
+    CU_ASSERT(&bar[0] == cvs_compactmap_get(&map, "one"));
+    CU_ASSERT(&bar[0] == cvs_compactmap_get(&map, "two"));
+    CU_ASSERT(&bar[2] == cvs_compactmap_get(&map, "three"));
+    CU_ASSERT(false   == cvs_compactmap_contains_key(&map, "four"));
+
+    CU_ASSERT(&bar[0] == cvs_compactmap_remove(&map, "one"));
+    CU_ASSERT(false   == cvs_compactmap_contains_key(&map, "one"));
+    CU_ASSERT(true    == cvs_compactmap_contains_key(&map, "two"));
+    CU_ASSERT(2       == cvs_compactmap_get_size(&map));
+
+    calls = 0;
+    cvs_compactmap_iterate(&map, compact_stop_iterator, &calls);
+    CU_ASSERT(1 == calls);
+
+    cvs_compactmap_destroy(&map);
+    CU_ASSERT(true == cvs_compactmap_is_empty(&map));
+}
+
+#define COMPACT_KEYS 100000
+void compact_order_uint64(void)
+{
+    cvs_compactmap_t map;
+    uint64_t *keys;
+    uint32_t *positions;
+    order_check_t check;
+    uint32_t i;
+
+    keys = (uint64_t*) malloc(COMPACT_KEYS * sizeof(uint64_t));
+    positions = (uint32_t*) malloc(COMPACT_KEYS * sizeof(uint32_t));
+    CU_ASSERT_FATAL((NULL != keys) && (NULL != positions));
+
+    CU_ASSERT(true == cvs_compactmap_init(&map, CHT__UINT64));
+
+    /* Enough keys to go through every index width. */
+    for (i = 0; i < COMPACT_KEYS; i++) {
+        keys[i] = (uint64_t) i * 7919;
+        positions[i] = i;
+        cvs_compactmap_put(&map, &keys[i], &positions[i]);
+    }
+    CU_ASSERT(COMPACT_KEYS == cvs_compactmap_get_size(&map));
+    CU_ASSERT(4 == map.index_width);
+
+    /* Holes from removals are skipped, then squeezed out by a rebuild. */
+    for (i = 0; i < COMPACT_KEYS; i++) {
+        if (0 != (i % 4)) {
+            CU_ASSERT(&positions[i] == cvs_compactmap_remove(&map, &keys[i]));
+        }
+    }
+    for (i = 0; i < COMPACT_KEYS; i++) {
+        CU_ASSERT(((0 == (i % 4)) ? &positions[i] : NULL) ==
+                  cvs_compactmap_get(&map, &keys[i]));
+    }
+
+    memset(&check, 0, sizeof(check));
+    check.ordered = true;
+    cvs_compactmap_iterate(&map, compact_order_iterator, &check);
+    CU_ASSERT(COMPACT_KEYS / 4 == check.seen);
+    CU_ASSERT(true == check.ordered);
+
+    /* Re-adding the removed keys appends them after the survivors. */
+    for (i = 0; i < COMPACT_KEYS; i++) {
+        if (0 != (i % 4)) {
+            cvs_compactmap_put(&map, &keys[i], &positions[i]);
+        }
+    }
+    CU_ASSERT(COMPACT_KEYS == cvs_compactmap_get_size(&map));
+    for (i = 0; i < COMPACT_KEYS; i++) {
+        CU_ASSERT(&positions[i] == cvs_compactmap_get(&map, &keys[i]));
+    }
+
+    memset(&check, 0, sizeof(check));
+    check.ordered = true;
+    cvs_compactmap_iterate(&map, compact_order_iterator, &check);
+    CU_ASSERT(COMPACT_KEYS == check.seen);
+    CU_ASSERT(false == check.ordered);
+
+    cvs_compactmap_destroy(&map);
+    free(keys);
+    free(positions);
+}
+
+void compact_boundary(void)
+{
+    cvs_compactmap_t map;
+    uint32_t key = 5;
+
+    CU_ASSERT(false == cvs_compactmap_init(NULL, CHT__UINT32));
+    CU_ASSERT(false == cvs_compactmap_init(&map, CHT__BLOB));
+    CU_ASSERT(true  == cvs_compactmap_init(&map, CHT__UINT32));
+
+    cvs_compactmap_destroy(NULL);
+    cvs_compactmap_iterate(NULL, NULL, NULL);
+    cvs_compactmap_iterate(&map, NULL, NULL);
+    cvs_compactmap_put(&map, NULL, NULL);
+    CU_ASSERT(0     == cvs_compactmap_get_size(NULL));
+    CU_ASSERT(false == cvs_compactmap_contains_key(NULL, NULL));
+    CU_ASSERT(false == cvs_compactmap_contains_key(&map, NULL));
+    CU_ASSERT(NULL  == cvs_compactmap_get(&map, NULL));
+    CU_ASSERT(NULL  == cvs_compactmap_remove(&map, NULL));
+
+    cvs_compactmap_put(&map, &key, &key);
+    CU_ASSERT(1 == map.index_width);
+    CU_ASSERT(&key == cvs_compactmap_get(&map, &key));
+
+    cvs_compactmap_destroy(&map);
+}
+
+
+void add_compactmap_tests(CU_pSuite *suite)
+{
+    CU_add_test(*suite, "compactmap string", compact_simple_string);
+    CU_add_test(*suite, "compactmap uint64_t insertion order", compact_order_uint64);
+    CU_add_test(*suite, "compactmap Boundary tests", compact_boundary);
+}
@@ -0,0 +1,215 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <CUnit/Basic.h>
+#include <stdbool.h>
+
+#include "../src/cvs-cowmap.h"
+#include "test_cowmap.h"
+#include "general.h"
+
+#define STRESS_READERS      3
+#define STRESS_KEYS         256
+#define STRESS_VERSIONS     200
+
+typedef struct {
+    cvs_cowmap_t *cowmap;
+    int *done;
+    size_t errors;
+} stress_arg_t;
+
+static void count_retired(cvs_hashmap_t *version, void *user_data)
+{
+    IGNORE_UNUSED(version)
+
+    (*((size_t*) user_data))++;
+}
+
+static cvs_hashmap_t *new_version(void)
+{
+    cvs_hashmap_t *version = (cvs_hashmap_t*) malloc(sizeof(cvs_hashmap_t));
+
+    cvs_hashmap_init_ex(version, CHT__UINT64, CHF__INCREMENTAL_REHASH);
+
+    return version;
+}
+
+void cowmap_basic(void)
+{
+    cvs_cowmap_t cowmap;
+    cvs_cowmap_reader_t *r1, *r2;
+    cvs_hashmap_t *v1, *v2, *held;
+    uint64_t key;
+    size_t retired;
+
+    CU_ASSERT(false == cvs_cowmap_init(NULL, 1, NULL, NULL));
+    CU_ASSERT(false == cvs_cowmap_init(&cowmap, 0, NULL, NULL));
+
+    retired = 0;
+    CU_ASSERT(true == cvs_cowmap_init(&cowmap, 2, count_retired, &retired));
+    CU_ASSERT(false == cvs_cowmap_publish(&cowmap, NULL));
+    CU_ASSERT(NULL == cvs_cowmap_copy(&cowmap));
+
+    /* Only two slots. */
+    r1 = cvs_cowmap_reader_new(&cowmap);
+    r2 = cvs_cowmap_reader_new(&cowmap);
+    CU_ASSERT(NULL != r1);
+    CU_ASSERT(NULL != r2);
+    CU_ASSERT(r1 != r2);
+    CU_ASSERT(NULL == cvs_cowmap_reader_new(&cowmap));
+    CU_ASSERT(NULL == cvs_cowmap_acquire(r1));
+    cvs_cowmap_release(r1);
+
+    v1 = new_version();
+    for (key = 0; key < 1000; key++) {
+        cvs_hashmap_put(v1, &key, (void*) (uintptr_t) (key + 1));
+    }
+    CU_ASSERT(true == cvs_cowmap_publish(&cowmap, v1));
+    CU_ASSERT(NULL == v1->old_buckets);
+    CU_ASSERT(v1 == cvs_cowmap_acquire(r1));
+
+    /* Publishing the current version again is refused, it stays current. */
+    CU_ASSERT(false == cvs_cowmap_publish(&cowmap, v1));
+    CU_ASSERT(0 == cvs_cowmap_reclaim(&cowmap));
+    CU_ASSERT(0 == retired);
+    CU_ASSERT(v1 == cvs_cowmap_acquire(r2));
+    key = 7;
+    CU_ASSERT((void*) 8 == cvs_hashmap_get(v1, &key));
+    cvs_cowmap_release(r2);
+
+    /* The copy is private until published, and a reader keeps the version
+     * it acquired. */
+    v2 = cvs_cowmap_copy(&cowmap);
+    CU_ASSERT_FATAL(NULL != v2);
+    CU_ASSERT(v1 != v2);
+    key = 7;
+    CU_ASSERT((void*) 8 == cvs_hashmap_remove(v2, &key));
+    CU_ASSERT((void*) 8 == cvs_hashmap_get(v1, &key));
+    CU_ASSERT(true == cvs_cowmap_publish(&cowmap, v2));
+    CU_ASSERT(0 == retired);
+    CU_ASSERT(1 == cvs_cowmap_reclaim(&cowmap));
+    CU_ASSERT((void*) 8 == cvs_hashmap_get(v1, &key));
+    CU_ASSERT(1000 == cvs_hashmap_get_size(v1));
+
+    held = cvs_cowmap_acquire(r2);
+    CU_ASSERT(v2 == held);
+    CU_ASSERT(NULL == cvs_hashmap_get(held, &key));
+
+    /* Acquiring again lets go of the old version. */
+    CU_ASSERT(v2 == cvs_cowmap_acquire(r1));
+    CU_ASSERT(0 == cvs_cowmap_reclaim(&cowmap));
+    CU_ASSERT(1 == retired);
+
+    cvs_cowmap_release(r1);
+    cvs_cowmap_release(r2);
+    cvs_cowmap_reader_free(r2);
+    CU_ASSERT(r2 == cvs_cowmap_reader_new(&cowmap));
+    cvs_cowmap_reader_free(r1);
+    cvs_cowmap_reader_free(r2);
+
+    /* Versions nobody holds are freed as soon as they are replaced. */
+    CU_ASSERT(true == cvs_cowmap_publish(&cowmap, cvs_cowmap_copy(&cowmap)));
+    CU_ASSERT(2 == retired);
+
+    cvs_cowmap_destroy(&cowmap);
+    CU_ASSERT(3 == retired);
+}
+
+static void *stress_reader(void *p)
+{
+    stress_arg_t *arg = (stress_arg_t*) p;
+    cvs_cowmap_reader_t *reader;
+    uintptr_t last = 0;
+
+    reader = cvs_cowmap_reader_new(arg->cowmap);
+    if (NULL == reader) {
+        arg->errors++;
+        return NULL;
+    }
+
+    /* Every key of a version has the same value, and versions only move
+     * forward. */
+    while (0 == __atomic_load_n(arg->done, __ATOMIC_ACQUIRE)) {
+        cvs_hashmap_t *version;
+        uintptr_t first;
+        uint64_t key;
+
+        version = cvs_cowmap_acquire(reader);
+        key = 0;
+        first = (uintptr_t) cvs_hashmap_get(version, &key);
+        if (first < last) {
+            arg->errors++;
+        }
+        for (key = 1; key < STRESS_KEYS; key++) {
+            if (first != (uintptr_t) cvs_hashmap_get(version, &key)) {
+                arg->errors++;
+            }
+        }
+        last = first;
+        cvs_cowmap_release(reader);
+    }
+    cvs_cowmap_reader_free(reader);
+
+    return NULL;
+}
+
+void cowmap_stress(void)
+{
+    cvs_cowmap_t cowmap;
+    cvs_hashmap_t *version;
+    pthread_t readers[STRESS_READERS];
+    stress_arg_t args[STRESS_READERS];
+    uint64_t key;
+    size_t i, retired;
+    int done;
+
+    retired = 0;
+    CU_ASSERT_FATAL(true == cvs_cowmap_init(&cowmap, STRESS_READERS, count_retired, &retired));
+    version = new_version();
+    for (key = 0; key < STRESS_KEYS; key++) {
+        cvs_hashmap_put(version, &key, (void*) 1);
+    }
+    CU_ASSERT(true == cvs_cowmap_publish(&cowmap, version));
+
+    done = 0;
+    for (i = 0; i < STRESS_READERS; i++) {
+        args[i].cowmap = &cowmap;
+        args[i].done = &done;
+        args[i].errors = 0;
+        pthread_create(&readers[i], NULL, stress_reader, &args[i]);
+    }
+
+    for (i = 2; i <= STRESS_VERSIONS; i++) {
+        version = cvs_cowmap_copy(&cowmap);
+        CU_ASSERT_FATAL(NULL != version);
+        for (key = 0; key < STRESS_KEYS; key++) {
+            cvs_hashmap_put(version, &key, (void*) (uintptr_t) i);
+        }
+        CU_ASSERT(true == cvs_cowmap_publish(&cowmap, version));
+        if (0 == i % 16) {
+            sched_yield();
+        }
+    }
+
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+    for (i = 0; i < STRESS_READERS; i++) {
+        pthread_join(readers[i], NULL);
+        CU_ASSERT(0 == args[i].errors);
+    }
+
+    /* With every reader gone, only the current version is left. */
+    CU_ASSERT(0 == cvs_cowmap_reclaim(&cowmap));
+    CU_ASSERT(STRESS_VERSIONS - 1 == retired);
+    cvs_cowmap_destroy(&cowmap);
+    CU_ASSERT(STRESS_VERSIONS == retired);
+}
+
+
+void add_cowmap_tests(CU_pSuite *suite)
+{
+    CU_add_test(*suite, "cowmap basic", cowmap_basic);
+    CU_add_test(*suite, "cowmap multi-threaded readers", cowmap_stress);
+}
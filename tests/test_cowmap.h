@@ -0,0 +1,17 @@
+#ifndef __TEST_COWMAP_H__
+#define __TEST_COWMAP_H__
+
+
+#include <CUnit/Basic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void add_cowmap_tests(CU_pSuite *suite);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,130 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include <stdbool.h>
+
+#include "../src/cvs-flatmap.h"
+#include "test_flatmap.h"
+#include "general.h"
+
+static bool flat_uint32_iterator(void *key, void *value, void *user_data)
+{
+    uint32_t *seen = (uint32_t*) user_data;
+
+    CU_ASSERT(CVSHM_KEY_TO_UINT32(key) == *((uint32_t*) value));
+    (*seen)++;
+
+    return true;
+}
+
+void flat_simple_uint64(void)
+{
+    cvs_flatmap_t map;
+    uint64_t keys[3];
+    uint32_t bar[3];
+
+    keys[0] = 20;
+    keys[1] = 21;
+    keys[2] = 0xffffffff00000014ULL;   /* low 32 bits match keys[0] */
+
+    bar[0] = 10;
+    bar[1] = 11;
+    bar[2] = 12;
+
+    CU_ASSERT(true  == cvs_flatmap_init(&map, CHT__UINT64));
+
+    CU_ASSERT(true  == cvs_flatmap_is_empty(&map));
+    CU_ASSERT(NULL  == cvs_flatmap_get(&map, &keys[0]));
+    CU_ASSERT(false == cvs_flatmap_contains_key(&map, &keys[0]));
+    CU_ASSERT(NULL  == cvs_flatmap_remove(&map, &keys[0]));
+
+    cvs_flatmap_put(&map, &keys[0], &bar[0]);
+    cvs_flatmap_put(&map, &keys[1], &bar[1]);
+    cvs_flatmap_put(&map, &keys[2], &bar[2]);
+    cvs_flatmap_put(&map, &keys[1], &bar[0]);
+
+    CU_ASSERT(3       == cvs_flatmap_get_size(&map));
+    CU_ASSERT(&bar[0] == cvs_flatmap_get(&map, &keys[0]));
+    CU_ASSERT(&bar[0] == cvs_flatmap_get(&map, &keys[1]));
+    CU_ASSERT(&bar[2] == cvs_flatmap_get(&map, &keys[2]));
+
+    CU_ASSERT(&bar[0] == cvs_flatmap_remove(&map, &keys[0]));
+    CU_ASSERT(NULL    == cvs_flatmap_get(&map, &keys[0]));
+    CU_ASSERT(true    == cvs_flatmap_contains_key(&map, &keys[2]));
+    CU_ASSERT(2       == cvs_flatmap_get_size(&map));
+
+    cvs_flatmap_destroy(&map);
+    CU_ASSERT(true == cvs_flatmap_is_empty(&map));
+}
+
+#define FLAT_KEYS 50000
+void flat_churn_uint32(void)
+{
+    cvs_flatmap_t map;
+    uint32_t *keys;
+    uint32_t i, seen;
+
+    keys = (uint32_t*) malloc(FLAT_KEYS * sizeof(uint32_t));
+    CU_ASSERT_FATAL(NULL != keys);
+
+    CU_ASSERT(true == cvs_flatmap_init(&map, CHT__UINT32));
+
+    for (i = 0; i < FLAT_KEYS; i++) {
+        keys[i] = i * 2654435761u;
+        cvs_flatmap_put(&map, &keys[i], &keys[i]);
+    }
+    CU_ASSERT(FLAT_KEYS == cvs_flatmap_get_size(&map));
+
+    /* Remove and re-add in waves so tombstones build up and get reclaimed. */
+    for (i = 0; i < FLAT_KEYS; i++) {
+        if (0 != (i % 3)) {
+            CU_ASSERT(&keys[i] == cvs_flatmap_remove(&map, &keys[i]));
+        }
+    }
+    for (i = 0; i < FLAT_KEYS; i++) {
+        if (0 == (i % 3)) {
+            CU_ASSERT(&keys[i] == cvs_flatmap_get(&map, &keys[i]));
+        } else {
+            CU_ASSERT(NULL == cvs_flatmap_get(&map, &keys[i]));
+            cvs_flatmap_put(&map, &keys[i], &keys[i]);
+        }
+    }
+    CU_ASSERT(FLAT_KEYS == cvs_flatmap_get_size(&map));
+
+    seen = 0;
+    cvs_flatmap_iterate(&map, flat_uint32_iterator, &seen);
+    CU_ASSERT(FLAT_KEYS == seen);
+
+    cvs_flatmap_destroy(&map);
+    free(keys);
+}
+
+void flat_boundary(void)
+{
+    cvs_flatmap_t map;
+
+    CU_ASSERT(false == cvs_flatmap_init(NULL, CHT__UINT32));
+    CU_ASSERT(false == cvs_flatmap_init(&map, CHT__STRING));
+    CU_ASSERT(true  == cvs_flatmap_init(&map, CHT__UINT32));
+
+    cvs_flatmap_destroy(NULL);
+    cvs_flatmap_iterate(NULL, NULL, NULL);
+    cvs_flatmap_iterate(&map, NULL, NULL);
+    cvs_flatmap_put(&map, NULL, NULL);
+    CU_ASSERT(0     == cvs_flatmap_get_size(NULL));
+    CU_ASSERT(false == cvs_flatmap_contains_key(NULL, NULL));
+    CU_ASSERT(false == cvs_flatmap_contains_key(&map, NULL));
+    CU_ASSERT(NULL  == cvs_flatmap_get(&map, NULL));
+
+    cvs_flatmap_destroy(&map);
+}
+
+
+void add_flatmap_tests(CU_pSuite *suite)
+{
+    CU_add_test(*suite, "flatmap uint64_t", flat_simple_uint64);
+    CU_add_test(*suite, "flatmap uint32_t churn", flat_churn_uint32);
+    CU_add_test(*suite, "flatmap Boundary tests", flat_boundary);
+}
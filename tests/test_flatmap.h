@@ -0,0 +1,17 @@
+#ifndef __TEST_FLATMAP_H__
+#define __TEST_FLATMAP_H__
+
+
+#include <CUnit/Basic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void add_flatmap_tests(CU_pSuite *suite);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
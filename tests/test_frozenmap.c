@@ -0,0 +1,156 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include <stdbool.h>
+
+#include "../src/cvs-frozenmap.h"
+#include "test_frozenmap.h"
+#include "general.h"
+
+static bool frozen_string_iterator(void *key, void *value, void *user_data)
+{
+    /* Each value is its own key. */
+    CU_ASSERT(0 == strcmp((char*) key, (char*) value));
+    (*((size_t*) user_data))++;
+
+    return true;
+}
+
+static bool frozen_blob_iterator(void *key, void *value, void *user_data)
+{
+    cvs_hashmap_blob_t *blob = (cvs_hashmap_blob_t*) key;
+
+    CU_ASSERT(blob->length == *((size_t*) value));
+    (*((size_t*) user_data))++;
+
+    return true;
+}
+
+#define FROZEN_KEYS 20000
+void frozen_strings(void)
+{
+    cvs_hashmap_t hash;
+    cvs_frozenmap_t frozen;
+    char (*keys)[16];
+    char key[16];
+    size_t i, seen;
+
+    keys = malloc(FROZEN_KEYS * sizeof(*keys));
+    CU_ASSERT_FATAL(NULL != keys);
+
+    CU_ASSERT(true == cvs_hashmap_init(&hash, CHT__STRING));
+    for (i = 0; i < FROZEN_KEYS; i++) {
+        sprintf(keys[i], "param.%zu", i);
+        cvs_hashmap_put(&hash, keys[i], keys[i]);
+    }
+
+    CU_ASSERT_FATAL(true == cvs_frozenmap_freeze(&frozen, &hash));
+    cvs_hashmap_destroy(&hash);
+
+    /* Exactly one entry per key, no empty slots. */
+    CU_ASSERT(FROZEN_KEYS == cvs_frozenmap_get_size(&frozen));
+    CU_ASSERT(false       == cvs_frozenmap_is_empty(&frozen));
+
+    for (i = 0; i < FROZEN_KEYS; i++) {
+        sprintf(key, "param.%zu", i);
+        CU_ASSERT(keys[i] == cvs_frozenmap_get(&frozen, key));
+    }
+    CU_ASSERT(NULL  == cvs_frozenmap_get(&frozen, "param."));
+    CU_ASSERT(NULL  == cvs_frozenmap_get(&frozen, "param.20000"));
+    CU_ASSERT(false == cvs_frozenmap_contains_key(&frozen, "other"));
+    CU_ASSERT(true  == cvs_frozenmap_contains_key(&frozen, "param.0"));
+
+    seen = 0;
+    cvs_frozenmap_iterate(&frozen, frozen_string_iterator, &seen);
+    CU_ASSERT(FROZEN_KEYS == seen);
+
+    cvs_frozenmap_destroy(&frozen);
+    CU_ASSERT(true == cvs_frozenmap_is_empty(&frozen));
+    CU_ASSERT(NULL == cvs_frozenmap_get(&frozen, "param.0"));
+    free(keys);
+}
+
+void frozen_other_types(void)
+{
+    cvs_hashmap_t hash;
+    cvs_frozenmap_t frozen;
+    cvs_hashmap_blob_t blob;
+    uint32_t keys32[100];
+    uint32_t key32;
+    char data[40];
+    size_t lengths[40];
+    size_t i, seen;
+
+    CU_ASSERT(true == cvs_hashmap_init(&hash, CHT__UINT32));
+    for (i = 0; i < 100; i++) {
+        keys32[i] = (uint32_t) (i * 977);
+        cvs_hashmap_put(&hash, &keys32[i], &keys32[i]);
+    }
+    CU_ASSERT_FATAL(true == cvs_frozenmap_freeze(&frozen, &hash));
+    cvs_hashmap_destroy(&hash);
+    for (i = 0; i < 100; i++) {
+        key32 = (uint32_t) (i * 977);
+        CU_ASSERT(&keys32[i] == cvs_frozenmap_get(&frozen, &key32));
+    }
+    key32 = 1;
+    CU_ASSERT(NULL == cvs_frozenmap_get(&frozen, &key32));
+    cvs_frozenmap_destroy(&frozen);
+
+    /* Blob keys that are prefixes of each other, including the empty key. */
+    memset(data, 'b', sizeof(data));
+    blob.data = data;
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__BLOB, CHF__NONE));
+    for (i = 0; i < 40; i++) {
+        lengths[i] = i;
+        blob.length = i;
+        cvs_hashmap_put(&hash, &blob, &lengths[i]);
+    }
+    CU_ASSERT_FATAL(true == cvs_frozenmap_freeze(&frozen, &hash));
+    cvs_hashmap_destroy(&hash);
+    for (i = 0; i < 40; i++) {
+        blob.length = i;
+        CU_ASSERT(&lengths[i] == cvs_frozenmap_get(&frozen, &blob));
+    }
+    seen = 0;
+    cvs_frozenmap_iterate(&frozen, frozen_blob_iterator, &seen);
+    CU_ASSERT(40 == seen);
+    cvs_frozenmap_destroy(&frozen);
+}
+
+void frozen_boundary(void)
+{
+    cvs_hashmap_t hash;
+    cvs_frozenmap_t frozen;
+    uint64_t key = 1;
+
+    CU_ASSERT(true  == cvs_hashmap_init(&hash, CHT__UINT64));
+    CU_ASSERT(false == cvs_frozenmap_freeze(NULL, &hash));
+    CU_ASSERT(false == cvs_frozenmap_freeze(&frozen, NULL));
+
+    /* An empty map freezes to an empty frozen map. */
+    CU_ASSERT(true  == cvs_frozenmap_freeze(&frozen, &hash));
+    CU_ASSERT(true  == cvs_frozenmap_is_empty(&frozen));
+    CU_ASSERT(NULL  == cvs_frozenmap_get(&frozen, &key));
+    cvs_frozenmap_destroy(&frozen);
+
+    cvs_hashmap_put(&hash, &key, &key);
+    CU_ASSERT(true  == cvs_frozenmap_freeze(&frozen, &hash));
+    CU_ASSERT(&key  == cvs_frozenmap_get(&frozen, &key));
+    CU_ASSERT(NULL  == cvs_frozenmap_get(&frozen, NULL));
+    CU_ASSERT(0     == cvs_frozenmap_get_size(NULL));
+    cvs_frozenmap_iterate(NULL, NULL, NULL);
+    cvs_frozenmap_iterate(&frozen, NULL, NULL);
+    cvs_frozenmap_destroy(&frozen);
+    cvs_frozenmap_destroy(NULL);
+    cvs_hashmap_destroy(&hash);
+}
+
+
+void add_frozenmap_tests(CU_pSuite *suite)
+{
+    CU_add_test(*suite, "frozenmap string", frozen_strings);
+    CU_add_test(*suite, "frozenmap uint32_t and blob", frozen_other_types);
+    CU_add_test(*suite, "frozenmap Boundary tests", frozen_boundary);
+}
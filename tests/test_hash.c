@@ -0,0 +1,105 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include <stdbool.h>
+
+#include "../src/rebar-hash.h"
+#include "test_hash.h"
+#include "general.h"
+
+void hash_seed(void)
+{
+    uint64_t seeds[64];
+    int i, j;
+
+    for (i = 0; i < 64; i++) {
+        seeds[i] = rebar_hash_seed();
+        for (j = 0; j < i; j++) {
+            CU_ASSERT(seeds[i] != seeds[j]);
+        }
+    }
+}
+
+void hash_bytes(void)
+{
+    uint8_t buf[256];
+    uint64_t seed = 0x0123456789abcdefULL;
+    uint64_t h[257];
+    size_t len, i, j;
+
+    for (i = 0; i < sizeof(buf); i++) {
+        buf[i] = (uint8_t) (i * 31);
+    }
+
+    /* Every length through all the read paths gives a distinct hash that
+     * only depends on the bytes, not their alignment. */
+    for (len = 0; len <= sizeof(buf); len++) {
+        uint8_t copy[257];
+
+        h[len] = rebar_hash_bytes(buf, len, seed);
+        memcpy(&copy[1], buf, len);
+        CU_ASSERT(h[len] == rebar_hash_bytes(&copy[1], len, seed));
+        for (j = 0; j < len; j++) {
+            CU_ASSERT(h[len] != h[j]);
+        }
+    }
+
+    /* Flipping any one bit changes the hash, and so does the seed. */
+    for (i = 0; i < 64 * 8; i++) {
+        uint8_t copy[64];
+
+        memcpy(copy, buf, sizeof(copy));
+        copy[i / 8] ^= (uint8_t) (1 << (i % 8));
+        CU_ASSERT(h[64] != rebar_hash_bytes(copy, sizeof(copy), seed));
+    }
+    CU_ASSERT(h[64] != rebar_hash_bytes(buf, 64, seed + 1));
+
+    len = 0;
+    CU_ASSERT(rebar_hash_bytes("device-0001", 11, seed) ==
+              rebar_hash_string("device-0001", &len, seed));
+    CU_ASSERT(11 == len);
+    CU_ASSERT(rebar_hash_bytes("", 0, seed) == rebar_hash_string("", NULL, seed));
+}
+
+void hash_integers(void)
+{
+    uint64_t seed = rebar_hash_seed();
+
+    CU_ASSERT(rebar_hash_u32(7, seed) == rebar_hash_u64(7, seed));
+    CU_ASSERT(rebar_hash_u64(7, seed) != rebar_hash_u64(8, seed));
+    CU_ASSERT(rebar_hash_u64(7, seed) != rebar_hash_u64(7, seed ^ 1));
+    CU_ASSERT(0 != rebar_hash_mix64(1));
+}
+
+void hash_crc32c(void)
+{
+    const char *check = "123456789";
+    uint8_t buf[1000];
+    uint32_t crc;
+    size_t i;
+
+    /* The standard CRC32C check value, whichever implementation runs. */
+    CU_ASSERT(0xe3069283 == rebar_hash_crc32c(check, 9, 0));
+    CU_ASSERT(0 == rebar_hash_crc32c(NULL, 0, 0));
+    printf("crc32c %s\n", rebar_hash_crc32c_is_accelerated() ? "sse4.2" : "table");
+
+    /* A checksum can be built up from pieces of any size. */
+    for (i = 0; i < sizeof(buf); i++) {
+        buf[i] = (uint8_t) (i ^ (i >> 3));
+    }
+    crc = rebar_hash_crc32c(buf, 3, 0);
+    crc = rebar_hash_crc32c(&buf[3], 500, crc);
+    crc = rebar_hash_crc32c(&buf[503], sizeof(buf) - 503, crc);
+    CU_ASSERT(rebar_hash_crc32c(buf, sizeof(buf), 0) == crc);
+}
+
+
+void add_hash_tests(CU_pSuite *suite)
+{
+    CU_add_test(*suite, "hash seeds", hash_seed);
+    CU_add_test(*suite, "hash bytes", hash_bytes);
+    CU_add_test(*suite, "hash integers", hash_integers);
+    CU_add_test(*suite, "hash crc32c", hash_crc32c);
+}
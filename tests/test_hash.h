@@ -0,0 +1,17 @@
+#ifndef __TEST_HASH_H__
+#define __TEST_HASH_H__
+
+
+#include <CUnit/Basic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void add_hash_tests(CU_pSuite *suite);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -219,11 +219,1079 @@ void boundary(void)
     cvs_hashmap_destroy(&hash);
 }
 
+#define MANY_KEYS 20000
+void many_keys(void)
+{
+    cvs_hashmap_t u32_hash, str_hash;
+    uint32_t *keys;
+    char (*names)[16];
+    uint32_t i;
+
+    keys = (uint32_t*) malloc(MANY_KEYS * sizeof(uint32_t));
+    names = malloc(MANY_KEYS * sizeof(*names));
+    CU_ASSERT_FATAL((NULL != keys) && (NULL != names));
+
+    CU_ASSERT(true == cvs_hashmap_init(&u32_hash, CHT__UINT32));
+    CU_ASSERT(true == cvs_hashmap_init(&str_hash, CHT__STRING));
+
+    for (i = 0; i < MANY_KEYS; i++) {
+        keys[i] = i * 7919;
+        sprintf(names[i], "mac:%08x", i);
+        cvs_hashmap_put(&u32_hash, &keys[i], &keys[i]);
+        cvs_hashmap_put(&str_hash, names[i], &keys[i]);
+    }
+
+    CU_ASSERT(MANY_KEYS == cvs_hashmap_get_size(&u32_hash));
+    CU_ASSERT(MANY_KEYS == cvs_hashmap_get_size(&str_hash));
+
+    for (i = 0; i < MANY_KEYS; i++) {
+        char other[16];
+
+        CU_ASSERT(&keys[i] == cvs_hashmap_get(&u32_hash, &keys[i]));
+        CU_ASSERT(&keys[i] == cvs_hashmap_get(&str_hash, names[i]));
+
+        /* A copy of the key must find the same entry. */
+        strcpy(other, names[i]);
+        CU_ASSERT(&keys[i] == cvs_hashmap_get(&str_hash, other));
+    }
+
+    /* Remove every other key and make sure the rest survive. */
+    for (i = 0; i < MANY_KEYS; i += 2) {
+        CU_ASSERT(&keys[i] == cvs_hashmap_remove(&u32_hash, &keys[i]));
+        CU_ASSERT(&keys[i] == cvs_hashmap_remove(&str_hash, names[i]));
+    }
+
+    CU_ASSERT(MANY_KEYS / 2 == cvs_hashmap_get_size(&u32_hash));
+    CU_ASSERT(MANY_KEYS / 2 == cvs_hashmap_get_size(&str_hash));
+
+    for (i = 0; i < MANY_KEYS; i++) {
+        if (i & 1) {
+            CU_ASSERT(&keys[i] == cvs_hashmap_get(&u32_hash, &keys[i]));
+            CU_ASSERT(true == cvs_hashmap_contains_key(&str_hash, names[i]));
+        } else {
+            CU_ASSERT(NULL == cvs_hashmap_get(&u32_hash, &keys[i]));
+            CU_ASSERT(false == cvs_hashmap_contains_key(&str_hash, names[i]));
+        }
+    }
+
+    cvs_hashmap_destroy(&u32_hash);
+    cvs_hashmap_destroy(&str_hash);
+
+    CU_ASSERT(true == cvs_hashmap_is_empty(&u32_hash));
+
+    free(names);
+    free(keys);
+}
+
+#define REHASH_KEYS 100000
+void incremental_rehash(void)
+{
+    cvs_hashmap_t hash;
+    uint64_t *keys;
+    size_t i, max_visited, rehashes;
+
+    keys = (uint64_t*) malloc(REHASH_KEYS * sizeof(uint64_t));
+    CU_ASSERT_FATAL(NULL != keys);
+
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__UINT64, CHF__INCREMENTAL_REHASH));
+
+    max_visited = 0;
+    rehashes = 0;
+    for (i = 0; i < REHASH_KEYS; i++) {
+        rebar_ll_node_t **old;
+        size_t idx, old_count, visited;
+
+        keys[i] = i * 0x9e3779b97f4a7c15ULL;
+
+        old = hash.old_buckets;
+        idx = hash.rehash_idx;
+        old_count = hash.old_mask + 1;
+
+        cvs_hashmap_put(&hash, &keys[i], &keys[i]);
+
+        if ((NULL != hash.old_buckets) && (old != hash.old_buckets)) {
+            /* This put started a rehash and took the first bounded step. */
+            visited = hash.rehash_idx;
+            rehashes++;
+        } else if (NULL != old) {
+            visited = ((NULL != hash.old_buckets) ? hash.rehash_idx : old_count) - idx;
+        } else {
+            visited = 0;
+        }
+        if (visited > max_visited) {
+            max_visited = visited;
+        }
+
+        /* Lookups have to work no matter how far along the migration is. */
+        CU_ASSERT(&keys[i] == cvs_hashmap_get(&hash, &keys[i]));
+        CU_ASSERT(&keys[i / 2] == cvs_hashmap_get(&hash, &keys[i / 2]));
+    }
+
+    /* No single put visited more than the bounded number of old buckets. */
+    CU_ASSERT(0 < rehashes);
+    CU_ASSERT(max_visited <= CVSHM_REHASH_BUCKETS * CVSHM_REHASH_EMPTY_VISITS);
+    CU_ASSERT(REHASH_KEYS == cvs_hashmap_get_size(&hash));
+
+    for (i = 0; i < REHASH_KEYS; i++) {
+        CU_ASSERT(&keys[i] == cvs_hashmap_remove(&hash, &keys[i]));
+    }
+    CU_ASSERT(true == cvs_hashmap_is_empty(&hash));
+
+    cvs_hashmap_destroy(&hash);
+    free(keys);
+}
+
+static bool count_iterator(void *key, void *value, void *user_data)
+{
+    IGNORE_UNUSED(key)
+    IGNORE_UNUSED(value)
+
+    (*((size_t*) user_data))++;
+
+    return true;
+}
+
+void incremental_rehash_iterate(void)
+{
+    cvs_hashmap_t hash;
+    uint32_t keys[1000];
+    size_t i, seen;
+
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__UINT32, CHF__INCREMENTAL_REHASH));
+
+    /* Stop as soon as a rehash is in progress and check both tables are
+     * visited. */
+    for (i = 0; i < 1000; i++) {
+        keys[i] = (uint32_t) i;
+        cvs_hashmap_put(&hash, &keys[i], &keys[i]);
+        if ((i > 100) && (NULL != hash.old_buckets)) {
+            break;
+        }
+    }
+    CU_ASSERT_FATAL(NULL != hash.old_buckets);
+
+    seen = 0;
+    cvs_hashmap_iterate(&hash, count_iterator, &seen);
+    CU_ASSERT(cvs_hashmap_get_size(&hash) == seen);
+
+    /* Destroying mid-rehash must free both tables. */
+    cvs_hashmap_destroy(&hash);
+}
+
+#define BATCH_KEYS 1000
+void batch_get_put(void)
+{
+    cvs_hashmap_t hash;
+    char (*names)[16];
+    void *keys[BATCH_KEYS + 1], *values[BATCH_KEYS + 1], *found[BATCH_KEYS + 1];
+    size_t i;
+
+    names = malloc(BATCH_KEYS * sizeof(*names));
+    CU_ASSERT_FATAL(NULL != names);
+
+    CU_ASSERT(true == cvs_hashmap_init(&hash, CHT__STRING));
+
+    for (i = 0; i < BATCH_KEYS; i++) {
+        sprintf(names[i], "device-%zu", i);
+        keys[i] = names[i];
+        values[i] = &names[i];
+    }
+    keys[BATCH_KEYS] = NULL;
+    values[BATCH_KEYS] = NULL;
+
+    /* Nothing there yet, everything comes back NULL. */
+    found[0] = &hash;
+    cvs_hashmap_get_many(&hash, keys, found, BATCH_KEYS);
+    for (i = 0; i < BATCH_KEYS; i++) {
+        CU_ASSERT(NULL == found[i]);
+    }
+
+    /* Only put the first half, including keys repeated in one batch. */
+    cvs_hashmap_put_many(&hash, keys, values, BATCH_KEYS / 2);
+    cvs_hashmap_put_many(&hash, keys, values, 20);
+    CU_ASSERT(BATCH_KEYS / 2 == cvs_hashmap_get_size(&hash));
+
+    cvs_hashmap_get_many(&hash, keys, found, BATCH_KEYS + 1);
+    for (i = 0; i < BATCH_KEYS + 1; i++) {
+        if (i < BATCH_KEYS / 2) {
+            CU_ASSERT(values[i] == found[i]);
+            CU_ASSERT(cvs_hashmap_get(&hash, keys[i]) == found[i]);
+        } else {
+            CU_ASSERT(NULL == found[i]);
+        }
+    }
+
+    /* A NULL key in a put batch is skipped. */
+    cvs_hashmap_put_many(&hash, keys, values, BATCH_KEYS + 1);
+    CU_ASSERT(BATCH_KEYS == cvs_hashmap_get_size(&hash));
+
+    cvs_hashmap_get_many(NULL, keys, found, 1);
+    cvs_hashmap_put_many(&hash, NULL, values, 1);
+
+    cvs_hashmap_destroy(&hash);
+    free(names);
+}
+
+static bool blob_iterator(void *key, void *value, void *user_data)
+{
+    cvs_hashmap_blob_t *blob = CVSHM_KEY_TO_BLOB(key);
+    size_t *seen = (size_t*) user_data;
+
+    /* Each value is the length of its key. */
+    CU_ASSERT(blob->length == *((size_t*) value));
+    (*seen)++;
+
+    return true;
+}
+
+void bytes_keys(void)
+{
+    cvs_hashmap_t macs, longs;
+    uint8_t mac[6] = { 0x00, 0x1a, 0x2b, 0x3c, 0x4d, 0x00 };
+    uint8_t other[6];
+    uint8_t big[40];
+    uint32_t bar[3];
+    int i;
+
+    CU_ASSERT(false == cvs_hashmap_init_bytes(&macs, 0, CHF__NONE));
+    CU_ASSERT(false == cvs_hashmap_init_ex(&macs, CHT__BYTES, CHF__NONE));
+    CU_ASSERT(true  == cvs_hashmap_init_bytes(&macs, sizeof(mac), CHF__NONE));
+    CU_ASSERT(true  == cvs_hashmap_init_bytes(&longs, sizeof(big), CHF__NONE));
+
+    /* The keys are copied so one buffer can be reused for every put. */
+    for (i = 0; i < 256; i++) {
+        mac[5] = (uint8_t) i;
+        cvs_hashmap_put(&macs, mac, &bar[i % 3]);
+
+        memset(big, 0, sizeof(big));
+        big[sizeof(big) - 1] = (uint8_t) i;
+        cvs_hashmap_put(&longs, big, &bar[i % 3]);
+    }
+    CU_ASSERT(256 == cvs_hashmap_get_size(&macs));
+    CU_ASSERT(256 == cvs_hashmap_get_size(&longs));
+
+    memcpy(other, mac, sizeof(other));
+    other[5] = 7;
+    CU_ASSERT(&bar[1] == cvs_hashmap_get(&macs, other));
+    CU_ASSERT(&bar[1] == cvs_hashmap_remove(&macs, other));
+    CU_ASSERT(false   == cvs_hashmap_contains_key(&macs, other));
+
+    big[sizeof(big) - 1] = 9;
+    CU_ASSERT(&bar[0] == cvs_hashmap_get(&longs, big));
+    big[0] = 1;
+    CU_ASSERT(NULL    == cvs_hashmap_get(&longs, big));
+
+    cvs_hashmap_destroy(&macs);
+    cvs_hashmap_destroy(&longs);
+}
+
+void blob_keys(void)
+{
+    cvs_hashmap_t hash;
+    cvs_hashmap_blob_t key;
+    char data[64];
+    size_t lengths[64];
+    size_t i, seen;
+
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__BLOB, CHF__NONE));
+
+    /* Keys of every length from 0 to 63 bytes, both inline and not.  Each is
+     * a prefix of the next, so the lengths have to be compared too. */
+    memset(data, 'x', sizeof(data));
+    key.data = data;
+    for (i = 0; i < 64; i++) {
+        lengths[i] = i;
+        key.length = i;
+        cvs_hashmap_put(&hash, &key, &lengths[i]);
+    }
+    CU_ASSERT(64 == cvs_hashmap_get_size(&hash));
+
+    for (i = 0; i < 64; i++) {
+        key.length = i;
+        CU_ASSERT(&lengths[i] == cvs_hashmap_get(&hash, &key));
+    }
+
+    seen = 0;
+    cvs_hashmap_iterate(&hash, blob_iterator, &seen);
+    CU_ASSERT(64 == seen);
+
+    key.length = 3;
+    data[1] = 'y';
+    CU_ASSERT(NULL == cvs_hashmap_get(&hash, &key));
+    data[1] = 'x';
+    CU_ASSERT(&lengths[3] == cvs_hashmap_remove(&hash, &key));
+    key.length = 40;
+    CU_ASSERT(&lengths[40] == cvs_hashmap_remove(&hash, &key));
+    CU_ASSERT(62 == cvs_hashmap_get_size(&hash));
+
+    cvs_hashmap_destroy(&hash);
+}
+
+
+void owned_keys(void)
+{
+    cvs_hashmap_t hash;
+    char buf[64];
+    char *longkey;
+    int values[2000];
+    int i;
+
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__STRING, CHF__OWN_KEYS));
+
+    /* The keys are copied so one buffer can be reused for every put. */
+    for (i = 0; i < 2000; i++) {
+        values[i] = i;
+        sprintf(buf, "key-%d", i);
+        cvs_hashmap_put(&hash, buf, &values[i]);
+    }
+    CU_ASSERT(2000 == cvs_hashmap_get_size(&hash));
+
+    strcpy(buf, "key-1234");
+    CU_ASSERT(&values[1234] == cvs_hashmap_get(&hash, buf));
+    /* A prefix with the same leading bytes is a different key. */
+    CU_ASSERT(NULL == cvs_hashmap_get(&hash, "key-123x"));
+    CU_ASSERT(NULL == cvs_hashmap_get(&hash, "key-"));
+    CU_ASSERT(&values[12] == cvs_hashmap_get(&hash, "key-12\0ignored"));
+
+    /* Removing most keys compacts the arena, the rest must still be found. */
+    for (i = 0; i < 2000; i++) {
+        if (0 != i % 10) {
+            sprintf(buf, "key-%d", i);
+            CU_ASSERT(&values[i] == cvs_hashmap_remove(&hash, buf));
+        }
+    }
+    CU_ASSERT(200 == cvs_hashmap_get_size(&hash));
+    CU_ASSERT(hash.arena_dead < hash.arena_used);
+    for (i = 0; i < 2000; i++) {
+        sprintf(buf, "key-%d", i);
+        CU_ASSERT(((0 == i % 10) ? &values[i] : NULL) == cvs_hashmap_get(&hash, buf));
+    }
+
+    /* A key longer than an arena chunk gets a chunk of its own. */
+    longkey = (char*) malloc(8192);
+    memset(longkey, 'k', 8192 - 1);
+    longkey[8192 - 1] = '\0';
+    cvs_hashmap_put(&hash, longkey, &values[0]);
+    longkey[0] = 'j';
+    CU_ASSERT(NULL == cvs_hashmap_get(&hash, longkey));
+    longkey[0] = 'k';
+    CU_ASSERT(&values[0] == cvs_hashmap_get(&hash, longkey));
+    free(longkey);
+
+    cvs_hashmap_destroy(&hash);
+    CU_ASSERT(NULL == hash.arena);
+}
+
+
+void stats(void)
+{
+    cvs_hashmap_t hash;
+    cvs_hashmap_stats_t st;
+    cvs_hashmap_blob_t blob;
+    uint64_t keys[1000];
+    uint64_t missing = 12345678;
+    char data[32];
+    size_t i, total;
+
+    CU_ASSERT(false == cvs_hashmap_stats(NULL, &st));
+    CU_ASSERT(true  == cvs_hashmap_init(&hash, CHT__UINT64));
+    CU_ASSERT(false == cvs_hashmap_stats(&hash, NULL));
+
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(0 == st.count);
+    CU_ASSERT(0 == st.buckets);
+    CU_ASSERT(0 == st.bytes);
+
+    for (i = 0; i < 1000; i++) {
+        keys[i] = i;
+        cvs_hashmap_put(&hash, &keys[i], &keys[i]);
+    }
+    for (i = 0; i < 1000; i += 2) {
+        CU_ASSERT(&keys[i] == cvs_hashmap_get(&hash, &keys[i]));
+    }
+    CU_ASSERT(NULL == cvs_hashmap_get(&hash, &missing));
+
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(1000 == st.count);
+    CU_ASSERT(1024 == st.buckets);
+    CU_ASSERT(false == st.rehashing);
+    CU_ASSERT((st.load_factor > 0.97) && (st.load_factor < 0.98));
+    CU_ASSERT(st.average_probe >= 1.0);
+    CU_ASSERT(st.max_chain >= 1);
+    CU_ASSERT(st.bytes >= 1024 * sizeof(void*) + 1000 * 24);
+
+    /* Every bucket is in exactly one histogram entry. */
+    total = 0;
+    for (i = 0; i < CVSHM_STATS_CHAINS; i++) {
+        total += st.chains[i];
+    }
+    CU_ASSERT(st.buckets == total);
+    CU_ASSERT(st.empty_buckets == st.chains[0]);
+
+#ifdef CVSHM_COUNTERS
+    CU_ASSERT(501 == st.counters.gets);
+    CU_ASSERT(500 == st.counters.hits);
+    CU_ASSERT(1   == st.counters.misses);
+    CU_ASSERT(7   == st.counters.resizes);   /* inline, then 16 to 1024 */
+#else
+    CU_ASSERT(0 == st.counters.gets);
+    CU_ASSERT(0 == st.counters.resizes);
+#endif
+    cvs_hashmap_destroy(&hash);
+
+    /* Long blob keys live outside the node and are counted too. */
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__BLOB, CHF__NONE));
+    memset(data, 'k', sizeof(data));
+    blob.data = data;
+    blob.length = sizeof(data);
+    cvs_hashmap_put(&hash, &blob, data);
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(1 == st.max_chain);
+    CU_ASSERT(1.0 == st.average_probe);
+    CU_ASSERT(st.bytes >= 8 * sizeof(void*) + sizeof(data));
+    cvs_hashmap_destroy(&hash);
+}
+
+
+void node_reuse(void)
+{
+    cvs_hashmap_t hash;
+    cvs_hashmap_stats_t st;
+    uint64_t keys[1000];
+    size_t i, round, bytes;
+
+    CU_ASSERT(true == cvs_hashmap_init(&hash, CHT__UINT64));
+    for (i = 0; i < 1000; i++) {
+        keys[i] = i;
+        cvs_hashmap_put(&hash, &keys[i], &keys[i]);
+    }
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    bytes = st.bytes;
+
+    /* Removed nodes are reused, so churn does not grow the slabs. */
+    for (round = 0; round < 5; round++) {
+        for (i = 0; i < 1000; i += 3) {
+            CU_ASSERT(&keys[i] == cvs_hashmap_remove(&hash, &keys[i]));
+        }
+        CU_ASSERT(666 == cvs_hashmap_get_size(&hash));
+        for (i = 0; i < 1000; i += 3) {
+            cvs_hashmap_put(&hash, &keys[i], &keys[i]);
+        }
+        CU_ASSERT(1000 == cvs_hashmap_get_size(&hash));
+    }
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(bytes == st.bytes);
+
+    for (i = 0; i < 1000; i++) {
+        CU_ASSERT(&keys[i] == cvs_hashmap_get(&hash, &keys[i]));
+    }
+
+    /* A destroyed map can be used again. */
+    cvs_hashmap_destroy(&hash);
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(0 == st.bytes);
+    cvs_hashmap_put(&hash, &keys[7], &keys[7]);
+    CU_ASSERT(&keys[7] == cvs_hashmap_get(&hash, &keys[7]));
+    cvs_hashmap_destroy(&hash);
+}
+
+
+void reserve(void)
+{
+    cvs_hashmap_t hash;
+    cvs_hashmap_stats_t st;
+    uint64_t keys[1000];
+    size_t i;
+
+    CU_ASSERT(false == cvs_hashmap_reserve(NULL, 10));
+
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__UINT64, CHF__INCREMENTAL_REHASH));
+    CU_ASSERT(true == cvs_hashmap_reserve(&hash, 1000));
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(1024 == st.buckets);
+
+    /* Filling up to the reserved count never rehashes. */
+    for (i = 0; i < 1000; i++) {
+        keys[i] = i;
+        cvs_hashmap_put(&hash, &keys[i], &keys[i]);
+        CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+        CU_ASSERT(1024 == st.buckets);
+    }
+
+    /* Smaller reservations do nothing, bigger ones migrate right away. */
+    CU_ASSERT(true == cvs_hashmap_reserve(&hash, 10));
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(1024 == st.buckets);
+    CU_ASSERT(true == cvs_hashmap_reserve(&hash, 3000));
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(4096 == st.buckets);
+    CU_ASSERT(false == st.rehashing);
+    CU_ASSERT(1000 == st.count);
+
+    for (i = 0; i < 1000; i++) {
+        CU_ASSERT(&keys[i] == cvs_hashmap_get(&hash, &keys[i]));
+    }
+    cvs_hashmap_destroy(&hash);
+}
+
+
+void init_from_arrays(void)
+{
+    cvs_hashmap_t hash;
+    cvs_hashmap_stats_t st;
+    char strings[500][16];
+    void *keys[501];
+    void *values[501];
+    size_t i;
+
+    for (i = 0; i < 500; i++) {
+        sprintf(strings[i], "key-%zu", i);
+        keys[i] = strings[i];
+        values[i] = &strings[i][1];
+    }
+    keys[500] = NULL;
+    values[500] = NULL;
+
+    CU_ASSERT(false == cvs_hashmap_init_from_arrays(NULL, CHT__STRING, CHF__NONE,
+                                                    keys, values, 501, true));
+    CU_ASSERT(false == cvs_hashmap_init_from_arrays(&hash, CHT__STRING, CHF__NONE,
+                                                    NULL, values, 501, true));
+
+    /* Unique keys, with a NULL key that is skipped. */
+    CU_ASSERT(true == cvs_hashmap_init_from_arrays(&hash, CHT__STRING, CHF__OWN_KEYS,
+                                                   keys, values, 501, true));
+    CU_ASSERT(500 == cvs_hashmap_get_size(&hash));
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(512 == st.buckets);
+    for (i = 0; i < 500; i++) {
+        CU_ASSERT(values[i] == cvs_hashmap_get(&hash, strings[i]));
+    }
+    CU_ASSERT(NULL == cvs_hashmap_get(&hash, "key-500"));
+
+    /* The loaded map behaves like any other. */
+    CU_ASSERT(values[7] == cvs_hashmap_remove(&hash, "key-7"));
+    cvs_hashmap_put(&hash, "key-7", values[8]);
+    CU_ASSERT(values[8] == cvs_hashmap_get(&hash, "key-7"));
+    CU_ASSERT(500 == cvs_hashmap_get_size(&hash));
+    cvs_hashmap_destroy(&hash);
+
+    /* Without the promise repeated keys keep the last value. */
+    keys[1] = strings[0];
+    CU_ASSERT(true == cvs_hashmap_init_from_arrays(&hash, CHT__STRING, CHF__NONE,
+                                                   keys, values, 501, false));
+    CU_ASSERT(499 == cvs_hashmap_get_size(&hash));
+    CU_ASSERT(values[1] == cvs_hashmap_get(&hash, strings[0]));
+    cvs_hashmap_destroy(&hash);
+
+    CU_ASSERT(true == cvs_hashmap_init_from_arrays(&hash, CHT__UINT32, CHF__NONE,
+                                                   keys, values, 0, true));
+    CU_ASSERT(true == cvs_hashmap_is_empty(&hash));
+    cvs_hashmap_destroy(&hash);
+}
+
+
+static void *count_update(void *key, void *value, bool found, void *user_data)
+{
+    (void) key;
+    if (!found) {
+        CU_ASSERT(NULL == value);
+        (*((size_t*) user_data))++;
+    }
+
+    return (void*) ((uintptr_t) value + 1);
+}
+
+void get_or_insert(void)
+{
+    cvs_hashmap_t hash;
+    const char *words[] = { "a", "b", "a", "c", "a", "b" };
+    char key[8];
+    void **slot;
+    bool inserted;
+    size_t i, added;
+
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__STRING, CHF__OWN_KEYS));
+    CU_ASSERT(NULL == cvs_hashmap_get_or_insert(NULL, "a", &inserted));
+    CU_ASSERT(NULL == cvs_hashmap_get_or_insert(&hash, NULL, &inserted));
+    CU_ASSERT(NULL == cvs_hashmap_upsert(&hash, "a", NULL, NULL));
+
+    for (i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+        /* The key is copied in, so a reused buffer is fine. */
+        strcpy(key, words[i]);
+        slot = cvs_hashmap_get_or_insert(&hash, key, &inserted);
+        CU_ASSERT(NULL != slot);
+        CU_ASSERT(inserted == (i < 2 || 3 == i));
+        *slot = (void*) ((uintptr_t) *slot + 1);
+    }
+    CU_ASSERT(3 == cvs_hashmap_get_size(&hash));
+    CU_ASSERT(3 == (uintptr_t) cvs_hashmap_get(&hash, "a"));
+    CU_ASSERT(2 == (uintptr_t) cvs_hashmap_get(&hash, "b"));
+    CU_ASSERT(1 == (uintptr_t) cvs_hashmap_get(&hash, "c"));
+
+    /* The slot stays put while other keys are added and the map grows. */
+    slot = cvs_hashmap_get_or_insert(&hash, "c", NULL);
+    for (i = 0; i < 100; i++) {
+        sprintf(key, "k%zu", i);
+        cvs_hashmap_put(&hash, key, NULL);
+    }
+    CU_ASSERT(slot == cvs_hashmap_get_or_insert(&hash, "c", &inserted));
+    CU_ASSERT(false == inserted);
+
+    added = 0;
+    CU_ASSERT(4 == (uintptr_t) cvs_hashmap_upsert(&hash, "a", count_update, &added));
+    CU_ASSERT(1 == (uintptr_t) cvs_hashmap_upsert(&hash, "d", count_update, &added));
+    CU_ASSERT(1 == added);
+    CU_ASSERT(4 == (uintptr_t) cvs_hashmap_get(&hash, "a"));
+    CU_ASSERT(104 == cvs_hashmap_get_size(&hash));
+
+    cvs_hashmap_destroy(&hash);
+}
+
+
+static rebar_ll_iterator_response_t expire_odd(void *key, void *value, void *user_data)
+{
+    (void) user_data;
+    CU_ASSERT(*((uint64_t*) key) == *((uint64_t*) value));
+    if (*((uint64_t*) key) & 1) {
+        return REBAR_IR__DELETE_AND_CONTINUE;
+    }
+
+    return REBAR_IR__CONTINUE;
+}
+
+static rebar_ll_iterator_response_t delete_one(void *key, void *value, void *user_data)
+{
+    (void) key;
+    (void) value;
+    (void) user_data;
+
+    return REBAR_IR__DELETE_AND_STOP;
+}
+
+static rebar_ll_iterator_response_t stop_now(void *key, void *value, void *user_data)
+{
+    (void) key;
+    (void) value;
+    (*((size_t*) user_data))++;
+
+    return REBAR_IR__STOP;
+}
+
+static void count_deleted(void *key, void *value, void *user_data)
+{
+    CU_ASSERT(key != value);
+    CU_ASSERT(*((uint64_t*) key) == *((uint64_t*) value));
+    (*((size_t*) user_data))++;
+}
+
+static rebar_ll_iterator_response_t expire_all(void *key, void *value, void *user_data)
+{
+    (void) key;
+    (void) value;
+    (void) user_data;
+
+    return REBAR_IR__DELETE_AND_CONTINUE;
+}
+
+void iterate_ex(void)
+{
+    cvs_hashmap_t hash;
+    cvs_hashmap_stats_t st;
+    uint64_t keys[540];
+    char strings[1000][16];
+    size_t i, calls;
+
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__UINT64, CHF__INCREMENTAL_REHASH));
+    cvs_hashmap_iterate_ex(&hash, expire_odd, NULL, NULL);
+    for (i = 0; i < 540; i++) {
+        keys[i] = i;
+        cvs_hashmap_put(&hash, &keys[i], &keys[i]);
+    }
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(true == st.rehashing);
+
+    /* Remove half in one pass, across both tables of a running rehash. */
+    calls = 0;
+    cvs_hashmap_iterate_ex(&hash, expire_odd, count_deleted, &calls);
+    CU_ASSERT(270 == calls);
+    CU_ASSERT(270 == cvs_hashmap_get_size(&hash));
+    for (i = 0; i < 540; i++) {
+        CU_ASSERT(((i & 1) ? NULL : &keys[i]) == cvs_hashmap_get(&hash, &keys[i]));
+    }
+
+    cvs_hashmap_iterate_ex(&hash, delete_one, NULL, NULL);
+    CU_ASSERT(269 == cvs_hashmap_get_size(&hash));
+
+    calls = 0;
+    cvs_hashmap_iterate_ex(&hash, stop_now, count_deleted, &calls);
+    CU_ASSERT(1 == calls);
+    CU_ASSERT(269 == cvs_hashmap_get_size(&hash));
+
+    cvs_hashmap_iterate_ex(&hash, expire_all, NULL, NULL);
+    CU_ASSERT(true == cvs_hashmap_is_empty(&hash));
+    cvs_hashmap_destroy(&hash);
+
+    /* Removing owned keys compacts the arena after the pass. */
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__STRING, CHF__OWN_KEYS));
+    for (i = 0; i < 1000; i++) {
+        sprintf(strings[i], "expiring-%zu", i);
+        cvs_hashmap_put(&hash, strings[i], strings[i]);
+    }
+    cvs_hashmap_iterate_ex(&hash, expire_all, NULL, NULL);
+    CU_ASSERT(true == cvs_hashmap_is_empty(&hash));
+    CU_ASSERT(0 == hash.arena_dead);
+    cvs_hashmap_put(&hash, strings[0], strings[0]);
+    CU_ASSERT(strings[0] == cvs_hashmap_get(&hash, "expiring-0"));
+    cvs_hashmap_destroy(&hash);
+}
+
+
+static bool sum_u32(void *key, void *value, void *user_data)
+{
+    CU_ASSERT(*((uint32_t*) key) + 1 == (uintptr_t) value);
+    *((uint64_t*) user_data) += *((uint32_t*) key);
+
+    return true;
+}
+
+void small_maps(void)
+{
+    cvs_hashmap_t hash;
+    cvs_hashmap_stats_t st;
+    uint64_t keys[CVSHM_SMALL_MAX + 1], sum;
+    void *values[3];
+    void *lookups[3];
+    void **slot;
+    uint32_t k;
+    size_t i, calls;
+
+    /* Up to CVSHM_SMALL_MAX keys stay inline, including after removals. */
+    CU_ASSERT(true == cvs_hashmap_init(&hash, CHT__UINT32));
+    for (k = 100; k < 100 + CVSHM_SMALL_MAX; k++) {
+        cvs_hashmap_put(&hash, &k, (void*) (uintptr_t) (k + 1));
+    }
+    CU_ASSERT(CVSHM_SMALL_MAX == cvs_hashmap_get_size(&hash));
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(true == st.small);
+    CU_ASSERT(0 == st.bytes);
+
+    k = 103;
+    CU_ASSERT((void*) 104 == cvs_hashmap_remove(&hash, &k));
+    CU_ASSERT(NULL == cvs_hashmap_remove(&hash, &k));
+    CU_ASSERT(false == cvs_hashmap_contains_key(&hash, &k));
+    for (k = 100; k < 100 + CVSHM_SMALL_MAX; k++) {
+        if (103 != k) {
+            CU_ASSERT((void*) (uintptr_t) (k + 1) == cvs_hashmap_get(&hash, &k));
+        }
+    }
+    k = 103;
+    cvs_hashmap_put(&hash, &k, (void*) 104);
+    k = 105;
+    cvs_hashmap_put(&hash, &k, (void*) 106);
+    CU_ASSERT(CVSHM_SMALL_MAX == cvs_hashmap_get_size(&hash));
+
+    sum = 0;
+    cvs_hashmap_iterate(&hash, sum_u32, &sum);
+    CU_ASSERT(100 * CVSHM_SMALL_MAX + (CVSHM_SMALL_MAX - 1) * CVSHM_SMALL_MAX / 2 == sum);
+
+    /* The removed last key is still in its lane, but past the count. */
+    k = 100 + CVSHM_SMALL_MAX - 1;
+    CU_ASSERT((void*) (uintptr_t) (k + 1) == cvs_hashmap_remove(&hash, &k));
+    CU_ASSERT(NULL == cvs_hashmap_get(&hash, &k));
+    cvs_hashmap_put(&hash, &k, (void*) (uintptr_t) (k + 1));
+
+    /* One more key moves everything into buckets. */
+    k = 1000;
+    cvs_hashmap_put(&hash, &k, (void*) 1001);
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(false == st.small);
+    CU_ASSERT(0 < st.buckets);
+    CU_ASSERT(CVSHM_SMALL_MAX + 1 == cvs_hashmap_get_size(&hash));
+    for (k = 100; k < 100 + CVSHM_SMALL_MAX; k++) {
+        CU_ASSERT((void*) (uintptr_t) (k + 1) == cvs_hashmap_get(&hash, &k));
+    }
+    cvs_hashmap_destroy(&hash);
+
+    /* uint64_t keys differing only in one half must not match. */
+    CU_ASSERT(true == cvs_hashmap_init(&hash, CHT__UINT64));
+    for (i = 0; i < CVSHM_SMALL_MAX; i++) {
+        keys[i] = ((uint64_t) i << 32) | 7;
+        cvs_hashmap_put(&hash, &keys[i], &keys[i]);
+    }
+    keys[CVSHM_SMALL_MAX] = ((uint64_t) 1 << 32) | 8;
+    CU_ASSERT(NULL == cvs_hashmap_get(&hash, &keys[CVSHM_SMALL_MAX]));
+    keys[CVSHM_SMALL_MAX] = 7;
+    CU_ASSERT(&keys[0] == cvs_hashmap_get(&hash, &keys[CVSHM_SMALL_MAX]));
+    keys[CVSHM_SMALL_MAX] = ((uint64_t) 100 << 32) | 7;
+    CU_ASSERT(NULL == cvs_hashmap_get(&hash, &keys[CVSHM_SMALL_MAX]));
+
+    lookups[0] = &keys[2];
+    lookups[1] = NULL;
+    lookups[2] = &keys[CVSHM_SMALL_MAX];
+    cvs_hashmap_get_many(&hash, lookups, values, 3);
+    CU_ASSERT(&keys[2] == values[0]);
+    CU_ASSERT(NULL == values[1]);
+    CU_ASSERT(NULL == values[2]);
+
+    /* Removing while iterating visits every pair once. */
+    for (i = 0; i < CVSHM_SMALL_MAX; i++) {
+        keys[i] = i;
+    }
+    cvs_hashmap_destroy(&hash);
+    CU_ASSERT(true == cvs_hashmap_init(&hash, CHT__UINT64));
+    for (i = 0; i < CVSHM_SMALL_MAX; i++) {
+        cvs_hashmap_put(&hash, &keys[i], &keys[i]);
+    }
+    calls = 0;
+    cvs_hashmap_iterate_ex(&hash, expire_odd, count_deleted, &calls);
+    CU_ASSERT(CVSHM_SMALL_MAX / 2 == calls);
+    CU_ASSERT(CVSHM_SMALL_MAX / 2 == cvs_hashmap_get_size(&hash));
+    for (i = 0; i < CVSHM_SMALL_MAX; i++) {
+        CU_ASSERT(((i & 1) ? NULL : &keys[i]) == cvs_hashmap_get(&hash, &keys[i]));
+    }
+    cvs_hashmap_iterate_ex(&hash, expire_all, NULL, NULL);
+    CU_ASSERT(true == cvs_hashmap_is_empty(&hash));
+
+    /* Reserving for more than fits inline goes straight to buckets. */
+    CU_ASSERT(true == cvs_hashmap_reserve(&hash, CVSHM_SMALL_MAX));
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(true == st.small);
+    CU_ASSERT(true == cvs_hashmap_reserve(&hash, 100));
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(false == st.small);
+    CU_ASSERT(128 == st.buckets);
+    cvs_hashmap_destroy(&hash);
+
+    /* A slot is only good until the next change: a remove moves the last
+     * pair into the hole and growing moves every pair into nodes.  Values
+     * written before the change move with their pair. */
+    CU_ASSERT(true == cvs_hashmap_init(&hash, CHT__UINT64));
+    for (i = 0; i < CVSHM_SMALL_MAX; i++) {
+        cvs_hashmap_put(&hash, &keys[i], NULL);
+    }
+    slot = cvs_hashmap_get_or_insert(&hash, &keys[CVSHM_SMALL_MAX - 1], NULL);
+    *slot = &keys[0];
+    cvs_hashmap_remove(&hash, &keys[1]);
+    CU_ASSERT(&keys[0] == cvs_hashmap_get(&hash, &keys[CVSHM_SMALL_MAX - 1]));
+    CU_ASSERT(slot != cvs_hashmap_get_or_insert(&hash, &keys[CVSHM_SMALL_MAX - 1], NULL));
+    slot = cvs_hashmap_get_or_insert(&hash, &keys[CVSHM_SMALL_MAX - 1], NULL);
+    *slot = &keys[2];
+    CU_ASSERT(&keys[2] == cvs_hashmap_get(&hash, &keys[CVSHM_SMALL_MAX - 1]));
+
+    slot = cvs_hashmap_get_or_insert(&hash, &keys[3], NULL);
+    *slot = &keys[3];
+    cvs_hashmap_put(&hash, &keys[1], NULL);
+    cvs_hashmap_put(&hash, &keys[CVSHM_SMALL_MAX], NULL);
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(false == st.small);
+    CU_ASSERT(&keys[3] == cvs_hashmap_get(&hash, &keys[3]));
+    CU_ASSERT(slot != cvs_hashmap_get_or_insert(&hash, &keys[3], NULL));
+    slot = cvs_hashmap_get_or_insert(&hash, &keys[3], NULL);
+    *slot = &keys[4];
+    CU_ASSERT(&keys[4] == cvs_hashmap_get(&hash, &keys[3]));
+    CU_ASSERT(&keys[2] == cvs_hashmap_get(&hash, &keys[CVSHM_SMALL_MAX - 1]));
+    cvs_hashmap_destroy(&hash);
+}
+
+
+void bloom_filter(void)
+{
+    cvs_hashmap_t hash;
+    cvs_hashmap_stats_t st;
+    uint64_t keys[20000];
+    char strings[3000][16];
+    double full_rate;
+    size_t i, round, misses;
+
+    /* Even keys are present, odd ones never were. */
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__UINT64, CHF__BLOOM_FILTER));
+    for (i = 0; i < 20000; i++) {
+        keys[i] = i;
+    }
+    for (i = 0; i < 20000; i += 2) {
+        cvs_hashmap_put(&hash, &keys[i], &keys[i]);
+    }
+    for (i = 0; i < 20000; i++) {
+        CU_ASSERT(((i & 1) ? NULL : &keys[i]) == cvs_hashmap_get(&hash, &keys[i]));
+    }
+    CU_ASSERT(NULL == hash.bloom_next);
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(0 < st.bloom_bytes);
+    CU_ASSERT(st.bloom_bytes < st.bytes);
+    CU_ASSERT(0.0 < st.bloom_false_positive_rate);
+    CU_ASSERT(st.bloom_false_positive_rate < 0.05);
+    full_rate = st.bloom_false_positive_rate;
+#ifdef CVSHM_COUNTERS
+    CU_ASSERT(10000 == st.counters.bloom_rejects + st.counters.bloom_false_positives);
+    CU_ASSERT(st.counters.bloom_false_positives < 500);
+#else
+    CU_ASSERT(0 == st.counters.bloom_rejects);
+#endif
+
+    /* Removing most keys starts a rebuild, the lookups that follow finish it
+     * and the emptier filter passes fewer absent keys. */
+    for (i = 0; i < 16000; i += 2) {
+        CU_ASSERT(&keys[i] == cvs_hashmap_remove(&hash, &keys[i]));
+    }
+    CU_ASSERT(NULL != hash.bloom_next);
+    for (i = 0; i < 20000; i++) {
+        CU_ASSERT(((i & 1) || (i < 16000) ? NULL : &keys[i]) == cvs_hashmap_get(&hash, &keys[i]));
+    }
+    CU_ASSERT(NULL == hash.bloom_next);
+    CU_ASSERT(true == cvs_hashmap_stats(&hash, &st));
+    CU_ASSERT(st.bloom_false_positive_rate < full_rate);
+    cvs_hashmap_destroy(&hash);
+    CU_ASSERT(NULL == hash.bloom);
+
+    /* Present keys are never rejected, through resizes, incremental rehashes
+     * and rebuilds started by removes. */
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__STRING,
+                                          CHF__BLOOM_FILTER | CHF__INCREMENTAL_REHASH));
+    for (round = 0; round < 3; round++) {
+        for (i = 0; i < 3000; i++) {
+            sprintf(strings[i], "device-%zu", i);
+            cvs_hashmap_put(&hash, strings[i], strings[i]);
+            CU_ASSERT(strings[i / 2] == cvs_hashmap_get(&hash, strings[i / 2]));
+        }
+        CU_ASSERT(3000 == cvs_hashmap_get_size(&hash));
+        misses = 0;
+        for (i = 0; i < 3000; i++) {
+            CU_ASSERT(strings[i] == cvs_hashmap_get(&hash, strings[i]));
+            if (NULL == cvs_hashmap_get(&hash, "no-such-device")) {
+                misses++;
+            }
+        }
+        CU_ASSERT(3000 == misses);
+
+        cvs_hashmap_iterate_ex(&hash, expire_all, NULL, NULL);
+        CU_ASSERT(true == cvs_hashmap_is_empty(&hash));
+        CU_ASSERT(NULL == cvs_hashmap_get(&hash, strings[0]));
+    }
+    cvs_hashmap_destroy(&hash);
+
+    /* Small integer maps get their filter when they move into buckets. */
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__UINT32, CHF__BLOOM_FILTER));
+    for (i = 0; i < CVSHM_SMALL_MAX; i++) {
+        uint32_t k = (uint32_t) i;
+
+        cvs_hashmap_put(&hash, &k, &keys[i]);
+    }
+    CU_ASSERT(NULL == hash.bloom);
+    for (i = CVSHM_SMALL_MAX; i < 100; i++) {
+        uint32_t k = (uint32_t) i;
+
+        cvs_hashmap_put(&hash, &k, &keys[i]);
+    }
+    CU_ASSERT(NULL != hash.bloom);
+    for (i = 0; i < 200; i++) {
+        uint32_t k = (uint32_t) i;
+
+        CU_ASSERT(((i < 100) ? &keys[i] : NULL) == cvs_hashmap_get(&hash, &k));
+    }
+    cvs_hashmap_destroy(&hash);
+}
+
+
+void clone_settle(void)
+{
+    cvs_hashmap_t hash, copy;
+    cvs_hashmap_blob_t blob;
+    uint64_t keys[5000];
+    char buffer[16];
+    size_t i;
+
+    CU_ASSERT(false == cvs_hashmap_clone(NULL, &hash));
+    CU_ASSERT(false == cvs_hashmap_clone(&copy, NULL));
+
+    /* Settling finishes an incremental rehash and a filter rebuild. */
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__UINT64,
+                                          CHF__INCREMENTAL_REHASH | CHF__BLOOM_FILTER));
+    for (i = 0; i < 5000; i++) {
+        keys[i] = i;
+        cvs_hashmap_put(&hash, &keys[i], &keys[i]);
+    }
+    for (i = 0; i < 4000; i++) {
+        cvs_hashmap_remove(&hash, &keys[i]);
+    }
+    CU_ASSERT(NULL != hash.bloom_next);
+    cvs_hashmap_settle(&hash);
+    CU_ASSERT(NULL == hash.old_buckets);
+    CU_ASSERT(NULL == hash.bloom_next);
+
+    /* The clone has the same flags and pairs, and changes to it are its own. */
+    CU_ASSERT(true == cvs_hashmap_clone(&copy, &hash));
+    CU_ASSERT(hash.flags == copy.flags);
+    CU_ASSERT(1000 == cvs_hashmap_get_size(&copy));
+    for (i = 0; i < 5000; i++) {
+        CU_ASSERT(cvs_hashmap_get(&hash, &keys[i]) == cvs_hashmap_get(&copy, &keys[i]));
+    }
+    cvs_hashmap_remove(&copy, &keys[4999]);
+    cvs_hashmap_put(&copy, &keys[0], &keys[0]);
+    CU_ASSERT(&keys[4999] == cvs_hashmap_get(&hash, &keys[4999]));
+    CU_ASSERT(NULL == cvs_hashmap_get(&hash, &keys[0]));
+    cvs_hashmap_destroy(&copy);
+    cvs_hashmap_destroy(&hash);
+
+    /* Owned and blob keys are copied, so the clone outlives the source. */
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__STRING, CHF__OWN_KEYS));
+    for (i = 0; i < 100; i++) {
+        sprintf(buffer, "key-%zu", i);
+        cvs_hashmap_put(&hash, buffer, &keys[i]);
+    }
+    CU_ASSERT(true == cvs_hashmap_clone(&copy, &hash));
+    cvs_hashmap_destroy(&hash);
+    CU_ASSERT(&keys[42] == cvs_hashmap_get(&copy, "key-42"));
+    cvs_hashmap_destroy(&copy);
+
+    CU_ASSERT(true == cvs_hashmap_init(&hash, CHT__BLOB));
+    blob.data = buffer;
+    blob.length = 8;
+    memset(buffer, 'x', sizeof(buffer));
+    cvs_hashmap_put(&hash, &blob, &keys[1]);
+    CU_ASSERT(true == cvs_hashmap_clone(&copy, &hash));
+    cvs_hashmap_destroy(&hash);
+    CU_ASSERT(&keys[1] == cvs_hashmap_get(&copy, &blob));
+    cvs_hashmap_destroy(&copy);
+
+    /* Small maps stay small. */
+    CU_ASSERT(true == cvs_hashmap_init(&hash, CHT__UINT32));
+    for (i = 0; i < 3; i++) {
+        uint32_t k = (uint32_t) i;
+
+        cvs_hashmap_put(&hash, &k, &keys[i]);
+    }
+    CU_ASSERT(true == cvs_hashmap_clone(&copy, &hash));
+    CU_ASSERT(NULL == copy.buckets);
+    for (i = 0; i < 3; i++) {
+        uint32_t k = (uint32_t) i;
+
+        CU_ASSERT(&keys[i] == cvs_hashmap_get(&copy, &k));
+    }
+    cvs_hashmap_destroy(&copy);
+    cvs_hashmap_destroy(&hash);
+}
+
 
 void add_hashmap_tests(CU_pSuite *suite)
 {
     CU_add_test(*suite, "hashmap string", simple_string);
     CU_add_test(*suite, "hashmap uint64_t", simple_uint64);
     CU_add_test(*suite, "hashmap Boundary tests ", boundary);
+    CU_add_test(*suite, "hashmap many keys", many_keys);
+    CU_add_test(*suite, "hashmap incremental rehash", incremental_rehash);
+    CU_add_test(*suite, "hashmap incremental rehash iterate", incremental_rehash_iterate);
+    CU_add_test(*suite, "hashmap batch get/put", batch_get_put);
+    CU_add_test(*suite, "hashmap fixed length byte keys", bytes_keys);
+    CU_add_test(*suite, "hashmap blob keys", blob_keys);
+    CU_add_test(*suite, "hashmap owned string keys", owned_keys);
+    CU_add_test(*suite, "hashmap stats", stats);
+    CU_add_test(*suite, "hashmap node reuse", node_reuse);
+    CU_add_test(*suite, "hashmap reserve", reserve);
+    CU_add_test(*suite, "hashmap init from arrays", init_from_arrays);
+    CU_add_test(*suite, "hashmap get or insert", get_or_insert);
+    CU_add_test(*suite, "hashmap iterate_ex", iterate_ex);
+    CU_add_test(*suite, "hashmap small maps", small_maps);
+    CU_add_test(*suite, "hashmap bloom filter", bloom_filter);
+    CU_add_test(*suite, "hashmap clone and settle", clone_settle);
 }
  
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include <stdbool.h>
+
+#include "../src/rebar-lru.h"
+#include "test_lru.h"
+#include "general.h"
+
+typedef struct {
+    size_t count;
+    uint64_t last;
+} evicted_t;
+
+static void evict_u64(void *key, void *value, void *user_data)
+{
+    evicted_t *evicted = (evicted_t*) user_data;
+
+    CU_ASSERT(*((uint64_t*) key) == (uintptr_t) value);
+    evicted->count++;
+    evicted->last = *((uint64_t*) key);
+}
+
+static void evict_string(void *key, void *value, void *user_data)
+{
+    CU_ASSERT(0 == strcmp((const char*) key, (const char*) value));
+    (*((size_t*) user_data))++;
+    free(value);
+}
+
+void lru_exact(void)
+{
+    rebar_lru_t lru;
+    evicted_t evicted;
+    uint64_t key;
+
+    CU_ASSERT(false == rebar_lru_init(NULL, CHT__UINT64, 3, REBAR_LRU__EXACT, NULL, NULL));
+    CU_ASSERT(false == rebar_lru_init(&lru, CHT__UINT64, 0, REBAR_LRU__EXACT, NULL, NULL));
+    CU_ASSERT(false == rebar_lru_init(&lru, CHT__BYTES, 3, REBAR_LRU__EXACT, NULL, NULL));
+
+    memset(&evicted, 0, sizeof(evicted));
+    CU_ASSERT(true == rebar_lru_init(&lru, CHT__UINT64, 3, REBAR_LRU__EXACT,
+                                     evict_u64, &evicted));
+    for (key = 1; key <= 3; key++) {
+        CU_ASSERT(NULL == rebar_lru_put(&lru, &key, (void*) (uintptr_t) key));
+    }
+    CU_ASSERT(3 == rebar_lru_get_size(&lru));
+    CU_ASSERT(0 == evicted.count);
+
+    /* 1 is used, so 2 is now the oldest. */
+    key = 1;
+    CU_ASSERT((void*) 1 == rebar_lru_get(&lru, &key));
+    key = 4;
+    CU_ASSERT(NULL == rebar_lru_put(&lru, &key, (void*) 4));
+    CU_ASSERT(1 == evicted.count);
+    CU_ASSERT(2 == evicted.last);
+    CU_ASSERT(3 == rebar_lru_get_size(&lru));
+    key = 2;
+    CU_ASSERT(NULL == rebar_lru_get(&lru, &key));
+
+    /* A peek does not count as a use, a put of an existing key does. */
+    key = 3;
+    CU_ASSERT((void*) 3 == rebar_lru_peek(&lru, &key));
+    key = 1;
+    CU_ASSERT((void*) 1 == rebar_lru_put(&lru, &key, (void*) 1));
+    key = 5;
+    rebar_lru_put(&lru, &key, (void*) 5);
+    CU_ASSERT(3 == evicted.last);
+    key = 6;
+    rebar_lru_put(&lru, &key, (void*) 6);
+    CU_ASSERT(4 == evicted.last);
+    CU_ASSERT(3 == evicted.count);
+
+    /* Removing does not evict. */
+    key = 1;
+    CU_ASSERT((void*) 1 == rebar_lru_remove(&lru, &key));
+    CU_ASSERT(NULL == rebar_lru_remove(&lru, &key));
+    CU_ASSERT(2 == rebar_lru_get_size(&lru));
+    key = 7;
+    rebar_lru_put(&lru, &key, (void*) 7);
+    CU_ASSERT(3 == evicted.count);
+
+    CU_ASSERT(NULL == rebar_lru_get(NULL, &key));
+    CU_ASSERT(NULL == rebar_lru_get(&lru, NULL));
+    CU_ASSERT(NULL == rebar_lru_put(&lru, NULL, NULL));
+    CU_ASSERT(NULL == rebar_lru_remove(NULL, &key));
+    CU_ASSERT(0 == rebar_lru_get_size(NULL));
+    rebar_lru_destroy(&lru);
+    rebar_lru_destroy(NULL);
+}
+
+void lru_clock(void)
+{
+    rebar_lru_t lru;
+    evicted_t evicted;
+    uint64_t key;
+
+    memset(&evicted, 0, sizeof(evicted));
+    CU_ASSERT(true == rebar_lru_init(&lru, CHT__UINT64, 4, REBAR_LRU__CLOCK,
+                                     evict_u64, &evicted));
+    for (key = 1; key <= 4; key++) {
+        rebar_lru_put(&lru, &key, (void*) (uintptr_t) key);
+    }
+
+    /* 1 and 2 get a second chance, 3 is the first unreferenced entry. */
+    key = 1;
+    CU_ASSERT((void*) 1 == rebar_lru_get(&lru, &key));
+    key = 2;
+    CU_ASSERT((void*) 2 == rebar_lru_get(&lru, &key));
+    key = 5;
+    rebar_lru_put(&lru, &key, (void*) 5);
+    CU_ASSERT(3 == evicted.last);
+    key = 6;
+    rebar_lru_put(&lru, &key, (void*) 6);
+    CU_ASSERT(4 == evicted.last);
+
+    /* Their marks were cleared, so they are next. */
+    key = 7;
+    rebar_lru_put(&lru, &key, (void*) 7);
+    CU_ASSERT(1 == evicted.last);
+
+    /* With every entry referenced the oldest still goes. */
+    for (key = 2; key <= 7; key++) {
+        rebar_lru_get(&lru, &key);
+    }
+    key = 8;
+    rebar_lru_put(&lru, &key, (void*) 8);
+    CU_ASSERT(2 == evicted.last);
+    CU_ASSERT(4 == evicted.count);
+    CU_ASSERT(4 == rebar_lru_get_size(&lru));
+
+    rebar_lru_destroy(&lru);
+}
+
+void lru_key_types(void)
+{
+    rebar_lru_t lru;
+    cvs_hashmap_blob_t blob;
+    char buffer[32];
+    uint8_t mac[6] = { 0, 1, 2, 3, 4, 5 };
+    size_t i, evicted;
+    uint32_t u32;
+
+    /* String keys are copied, the buffer is reused for every put. */
+    evicted = 0;
+    CU_ASSERT(true == rebar_lru_init(&lru, CHT__STRING, 10, REBAR_LRU__EXACT,
+                                     evict_string, &evicted));
+    for (i = 0; i < 25; i++) {
+        char *value = (char*) malloc(16);
+
+        sprintf(buffer, "device-%zu", i);
+        strcpy(value, buffer);
+        free(rebar_lru_put(&lru, buffer, value));
+    }
+    CU_ASSERT(15 == evicted);
+    CU_ASSERT(NULL == rebar_lru_get(&lru, "device-14"));
+    CU_ASSERT(0 == strcmp("device-15", (char*) rebar_lru_get(&lru, "device-15")));
+    for (i = 15; i < 25; i++) {
+        sprintf(buffer, "device-%zu", i);
+        free(rebar_lru_remove(&lru, buffer));
+    }
+    CU_ASSERT(0 == rebar_lru_get_size(&lru));
+    rebar_lru_destroy(&lru);
+
+    CU_ASSERT(false == rebar_lru_init_bytes(&lru, 0, 2, REBAR_LRU__EXACT, NULL, NULL));
+    CU_ASSERT(true == rebar_lru_init_bytes(&lru, sizeof(mac), 2, REBAR_LRU__CLOCK, NULL, NULL));
+    for (i = 0; i < 3; i++) {
+        mac[5] = (uint8_t) i;
+        rebar_lru_put(&lru, mac, (void*) (i + 1));
+    }
+    mac[5] = 0;
+    CU_ASSERT(NULL == rebar_lru_get(&lru, mac));
+    mac[5] = 2;
+    CU_ASSERT((void*) 3 == rebar_lru_get(&lru, mac));
+    rebar_lru_destroy(&lru);
+
+    CU_ASSERT(true == rebar_lru_init(&lru, CHT__BLOB, 2, REBAR_LRU__EXACT, NULL, NULL));
+    for (i = 0; i < 3; i++) {
+        memset(buffer, 'a' + (int) i, sizeof(buffer));
+        blob.data = buffer;
+        blob.length = 20 + i;
+        rebar_lru_put(&lru, &blob, (void*) (i + 1));
+    }
+    memset(buffer, 'b', sizeof(buffer));
+    blob.length = 21;
+    CU_ASSERT((void*) 2 == rebar_lru_get(&lru, &blob));
+    memset(buffer, 'a', sizeof(buffer));
+    blob.length = 20;
+    CU_ASSERT(NULL == rebar_lru_get(&lru, &blob));
+    rebar_lru_destroy(&lru);
+
+    CU_ASSERT(true == rebar_lru_init(&lru, CHT__UINT32, 1, REBAR_LRU__EXACT, NULL, NULL));
+    u32 = 9;
+    rebar_lru_put(&lru, &u32, (void*) 9);
+    u32 = 10;
+    rebar_lru_put(&lru, &u32, (void*) 10);
+    CU_ASSERT((void*) 10 == rebar_lru_get(&lru, &u32));
+    u32 = 9;
+    CU_ASSERT(NULL == rebar_lru_get(&lru, &u32));
+    rebar_lru_destroy(&lru);
+}
+
+
+void add_lru_tests(CU_pSuite *suite)
+{
+    CU_add_test(*suite, "lru exact", lru_exact);
+    CU_add_test(*suite, "lru clock", lru_clock);
+    CU_add_test(*suite, "lru key types", lru_key_types);
+}
@@ -0,0 +1,129 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include <stdbool.h>
+
+#include "../src/rebar-hashmap.h"
+#include "test_rebar_hashmap.h"
+#include "general.h"
+
+typedef struct {
+    uint32_t hits;
+    uint64_t bytes;
+} counters_t;
+
+REBAR_HASHMAP_DEFINE(u64map, uint64_t, uint64_t, rebar_hash_u64, REBAR_HASHMAP_EQ)
+REBAR_HASHMAP_DEFINE(strmap, const char*, counters_t, rebar_hashmap_hash_string,
+                     rebar_hashmap_eq_string)
+
+static bool sum_values(uint64_t *key, uint64_t *value, void *user_data)
+{
+    CU_ASSERT(*key * 3 == *value);
+    *((uint64_t*) user_data) += *value;
+    return true;
+}
+
+static bool stop_at_first(const char **key, counters_t *value, void *user_data)
+{
+    (void) key;
+    (void) value;
+    (*((size_t*) user_data))++;
+    return false;
+}
+
+void rebar_hashmap_u64(void)
+{
+    u64map_t map;
+    uint64_t key, value, sum;
+
+    CU_ASSERT(false == u64map_init(NULL));
+    CU_ASSERT(NULL == u64map_get(NULL, 1));
+    CU_ASSERT(true == u64map_init(&map));
+    CU_ASSERT(true == u64map_is_empty(&map));
+    CU_ASSERT(NULL == u64map_get(&map, 1));
+    CU_ASSERT(false == u64map_remove(&map, 1, NULL));
+
+    /* Key 0 is a key like any other. */
+    for (key = 0; key < 10000; key++) {
+        CU_ASSERT(true == u64map_put(&map, key, key * 3));
+    }
+    CU_ASSERT(10000 == u64map_get_size(&map));
+    for (key = 0; key < 10000; key++) {
+        uint64_t *v = u64map_get(&map, key);
+
+        CU_ASSERT(NULL != v);
+        CU_ASSERT((NULL != v) && (key * 3 == *v));
+    }
+    CU_ASSERT(false == u64map_contains_key(&map, 10000));
+
+    sum = 0;
+    u64map_iterate(&map, sum_values, &sum);
+    CU_ASSERT(3 * (9999 * 10000 / 2) == sum);
+
+    /* Remove the odd keys, then churn so the deleted slots get reused. */
+    for (key = 1; key < 10000; key += 2) {
+        CU_ASSERT(true == u64map_remove(&map, key, &value));
+        CU_ASSERT(key * 3 == value);
+    }
+    CU_ASSERT(5000 == u64map_get_size(&map));
+    for (key = 100000; key < 200000; key++) {
+        u64map_put(&map, key, key * 3);
+        u64map_remove(&map, key, NULL);
+    }
+    CU_ASSERT(5000 == u64map_get_size(&map));
+    CU_ASSERT(map.used < map.mask + 1);
+    for (key = 0; key < 10000; key++) {
+        CU_ASSERT(((0 == key % 2) ? true : false) == u64map_contains_key(&map, key));
+    }
+
+    u64map_destroy(&map);
+    CU_ASSERT(0 == u64map_get_size(&map));
+    u64map_destroy(&map);
+}
+
+void rebar_hashmap_strings(void)
+{
+    strmap_t map;
+    counters_t *c;
+    const char *words[] = { "alpha", "beta", "gamma", "beta", "alpha", "beta", NULL };
+    char buffer[16];
+    bool inserted;
+    size_t i, calls;
+
+    CU_ASSERT(true == strmap_init(&map));
+    CU_ASSERT(true == strmap_reserve(&map, 100));
+    CU_ASSERT(127 < map.mask);
+    for (i = 0; NULL != words[i]; i++) {
+        c = strmap_get_or_insert(&map, words[i], &inserted);
+        CU_ASSERT(inserted == (i < 3));
+        c->hits++;
+        c->bytes += strlen(words[i]);
+    }
+    CU_ASSERT(3 == strmap_get_size(&map));
+
+    /* Lookups compare the strings, not the pointers. */
+    strcpy(buffer, "beta");
+    c = strmap_get(&map, buffer);
+    CU_ASSERT((NULL != c) && (3 == c->hits) && (12 == c->bytes));
+    strcpy(buffer, "delta");
+    CU_ASSERT(NULL == strmap_get(&map, buffer));
+
+    calls = 0;
+    strmap_iterate(&map, stop_at_first, &calls);
+    CU_ASSERT(1 == calls);
+
+    CU_ASSERT(true == strmap_remove(&map, "alpha", NULL));
+    CU_ASSERT(false == strmap_contains_key(&map, "alpha"));
+    CU_ASSERT(2 == strmap_get_size(&map));
+
+    strmap_destroy(&map);
+}
+
+
+void add_rebar_hashmap_tests(CU_pSuite *suite)
+{
+    CU_add_test(*suite, "rebar hashmap u64", rebar_hashmap_u64);
+    CU_add_test(*suite, "rebar hashmap strings", rebar_hashmap_strings);
+}
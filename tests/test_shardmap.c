@@ -0,0 +1,163 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <CUnit/Basic.h>
+#include <stdbool.h>
+
+#include "../src/cvs-shardmap.h"
+#include "test_shardmap.h"
+#include "general.h"
+
+#define SENDERS         4
+#define SENDER_KEYS     2000
+
+typedef struct {
+    cvs_shardmap_t *map;
+    size_t shard;
+    uint64_t first;
+} sender_t;
+
+static void count_deleted(void *key, void *value, void *user_data)
+{
+    (void) key;
+    (void) value;
+
+    /* The senders remove keys of their own shards, so the deleter runs on
+     * several threads at once. */
+    __atomic_fetch_add((size_t*) user_data, 1, __ATOMIC_RELAXED);
+}
+
+static void *send_keys(void *data)
+{
+    sender_t *sender = (sender_t*) data;
+    uint64_t key;
+
+    /* Every key is put, and every third one removed again. */
+    for (key = sender->first; key < sender->first + SENDER_KEYS; key++) {
+        cvs_shardmap_put(sender->map, sender->shard, &key, (void*) (uintptr_t) (key + 1));
+        if (0 == key % 3) {
+            cvs_shardmap_remove(sender->map, sender->shard, &key);
+        }
+    }
+
+    return NULL;
+}
+
+void shard_strings(void)
+{
+    cvs_shardmap_t map;
+    char key[16];
+    size_t i, shard, deleted, total;
+
+    CU_ASSERT(false == cvs_shardmap_init(NULL, CHT__STRING, CHF__NONE, 4, NULL, NULL));
+    CU_ASSERT(false == cvs_shardmap_init(&map, CHT__STRING, CHF__NONE, 0, NULL, NULL));
+    CU_ASSERT(false == cvs_shardmap_init(&map, CHT__BLOB, CHF__NONE, 4, NULL, NULL));
+
+    deleted = 0;
+    CU_ASSERT(true == cvs_shardmap_init(&map, CHT__STRING, CHF__NONE, 4, count_deleted, &deleted));
+
+    /* Sent from outside the shards, nothing lands until a drain. */
+    for (i = 0; i < 100; i++) {
+        sprintf(key, "key-%zu", i);
+        CU_ASSERT(true == cvs_shardmap_put(&map, CVSSM_NO_SHARD, key, (void*) (i + 1)));
+        CU_ASSERT(map.shard_count > cvs_shardmap_route(&map, key));
+    }
+    strcpy(key, "key-1");
+    shard = cvs_shardmap_route(&map, key);
+    CU_ASSERT(NULL == cvs_shardmap_get(&map, shard, key));
+
+    total = 0;
+    for (i = 0; i < 4; i++) {
+        total += cvs_shardmap_drain(&map, i);
+        CU_ASSERT(0 == cvs_shardmap_drain(&map, i));
+    }
+    CU_ASSERT(100 == total);
+
+    /* The key buffer was reused, so every key must have been copied. */
+    total = 0;
+    for (i = 0; i < 100; i++) {
+        sprintf(key, "key-%zu", i);
+        shard = cvs_shardmap_route(&map, key);
+        CU_ASSERT((void*) (i + 1) == cvs_shardmap_get(&map, shard, key));
+        CU_ASSERT(NULL == cvs_shardmap_get(&map, (shard + 1) % 4, key));
+    }
+    for (i = 0; i < 4; i++) {
+        total += cvs_hashmap_get_size(cvs_shardmap_local(&map, i));
+    }
+    CU_ASSERT(100 == total);
+
+    /* The owner's own changes apply right away. */
+    strcpy(key, "key-5");
+    shard = cvs_shardmap_route(&map, key);
+    CU_ASSERT(true == cvs_shardmap_put(&map, shard, key, (void*) 99));
+    CU_ASSERT(1 == deleted);
+    CU_ASSERT((void*) 99 == cvs_shardmap_get(&map, shard, key));
+    CU_ASSERT(true == cvs_shardmap_remove(&map, shard, key));
+    CU_ASSERT(2 == deleted);
+    CU_ASSERT(NULL == cvs_shardmap_get(&map, shard, key));
+
+    /* Undrained changes are dropped by destroy, which hands the values of
+     * the dropped puts to the deleter unless the shard already holds them. */
+    CU_ASSERT(true == cvs_shardmap_remove(&map, CVSSM_NO_SHARD, "key-6"));
+    CU_ASSERT(true == cvs_shardmap_put(&map, CVSSM_NO_SHARD, "key-7", NULL));
+    CU_ASSERT(true == cvs_shardmap_put(&map, CVSSM_NO_SHARD, "key-8", (void*) 100));
+    CU_ASSERT(true == cvs_shardmap_put(&map, CVSSM_NO_SHARD, "key-9", (void*) 10));
+    cvs_shardmap_destroy(&map);
+    CU_ASSERT(3 == deleted);
+    cvs_shardmap_destroy(&map);
+}
+
+void shard_threads(void)
+{
+    cvs_shardmap_t map;
+    sender_t senders[SENDERS];
+    pthread_t threads[SENDERS];
+    uint64_t key;
+    size_t i, total, deleted;
+
+    deleted = 0;
+    CU_ASSERT(true == cvs_shardmap_init(&map, CHT__UINT64, CHF__NONE, SENDERS,
+                                        count_deleted, &deleted));
+    for (i = 0; i < SENDERS; i++) {
+        senders[i].map = &map;
+        senders[i].shard = i;
+        senders[i].first = i * SENDER_KEYS;
+        pthread_create(&threads[i], NULL, send_keys, &senders[i]);
+    }
+    for (i = 0; i < SENDERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    /* The remove of a key always follows its put from the same sender. */
+    for (i = 0; i < SENDERS; i++) {
+        cvs_shardmap_drain(&map, i);
+    }
+    total = 0;
+    for (i = 0; i < SENDERS; i++) {
+        total += cvs_hashmap_get_size(cvs_shardmap_local(&map, i));
+    }
+    CU_ASSERT(SENDERS * SENDER_KEYS - (SENDERS * SENDER_KEYS + 2) / 3 == total);
+    CU_ASSERT((SENDERS * SENDER_KEYS + 2) / 3 == deleted);
+
+    for (key = 0; key < SENDERS * SENDER_KEYS; key++) {
+        void *expect = (0 == key % 3) ? NULL : (void*) (uintptr_t) (key + 1);
+
+        CU_ASSERT(expect == cvs_shardmap_get(&map, cvs_shardmap_route(&map, &key), &key));
+    }
+
+    CU_ASSERT(CVSSM_NO_SHARD == cvs_shardmap_route(&map, NULL));
+    CU_ASSERT(NULL == cvs_shardmap_local(&map, SENDERS));
+    CU_ASSERT(0 == cvs_shardmap_drain(&map, SENDERS));
+    CU_ASSERT(false == cvs_shardmap_put(&map, 0, NULL, NULL));
+    CU_ASSERT(false == cvs_shardmap_remove(NULL, 0, &key));
+    cvs_shardmap_destroy(&map);
+}
+
+
+void add_shardmap_tests(CU_pSuite *suite)
+{
+    CU_add_test(*suite, "shardmap string", shard_strings);
+    CU_add_test(*suite, "shardmap threads", shard_threads);
+}
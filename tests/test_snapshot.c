@@ -0,0 +1,199 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <CUnit/Basic.h>
+#include <stdbool.h>
+
+#include "../src/cvs-snapshot.h"
+#include "test_snapshot.h"
+#include "general.h"
+
+typedef struct {
+    uint64_t id;
+    uint32_t flags;
+} snap_value_t;
+
+static bool snap_serializer(void *key, void *value, const void **data,
+                            size_t *length, void *user_data)
+{
+    IGNORE_UNUSED(key);
+    (*((int*) user_data))++;
+    *data = value;
+    *length = sizeof(snap_value_t);
+
+    return true;
+}
+
+static bool snap_failing_serializer(void *key, void *value, const void **data,
+                                    size_t *length, void *user_data)
+{
+    IGNORE_UNUSED(key);
+    IGNORE_UNUSED(value);
+    IGNORE_UNUSED(data);
+    IGNORE_UNUSED(length);
+    IGNORE_UNUSED(user_data);
+
+    return false;
+}
+
+static void snap_path(char *path, size_t size)
+{
+    int fd;
+
+    snprintf(path, size, "/tmp/rebar-snapshot-XXXXXX");
+    fd = mkstemp(path);
+    CU_ASSERT_FATAL(0 <= fd);
+    close(fd);
+}
+
+void snapshot_strings(void)
+{
+    cvs_hashmap_t hash;
+    cvs_snapshot_t snap;
+    char path[64];
+    char keys[1000][16];
+    char values[1000][16];
+    size_t length;
+    int i;
+
+    snap_path(path, sizeof(path));
+
+    CU_ASSERT(true == cvs_hashmap_init(&hash, CHT__STRING));
+    for (i = 0; i < 1000; i++) {
+        sprintf(keys[i], "device-%d", i);
+        sprintf(values[i], "v%d", i * 3);
+        cvs_hashmap_put(&hash, keys[i], values[i]);
+    }
+    CU_ASSERT(true == cvs_snapshot_save(&hash, path, NULL, NULL));
+    cvs_hashmap_destroy(&hash);
+
+    CU_ASSERT_FATAL(true == cvs_snapshot_open(&snap, path));
+    CU_ASSERT(true == cvs_snapshot_verify(&snap));
+    CU_ASSERT(1000 == cvs_snapshot_get_size(&snap));
+
+    for (i = 0; i < 1000; i++) {
+        char key[16], value[16];
+        const char *got;
+
+        sprintf(key, "device-%d", i);
+        sprintf(value, "v%d", i * 3);
+        got = (const char*) cvs_snapshot_get(&snap, key, &length);
+        CU_ASSERT_FATAL(NULL != got);
+        CU_ASSERT(0 == strcmp(value, got));
+        CU_ASSERT(strlen(value) + 1 == length);
+    }
+    CU_ASSERT(NULL  == cvs_snapshot_get(&snap, "device-1000", NULL));
+    CU_ASSERT(NULL  == cvs_snapshot_get(&snap, "device-", NULL));
+    CU_ASSERT(false == cvs_snapshot_contains_key(&snap, "nothing"));
+    CU_ASSERT(true  == cvs_snapshot_contains_key(&snap, "device-999"));
+
+    cvs_snapshot_close(&snap);
+    CU_ASSERT(NULL == cvs_snapshot_get(&snap, "device-1", NULL));
+    unlink(path);
+}
+
+void snapshot_uint64_structs(void)
+{
+    cvs_hashmap_t hash;
+    cvs_snapshot_t snap;
+    char path[64];
+    uint64_t keys[500];
+    snap_value_t values[500];
+    const snap_value_t *got;
+    size_t length;
+    int calls, i;
+
+    snap_path(path, sizeof(path));
+
+    CU_ASSERT(true == cvs_hashmap_init(&hash, CHT__UINT64));
+    for (i = 0; i < 500; i++) {
+        keys[i] = (uint64_t) i << 40;
+        values[i].id = keys[i] + 1;
+        values[i].flags = (uint32_t) i;
+        cvs_hashmap_put(&hash, &keys[i], &values[i]);
+    }
+
+    CU_ASSERT(false == cvs_snapshot_save(&hash, path, snap_failing_serializer, NULL));
+    calls = 0;
+    CU_ASSERT(true == cvs_snapshot_save(&hash, path, snap_serializer, &calls));
+    CU_ASSERT(500 == calls);
+    cvs_hashmap_destroy(&hash);
+
+    CU_ASSERT_FATAL(true == cvs_snapshot_open(&snap, path));
+    for (i = 0; i < 500; i++) {
+        uint64_t key = (uint64_t) i << 40;
+
+        got = (const snap_value_t*) cvs_snapshot_get(&snap, &key, &length);
+        CU_ASSERT_FATAL(NULL != got);
+        CU_ASSERT(0 == ((uintptr_t) got & 7));
+        CU_ASSERT(sizeof(snap_value_t) == length);
+        CU_ASSERT(key + 1 == got->id);
+        CU_ASSERT((uint32_t) i == got->flags);
+    }
+    cvs_snapshot_close(&snap);
+    unlink(path);
+}
+
+void snapshot_damaged(void)
+{
+    cvs_hashmap_t hash;
+    cvs_snapshot_t snap;
+    cvs_hashmap_blob_t key;
+    char path[64];
+    FILE *f;
+    long size;
+    int c;
+
+    snap_path(path, sizeof(path));
+
+    CU_ASSERT(false == cvs_snapshot_open(&snap, "/nonexistent/snapshot"));
+    CU_ASSERT(false == cvs_snapshot_open(&snap, path));     /* empty file */
+    CU_ASSERT(false == cvs_snapshot_save(NULL, path, NULL, NULL));
+    CU_ASSERT(false == cvs_snapshot_verify(NULL));
+    cvs_snapshot_close(NULL);
+
+    CU_ASSERT(true == cvs_hashmap_init_ex(&hash, CHT__BLOB, CHF__NONE));
+    key.data = "abcdef";
+    key.length = 3;
+    cvs_hashmap_put(&hash, &key, "abc");
+    key.length = 6;
+    cvs_hashmap_put(&hash, &key, "abcdef");
+    CU_ASSERT(true == cvs_snapshot_save(&hash, path, NULL, NULL));
+    cvs_hashmap_destroy(&hash);
+
+    CU_ASSERT_FATAL(true == cvs_snapshot_open(&snap, path));
+    key.length = 3;
+    CU_ASSERT(0 == strcmp("abc", (const char*) cvs_snapshot_get(&snap, &key, NULL)));
+    key.length = 4;
+    CU_ASSERT(NULL == cvs_snapshot_get(&snap, &key, NULL));
+    cvs_snapshot_close(&snap);
+
+    /* Flip the last byte: the file opens, the checksum catches it. */
+    f = fopen(path, "r+b");
+    CU_ASSERT_FATAL(NULL != f);
+    fseek(f, -1, SEEK_END);
+    size = ftell(f) + 1;
+    c = fgetc(f);
+    fseek(f, -1, SEEK_END);
+    fputc(c ^ 0xff, f);
+    fclose(f);
+    CU_ASSERT_FATAL(true == cvs_snapshot_open(&snap, path));
+    CU_ASSERT(false == cvs_snapshot_verify(&snap));
+    cvs_snapshot_close(&snap);
+
+    /* A truncated file does not open at all. */
+    CU_ASSERT(0 == truncate(path, size - 8));
+    CU_ASSERT(false == cvs_snapshot_open(&snap, path));
+
+    unlink(path);
+}
+
+
+void add_snapshot_tests(CU_pSuite *suite)
+{
+    CU_add_test(*suite, "snapshot string keys", snapshot_strings);
+    CU_add_test(*suite, "snapshot uint64_t keys", snapshot_uint64_structs);
+    CU_add_test(*suite, "snapshot damaged files", snapshot_damaged);
+}
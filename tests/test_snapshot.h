@@ -0,0 +1,17 @@
+#ifndef __TEST_SNAPSHOT_H__
+#define __TEST_SNAPSHOT_H__
+
+
+#include <CUnit/Basic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void add_snapshot_tests(CU_pSuite *suite);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,272 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include <stdbool.h>
+
+#include "../src/cvs-ttlmap.h"
+#include "test_ttlmap.h"
+#include "general.h"
+
+#define RANDOM_KEYS     2000
+
+typedef struct {
+    size_t count;
+    uint64_t last;
+} expired_t;
+
+typedef struct {
+    uint64_t *deadlines;        /* 0 once expired or removed */
+    uint64_t from;              /* the tick advanced from */
+    uint64_t to;                /* the tick advanced to */
+    size_t count;
+} reference_t;
+
+static void expire_u64(void *key, void *value, void *user_data)
+{
+    expired_t *expired = (expired_t*) user_data;
+
+    CU_ASSERT(*((uint64_t*) key) == (uintptr_t) value);
+    expired->count++;
+    expired->last = *((uint64_t*) key);
+}
+
+static void expire_string(void *key, void *value, void *user_data)
+{
+    CU_ASSERT(0 == strcmp((const char*) key, (const char*) value));
+    (*((size_t*) user_data))++;
+    free(value);
+}
+
+static void expire_checked(void *key, void *value, void *user_data)
+{
+    reference_t *ref = (reference_t*) user_data;
+    uint32_t k = *((uint32_t*) key);
+
+    CU_ASSERT((uintptr_t) value == k + 1);
+    CU_ASSERT(ref->from < ref->deadlines[k]);
+    CU_ASSERT(ref->deadlines[k] <= ref->to);
+    ref->deadlines[k] = 0;
+    ref->count++;
+}
+
+static uint64_t __xorshift(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+void ttlmap_basic(void)
+{
+    cvs_ttlmap_t ttlmap;
+    expired_t expired;
+    uint64_t key;
+
+    CU_ASSERT(false == cvs_ttlmap_init(NULL, CHT__UINT64, 0, NULL, NULL));
+    CU_ASSERT(false == cvs_ttlmap_init(&ttlmap, CHT__BYTES, 0, NULL, NULL));
+
+    memset(&expired, 0, sizeof(expired));
+    CU_ASSERT(true == cvs_ttlmap_init(&ttlmap, CHT__UINT64, 1000, expire_u64, &expired));
+    for (key = 1; key <= 5; key++) {
+        CU_ASSERT(NULL == cvs_ttlmap_put(&ttlmap, &key, (void*) (uintptr_t) key, key * 10));
+    }
+    CU_ASSERT(5 == cvs_ttlmap_get_size(&ttlmap));
+
+    /* Due at 1010, so it is still there at 1009. */
+    CU_ASSERT(0 == cvs_ttlmap_advance(&ttlmap, 1009));
+    CU_ASSERT(1 == cvs_ttlmap_advance(&ttlmap, 1010));
+    CU_ASSERT(1 == expired.last);
+    key = 1;
+    CU_ASSERT(NULL == cvs_ttlmap_get(&ttlmap, &key));
+
+    /* Going back in time does nothing. */
+    CU_ASSERT(0 == cvs_ttlmap_advance(&ttlmap, 5));
+
+    /* Refreshing and putting both move the deadline to now + ttl. */
+    key = 2;
+    CU_ASSERT(true == cvs_ttlmap_refresh(&ttlmap, &key, 100));
+    key = 3;
+    CU_ASSERT((void*) 3 == cvs_ttlmap_put(&ttlmap, &key, (void*) 3, 200));
+    key = 9;
+    CU_ASSERT(false == cvs_ttlmap_refresh(&ttlmap, &key, 100));
+    CU_ASSERT(2 == cvs_ttlmap_advance(&ttlmap, 1050));
+    CU_ASSERT(5 == expired.last);
+    CU_ASSERT(1 == cvs_ttlmap_advance(&ttlmap, 1110));
+    CU_ASSERT(2 == expired.last);
+
+    /* Removing does not expire, a ttl of 0 is the next tick. */
+    key = 3;
+    CU_ASSERT((void*) 3 == cvs_ttlmap_remove(&ttlmap, &key));
+    CU_ASSERT(NULL == cvs_ttlmap_remove(&ttlmap, &key));
+    key = 7;
+    cvs_ttlmap_put(&ttlmap, &key, (void*) 7, 0);
+    CU_ASSERT((void*) 7 == cvs_ttlmap_get(&ttlmap, &key));
+    CU_ASSERT(1 == cvs_ttlmap_advance(&ttlmap, 1111));
+    CU_ASSERT(5 == expired.count);
+    CU_ASSERT(0 == cvs_ttlmap_get_size(&ttlmap));
+
+    cvs_ttlmap_destroy(&ttlmap);
+}
+
+void ttlmap_levels(void)
+{
+    cvs_ttlmap_t ttlmap;
+    expired_t expired;
+    uint64_t ttls[] = { 255, 256, 65535, 65536, 70000, 1ULL << 24,
+                        (1ULL << 32) - 1, 1ULL << 32, 5ULL << 32, 0 };
+    uint64_t key;
+
+    memset(&expired, 0, sizeof(expired));
+    CU_ASSERT(true == cvs_ttlmap_init(&ttlmap, CHT__UINT64, 17, expire_u64, &expired));
+    for (key = 0; 0 != ttls[key]; key++) {
+        cvs_ttlmap_put(&ttlmap, &key, (void*) (uintptr_t) key, ttls[key]);
+    }
+
+    /* Each deadline is found exactly, whatever level it started in, and the
+     * far ones are placed again on the way. */
+    for (key = 0; 0 != ttls[key]; key++) {
+        CU_ASSERT(0 == cvs_ttlmap_advance(&ttlmap, 17 + ttls[key] - 1));
+        CU_ASSERT(1 == cvs_ttlmap_advance(&ttlmap, 17 + ttls[key]));
+        CU_ASSERT(key == expired.last);
+    }
+    CU_ASSERT(0 == cvs_ttlmap_get_size(&ttlmap));
+
+    /* A deadline past the end of time is kept, and freed by destroy. */
+    key = 1;
+    cvs_ttlmap_put(&ttlmap, &key, (void*) 1, UINT64_MAX);
+    CU_ASSERT(0 == cvs_ttlmap_advance(&ttlmap, 1ULL << 40));
+    CU_ASSERT((void*) 1 == cvs_ttlmap_get(&ttlmap, &key));
+
+    cvs_ttlmap_destroy(&ttlmap);
+}
+
+void ttlmap_random(void)
+{
+    cvs_ttlmap_t ttlmap;
+    reference_t ref;
+    uint64_t state, now;
+    uint32_t k;
+    size_t round, expected;
+
+    ref.deadlines = (uint64_t*) calloc(RANDOM_KEYS, sizeof(uint64_t));
+    ref.count = 0;
+    state = 88172645463325252ULL;
+    now = 123456;
+
+    CU_ASSERT(true == cvs_ttlmap_init(&ttlmap, CHT__UINT32, now, expire_checked, &ref));
+    for (round = 0; round < 400; round++) {
+        size_t i;
+
+        for (i = 0; i < 50; i++) {
+            uint64_t r = __xorshift(&state);
+            uint64_t ttl;
+
+            k = (uint32_t) (r % RANDOM_KEYS);
+            switch( (r >> 16) % 4 ) {
+                case 0: ttl = 1 + (r >> 20) % 300; break;
+                case 1: ttl = 1 + (r >> 20) % 70000; break;
+                case 2: ttl = 1 + (r >> 20) % 20000000; break;
+                default: ttl = 1 + (r >> 20) % 800; break;
+            }
+
+            if (0 == (r >> 40) % 10) {
+                CU_ASSERT((0 != ref.deadlines[k]) ==
+                          (NULL != cvs_ttlmap_remove(&ttlmap, &k)));
+                ref.deadlines[k] = 0;
+            } else if (0 == (r >> 40) % 3) {
+                CU_ASSERT((0 != ref.deadlines[k]) ==
+                          cvs_ttlmap_refresh(&ttlmap, &k, ttl));
+                if (0 != ref.deadlines[k]) {
+                    ref.deadlines[k] = now + ttl;
+                }
+            } else {
+                cvs_ttlmap_put(&ttlmap, &k, (void*) (uintptr_t) (k + 1), ttl);
+                ref.deadlines[k] = now + ttl;
+            }
+        }
+
+        /* Mostly short steps, sometimes a long jump. */
+        ref.from = now;
+        now += (0 == round % 37) ? (__xorshift(&state) % 5000000) : (__xorshift(&state) % 400);
+        ref.to = now;
+        cvs_ttlmap_advance(&ttlmap, now);
+
+        expected = 0;
+        for (k = 0; k < RANDOM_KEYS; k++) {
+            CU_ASSERT((0 == ref.deadlines[k] || now < ref.deadlines[k]));
+            CU_ASSERT((0 != ref.deadlines[k]) == (NULL != cvs_ttlmap_get(&ttlmap, &k)));
+            if (0 != ref.deadlines[k]) {
+                expected++;
+            }
+        }
+        CU_ASSERT(expected == cvs_ttlmap_get_size(&ttlmap));
+    }
+    CU_ASSERT(0 < ref.count);
+
+    cvs_ttlmap_destroy(&ttlmap);
+    free(ref.deadlines);
+}
+
+void ttlmap_key_types(void)
+{
+    cvs_ttlmap_t ttlmap;
+    cvs_hashmap_blob_t blob;
+    char buffer[32];
+    uint8_t mac[6] = { 0, 1, 2, 3, 4, 5 };
+    size_t i, expired;
+
+    /* String keys are copied, the buffer is reused for every put. */
+    expired = 0;
+    CU_ASSERT(true == cvs_ttlmap_init(&ttlmap, CHT__STRING, 0, expire_string, &expired));
+    for (i = 0; i < 20; i++) {
+        char *value = (char*) malloc(16);
+
+        sprintf(buffer, "session-%zu", i);
+        strcpy(value, buffer);
+        cvs_ttlmap_put(&ttlmap, buffer, value, 10 + i);
+    }
+    CU_ASSERT(10 == cvs_ttlmap_advance(&ttlmap, 19));
+    CU_ASSERT(10 == expired);
+    CU_ASSERT(NULL == cvs_ttlmap_get(&ttlmap, "session-9"));
+    CU_ASSERT(0 == strcmp("session-10", (char*) cvs_ttlmap_get(&ttlmap, "session-10")));
+    free(cvs_ttlmap_remove(&ttlmap, "session-10"));
+    CU_ASSERT(9 == cvs_ttlmap_advance(&ttlmap, 1000));
+    CU_ASSERT(19 == expired);
+    cvs_ttlmap_destroy(&ttlmap);
+
+    CU_ASSERT(false == cvs_ttlmap_init_bytes(&ttlmap, 0, 0, NULL, NULL));
+    CU_ASSERT(true == cvs_ttlmap_init_bytes(&ttlmap, sizeof(mac), 0, NULL, NULL));
+    for (i = 0; i < 3; i++) {
+        mac[5] = (uint8_t) i;
+        cvs_ttlmap_put(&ttlmap, mac, (void*) (i + 1), 5 * (i + 1));
+    }
+    CU_ASSERT(2 == cvs_ttlmap_advance(&ttlmap, 10));
+    mac[5] = 2;
+    CU_ASSERT((void*) 3 == cvs_ttlmap_get(&ttlmap, mac));
+    cvs_ttlmap_destroy(&ttlmap);
+
+    /* Entries still in the wheel are freed by destroy. */
+    CU_ASSERT(true == cvs_ttlmap_init(&ttlmap, CHT__BLOB, 0, NULL, NULL));
+    for (i = 0; i < 3; i++) {
+        memset(buffer, 'a' + (int) i, sizeof(buffer));
+        blob.data = buffer;
+        blob.length = 20 + i;
+        cvs_ttlmap_put(&ttlmap, &blob, (void*) (i + 1), 1000000);
+    }
+    memset(buffer, 'b', sizeof(buffer));
+    blob.length = 21;
+    CU_ASSERT((void*) 2 == cvs_ttlmap_get(&ttlmap, &blob));
+    cvs_ttlmap_destroy(&ttlmap);
+}
+
+
+void add_ttlmap_tests(CU_pSuite *suite)
+{
+    CU_add_test(*suite, "ttlmap basic", ttlmap_basic);
+    CU_add_test(*suite, "ttlmap levels", ttlmap_levels);
+    CU_add_test(*suite, "ttlmap random", ttlmap_random);
+    CU_add_test(*suite, "ttlmap key types", ttlmap_key_types);
+}